@@ -0,0 +1,205 @@
+#include "base64.h"
+#include <fmt/format.h>
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define IGGY_HAVE_X86_SIMD 1
+#endif
+
+namespace {
+const char ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/// @brief Marks bytes outside the base64 alphabet in the decoding table.
+const uint8_t INVALID = 0xff;
+
+constexpr std::array<uint8_t, 256> makeDecodingTable() {
+    std::array<uint8_t, 256> table = {};
+    for (auto& entry : table) {
+        entry = INVALID;
+    }
+    for (uint8_t i = 0; i < 64; i++) {
+        table[static_cast<unsigned char>(ALPHABET[i])] = i;
+    }
+    return table;
+}
+
+constexpr std::array<uint8_t, 256> DECODING_TABLE = makeDecodingTable();
+
+[[noreturn]] void throwInvalid(std::string_view encoded, size_t pos) {
+    throw std::runtime_error(fmt::format("Invalid base64 character {:#04x} at offset {}", static_cast<unsigned char>(encoded[pos]), pos));
+}
+
+using TripleEncoder = size_t (*)(const unsigned char* data, size_t pos, size_t length, char* out);
+
+/**
+ * @brief Encodes the whole three-byte groups from pos onwards, returning where the leftover bytes start.
+ *
+ * pos must be a multiple of three; the group starting at pos is written to out + pos / 3 * 4.
+ */
+size_t encodeTriplesScalar(const unsigned char* data, size_t pos, size_t length, char* out) {
+    out += pos / 3 * 4;
+    for (; pos + 3 <= length; pos += 3) {
+        uint32_t bits = (static_cast<uint32_t>(data[pos]) << 16) | (static_cast<uint32_t>(data[pos + 1]) << 8) | data[pos + 2];
+        out[0] = ALPHABET[bits >> 18];
+        out[1] = ALPHABET[(bits >> 12) & 0x3f];
+        out[2] = ALPHABET[(bits >> 6) & 0x3f];
+        out[3] = ALPHABET[bits & 0x3f];
+        out += 4;
+    }
+    return pos;
+}
+
+#if defined(IGGY_HAVE_X86_SIMD)
+/*
+ * The vector encoders follow Wojciech Muła's SSSE3 algorithm: a byte shuffle spreads each three input bytes over a 32-bit
+ * lane, two multiplies move the four 6-bit indices into separate bytes, and a 16-entry shuffle table maps each index range
+ * to the offset that turns it into its ASCII character.
+ */
+
+__attribute__((target("ssse3"))) __m128i lookupSsse3(__m128i indices) {
+    // 0..25 -> 13 ('A'), 26..51 -> 0 ('a'), 52..61 -> 1..10 ('0'), 62 -> 11 ('+') and 63 -> 12 ('/')
+    __m128i offsetIndex = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    __m128i isUpper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    offsetIndex = _mm_or_si128(offsetIndex, _mm_and_si128(isUpper, _mm_set1_epi8(13)));
+    const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    return _mm_add_epi8(indices, _mm_shuffle_epi8(offsets, offsetIndex));
+}
+
+__attribute__((target("ssse3"))) size_t encodeTriplesSsse3(const unsigned char* data, size_t pos, size_t length, char* out) {
+    const __m128i spread = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+    // each iteration encodes 12 bytes but loads 16, so it stops while the load still fits in the input
+    for (; pos + 16 <= length; pos += 12) {
+        __m128i in = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos)), spread);
+        __m128i high = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+        __m128i low = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + pos / 3 * 4), lookupSsse3(_mm_or_si128(high, low)));
+    }
+    return encodeTriplesScalar(data, pos, length, out);
+}
+
+__attribute__((target("avx2"))) __m256i lookupAvx2(__m256i indices) {
+    __m256i offsetIndex = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+    __m256i isUpper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+    offsetIndex = _mm256_or_si256(offsetIndex, _mm256_and_si256(isUpper, _mm256_set1_epi8(13)));
+    const __m256i offsets = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                             '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0, 'a' - 26, '0' - 52, '0' - 52, '0' - 52,
+                                             '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A',
+                                             0, 0);
+    return _mm256_add_epi8(indices, _mm256_shuffle_epi8(offsets, offsetIndex));
+}
+
+__attribute__((target("avx2"))) size_t encodeTriplesAvx2(const unsigned char* data, size_t pos, size_t length, char* out) {
+    const __m256i spread = _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1, 10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1,
+                                           2, 0, 1);
+    // the shuffle cannot cross 128-bit lanes, so each lane gets its own 12 input bytes
+    for (; pos + 28 <= length; pos += 24) {
+        __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + 12));
+        __m256i in = _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(first), second, 1), spread);
+        __m256i high = _mm256_mulhi_epu16(_mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00)), _mm256_set1_epi32(0x04000040));
+        __m256i low = _mm256_mullo_epi16(_mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0)), _mm256_set1_epi32(0x01000010));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + pos / 3 * 4), lookupAvx2(_mm256_or_si256(high, low)));
+    }
+    return encodeTriplesSsse3(data, pos, length, out);
+}
+#endif
+
+/// @brief Picks the widest encoder the CPU supports.
+TripleEncoder selectTripleEncoder() {
+#if defined(IGGY_HAVE_X86_SIMD)
+    if (__builtin_cpu_supports("avx2")) {
+        return encodeTriplesAvx2;
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        return encodeTriplesSsse3;
+    }
+#endif
+    return encodeTriplesScalar;
+}
+}  // namespace
+
+size_t iggy::serialization::base64::encodedLength(size_t length) {
+    return (length + 2) / 3 * 4;
+}
+
+void iggy::serialization::base64::encode(const unsigned char* data, size_t length, char* out) {
+    static const TripleEncoder encodeTriples = selectTripleEncoder();
+    size_t pos = encodeTriples(data, 0, length, out);
+
+    // one or two bytes left over make a final quantum padded with '='
+    out += pos / 3 * 4;
+    if (pos + 1 == length) {
+        out[0] = ALPHABET[data[pos] >> 2];
+        out[1] = ALPHABET[(data[pos] & 0x03) << 4];
+        out[2] = '=';
+        out[3] = '=';
+    } else if (pos + 2 == length) {
+        out[0] = ALPHABET[data[pos] >> 2];
+        out[1] = ALPHABET[((data[pos] & 0x03) << 4) | (data[pos + 1] >> 4)];
+        out[2] = ALPHABET[(data[pos + 1] & 0x0f) << 2];
+        out[3] = '=';
+    }
+}
+
+size_t iggy::serialization::base64::decodedLength(std::string_view encoded) {
+    if (encoded.size() % 4 != 0) {
+        throw std::runtime_error(fmt::format("Invalid base64 length {}", encoded.size()));
+    }
+    size_t padding = 0;
+    if (!encoded.empty() && encoded.back() == '=') {
+        padding = encoded[encoded.size() - 2] == '=' ? 2 : 1;
+    }
+    return encoded.size() / 4 * 3 - padding;
+}
+
+void iggy::serialization::base64::decode(std::string_view encoded, unsigned char* out) {
+    size_t length = decodedLength(encoded);
+    if (length == 0) {
+        return;
+    }
+
+    // every quantum but the last is four alphabet characters; OR-ing the table entries catches any invalid one at once
+    size_t fullQuanta = (encoded.size() - 4) / 4;
+    auto data = reinterpret_cast<const unsigned char*>(encoded.data());
+    for (size_t q = 0; q < fullQuanta; q++) {
+        uint8_t a = DECODING_TABLE[data[4 * q]];
+        uint8_t b = DECODING_TABLE[data[4 * q + 1]];
+        uint8_t c = DECODING_TABLE[data[4 * q + 2]];
+        uint8_t d = DECODING_TABLE[data[4 * q + 3]];
+        if ((a | b | c | d) & 0xc0) {
+            for (size_t pos = 4 * q;; pos++) {
+                if (DECODING_TABLE[data[pos]] == INVALID) {
+                    throwInvalid(encoded, pos);
+                }
+            }
+        }
+        uint32_t bits = (static_cast<uint32_t>(a) << 18) | (static_cast<uint32_t>(b) << 12) | (static_cast<uint32_t>(c) << 6) | d;
+        out[0] = static_cast<unsigned char>(bits >> 16);
+        out[1] = static_cast<unsigned char>(bits >> 8);
+        out[2] = static_cast<unsigned char>(bits);
+        out += 3;
+    }
+
+    // the last quantum may end in one or two padding characters, which decode to nothing
+    size_t last = encoded.size() - 4;
+    size_t remaining = length - fullQuanta * 3;
+    uint32_t bits = 0;
+    for (size_t i = 0; i < 4; i++) {
+        uint8_t value = 0;
+        if (i <= remaining) {
+            value = DECODING_TABLE[data[last + i]];
+            if (value == INVALID) {
+                throwInvalid(encoded, last + i);
+            }
+        } else if (data[last + i] != '=') {
+            throwInvalid(encoded, last + i);
+        }
+        bits = (bits << 6) | value;
+    }
+    for (size_t i = 0; i < remaining; i++) {
+        out[i] = static_cast<unsigned char>(bits >> (16 - 8 * i));
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace iggy {
+namespace serialization {
+
+/**
+ * @namespace base64
+ * @brief Standard padded base64 (RFC 4648), which the HTTP REST API uses for message payloads and header values.
+ */
+namespace base64 {
+
+/**
+ * @brief Gets the number of characters that length bytes encode to, padding included.
+ */
+size_t encodedLength(size_t length);
+
+/**
+ * @brief Encodes length bytes into out, which must have room for @ref encodedLength characters.
+ *
+ * Uses AVX2 or SSSE3 when the CPU has them, encoding 24 or 12 bytes per step, and a scalar loop otherwise.
+ */
+void encode(const unsigned char* data, size_t length, char* out);
+
+/**
+ * @brief Gets the exact number of bytes that encoded decodes to.
+ * @throws std::runtime_error if the length is not a multiple of four.
+ */
+size_t decodedLength(std::string_view encoded);
+
+/**
+ * @brief Decodes into out, which must have room for @ref decodedLength bytes.
+ * @throws std::runtime_error if the input is not valid padded base64.
+ */
+void decode(std::string_view encoded, unsigned char* out);
+
+}  // namespace base64
+}  // namespace serialization
+}  // namespace iggy
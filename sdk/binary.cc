@@ -0,0 +1,515 @@
+#include "binary.h"
+#include <fmt/format.h>
+#include <algorithm>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+namespace {
+/// @brief Encoded size of a polled message with no headers and an empty payload.
+const size_t MIN_POLLED_MESSAGE_SIZE = 45;
+
+float readFloat32(iggy::serialization::ByteReader& in) {
+    uint32_t bits = in.readLittleEndian<uint32_t>();
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+std::string readString(iggy::serialization::ByteReader& in, size_t length) {
+    auto bytes = in.take(length);
+    return iggy::serialization::convertToUTF8(std::string(bytes.begin(), bytes.end()), false);
+}
+
+template <typename T>
+void writeLittleEndian(iggy::serialization::ByteWriter& out, T value) {
+    out.writeLittleEndian(value);
+}
+
+template <typename T>
+void writeLittleEndian(iggy::serialization::binary::GatherBuffer& out, T value) {
+    unsigned char bytes[sizeof(T)];
+    for (size_t i = 0; i < sizeof(T); i++) {
+        bytes[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+    out.append(bytes, sizeof(T));
+}
+
+void writeBytes(iggy::serialization::ByteWriter& out, const unsigned char* data, size_t length) {
+    out.writeBytes(data, length);
+}
+
+void writeBytes(iggy::serialization::binary::GatherBuffer& out, const unsigned char* data, size_t length) {
+    out.append(data, length);
+}
+
+/// @brief Encoded size of a run of fixed-width fields, known at compile time.
+template <typename... Fields>
+constexpr size_t FIXED_SIZE = (sizeof(Fields) + ... + 0);
+
+/// @brief Encoded size of a consumer: its kind and numeric id.
+constexpr size_t CONSUMER_SIZE = FIXED_SIZE<uint8_t, uint32_t>;
+
+/// @brief Encoded size of a sent message's fixed fields: its id and the lengths of its headers block and payload.
+constexpr size_t SEND_MESSAGE_FIXED_SIZE = FIXED_SIZE<uint128_t, uint32_t, uint32_t>;
+
+size_t identifierSize(const iggy::model::shared::Identifier& id) {
+    return FIXED_SIZE<uint8_t, uint8_t> + id.getLength();
+}
+
+size_t shortStringSize(const std::string& value) {
+    return FIXED_SIZE<uint8_t> + value.size();
+}
+
+template <typename Out>
+void writeIdentifier(Out& out, const iggy::model::shared::Identifier& id) {
+    auto value = id.getValue();
+    writeLittleEndian<uint8_t>(out, static_cast<uint8_t>(id.getKind()));
+    writeLittleEndian<uint8_t>(out, static_cast<uint8_t>(value.size()));
+    writeBytes(out, value.data(), value.size());
+}
+
+void writeConsumer(iggy::serialization::ByteWriter& out, iggy::model::shared::Consumer consumer) {
+    out.writeLittleEndian<uint8_t>(static_cast<uint8_t>(consumer.getKind()));
+    out.writeLittleEndian<uint32_t>(consumer.getId());
+}
+
+/**
+ * @brief Encodes the stream and topic identifiers that lead most topic-scoped commands, first reserving room for them and
+ * for trailingSize bytes of fixed-width fields that the caller writes after them.
+ */
+template <typename Command>
+void writeTopicScope(iggy::serialization::ByteWriter& out, const Command& value, size_t trailingSize) {
+    const auto& streamId = value.getStreamId();
+    const auto& topicId = value.getTopicId();
+    out.reserve(identifierSize(streamId) + identifierSize(topicId) + trailingSize);
+    writeIdentifier(out, streamId);
+    writeIdentifier(out, topicId);
+}
+
+/**
+ * @brief Gets the numeric value of an identifier for the commands whose wire format has a plain u32 id in its place.
+ */
+uint32_t numericId(const iggy::model::shared::Identifier& id, const char* fieldName) {
+    if (!id.isNumeric()) {
+        throw std::invalid_argument(fmt::format("The {} must be a numeric identifier", fieldName));
+    }
+    return id.getNumericValue();
+}
+
+/**
+ * @brief Checks that a message headers block is well-formed so that MessageView can walk it later without bounds checks.
+ */
+void validateHeaders(std::span<const unsigned char> headers) {
+    iggy::serialization::ByteReader reader(headers);
+    while (!reader.atEnd()) {
+        reader.take(reader.readLittleEndian<uint32_t>());
+        reader.readLittleEndian<uint8_t>();
+        reader.take(reader.readLittleEndian<uint32_t>());
+    }
+}
+
+size_t headersSize(const iggy::model::message::Headers& headers) {
+    size_t size = 0;
+    for (const auto& [key, value] : headers) {
+        size += iggy::serialization::HEADER_ENTRY_OVERHEAD + key.size() + value.getValue().size();
+    }
+    return size;
+}
+
+void writeHeaders(iggy::serialization::binary::GatherBuffer& out, const iggy::model::message::Headers& headers, size_t blockSize) {
+    writeLittleEndian<uint32_t>(out, static_cast<uint32_t>(blockSize));
+    for (const auto& [key, value] : headers) {
+        auto bytes = value.getValue();
+        writeLittleEndian<uint32_t>(out, static_cast<uint32_t>(key.size()));
+        out.append(reinterpret_cast<const unsigned char*>(key.data()), key.size());
+        writeLittleEndian<uint8_t>(out, static_cast<uint8_t>(value.getKind()));
+        writeLittleEndian<uint32_t>(out, static_cast<uint32_t>(bytes.size()));
+        out.append(bytes.data(), bytes.size());
+    }
+}
+
+void writeShortString(iggy::serialization::ByteWriter& out, const std::string& value, const char* fieldName) {
+    if (value.empty() || value.size() > UINT8_MAX) {
+        throw std::invalid_argument(fmt::format("The {} must be between 1 and {} bytes long", fieldName, UINT8_MAX));
+    }
+    out.writeLittleEndian<uint8_t>(static_cast<uint8_t>(value.size()));
+    out.writeBytes(reinterpret_cast<const unsigned char*>(value.data()), value.size());
+}
+}  // namespace
+
+iggy::serialization::binary::GatherBuffer::GatherBuffer(std::vector<unsigned char> bytes)
+    : owned(std::move(bytes))
+    , totalSize(owned.size()) {
+    if (!this->owned.empty()) {
+        this->segments.push_back({nullptr, 0, this->owned.size()});
+    }
+}
+
+void iggy::serialization::binary::GatherBuffer::reserve(size_t ownedBytes, size_t segmentCount) {
+    this->owned.reserve(this->owned.size() + ownedBytes);
+    this->segments.reserve(this->segments.size() + segmentCount);
+}
+
+void iggy::serialization::binary::GatherBuffer::append(const unsigned char* data, size_t length) {
+    if (length == 0) {
+        return;
+    }
+    if (!this->segments.empty() && !this->segments.back().external) {
+        this->segments.back().length += length;
+    } else {
+        this->segments.push_back({nullptr, this->owned.size(), length});
+    }
+    this->owned.insert(this->owned.end(), data, data + length);
+    this->totalSize += length;
+}
+
+void iggy::serialization::binary::GatherBuffer::appendReference(const unsigned char* data, size_t length) {
+    if (length < REFERENCE_THRESHOLD) {
+        this->append(data, length);
+        return;
+    }
+    this->segments.push_back({data, 0, length});
+    this->totalSize += length;
+}
+
+std::vector<unsigned char> iggy::serialization::binary::GatherBuffer::flatten() const {
+    std::vector<unsigned char> bytes;
+    bytes.reserve(this->totalSize);
+    this->forEachSegment([&bytes](const unsigned char* data, size_t length) { bytes.insert(bytes.end(), data, data + length); });
+    return bytes;
+}
+
+template <>
+iggy::model::system::Stats iggy::serialization::binary::BinaryWireFormat::read<iggy::model::system::Stats>(ByteReader& in) const {
+    auto processId = static_cast<pid_t>(in.readLittleEndian<uint32_t>());
+    auto cpuUsage = readFloat32(in);
+    auto memoryUsage = in.readLittleEndian<uint64_t>();
+    auto totalMemory = in.readLittleEndian<uint64_t>();
+    auto availableMemory = in.readLittleEndian<uint64_t>();
+    auto runTime = in.readLittleEndian<uint64_t>();
+    auto startTime = in.readLittleEndian<uint64_t>();
+    auto readBytes = in.readLittleEndian<uint64_t>();
+    auto writtenBytes = in.readLittleEndian<uint64_t>();
+    auto messagesSizeBytes = in.readLittleEndian<uint64_t>();
+    auto streamsCount = in.readLittleEndian<uint32_t>();
+    auto topicsCount = in.readLittleEndian<uint32_t>();
+    auto partitionsCount = in.readLittleEndian<uint32_t>();
+    auto segmentsCount = in.readLittleEndian<uint32_t>();
+    auto messagesCount = in.readLittleEndian<uint64_t>();
+    auto clientsCount = in.readLittleEndian<uint32_t>();
+    auto consumerGroupsCount = in.readLittleEndian<uint32_t>();
+    auto hostname = readString(in, in.readLittleEndian<uint32_t>());
+    auto osName = readString(in, in.readLittleEndian<uint32_t>());
+    auto osVersion = readString(in, in.readLittleEndian<uint32_t>());
+    auto kernelVersion = readString(in, in.readLittleEndian<uint32_t>());
+
+    return iggy::model::system::Stats(processId, cpuUsage, memoryUsage, totalMemory, availableMemory, runTime, startTime, readBytes,
+                                      writtenBytes, messagesSizeBytes, streamsCount, topicsCount, partitionsCount, segmentsCount,
+                                      messagesCount, clientsCount, consumerGroupsCount, hostname, osName, osVersion, kernelVersion);
+}
+
+template <>
+iggy::model::message::PolledMessagesView iggy::serialization::binary::BinaryWireFormat::read<iggy::model::message::PolledMessagesView>(
+    std::shared_ptr<const std::vector<unsigned char>> payload) const {
+    iggy::serialization::ByteReader reader(*payload);
+    auto partitionId = reader.readLittleEndian<uint32_t>();
+    auto currentOffset = reader.readLittleEndian<uint64_t>();
+    auto count = reader.readLittleEndian<uint32_t>();
+
+    // never trust the count for the reservation; the smallest possible message bounds it by the payload size instead
+    std::vector<iggy::model::message::MessageView> messages;
+    messages.reserve(std::min<size_t>(count, payload->size() / MIN_POLLED_MESSAGE_SIZE));
+    for (uint32_t i = 0; i < count; i++) {
+        auto offset = reader.readLittleEndian<uint64_t>();
+        auto state = static_cast<iggy::model::message::MessageState>(reader.readLittleEndian<uint8_t>());
+        auto timestamp = reader.readLittleEndian<uint64_t>();
+        auto id = reader.readLittleEndian<uint128_t>();
+        auto checksum = reader.readLittleEndian<uint32_t>();
+        auto headers = reader.take(reader.readLittleEndian<uint32_t>());
+        validateHeaders(headers);
+        auto body = reader.take(reader.readLittleEndian<uint32_t>());
+        messages.emplace_back(offset, state, timestamp, id, checksum, headers, body);
+
+        // checked here rather than on access, while the payload that was just sliced off is still in cache
+        if (this->verifyChecksums) {
+            iggy::serialization::verifyChecksum(messages.back());
+        }
+    }
+    return iggy::model::message::PolledMessagesView(std::move(payload), partitionId, currentOffset, std::move(messages));
+}
+
+template <>
+iggy::model::message::PolledMessages iggy::serialization::binary::BinaryWireFormat::read<iggy::model::message::PolledMessages>(
+    ByteReader& in) const {
+    auto rest = in.take(in.remaining());
+    auto payload = std::make_shared<std::vector<unsigned char>>(rest.begin(), rest.end());
+    return this->read<iggy::model::message::PolledMessagesView>(std::move(payload)).toPolledMessages();
+}
+
+
+template <>
+void iggy::serialization::binary::BinaryWireFormat::write<iggy::command::system::Ping>(ByteWriter&,
+                                                                                      const iggy::command::system::Ping&) const {}
+
+template <>
+void iggy::serialization::binary::BinaryWireFormat::write<iggy::command::system::GetStats>(ByteWriter&,
+                                                                                          const iggy::command::system::GetStats&) const {}
+
+template <>
+void iggy::serialization::binary::BinaryWireFormat::write<iggy::command::system::GetMe>(ByteWriter&,
+                                                                                       const iggy::command::system::GetMe&) const {}
+
+template <>
+void iggy::serialization::binary::BinaryWireFormat::write<iggy::command::system::GetClient>(
+    ByteWriter& out,
+    const iggy::command::system::GetClient& value) const {
+    out.reserve(FIXED_SIZE<uint32_t>);
+    out.writeLittleEndian<uint32_t>(value.getClientId());
+}
+
+template <>
+void iggy::serialization::binary::BinaryWireFormat::write<iggy::command::system::GetClients>(
+    ByteWriter&,
+    const iggy::command::system::GetClients&) const {}
+
+template <>
+void iggy::serialization::binary::BinaryWireFormat::write<iggy::command::user::LoginUser>(ByteWriter& out,
+                                                                                         const iggy::command::user::LoginUser& value) const {
+    const auto& username = value.getUsername();
+    const auto& password = value.getPassword();
+    out.reserve(shortStringSize(username) + shortStringSize(password) + FIXED_SIZE<uint32_t, uint32_t>);
+    writeShortString(out, username, "username");
+    writeShortString(out, password, "password");
+
+    // optional client version and login context, both sent as empty
+    out.writeLittleEndian<uint32_t>(0);
+    out.writeLittleEndian<uint32_t>(0);
+}
+
+template <>
+void iggy::serialization::binary::BinaryWireFormat::write<iggy::command::stream::GetStream>(
+    ByteWriter& out,
+    const iggy::command::stream::GetStream& value) const {
+    const auto& streamId = value.getStreamId();
+    out.reserve(identifierSize(streamId));
+    writeIdentifier(out, streamId);
+}
+
+template <>
+void iggy::serialization::binary::BinaryWireFormat::write<iggy::command::stream::GetStreams>(
+    ByteWriter&,
+    const iggy::command::stream::GetStreams&) const {}
+
+template <>
+void iggy::serialization::binary::BinaryWireFormat::write<iggy::command::stream::CreateStream>(
+    ByteWriter& out,
+    const iggy::command::stream::CreateStream& value) const {
+    auto streamId = numericId(value.getStreamId(), "stream ID");
+    const auto& name = value.getName();
+    out.reserve(FIXED_SIZE<uint32_t> + shortStringSize(name));
+    out.writeLittleEndian<uint32_t>(streamId);
+    writeShortString(out, name, "stream name");
+}
+
+template <>
+void iggy::serialization::binary::BinaryWireFormat::write<iggy::command::stream::DeleteStream>(
+    ByteWriter& out,
+    const iggy::command::stream::DeleteStream& value) const {
+    const auto& streamId = value.getStreamId();
+    out.reserve(identifierSize(streamId));
+    writeIdentifier(out, streamId);
+}
+
+template <>
+void iggy::serialization::binary::BinaryWireFormat::write<iggy::command::topic::GetTopic>(
+    ByteWriter& out,
+    const iggy::command::topic::GetTopic& value) const {
+    writeTopicScope(out, value, 0);
+}
+
+template <>
+void iggy::serialization::binary::BinaryWireFormat::write<iggy::command::topic::GetTopics>(
+    ByteWriter& out,
+    const iggy::command::topic::GetTopics& value) const {
+    const auto& streamId = value.getStreamId();
+    out.reserve(identifierSize(streamId));
+    writeIdentifier(out, streamId);
+}
+
+template <>
+void iggy::serialization::binary::BinaryWireFormat::write<iggy::command::topic::CreateTopic>(
+    ByteWriter& out,
+    const iggy::command::topic::CreateTopic& value) const {
+    const auto& streamId = value.getStreamId();
+    const auto& name = value.getName();
+    out.reserve(identifierSize(streamId) + FIXED_SIZE<uint32_t, uint32_t, uint32_t> + shortStringSize(name));
+    writeIdentifier(out, streamId);
+    out.writeLittleEndian<uint32_t>(value.getTopicId());
+    out.writeLittleEndian<uint32_t>(value.getPartitionsCount());
+
+    // zero means the messages never expire
+    out.writeLittleEndian<uint32_t>(value.getMessageExpiry().value_or(0));
+    writeShortString(out, name, "topic name");
+}
+
+template <>
+void iggy::serialization::binary::BinaryWireFormat::write<iggy::command::partition::CreatePartitions>(
+    ByteWriter& out,
+    const iggy::command::partition::CreatePartitions& value) const {
+    writeTopicScope(out, value, FIXED_SIZE<uint32_t>);
+    out.writeLittleEndian<uint32_t>(value.getPartitionsCount());
+}
+
+template <>
+void iggy::serialization::binary::BinaryWireFormat::write<iggy::command::partition::DeletePartitions>(
+    ByteWriter& out,
+    const iggy::command::partition::DeletePartitions& value) const {
+    writeTopicScope(out, value, FIXED_SIZE<uint32_t>);
+    out.writeLittleEndian<uint32_t>(value.getPartitionsCount());
+}
+
+template <>
+void iggy::serialization::binary::BinaryWireFormat::write<iggy::command::message::PollMessages>(
+    ByteWriter& out,
+    const iggy::command::message::PollMessages& value) const {
+    const auto& streamId = value.getStreamId();
+    const auto& topicId = value.getTopicId();
+    out.reserve(CONSUMER_SIZE + identifierSize(streamId) + identifierSize(topicId) +
+                FIXED_SIZE<uint32_t, uint8_t, uint64_t, uint32_t, uint8_t>);
+    writeConsumer(out, value.getConsumer());
+    writeIdentifier(out, streamId);
+    writeIdentifier(out, topicId);
+    out.writeLittleEndian<uint32_t>(value.getPartitionId());
+    auto strategy = value.getStrategy();
+    out.writeLittleEndian<uint8_t>(static_cast<uint8_t>(strategy.getKind()));
+    out.writeLittleEndian<uint64_t>(strategy.getValue());
+    out.writeLittleEndian<uint32_t>(value.getCount());
+    out.writeLittleEndian<uint8_t>(value.getAutoCommit() ? 1 : 0);
+}
+
+template <>
+void iggy::serialization::binary::BinaryWireFormat::write<iggy::command::message::SendMessages>(
+    GatherBuffer& out,
+    const iggy::command::message::SendMessages& value) const {
+    const auto& messages = value.getMessages();
+    if (messages.empty()) {
+        throw std::invalid_argument("At least one message must be sent");
+    }
+    const auto& streamId = value.getStreamId();
+    const auto& topicId = value.getTopicId();
+    const auto& partitioning = value.getPartitioning();
+    const auto& partitionKey = partitioning.getValue();
+
+    // size the copied bytes and the iovecs in one pass, so neither the owned buffer nor the segment list ever grows
+    size_t ownedBytes = identifierSize(streamId) + identifierSize(topicId) + FIXED_SIZE<uint8_t, uint8_t> + partitionKey.size();
+    size_t segmentCount = 1;
+    std::vector<size_t> headerSizes;
+    headerSizes.reserve(messages.size());
+    for (const auto& message : messages) {
+        if (this->verifyChecksums) {
+            iggy::serialization::verifyChecksum(message);
+        }
+        headerSizes.push_back(headersSize(message.getHeaders()));
+        ownedBytes += SEND_MESSAGE_FIXED_SIZE + headerSizes.back();
+        if (message.getPayload().size() < GatherBuffer::REFERENCE_THRESHOLD) {
+            ownedBytes += message.getPayload().size();
+        } else {
+            segmentCount += 2;
+        }
+    }
+    out.reserve(ownedBytes, segmentCount);
+
+    writeIdentifier(out, streamId);
+    writeIdentifier(out, topicId);
+    writeLittleEndian<uint8_t>(out, static_cast<uint8_t>(partitioning.getKind()));
+    writeLittleEndian<uint8_t>(out, static_cast<uint8_t>(partitionKey.size()));
+    out.append(partitionKey.data(), partitionKey.size());
+
+    for (size_t i = 0; i < messages.size(); i++) {
+        const auto& message = messages[i];
+        auto payload = message.getPayload();
+        writeLittleEndian<uint64_t>(out, static_cast<uint64_t>(message.getId()));
+        writeLittleEndian<uint64_t>(out, static_cast<uint64_t>(message.getId() >> 64));
+        writeHeaders(out, message.getHeaders(), headerSizes[i]);
+        writeLittleEndian<uint32_t>(out, static_cast<uint32_t>(payload.size()));
+
+        // the payload is by far the largest part of the frame, so it is gathered from the message rather than copied
+        out.appendReference(payload.data(), payload.size());
+    }
+}
+
+template <>
+void iggy::serialization::binary::BinaryWireFormat::write<iggy::command::consumeroffset::GetConsumerOffset>(
+    ByteWriter& out,
+    const iggy::command::consumeroffset::GetConsumerOffset& value) const {
+    const auto& streamId = value.getStreamId();
+    const auto& topicId = value.getTopicId();
+    out.reserve(CONSUMER_SIZE + identifierSize(streamId) + identifierSize(topicId) + FIXED_SIZE<uint32_t>);
+    writeConsumer(out, value.getConsumer());
+    writeIdentifier(out, streamId);
+    writeIdentifier(out, topicId);
+    out.writeLittleEndian<uint32_t>(value.getPartitionId());
+}
+
+template <>
+void iggy::serialization::binary::BinaryWireFormat::write<iggy::command::consumeroffset::StoreConsumerOffset>(
+    ByteWriter& out,
+    const iggy::command::consumeroffset::StoreConsumerOffset& value) const {
+    const auto& streamId = value.getStreamId();
+    const auto& topicId = value.getTopicId();
+    out.reserve(CONSUMER_SIZE + identifierSize(streamId) + identifierSize(topicId) + FIXED_SIZE<uint32_t, uint64_t>);
+    writeConsumer(out, value.getConsumer());
+    writeIdentifier(out, streamId);
+    writeIdentifier(out, topicId);
+    out.writeLittleEndian<uint32_t>(value.getPartitionId());
+    out.writeLittleEndian<uint64_t>(value.getOffset());
+}
+
+template <>
+void iggy::serialization::binary::BinaryWireFormat::write<iggy::command::consumergroup::GetConsumerGroup>(
+    ByteWriter& out,
+    const iggy::command::consumergroup::GetConsumerGroup& value) const {
+    writeTopicScope(out, value, FIXED_SIZE<uint32_t>);
+    out.writeLittleEndian<uint32_t>(value.getConsumerGroupId());
+}
+
+template <>
+void iggy::serialization::binary::BinaryWireFormat::write<iggy::command::consumergroup::GetConsumerGroups>(
+    ByteWriter& out,
+    const iggy::command::consumergroup::GetConsumerGroups& value) const {
+    writeTopicScope(out, value, 0);
+}
+
+template <>
+void iggy::serialization::binary::BinaryWireFormat::write<iggy::command::consumergroup::CreateConsumerGroup>(
+    ByteWriter& out,
+    const iggy::command::consumergroup::CreateConsumerGroup& value) const {
+    writeTopicScope(out, value, FIXED_SIZE<uint32_t>);
+    out.writeLittleEndian<uint32_t>(value.getConsumerGroupId());
+}
+
+template <>
+void iggy::serialization::binary::BinaryWireFormat::write<iggy::command::consumergroup::DeleteConsumerGroup>(
+    ByteWriter& out,
+    const iggy::command::consumergroup::DeleteConsumerGroup& value) const {
+    writeTopicScope(out, value, FIXED_SIZE<uint32_t>);
+    out.writeLittleEndian<uint32_t>(value.getConsumerGroupId());
+}
+
+template <>
+void iggy::serialization::binary::BinaryWireFormat::write<iggy::command::consumergroup::JoinConsumerGroup>(
+    ByteWriter& out,
+    const iggy::command::consumergroup::JoinConsumerGroup& value) const {
+    writeTopicScope(out, value, FIXED_SIZE<uint32_t>);
+    out.writeLittleEndian<uint32_t>(value.getConsumerGroupId());
+}
+
+template <>
+void iggy::serialization::binary::BinaryWireFormat::write<iggy::command::consumergroup::LeaveConsumerGroup>(
+    ByteWriter& out,
+    const iggy::command::consumergroup::LeaveConsumerGroup& value) const {
+    writeTopicScope(out, value, FIXED_SIZE<uint32_t>);
+    out.writeLittleEndian<uint32_t>(value.getConsumerGroupId());
+}
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cstddef>
+#include <memory>
+#include <vector>
 #include "serialization.h"
 
 namespace iggy {
@@ -25,6 +28,7 @@ enum CommandCode {
     GET_ME = 20,
     GET_CLIENT = 21,
     GET_CLIENTS = 22,
+    LOGIN_USER = 38,
     POLL_MESSAGES = 100,
     SEND_MESSAGES = 101,
     GET_CONSUMER_OFFSET = 120,
@@ -47,14 +51,242 @@ enum CommandCode {
     LEAVE_CONSUMER_GROUP = 605
 };
 
+/**
+ * @class GatherBuffer
+ * @brief An encoded request payload made of owned bytes and references to caller memory, written with one gathered write.
+ *
+ * Small fields are copied into an owned buffer while large ones, typically message payloads, are referenced in place so
+ * the kernel gathers them straight from the caller's memory. Referenced memory must stay valid and unmodified until the
+ * response to the request has arrived.
+ */
+class GatherBuffer {
+private:
+    struct Segment {
+        // nullptr for segments stored in owned; offsets rather than pointers survive owned growing
+        const unsigned char* external;
+        size_t offset;
+        size_t length;
+    };
+
+    std::vector<unsigned char> owned;
+    std::vector<Segment> segments;
+    size_t totalSize = 0;
+
+public:
+    /**
+     * @brief Fields shorter than this are copied by @ref appendReference; an iovec per tiny field costs more than the copy.
+     */
+    static const size_t REFERENCE_THRESHOLD = 512;
+
+    GatherBuffer() = default;
+
+    /**
+     * @brief Wraps an already-encoded contiguous payload without copying it.
+     */
+    explicit GatherBuffer(std::vector<unsigned char> bytes);
+
+    /**
+     * @brief Makes room for ownedBytes more copied bytes and segmentCount more segments, so an encoder that sizes its
+     * frame in a pre-pass appends without reallocating.
+     */
+    void reserve(size_t ownedBytes, size_t segmentCount);
+
+    /**
+     * @brief Copies bytes into the owned buffer, extending the previous segment if it is owned too.
+     */
+    void append(const unsigned char* data, size_t length);
+
+    /**
+     * @brief References caller memory as a separate segment, or copies it if it is below @ref REFERENCE_THRESHOLD.
+     */
+    void appendReference(const unsigned char* data, size_t length);
+
+    /**
+     * @brief Gets the total encoded length in bytes.
+     */
+    size_t size() const { return totalSize; }
+
+    /**
+     * @brief Tests whether nothing has been encoded.
+     */
+    bool empty() const { return totalSize == 0; }
+
+    /**
+     * @brief Gets the number of segments, i.e. the number of iovecs needed to write the payload.
+     */
+    size_t segmentCount() const { return segments.size(); }
+
+    /**
+     * @brief Calls visit(const unsigned char* data, size_t length) for each segment in order.
+     */
+    template <typename Visitor>
+    void forEachSegment(Visitor&& visit) const {
+        for (const auto& segment : segments) {
+            visit(segment.external ? segment.external : owned.data() + segment.offset, segment.length);
+        }
+    }
+
+    /**
+     * @brief Copies all segments into one contiguous buffer.
+     */
+    std::vector<unsigned char> flatten() const;
+};
+
 /**
  * @class BinaryWireFormat
  * @brief Simple binary serialization and deserialization for Iggy's protocol.
  */
-class BinaryWireFormat : iggy::serialization::WireFormat {
+class BinaryWireFormat : public iggy::serialization::WireFormat {
+private:
+    bool verifyChecksums = false;
+
 public:
     BinaryWireFormat() = default;
-}
+
+    /**
+     * @param verifyChecksums Whether to check each polled payload against its CRC-32 checksum as it is decoded, and each
+     * message sent against the checksum it carries, if any; see @ref verifyChecksum.
+     */
+    explicit BinaryWireFormat(bool verifyChecksums)
+        : verifyChecksums(verifyChecksums) {}
+
+    /**
+     * @brief Decodes a model object from a response payload; only the specializations declared below are available.
+     * @throws std::runtime_error if the payload is truncated.
+     */
+    template <typename T>
+    T read(ByteReader& in) const;
+
+    /**
+     * @brief Decodes a model object that borrows from the payload buffer instead of copying out of it.
+     * @throws std::runtime_error if the payload is truncated or malformed.
+     */
+    template <typename T>
+    T read(std::shared_ptr<const std::vector<unsigned char>> payload) const;
+
+    /**
+     * @brief Encodes a command as a request payload, excluding the frame length and command code prefix.
+     *
+     * Each specialization computes the payload size before writing anything and reserves it in one go: at compile time
+     * for commands made only of fixed-width fields, and with a single pass over identifiers and strings otherwise.
+     * @throws std::invalid_argument if a field does not fit its encoding, e.g. a name longer than 255 bytes.
+     */
+    template <typename T>
+    void write(ByteWriter& out, const T& value) const;
+
+    /**
+     * @brief Encodes a command as a gathered request payload, referencing large fields such as message payloads in place.
+     */
+    template <typename T>
+    void write(GatherBuffer& out, const T& value) const;
+};
+
+template <>
+iggy::model::system::Stats BinaryWireFormat::read<iggy::model::system::Stats>(ByteReader& in) const;
+
+template <>
+iggy::model::message::PolledMessages BinaryWireFormat::read<iggy::model::message::PolledMessages>(ByteReader& in) const;
+
+template <>
+iggy::model::message::PolledMessagesView BinaryWireFormat::read<iggy::model::message::PolledMessagesView>(
+    std::shared_ptr<const std::vector<unsigned char>> payload) const;
+
+template <>
+void BinaryWireFormat::write<iggy::command::system::Ping>(ByteWriter& out, const iggy::command::system::Ping& value) const;
+
+template <>
+void BinaryWireFormat::write<iggy::command::system::GetStats>(ByteWriter& out, const iggy::command::system::GetStats& value) const;
+
+template <>
+void BinaryWireFormat::write<iggy::command::system::GetMe>(ByteWriter& out, const iggy::command::system::GetMe& value) const;
+
+template <>
+void BinaryWireFormat::write<iggy::command::system::GetClient>(ByteWriter& out, const iggy::command::system::GetClient& value) const;
+
+template <>
+void BinaryWireFormat::write<iggy::command::system::GetClients>(ByteWriter& out, const iggy::command::system::GetClients& value) const;
+
+template <>
+void BinaryWireFormat::write<iggy::command::user::LoginUser>(ByteWriter& out, const iggy::command::user::LoginUser& value) const;
+
+template <>
+void BinaryWireFormat::write<iggy::command::stream::GetStream>(ByteWriter& out, const iggy::command::stream::GetStream& value) const;
+
+template <>
+void BinaryWireFormat::write<iggy::command::stream::GetStreams>(ByteWriter& out, const iggy::command::stream::GetStreams& value) const;
+
+template <>
+void BinaryWireFormat::write<iggy::command::stream::CreateStream>(ByteWriter& out,
+                                                                  const iggy::command::stream::CreateStream& value) const;
+
+template <>
+void BinaryWireFormat::write<iggy::command::stream::DeleteStream>(ByteWriter& out,
+                                                                  const iggy::command::stream::DeleteStream& value) const;
+
+template <>
+void BinaryWireFormat::write<iggy::command::topic::GetTopic>(ByteWriter& out, const iggy::command::topic::GetTopic& value) const;
+
+template <>
+void BinaryWireFormat::write<iggy::command::topic::GetTopics>(ByteWriter& out, const iggy::command::topic::GetTopics& value) const;
+
+template <>
+void BinaryWireFormat::write<iggy::command::topic::CreateTopic>(ByteWriter& out, const iggy::command::topic::CreateTopic& value) const;
+
+template <>
+void BinaryWireFormat::write<iggy::command::partition::CreatePartitions>(ByteWriter& out,
+                                                                         const iggy::command::partition::CreatePartitions& value) const;
+
+template <>
+void BinaryWireFormat::write<iggy::command::partition::DeletePartitions>(ByteWriter& out,
+                                                                         const iggy::command::partition::DeletePartitions& value) const;
+
+template <>
+void BinaryWireFormat::write<iggy::command::message::PollMessages>(ByteWriter& out,
+                                                                   const iggy::command::message::PollMessages& value) const;
+
+template <>
+void BinaryWireFormat::write<iggy::command::consumeroffset::GetConsumerOffset>(
+    ByteWriter& out,
+    const iggy::command::consumeroffset::GetConsumerOffset& value) const;
+
+template <>
+void BinaryWireFormat::write<iggy::command::consumeroffset::StoreConsumerOffset>(
+    ByteWriter& out,
+    const iggy::command::consumeroffset::StoreConsumerOffset& value) const;
+
+template <>
+void BinaryWireFormat::write<iggy::command::consumergroup::GetConsumerGroup>(
+    ByteWriter& out,
+    const iggy::command::consumergroup::GetConsumerGroup& value) const;
+
+template <>
+void BinaryWireFormat::write<iggy::command::consumergroup::GetConsumerGroups>(
+    ByteWriter& out,
+    const iggy::command::consumergroup::GetConsumerGroups& value) const;
+
+template <>
+void BinaryWireFormat::write<iggy::command::consumergroup::CreateConsumerGroup>(
+    ByteWriter& out,
+    const iggy::command::consumergroup::CreateConsumerGroup& value) const;
+
+template <>
+void BinaryWireFormat::write<iggy::command::consumergroup::DeleteConsumerGroup>(
+    ByteWriter& out,
+    const iggy::command::consumergroup::DeleteConsumerGroup& value) const;
+
+template <>
+void BinaryWireFormat::write<iggy::command::consumergroup::JoinConsumerGroup>(
+    ByteWriter& out,
+    const iggy::command::consumergroup::JoinConsumerGroup& value) const;
+
+template <>
+void BinaryWireFormat::write<iggy::command::consumergroup::LeaveConsumerGroup>(
+    ByteWriter& out,
+    const iggy::command::consumergroup::LeaveConsumerGroup& value) const;
+
+template <>
+void BinaryWireFormat::write<iggy::command::message::SendMessages>(GatherBuffer& out,
+                                                                   const iggy::command::message::SendMessages& value) const;
 
 }  // namespace binary
 }  // namespace serialization
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstring>
+
+namespace iggy {
+namespace serialization {
+
+/**
+ * @brief Reads an unsigned integer stored in little-endian byte order, without bounds checks.
+ *
+ * This is the primitive under @ref ByteReader and the fixed-offset decoders that cannot afford or do not need a cursor, such
+ * as frame headers and already validated message headers; it lives apart from serialization.h so that model.h can use it.
+ */
+template <typename T>
+inline T loadLittleEndian(const unsigned char* in) {
+    T value = 0;
+    if constexpr (std::endian::native == std::endian::little) {
+        std::memcpy(&value, in, sizeof(T));
+    } else {
+        for (size_t i = 0; i < sizeof(T); i++) {
+            value |= static_cast<T>(in[i]) << (8 * i);
+        }
+    }
+    return value;
+}
+
+/**
+ * @brief Writes an unsigned integer in little-endian byte order, without bounds checks; the primitive under @ref ByteWriter.
+ */
+template <typename T>
+inline void storeLittleEndian(unsigned char* out, T value) {
+    if constexpr (std::endian::native == std::endian::little) {
+        std::memcpy(out, &value, sizeof(T));
+    } else {
+        for (size_t i = 0; i < sizeof(T); i++) {
+            out[i] = static_cast<unsigned char>(value >> (8 * i));
+        }
+    }
+}
+
+}  // namespace serialization
+}  // namespace iggy
@@ -1,24 +1,289 @@
 #include "client.h"
-#include <reproc++/reproc.hpp>
+#include <fmt/format.h>
+#include <cctype>
 #include <string>
+#include <string_view>
 #include <vector>
+#include "net/crypto/ssl.h"
+#include "net/http/conn.h"
+#include "net/iggy.h"
+#include "net/quic/conn.h"
+#include "net/tcp/conn.h"
+#if defined(IGGY_HAVE_IO_URING)
+#include "net/tcp/uring.h"
+#endif
 
-iggy::client::Client::Client(const Options& options) {
+namespace {
+iggy::net::conn::Response checkStatus(iggy::serialization::binary::CommandCode command, iggy::net::conn::Response response) {
+    if (!response.isOk()) {
+        throw std::runtime_error(fmt::format("Server returned error status {} for command {}", response.getStatus(), static_cast<int>(command)));
+    }
+    return response;
+}
+
+const iggy::net::IggyProtocolProvider& getProtocolProvider() {
+    static iggy::net::IggyProtocolProvider provider;
+    return provider;
+}
+
+const char* getSecureProtocol(iggy::net::transport::Transport transport) {
+    return transport == iggy::net::transport::Transport::QUIC ? iggy::net::QUIC_PROTOCOL : iggy::net::TCP_TLS_PROTOCOL;
+}
+
+iggy::net::http::Response checkHttpStatus(const std::string& path, iggy::net::http::Response response) {
+    if (!response.isOk()) {
+        throw std::runtime_error(fmt::format("Server returned HTTP status {} for {}", response.getStatus(), path));
+    }
+    return response;
+}
+
+/// @brief Appends a JSON string literal, escaping quotes, backslashes and control characters.
+void appendJsonString(std::string& out, const std::string& value) {
+    out.push_back('"');
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            out.push_back('\\');
+            out.push_back(c);
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out.append(fmt::format("\\u{:04x}", static_cast<int>(c)));
+        } else {
+            out.push_back(c);
+        }
+    }
+    out.push_back('"');
+}
+
+/// @brief Renders a stream or topic identifier as a REST path segment: numeric ids in decimal, names percent-encoded.
+std::string toPathSegment(const iggy::model::shared::Identifier& id) {
+    if (id.isNumeric()) {
+        return std::to_string(id.getNumericValue());
+    }
+    std::string segment;
+    for (unsigned char c : id.getValue()) {
+        if (std::isalnum(c) || c == '-' || c == '.' || c == '_' || c == '~') {
+            segment.push_back(static_cast<char>(c));
+        } else {
+            segment.append(fmt::format("%{:02X}", c));
+        }
+    }
+    return segment;
+}
+
+const char* getPollingKindName(iggy::command::message::PollingKind kind) {
+    switch (kind) {
+        case iggy::command::message::OFFSET:
+            return "offset";
+        case iggy::command::message::TIMESTAMP:
+            return "timestamp";
+        case iggy::command::message::FIRST:
+            return "first";
+        case iggy::command::message::LAST:
+            return "last";
+        case iggy::command::message::NEXT:
+            return "next";
+    }
+    throw std::invalid_argument(fmt::format("Unknown polling kind {}", static_cast<int>(kind)));
+}
+
+}  // namespace
+
+struct iggy::client::Client::Tls {
+    iggy::ssl::SSLOptions<WOLFSSL_CTX*> sslOptions;
+    iggy::crypto::CertificateAuthority<WOLFSSL_CTX*> certAuth;
+    iggy::crypto::PKIEnvironment<WOLFSSL_CTX*> pkiEnv;
+
+    // one context, and so one session cache, for every connection in the pool; they connect one after another, so all but
+    // the first can resume
+    iggy::ssl::SSLContext<WOLFSSL_CTX*> context;
+    iggy::net::address::LogicalAddress address;
+
+    explicit Tls(const Options& options)
+        : certAuth(options.tlsCaCertificatePath, nullptr)
+        , pkiEnv(certAuth)
+        , context(sslOptions, pkiEnv)
+        , address(getProtocolProvider().createAddress(
+              fmt::format("{}://{}:{}", getSecureProtocol(options.transport), options.hostname, options.port))) {
+        this->pkiEnv.configure(this->context.getNativeHandle(), this->pkiEnv);
+        if (options.transport == iggy::net::transport::Transport::QUIC) {
+            iggy::net::quic::configureClientContext(this->context);
+        }
+        if (options.tlsSessionCache) {
+            this->context.setSessionCache(options.tlsSessionCache);
+        }
+    }
+};
+
+iggy::client::Client::Client(const Options& options)
+    : wireFormat(options.verifyChecksums)
+    , jsonFormat(options.verifyChecksums)
+    , compression(options.compression)
+    , compressionLevel(options.compressionLevel)
+    , encryption(options.encryption) {
     // to make more natural interface for setting options we use a struct, so need to validate it.
     options.validate();
+    if (options.transport == iggy::net::transport::Transport::HTTP) {
+        this->connectHttp(options);
+        return;
+    }
+    bool isQuic = options.transport == iggy::net::transport::Transport::QUIC;
+    if (options.tls || isQuic) {
+        this->tls = std::make_unique<Tls>(options);
+    }
+    std::optional<iggy::net::tcp::TlsEndpoint> tlsEndpoint;
+    if (this->tls) {
+        tlsEndpoint.emplace(iggy::net::tcp::TlsEndpoint{this->tls->context, this->tls->address});
+    }
+
+    auto factory = [&options, &tlsEndpoint, isQuic]() -> std::unique_ptr<iggy::net::conn::Connection> {
+        if (isQuic) {
+            std::set<iggy::serialization::binary::CommandCode> earlyDataCommands;
+            if (options.quicEarlyData) {
+                earlyDataCommands = options.quicEarlyDataCommands;
+            }
+            return std::make_unique<iggy::net::quic::QuicConnection>(options.hostname, options.port, *tlsEndpoint,
+                                                                     options.maxInFlightRequests, earlyDataCommands, options.quicBatchedIo);
+        }
+#if defined(IGGY_HAVE_IO_URING)
+        if (options.tcpBackend == iggy::net::transport::TcpBackend::IO_URING) {
+            return std::make_unique<iggy::net::tcp::UringConnection>(options.hostname, options.port, options.maxInFlightRequests);
+        }
+#endif
+        return std::make_unique<iggy::net::tcp::TcpConnection>(options.hostname, options.port, options.maxInFlightRequests, tlsEndpoint,
+                                                               options.kernelTls);
+    };
+    this->connections = std::make_unique<iggy::net::conn::ConnectionPool>(options.connectionCount, options.connectionAffinity, factory);
+    this->connections->connect();
+
+    // sessions are per-connection on the server, so every connection in the pool has to authenticate
+    iggy::serialization::ByteWriter login;
+    const auto& credentials = options.credentials;
+    this->wireFormat.write(login, iggy::command::user::LoginUser(credentials.getUsername(), credentials.getPassword()));
+    auto loginPayload = login.take();
+    std::vector<std::future<iggy::net::conn::Response>> logins;
+    for (size_t i = 0; i < this->connections->size(); i++) {
+        logins.push_back(this->connections->at(i).send(iggy::serialization::binary::LOGIN_USER, loginPayload));
+    }
+    for (auto& response : logins) {
+        checkStatus(iggy::serialization::binary::LOGIN_USER, response.get());
+    }
+}
+
+iggy::client::Client::~Client() = default;
+
+void iggy::client::Client::connectHttp(const Options& options) {
+    // libcurl runs its own TLS with the CA certificates given, so there is no wolfSSL context to share here
+    auto baseUrl = fmt::format("{}://{}:{}", options.tls ? "https" : "http", options.hostname, options.port);
+    this->http = std::make_unique<iggy::net::http::HttpConnection>(baseUrl, options.connectionCount, options.maxInFlightRequests,
+                                                                   options.httpMultiplexing, options.tlsCaCertificatePath);
+    this->http->connect();
+
+    const auto& credentials = options.credentials;
+    std::string login = "{\"username\":";
+    appendJsonString(login, credentials.getUsername());
+    login.append(",\"password\":");
+    appendJsonString(login, credentials.getPassword());
+    login.push_back('}');
+    const std::string path = "/users/login";
+    auto response = checkHttpStatus(path, this->http->request(iggy::net::http::POST, path, {login.begin(), login.end()}).get());
+    auto identity = this->jsonFormat.read<iggy::model::user::IdentityInfo>(response.takeBody());
+    if (!identity.getAccessToken()) {
+        throw std::runtime_error("Server did not return an access token for the HTTP login");
+    }
+    this->http->setAccessToken(identity.getAccessToken()->getToken());
+}
+
+iggy::net::conn::Response iggy::client::Client::sendCommand(iggy::serialization::binary::CommandCode command,
+                                                            iggy::serialization::binary::GatherBuffer payload) {
+    return checkStatus(command, this->connections->sendGathered(command, std::move(payload)).get());
 }
 
 void iggy::client::Client::ping() {
-    // temporary! using the Rust CLI from Docker to execute the ping to demonstrate test fixture
-    reproc::process ping_process;
-    reproc::options options;
-    options.redirect.parent = true;
-    std::vector<std::string> ping_args = {"docker", "exec", "iggy_test", "/iggy/iggy", "ping"};
-    ping_process.start(ping_args, options);
-    ping_process.wait(reproc::milliseconds(5000));
+    if (this->http) {
+        const std::string path = "/ping";
+        checkHttpStatus(path, this->http->request(iggy::net::http::GET, path).get());
+        return;
+    }
+    this->sendCommand(iggy::serialization::binary::PING, {});
 }
 
 iggy::model::system::Stats iggy::client::Client::getStats() {
-    // temporary! need to send GetStats command to server then use WireFormat to read the response
-    return iggy::model::system::Stats();
+    if (this->http) {
+        const std::string path = "/stats";
+        auto response = checkHttpStatus(path, this->http->request(iggy::net::http::GET, path).get());
+        return this->jsonFormat.read<iggy::model::system::Stats>(response.takeBody());
+    }
+    auto response = this->sendCommand(iggy::serialization::binary::GET_STATS, {});
+    const auto& payload = response.getPayload();
+    iggy::serialization::ByteReader in(payload);
+    return this->wireFormat.read<iggy::model::system::Stats>(in);
+}
+
+void iggy::client::Client::sendMessages(const iggy::command::message::SendMessages& command) {
+    // the transformed batches, and the command whose unchanged payloads they borrow, have to outlive the write, which
+    // references those payloads rather than copying them
+    std::optional<iggy::command::message::SendMessages> compressed;
+    if (this->compression != iggy::serialization::compression::Codec::NONE) {
+        compressed = iggy::serialization::compression::compressMessages(command, this->compression, this->compressionLevel);
+    }
+    const auto& batch = compressed ? *compressed : command;
+    if (this->encryption) {
+        this->writeMessages(this->encryption->seal(batch));
+        return;
+    }
+    this->writeMessages(batch);
+}
+
+void iggy::client::Client::writeMessages(const iggy::command::message::SendMessages& command) {
+    if (this->http) {
+        // the encoded body is moved into the transfer, which libcurl uploads from without copying
+        iggy::serialization::ByteWriter body;
+        this->jsonFormat.write(body, command);
+        auto path =
+            fmt::format("/streams/{}/topics/{}/messages", toPathSegment(command.getStreamId()), toPathSegment(command.getTopicId()));
+        checkHttpStatus(path, this->http->request(iggy::net::http::POST, path, body.take()).get());
+        return;
+    }
+    // blocking on the response keeps the referenced payloads alive for as long as the connection may still be writing them
+    iggy::serialization::binary::GatherBuffer payload;
+    this->wireFormat.write(payload, command);
+    this->sendCommand(iggy::serialization::binary::SEND_MESSAGES, std::move(payload));
+}
+
+iggy::model::message::PolledMessages iggy::client::Client::pollMessages(const iggy::command::message::PollMessages& command) {
+    return this->pollMessagesView(command).toPolledMessages(this->arenas);
+}
+
+iggy::model::message::PolledMessagesView iggy::client::Client::pollMessagesView(const iggy::command::message::PollMessages& command) {
+    if (this->http) {
+        return this->decodePayloads(this->pollMessagesHttp(command));
+    }
+    iggy::serialization::ByteWriter request;
+    this->wireFormat.write(request, command);
+    auto response = this->sendCommand(iggy::serialization::binary::POLL_MESSAGES, iggy::serialization::binary::GatherBuffer(request.take()));
+
+    // the decoded view takes over the response payload as its shared receive buffer
+    auto payload = std::make_shared<const std::vector<unsigned char>>(response.takePayload());
+    return this->decodePayloads(this->wireFormat.read<iggy::model::message::PolledMessagesView>(std::move(payload)));
+}
+
+iggy::model::message::PolledMessagesView iggy::client::Client::decodePayloads(const iggy::model::message::PolledMessagesView& messages) {
+    // undo sendMessages in reverse: open first, since the codec header is only stripped once the payload is decompressed
+    if (this->encryption) {
+        return iggy::serialization::compression::decompressMessages(this->encryption->open(messages));
+    }
+    return iggy::serialization::compression::decompressMessages(messages);
+}
+
+iggy::model::message::PolledMessagesView iggy::client::Client::pollMessagesHttp(const iggy::command::message::PollMessages& command) {
+    auto consumer = command.getConsumer();
+    if (consumer.getKind() != iggy::model::shared::CONSUMER) {
+        throw std::runtime_error("Polling as a consumer group is not supported over the HTTP transport");
+    }
+    auto strategy = command.getStrategy();
+    auto path = fmt::format("/streams/{}/topics/{}/messages?consumer_id={}&partition_id={}&kind={}&value={}&count={}&auto_commit={}",
+                            toPathSegment(command.getStreamId()), toPathSegment(command.getTopicId()), consumer.getId(),
+                            command.getPartitionId(), getPollingKindName(strategy.getKind()), strategy.getValue(), command.getCount(),
+                            command.getAutoCommit());
+    auto response = checkHttpStatus(path, this->http->request(iggy::net::http::GET, path).get());
+    return this->jsonFormat.read<iggy::model::message::PolledMessagesView>(response.takeBody());
 }
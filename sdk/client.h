@@ -1,13 +1,33 @@
 #pragma once
 
 #include <sodium.h>
+#include <memory>
+#include <optional>
+#include <set>
 #include <stdexcept>
 #include <string>
+#include <vector>
+#include "binary.h"
+#include "compression.h"
+#include "encryption.h"
+#include "json.h"
 #include "model.h"
+#include "net/conn.h"
 #include "net/iggy.h"
+#include "net/pool.h"
 #include "net/transport.h"
 
 namespace iggy {
+namespace ssl {
+class SessionCache;
+};  // namespace ssl
+
+namespace net {
+namespace http {
+class HttpConnection;
+};  // namespace http
+};  // namespace net
+
 namespace client {
 
 /**
@@ -27,6 +47,9 @@ public:
         , password(password) {}
 
     ~Credentials() { sodium_memzero(&password[0], password.size()); }
+
+    const std::string& getUsername() const { return username; }
+    const std::string& getPassword() const { return password; }
 };
 
 /**
@@ -50,6 +73,10 @@ struct Options {
 
     /**
      * @brief The network transport to use when connecting to the server. Defaults to TCP.
+     *
+     * QUIC always runs over TLS and verifies the server as @ref tls does for TCP; remember to set @ref port to the server's
+     * QUIC port, by default iggy::net::DEFAULT_QUIC_PORT. Likewise HTTP talks to the server's REST API on its own port, by
+     * default iggy::net::DEFAULT_HTTP_PORT, and uses https when @ref tls is set.
      */
     iggy::net::transport::Transport transport = iggy::net::transport::Transport::TCP;
 
@@ -61,10 +88,155 @@ struct Options {
      */
     client::Credentials credentials = client::Credentials("iggy", "iggy");
 
+    /**
+     * @brief The maximum number of requests pipelined on a connection before waiting for responses. Defaults to 32.
+     *
+     * Setting this to 1 restores strict request/response lock-step, paying a full round trip per command.
+     */
+    uint32_t maxInFlightRequests = 32;
+
+    /**
+     * @brief The number of connections the client opens to the server. Defaults to 1.
+     *
+     * Each connection has its own I/O thread; set this to the number of producer threads to scale across cores. The HTTP
+     * transport instead serves every request from one I/O thread and opens up to this many connections as needed.
+     */
+    uint32_t connectionCount = 1;
+
+    /**
+     * @brief How calling threads are routed to connections when @ref connectionCount is greater than one. Defaults to THREAD.
+     */
+    iggy::net::conn::ConnectionAffinity connectionAffinity = iggy::net::conn::ConnectionAffinity::THREAD;
+
+    /**
+     * @brief The I/O backend used for the TCP transport. Defaults to LIBUV.
+     *
+     * IO_URING is only available when the library is built with ENABLE_IO_URING on Linux.
+     */
+    iggy::net::transport::TcpBackend tcpBackend = iggy::net::transport::TcpBackend::LIBUV;
+
+    /**
+     * @brief Whether to secure the TCP or HTTP transport with TLS, as for the tcp+tls and http+tls protocols. Defaults to
+     * false.
+     */
+    bool tls = false;
+
+    /**
+     * @brief PEM file with the CA certificates that verify the server when @ref tls is set or the transport is QUIC; defaults
+     * to the system CA store.
+     */
+    std::optional<std::string> tlsCaCertificatePath = std::nullopt;
+
+    /**
+     * @brief Whether TLS connections hand encryption of outgoing records to the kernel (kTLS) after the handshake. Defaults to
+     * true.
+     *
+     * This lets message payloads go from the gathered write straight into the kernel with no userspace copy. If the kernel
+     * tls module is not loaded or does not support the negotiated cipher, connections fall back to userspace encryption.
+     */
+    bool kernelTls = true;
+
+    /**
+     * @brief Cache of resumable TLS sessions to use; defaults to a new cache per client.
+     *
+     * Share one cache between clients so that a client recreated after losing its connections, e.g. when the server
+     * restarts, resumes its sessions with an abbreviated handshake instead of running a full key exchange.
+     */
+    std::shared_ptr<iggy::ssl::SessionCache> tlsSessionCache = nullptr;
+
+    /**
+     * @brief Whether QUIC connections that resume a cached session send @ref quicEarlyDataCommands as 0-RTT early data.
+     * Defaults to false.
+     *
+     * Those commands then go out in the very first flight instead of waiting one or two round trips for the handshake,
+     * which matters for clients that reconnect often over high-latency links. Share @ref tlsSessionCache between the old
+     * and new client so the new one has sessions to resume.
+     */
+    bool quicEarlyData = false;
+
+    /**
+     * @brief The commands allowed in 0-RTT early data when @ref quicEarlyData is set. Defaults to PING and GET_STATS.
+     *
+     * An attacker who captures early data can replay it to the server, so list only commands that are safe to run twice.
+     * Commands are matched by code alone, so add POLL_MESSAGES only if no poll sent through the client auto-commits, since
+     * a replayed auto-commit poll advances the consumer offset. Every connection logs in first, which waits for the
+     * handshake unless LOGIN_USER is listed too.
+     */
+    std::set<iggy::serialization::binary::CommandCode> quicEarlyDataCommands = {iggy::serialization::binary::PING,
+                                                                                 iggy::serialization::binary::GET_STATS};
+
+    /**
+     * @brief Whether QUIC connections batch their packets into as few system calls as possible. Defaults to true.
+     *
+     * Outgoing packets go out with UDP generic segmentation offload or sendmmsg and incoming ones are read with recvmmsg
+     * and generic receive offload, where the kernel supports them; turn this off to send and receive packet by packet.
+     */
+    bool quicBatchedIo = true;
+
+    /**
+     * @brief Whether the HTTP transport multiplexes concurrent requests over a single HTTP/2 connection. Defaults to true.
+     *
+     * Plain http then speaks HTTP/2 with prior knowledge, so turn this off for servers or proxies that only speak HTTP/1.1;
+     * requests then go over up to @ref connectionCount keep-alive connections. https negotiates the version either way.
+     */
+    bool httpMultiplexing = true;
+
+    /**
+     * @brief Whether to verify message payloads against their CRC-32 checksums. Defaults to false.
+     *
+     * Every polled payload is checked against the checksum the server computed when it stored the message, as it is
+     * decoded, and a poll with a corrupted message fails with std::runtime_error. Messages being sent are checked against
+     * the checksum they carry, if any, e.g. when forwarding polled messages. The check runs at memory bandwidth on CPUs
+     * with carry-less multiplication, so it costs little next to receiving the bytes.
+     */
+    bool verifyChecksums = false;
+
+    /**
+     * @brief The codec that message payloads are compressed with before they are sent. Defaults to NONE.
+     *
+     * Each batch is compressed message by message, and the codec is recorded in a reserved header so that polls decompress
+     * the messages again. That happens whatever this is set to, so consumers need no configuration. Messages that do not
+     * get smaller are sent as they are.
+     */
+    iggy::serialization::compression::Codec compression = iggy::serialization::compression::Codec::NONE;
+
+    /**
+     * @brief The level of @ref compression; 0, the default, picks the codec's own default level.
+     *
+     * Higher levels trade producer CPU for smaller payloads: LZ4 goes from 1 to 12 and Zstd from its negative fast levels to
+     * 22. Decompression speed barely depends on the level.
+     */
+    int compressionLevel = 0;
+
+    /**
+     * @brief Encryptor that seals message payloads before they are sent and opens sealed ones when polling; defaults to
+     * none, which sends payloads in the clear and leaves sealed ones polled as they are.
+     *
+     * Payloads are sealed after @ref compression, since ciphertext does not compress, and batches above
+     * iggy::serialization::encryption::PARALLEL_THRESHOLD bytes are sealed and opened on the encryptor's worker pool. Share
+     * one encryptor between clients so that they share its keys and workers.
+     */
+    std::shared_ptr<iggy::serialization::encryption::PayloadEncryptor> encryption = nullptr;
+
     void validate() const {
         if (hostname.empty()) {
             throw std::invalid_argument("Hostname cannot be empty");
         }
+        if (maxInFlightRequests == 0) {
+            throw std::invalid_argument("Max in-flight requests must be at least 1");
+        }
+        if (connectionCount == 0) {
+            throw std::invalid_argument("Connection count must be at least 1");
+        }
+        iggy::serialization::compression::validateLevel(compression, compressionLevel);
+        if (transport == iggy::net::transport::Transport::TCP && tls && tcpBackend != iggy::net::transport::TcpBackend::LIBUV) {
+            throw std::invalid_argument("TLS is only supported on the libuv TCP backend");
+        }
+#if !defined(IGGY_HAVE_IO_URING)
+        if (tcpBackend == iggy::net::transport::TcpBackend::IO_URING) {
+            throw std::invalid_argument("The io_uring TCP backend is not available in this build");
+        }
+#endif
     }
 };
 
@@ -75,8 +247,60 @@ struct Options {
  * Main Iggy C++ client. You can use Options to configure the endpoint, credentials and transport.
  */
 class Client {
+private:
+    // TLS context shared by every connection, defined in client.cc to keep wolfSSL out of this header; declared first so it
+    // outlives the connections using it
+    struct Tls;
+    std::unique_ptr<Tls> tls;
+
+    std::unique_ptr<iggy::net::conn::ConnectionPool> connections;
+    iggy::serialization::binary::BinaryWireFormat wireFormat;
+
+    // set instead of the connection pool when talking to the REST API
+    std::unique_ptr<iggy::net::http::HttpConnection> http;
+    iggy::serialization::json::JsonWireFormat jsonFormat;
+
+    // recycles the header arenas of the batches returned by pollMessages
+    iggy::model::message::ArenaPool arenas;
+
+    iggy::serialization::compression::Codec compression;
+    int compressionLevel;
+    std::shared_ptr<iggy::serialization::encryption::PayloadEncryptor> encryption;
+
+    /**
+     * @brief Connects to the REST API, which needs a bearer token from logging in on every request.
+     */
+    void connectHttp(const Options& options);
+
+    /**
+     * @brief Sends a command and blocks for the response, raising an error for any non-OK status.
+     */
+    iggy::net::conn::Response sendCommand(iggy::serialization::binary::CommandCode command,
+                                          iggy::serialization::binary::GatherBuffer payload);
+
+    /**
+     * @brief Encodes and sends a batch of messages as they are, blocking until the server has accepted them.
+     */
+    void writeMessages(const iggy::command::message::SendMessages& command);
+
+    /**
+     * @brief Opens sealed payloads and decompresses compressed ones in a polled batch.
+     */
+    iggy::model::message::PolledMessagesView decodePayloads(const iggy::model::message::PolledMessagesView& messages);
+
+    /**
+     * @brief Polls through the REST API, which takes the command as query parameters and answers with JSON.
+     */
+    iggy::model::message::PolledMessagesView pollMessagesHttp(const iggy::command::message::PollMessages& command);
+
 public:
+    /**
+     * @brief Connects and authenticates to the server configured in the options.
+     * @throws std::invalid_argument if the options are invalid or the transport is not supported yet.
+     * @throws std::runtime_error if the server cannot be reached or rejects the credentials.
+     */
     explicit Client(const Options& options);
+    ~Client();
 
     /**
      * @brief Send a synchronous ping to the server to check if it is alive.
@@ -87,6 +311,32 @@ public:
      * @brief Get the Iggy server's performance statistics.
      */
     iggy::model::system::Stats getStats();
+
+    /**
+     * @brief Appends a batch of messages to a topic, blocking until the server has accepted them.
+     *
+     * Message payloads are written to the socket directly from the command rather than copied into a request buffer. With
+     * @ref Options::compression or @ref Options::encryption set they are compressed and sealed first, and those copies are
+     * written instead.
+     */
+    void sendMessages(const iggy::command::message::SendMessages& command);
+
+    /**
+     * @brief Polls a batch of messages into owning @ref iggy::model::message::Message objects.
+     *
+     * Payloads are borrowed from the response buffer and headers come from a pooled arena, so the batch costs no per-message
+     * allocation; the messages share that storage and release it when the last of them is gone.
+     */
+    iggy::model::message::PolledMessages pollMessages(const iggy::command::message::PollMessages& command);
+
+    /**
+     * @brief Polls a batch of messages without copying them out of the response buffer.
+     *
+     * Preferred for large batches: decoding performs a single allocation for the message index, and payloads and headers are
+     * exposed as spans into the response, which the returned view keeps alive. Sealed and compressed messages are the
+     * exception: they are opened and decompressed into further buffers, which the view also keeps alive.
+     */
+    iggy::model::message::PolledMessagesView pollMessagesView(const iggy::command::message::PollMessages& command);
 };
 };  // namespace client
 };  // namespace iggy
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <string>
+#include <utility>
+#include <vector>
 #include "model.h"
 #include "types.h"
 
@@ -30,7 +32,7 @@ public:
     explicit GetStream(iggy::model::shared::Identifier streamId)
         : streamId(streamId) {}
 
-    iggy::model::shared::Identifier getStreamId() const { return streamId; }
+    const iggy::model::shared::Identifier& getStreamId() const { return streamId; }
 };
 
 class GetStreams : Command {};
@@ -42,10 +44,10 @@ private:
 public:
     CreateStream(iggy::model::shared::Identifier streamId, std::string name)
         : streamId(streamId)
-        , name(name) {}
+        , name(std::move(name)) {}
 
-    iggy::model::shared::Identifier getStreamId() const { return streamId; }
-    std::string getName() const { return name; }
+    const iggy::model::shared::Identifier& getStreamId() const { return streamId; }
+    const std::string& getName() const { return name; }
 };
 
 class DeleteStream : Command {
@@ -56,7 +58,7 @@ public:
     explicit DeleteStream(iggy::model::shared::Identifier streamId)
         : streamId(streamId) {}
 
-    iggy::model::shared::Identifier getStreamId() const { return streamId; }
+    const iggy::model::shared::Identifier& getStreamId() const { return streamId; }
 };
 }  // namespace stream
 
@@ -74,8 +76,8 @@ public:
         : streamId(streamId)
         , topicId(topicId) {}
 
-    iggy::model::shared::Identifier getStreamId() const { return streamId; }
-    iggy::model::shared::Identifier getTopicId() const { return topicId; }
+    const iggy::model::shared::Identifier& getStreamId() const { return streamId; }
+    const iggy::model::shared::Identifier& getTopicId() const { return topicId; }
 };
 
 class GetTopics : Command {
@@ -86,7 +88,7 @@ public:
     explicit GetTopics(iggy::model::shared::Identifier streamId)
         : streamId(streamId) {}
 
-    iggy::model::shared::Identifier getStreamId() const { return streamId; }
+    const iggy::model::shared::Identifier& getStreamId() const { return streamId; }
 };
 
 class CreateTopic : Command {
@@ -107,13 +109,13 @@ public:
         , topicId(topicId)
         , partitionsCount(partitionsCount)
         , messageExpiry(messageExpiry)
-        , name(name) {}
+        , name(std::move(name)) {}
 
-    iggy::model::shared::Identifier getStreamId() const { return streamId; }
+    const iggy::model::shared::Identifier& getStreamId() const { return streamId; }
     uint32_t getTopicId() const { return topicId; }
     uint32_t getPartitionsCount() const { return partitionsCount; }
     std::optional<uint32_t> getMessageExpiry() const { return messageExpiry; }
-    std::string getName() const { return name; }
+    const std::string& getName() const { return name; }
 };
 }  // namespace topic
 
@@ -133,8 +135,8 @@ public:
         , topicId(topicId)
         , partitionsCount(partitionsCount) {}
 
-    iggy::model::shared::Identifier getStreamId() const { return streamId; }
-    iggy::model::shared::Identifier getTopicId() const { return topicId; }
+    const iggy::model::shared::Identifier& getStreamId() const { return streamId; }
+    const iggy::model::shared::Identifier& getTopicId() const { return topicId; }
     uint32_t getPartitionsCount() const { return partitionsCount; }
 };
 
@@ -150,8 +152,8 @@ public:
         , topicId(topicId)
         , partitionsCount(partitionsCount) {}
 
-    iggy::model::shared::Identifier getStreamId() const { return streamId; }
-    iggy::model::shared::Identifier getTopicId() const { return topicId; }
+    const iggy::model::shared::Identifier& getStreamId() const { return streamId; }
+    const iggy::model::shared::Identifier& getTopicId() const { return topicId; }
     uint32_t getPartitionsCount() const { return partitionsCount; }
 };
 }  // namespace partition
@@ -201,8 +203,8 @@ public:
         , autoCommit(autoCommit) {}
 
     iggy::model::shared::Consumer getConsumer() const { return consumer; }
-    iggy::model::shared::Identifier getStreamId() const { return streamId; }
-    iggy::model::shared::Identifier getTopicId() const { return topicId; }
+    const iggy::model::shared::Identifier& getStreamId() const { return streamId; }
+    const iggy::model::shared::Identifier& getTopicId() const { return topicId; }
     uint32_t getPartitionId() const { return partitionId; }
     PollingStrategy getStrategy() const { return strategy; }
     uint32_t getCount() const { return count; }
@@ -224,13 +226,42 @@ public:
     Partitioning(PartitioningKind kind, uint8_t length, std::vector<unsigned char> value)
         : kind(kind)
         , length(length)
-        , value(value) {}
+        , value(std::move(value)) {}
 
     PartitioningKind getKind() const { return kind; }
     uint8_t getLength() const { return length; }
-    std::vector<unsigned char> getValue() const { return value; }
+    const std::vector<unsigned char>& getValue() const { return value; }
+};
+
+/**
+ * @brief Command to append a batch of messages to a topic.
+ */
+class SendMessages : Command {
+private:
+    iggy::model::shared::Identifier streamId;
+    iggy::model::shared::Identifier topicId;
+    Partitioning partitioning;
+    std::vector<iggy::model::message::Message> messages;
+
+public:
+    SendMessages(iggy::model::shared::Identifier streamId,
+                 iggy::model::shared::Identifier topicId,
+                 Partitioning partitioning,
+                 std::vector<iggy::model::message::Message> messages)
+        : streamId(streamId)
+        , topicId(topicId)
+        , partitioning(std::move(partitioning))
+        , messages(std::move(messages)) {}
+
+    const iggy::model::shared::Identifier& getStreamId() const { return streamId; }
+    const iggy::model::shared::Identifier& getTopicId() const { return topicId; }
+    const Partitioning& getPartitioning() const { return partitioning; }
+
+    /**
+     * @brief Gets the messages by reference; the binary encoder sends their payloads straight from this storage.
+     */
+    const std::vector<iggy::model::message::Message>& getMessages() const { return messages; }
 };
-class SendMessages : Command {};
 
 }  // namespace message
 
@@ -260,8 +291,8 @@ public:
         , partitionId(partitionId) {}
 
     iggy::model::shared::Consumer getConsumer() const { return consumer; }
-    iggy::model::shared::Identifier getStreamId() const { return streamId; }
-    iggy::model::shared::Identifier getTopicId() const { return topicId; }
+    const iggy::model::shared::Identifier& getStreamId() const { return streamId; }
+    const iggy::model::shared::Identifier& getTopicId() const { return topicId; }
     uint32_t getPartitionId() const { return partitionId; }
 };
 
@@ -289,8 +320,8 @@ public:
         , offset(offset) {}
 
     iggy::model::shared::Consumer getConsumer() const { return consumer; }
-    iggy::model::shared::Identifier getStreamId() const { return streamId; }
-    iggy::model::shared::Identifier getTopicId() const { return topicId; }
+    const iggy::model::shared::Identifier& getStreamId() const { return streamId; }
+    const iggy::model::shared::Identifier& getTopicId() const { return topicId; }
     uint32_t getPartitionId() const { return partitionId; }
     uint64_t getOffset() const { return offset; }
 };
@@ -317,8 +348,8 @@ public:
         , topicId(topicId)
         , consumerGroupId(consumerGroupId) {}
 
-    iggy::model::shared::Identifier getStreamId() const { return streamId; }
-    iggy::model::shared::Identifier getTopicId() const { return topicId; }
+    const iggy::model::shared::Identifier& getStreamId() const { return streamId; }
+    const iggy::model::shared::Identifier& getTopicId() const { return topicId; }
     uint32_t getConsumerGroupId() const { return consumerGroupId; }
 };
 
@@ -335,8 +366,8 @@ public:
         : streamId(streamId)
         , topicId(topicId) {}
 
-    iggy::model::shared::Identifier getStreamId() const { return streamId; }
-    iggy::model::shared::Identifier getTopicId() const { return topicId; }
+    const iggy::model::shared::Identifier& getStreamId() const { return streamId; }
+    const iggy::model::shared::Identifier& getTopicId() const { return topicId; }
 };
 
 class CreateConsumerGroup : Command {
@@ -351,8 +382,8 @@ public:
         , topicId(topicId)
         , consumerGroupId(consumerGroupId) {}
 
-    iggy::model::shared::Identifier getStreamId() const { return streamId; }
-    iggy::model::shared::Identifier getTopicId() const { return topicId; }
+    const iggy::model::shared::Identifier& getStreamId() const { return streamId; }
+    const iggy::model::shared::Identifier& getTopicId() const { return topicId; }
     uint32_t getConsumerGroupId() const { return consumerGroupId; }
 };
 
@@ -368,8 +399,8 @@ public:
         , topicId(topicId)
         , consumerGroupId(consumerGroupId) {}
 
-    iggy::model::shared::Identifier getStreamId() const { return streamId; }
-    iggy::model::shared::Identifier getTopicId() const { return topicId; }
+    const iggy::model::shared::Identifier& getStreamId() const { return streamId; }
+    const iggy::model::shared::Identifier& getTopicId() const { return topicId; }
     uint32_t getConsumerGroupId() const { return consumerGroupId; }
 };
 
@@ -385,8 +416,8 @@ public:
         , topicId(topicId)
         , consumerGroupId(consumerGroupId) {}
 
-    iggy::model::shared::Identifier getStreamId() const { return streamId; }
-    iggy::model::shared::Identifier getTopicId() const { return topicId; }
+    const iggy::model::shared::Identifier& getStreamId() const { return streamId; }
+    const iggy::model::shared::Identifier& getTopicId() const { return topicId; }
     uint32_t getConsumerGroupId() const { return consumerGroupId; }
 };
 
@@ -402,13 +433,35 @@ public:
         , topicId(topicId)
         , consumerGroupId(consumerGroupId) {}
 
-    iggy::model::shared::Identifier getStreamId() const { return streamId; }
-    iggy::model::shared::Identifier getTopicId() const { return topicId; }
+    const iggy::model::shared::Identifier& getStreamId() const { return streamId; }
+    const iggy::model::shared::Identifier& getTopicId() const { return topicId; }
     uint32_t getConsumerGroupId() const { return consumerGroupId; }
 };
 
 }  // namespace consumergroup
 
+/**
+ * @brief Commands related to user authentication.
+ */
+namespace user {
+/**
+ * @brief Command to authenticate the connection with a username and password.
+ */
+class LoginUser : Command {
+private:
+    std::string username;
+    std::string password;
+
+public:
+    LoginUser(std::string username, std::string password)
+        : username(std::move(username))
+        , password(std::move(password)) {}
+
+    const std::string& getUsername() const { return username; }
+    const std::string& getPassword() const { return password; }
+};
+}  // namespace user
+
 /**
  * @brief Commands related to global system state.
  */
@@ -0,0 +1,308 @@
+#include "compression.h"
+#include <fmt/format.h>
+#include <lz4frame.h>
+#include <lz4hc.h>
+#include <zstd.h>
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include "encryption.h"
+#include "serialization.h"
+
+namespace {
+/**
+ * @brief Codec contexts reused by every batch a thread compresses or decompresses, so that their tables and match state
+ * are allocated once per thread rather than once per message.
+ */
+struct Contexts {
+    std::unique_ptr<LZ4F_cctx, decltype(&LZ4F_freeCompressionContext)> lz4Compress{nullptr, &LZ4F_freeCompressionContext};
+    std::unique_ptr<LZ4F_dctx, decltype(&LZ4F_freeDecompressionContext)> lz4Decompress{nullptr, &LZ4F_freeDecompressionContext};
+    std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> zstdCompress{ZSTD_createCCtx(), &ZSTD_freeCCtx};
+    std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> zstdDecompress{ZSTD_createDCtx(), &ZSTD_freeDCtx};
+
+    Contexts() {
+        LZ4F_cctx* compress = nullptr;
+        LZ4F_dctx* decompress = nullptr;
+        bool failed = LZ4F_isError(LZ4F_createCompressionContext(&compress, LZ4F_VERSION));
+        this->lz4Compress.reset(compress);
+        failed |= LZ4F_isError(LZ4F_createDecompressionContext(&decompress, LZ4F_VERSION));
+        this->lz4Decompress.reset(decompress);
+        if (failed || !this->zstdCompress || !this->zstdDecompress) {
+            throw std::bad_alloc();
+        }
+    }
+};
+
+/// @brief Gets the calling thread's codec contexts, creating them on first use.
+Contexts& getContexts() {
+    thread_local Contexts contexts;
+    return contexts;
+}
+
+/// @brief Reads the uncompressed length a frame records in its header, rejecting frames that do not record it.
+size_t decompressedLength(iggy::serialization::compression::Codec codec, std::span<const unsigned char> frame) {
+    size_t length;
+    switch (codec) {
+        case iggy::serialization::compression::Codec::LZ4: {
+            LZ4F_dctx* context = getContexts().lz4Decompress.get();
+            LZ4F_frameInfo_t info = LZ4F_INIT_FRAMEINFO;
+            size_t consumed = frame.size();
+            size_t result = LZ4F_getFrameInfo(context, &info, frame.data(), &consumed);
+            LZ4F_resetDecompressionContext(context);
+            if (LZ4F_isError(result)) {
+                throw std::runtime_error(fmt::format("Invalid LZ4 frame: {}", LZ4F_getErrorName(result)));
+            }
+            // an LZ4 frame records 0 when its length is unknown; an empty payload is never compressed, so 0 cannot be genuine
+            if (info.contentSize == 0) {
+                throw std::runtime_error("LZ4 frame does not record its decompressed length");
+            }
+            length = static_cast<size_t>(info.contentSize);
+            break;
+        }
+        case iggy::serialization::compression::Codec::ZSTD: {
+            unsigned long long recorded = ZSTD_getFrameContentSize(frame.data(), frame.size());
+            if (recorded == ZSTD_CONTENTSIZE_ERROR) {
+                throw std::runtime_error("Invalid Zstd frame");
+            }
+            if (recorded == ZSTD_CONTENTSIZE_UNKNOWN) {
+                throw std::runtime_error("Zstd frame does not record its decompressed length");
+            }
+            length = static_cast<size_t>(recorded);
+            break;
+        }
+        default:
+            return frame.size();
+    }
+    if (length > iggy::serialization::compression::MAX_DECOMPRESSED_LENGTH) {
+        throw std::runtime_error(fmt::format("Compressed payload claims {} bytes, more than the limit of {}", length,
+                                             iggy::serialization::compression::MAX_DECOMPRESSED_LENGTH));
+    }
+    return length;
+}
+
+/// @brief Decompresses a frame into out, which must be exactly the length the frame records.
+void decompressInto(iggy::serialization::compression::Codec codec, std::span<const unsigned char> frame, std::span<unsigned char> out) {
+    switch (codec) {
+        case iggy::serialization::compression::Codec::LZ4: {
+            LZ4F_dctx* context = getContexts().lz4Decompress.get();
+            size_t written = out.size();
+            size_t consumed = frame.size();
+            size_t result = LZ4F_decompress(context, out.data(), &written, frame.data(), &consumed, nullptr);
+
+            // a complete frame decodes in one call given the whole output; anything left over means it was cut short
+            if (LZ4F_isError(result) || result != 0 || written != out.size()) {
+                LZ4F_resetDecompressionContext(context);
+                throw std::runtime_error(fmt::format("Corrupt LZ4 frame: {}",
+                                                     LZ4F_isError(result) ? LZ4F_getErrorName(result) : "truncated"));
+            }
+            break;
+        }
+        case iggy::serialization::compression::Codec::ZSTD: {
+            size_t result = ZSTD_decompressDCtx(getContexts().zstdDecompress.get(), out.data(), out.size(), frame.data(), frame.size());
+            if (ZSTD_isError(result) || result != out.size()) {
+                throw std::runtime_error(
+                    fmt::format("Corrupt Zstd frame: {}", ZSTD_isError(result) ? ZSTD_getErrorName(result) : "length mismatch"));
+            }
+            break;
+        }
+        default:
+            std::copy(frame.begin(), frame.end(), out.begin());
+    }
+}
+
+/// @brief Gets the codec a polled message was compressed with, if it carries a codec header this client understands and
+/// its payload is not still sealed, which happens when the client has no encryptor to open it with.
+std::optional<iggy::serialization::compression::Codec> findMessageCodec(const iggy::model::message::MessageView& message) {
+    auto header = message.findHeader(iggy::serialization::compression::CODEC_HEADER);
+    if (!header || message.findHeader(iggy::serialization::encryption::CIPHER_HEADER) ||
+        header->getKind() != iggy::model::message::STRING) {
+        return std::nullopt;
+    }
+    auto value = header->getValue();
+    auto codec = iggy::serialization::compression::findCodec(std::string_view(reinterpret_cast<const char*>(value.data()), value.size()));
+    if (codec == iggy::serialization::compression::Codec::NONE) {
+        return std::nullopt;
+    }
+    return codec;
+}
+}  // namespace
+
+std::string_view iggy::serialization::compression::getCodecName(Codec codec) {
+    switch (codec) {
+        case Codec::NONE:
+            return "none";
+        case Codec::LZ4:
+            return "lz4";
+        case Codec::ZSTD:
+            return "zstd";
+        default:
+            throw std::invalid_argument(fmt::format("Unknown compression codec {}", static_cast<int>(codec)));
+    }
+}
+
+std::optional<iggy::serialization::compression::Codec> iggy::serialization::compression::findCodec(std::string_view name) {
+    for (Codec codec : {Codec::NONE, Codec::LZ4, Codec::ZSTD}) {
+        if (getCodecName(codec) == name) {
+            return codec;
+        }
+    }
+    return std::nullopt;
+}
+
+void iggy::serialization::compression::validateLevel(Codec codec, int level) {
+    int minimum = 0;
+    int maximum = 0;
+    switch (codec) {
+        case Codec::NONE:
+            break;
+        case Codec::LZ4:
+            maximum = LZ4HC_CLEVEL_MAX;
+            break;
+        case Codec::ZSTD:
+            minimum = ZSTD_minCLevel();
+            maximum = ZSTD_maxCLevel();
+            break;
+        default:
+            throw std::invalid_argument(fmt::format("Unknown compression codec {}", static_cast<int>(codec)));
+    }
+    if (level < minimum || level > maximum) {
+        throw std::invalid_argument(
+            fmt::format("Compression level {} is out of range for {}: must be {} to {}", level, getCodecName(codec), minimum, maximum));
+    }
+}
+
+std::vector<unsigned char> iggy::serialization::compression::compress(Codec codec, int level, std::span<const unsigned char> payload) {
+    std::vector<unsigned char> out;
+    switch (codec) {
+        case Codec::LZ4: {
+            LZ4F_preferences_t preferences = LZ4F_INIT_PREFERENCES;
+            preferences.frameInfo.contentSize = payload.size();
+            preferences.compressionLevel = level;
+            LZ4F_cctx* context = getContexts().lz4Compress.get();
+            out.resize(LZ4F_compressFrameBound(payload.size(), &preferences));
+            size_t written = LZ4F_compressBegin(context, out.data(), out.size(), &preferences);
+            if (!LZ4F_isError(written)) {
+                size_t result = LZ4F_compressUpdate(context, out.data() + written, out.size() - written, payload.data(), payload.size(),
+                                                    nullptr);
+                written = LZ4F_isError(result) ? result : written + result;
+            }
+            if (!LZ4F_isError(written)) {
+                size_t result = LZ4F_compressEnd(context, out.data() + written, out.size() - written, nullptr);
+                written = LZ4F_isError(result) ? result : written + result;
+            }
+            if (LZ4F_isError(written)) {
+                throw std::runtime_error(fmt::format("LZ4 compression failed: {}", LZ4F_getErrorName(written)));
+            }
+            out.resize(written);
+            break;
+        }
+        case Codec::ZSTD: {
+            out.resize(ZSTD_compressBound(payload.size()));
+            size_t written = ZSTD_compressCCtx(getContexts().zstdCompress.get(), out.data(), out.size(), payload.data(), payload.size(),
+                                               level == 0 ? ZSTD_CLEVEL_DEFAULT : level);
+            if (ZSTD_isError(written)) {
+                throw std::runtime_error(fmt::format("Zstd compression failed: {}", ZSTD_getErrorName(written)));
+            }
+            out.resize(written);
+            break;
+        }
+        default:
+            out.assign(payload.begin(), payload.end());
+    }
+    return out;
+}
+
+std::vector<unsigned char> iggy::serialization::compression::decompress(Codec codec, std::span<const unsigned char> frame) {
+    std::vector<unsigned char> out(decompressedLength(codec, frame));
+    decompressInto(codec, frame, out);
+    return out;
+}
+
+std::optional<iggy::command::message::SendMessages> iggy::serialization::compression::compressMessages(
+    const iggy::command::message::SendMessages& command,
+    Codec codec,
+    int level) {
+    if (codec == Codec::NONE) {
+        return std::nullopt;
+    }
+    std::string_view name = getCodecName(codec);
+    std::span<const unsigned char> nameBytes(reinterpret_cast<const unsigned char*>(name.data()), name.size());
+    size_t headerLength = iggy::serialization::HEADER_ENTRY_OVERHEAD + CODEC_HEADER.size() + name.size();
+
+    // compress first and keep only the frames that pay for their header; a frame is never empty, so an empty entry marks a
+    // message that is sent as it is
+    const auto& originals = command.getMessages();
+    std::vector<std::vector<unsigned char>> frames(originals.size());
+    bool shrank = false;
+    for (size_t i = 0; i < originals.size(); i++) {
+        const auto& message = originals[i];
+        if (message.getHeaders().contains(CODEC_HEADER)) {
+            continue;
+        }
+        auto compressed = compress(codec, level, message.getPayload());
+        if (compressed.size() + headerLength < message.getPayload().size()) {
+            frames[i] = std::move(compressed);
+            shrank = true;
+        }
+    }
+    if (!shrank) {
+        return std::nullopt;
+    }
+
+    std::vector<iggy::model::message::Message> messages;
+    messages.reserve(originals.size());
+    for (size_t i = 0; i < originals.size(); i++) {
+        const auto& message = originals[i];
+        if (frames[i].empty()) {
+            messages.push_back(iggy::model::message::Message::borrow(message));
+            continue;
+        }
+        iggy::model::message::Headers headers;
+        headers.reserve(message.getHeaders().size() + 1);
+        for (const auto& [key, value] : message.getHeaders()) {
+            headers.emplace(key, value);
+        }
+        headers.emplace(iggy::model::message::HeaderKey(CODEC_HEADER),
+                        iggy::model::message::HeaderValue(iggy::model::message::STRING, nameBytes));
+        auto length = static_cast<uint32_t>(frames[i].size());
+        messages.emplace_back(message.getId(), std::move(headers), length, std::move(frames[i]));
+    }
+    return iggy::command::message::SendMessages(command.getStreamId(), command.getTopicId(), command.getPartitioning(),
+                                                std::move(messages));
+}
+
+iggy::model::message::PolledMessagesView iggy::serialization::compression::decompressMessages(
+    const iggy::model::message::PolledMessagesView& messages) {
+    // most batches carry no compressed messages at all, so look before allocating anything
+    const auto& views = messages.getMessages();
+    size_t first = 0;
+    while (first < views.size() && !findMessageCodec(views[first])) {
+        first++;
+    }
+    if (first == views.size()) {
+        return messages;
+    }
+
+    // check the lengths the frames record before anything is allocated, so that a batch claiming too much is rejected
+    std::vector<iggy::serialization::PayloadRewrite> rewrites;
+    std::vector<Codec> codecs;
+    size_t total = 0;
+    for (size_t i = first; i < views.size(); i++) {
+        if (auto codec = findMessageCodec(views[i])) {
+            size_t length = decompressedLength(*codec, views[i].getPayload());
+            total += length;
+            if (total > MAX_DECOMPRESSED_BATCH_LENGTH) {
+                throw std::runtime_error(fmt::format("Compressed batch claims more than the limit of {} bytes once decompressed",
+                                                     MAX_DECOMPRESSED_BATCH_LENGTH));
+            }
+            rewrites.push_back(iggy::serialization::PayloadRewrite{i, length});
+            codecs.push_back(*codec);
+        }
+    }
+
+    const std::string_view dropped[] = {CODEC_HEADER};
+    return iggy::serialization::rewriteMessages(messages, rewrites, dropped, [&](size_t i, std::span<unsigned char> out) {
+        decompressInto(codecs[i], views[rewrites[i].index].getPayload(), out);
+    });
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+#include "command.h"
+#include "model.h"
+
+namespace iggy {
+namespace serialization {
+
+/**
+ * @namespace compression
+ * @brief Client-side compression of message payloads, applied per batch on send and undone transparently on poll.
+ *
+ * The server stores whatever payload it is given, so the codec travels with each message in the reserved
+ * @ref CODEC_HEADER header, a STRING holding the codec name. Any client that knows the header can decompress the message;
+ * one that does not sees the compressed payload and the header as they are.
+ */
+namespace compression {
+
+/**
+ * @brief The compression codecs a client can apply to the payloads it sends.
+ */
+enum class Codec { NONE = 0, LZ4 = 1, ZSTD = 2 };
+
+/**
+ * @brief Key of the header that records the codec a payload was compressed with.
+ */
+const std::string_view CODEC_HEADER = "iggy-compression";
+
+/**
+ * @brief Largest payload a compressed frame may decompress to; a frame claiming more is rejected rather than allocated.
+ */
+const size_t MAX_DECOMPRESSED_LENGTH = 64 * 1024 * 1024;
+
+/**
+ * @brief Largest total the payloads of a polled batch may decompress to; a batch whose frames claim more is rejected
+ * before anything is allocated.
+ */
+const size_t MAX_DECOMPRESSED_BATCH_LENGTH = 256 * 1024 * 1024;
+
+/**
+ * @brief Gets the name recorded in @ref CODEC_HEADER for a codec: none, lz4 or zstd.
+ */
+std::string_view getCodecName(Codec codec);
+
+/**
+ * @brief Looks up a codec by the name recorded in @ref CODEC_HEADER.
+ * @return The codec, or nothing if the name is not one this client knows.
+ */
+std::optional<Codec> findCodec(std::string_view name);
+
+/**
+ * @brief Checks that a compression level is valid for the codec; 0 always is and selects the codec's default.
+ *
+ * LZ4 takes levels 1 to 12, with 3 and up using its high-compression mode, and Zstd takes its negative fast levels up to 22.
+ * @throws std::invalid_argument if the level is out of range.
+ */
+void validateLevel(Codec codec, int level);
+
+/**
+ * @brief Compresses a payload into one self-describing frame, which records the uncompressed length.
+ */
+std::vector<unsigned char> compress(Codec codec, int level, std::span<const unsigned char> payload);
+
+/**
+ * @brief Decompresses a frame made by @ref compress.
+ * @throws std::runtime_error if the frame is corrupt, does not record its length, or exceeds @ref MAX_DECOMPRESSED_LENGTH.
+ */
+std::vector<unsigned char> decompress(Codec codec, std::span<const unsigned char> frame);
+
+/**
+ * @brief Compresses the payloads of a batch about to be sent, recording the codec in each compressed message's headers.
+ *
+ * A message is left as it is if compression would not make it smaller, counting the added header, or if it already
+ * carries a @ref CODEC_HEADER, e.g. when forwarding polled messages that were not decompressed. Compressed messages drop
+ * any checksum they carried, which no longer matches their payload. Every payload is compressed before anything is copied,
+ * so a batch in which nothing gets smaller costs no more than the attempt.
+ * @return The batch to send, or nothing if no message got smaller, in which case the original is sent as it is. Messages
+ * left as they are borrow their payload from the original batch, which must outlive the result.
+ */
+std::optional<iggy::command::message::SendMessages> compressMessages(const iggy::command::message::SendMessages& command,
+                                                                    Codec codec,
+                                                                    int level);
+
+/**
+ * @brief Undoes @ref compressMessages on a polled batch.
+ *
+ * A batch without compressed messages is returned as it is. Otherwise the compressed payloads are decompressed, with their
+ * headers minus @ref CODEC_HEADER, into one new buffer that also keeps the original alive, and those messages get the
+ * CRC-32 of their decompressed payload as their checksum, so that they can be verified and forwarded like any other.
+ * Messages compressed with a codec this client does not know, or whose payload is still sealed because they were polled
+ * without an encryptor, are left compressed.
+ * @throws std::runtime_error if a compressed payload is corrupt, or if the batch would decompress to more than
+ * @ref MAX_DECOMPRESSED_BATCH_LENGTH.
+ */
+iggy::model::message::PolledMessagesView decompressMessages(const iggy::model::message::PolledMessagesView& messages);
+
+}  // namespace compression
+}  // namespace serialization
+}  // namespace iggy
@@ -0,0 +1,130 @@
+#include "crc32.h"
+#include <array>
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define IGGY_HAVE_X86_SIMD 1
+#endif
+
+namespace {
+/// @brief The IEEE 802.3 polynomial in the bit-reflected form used by zlib.
+const uint32_t POLYNOMIAL = 0xedb88320;
+
+using Tables = std::array<std::array<uint32_t, 256>, 8>;
+
+/**
+ * @brief Builds the slicing-by-8 tables: table k maps a byte to its CRC contribution when followed by k zero bytes.
+ */
+constexpr Tables makeTables() {
+    Tables tables = {};
+    for (uint32_t byte = 0; byte < 256; byte++) {
+        uint32_t crc = byte;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (POLYNOMIAL & (0 - (crc & 1)));
+        }
+        tables[0][byte] = crc;
+    }
+    for (uint32_t byte = 0; byte < 256; byte++) {
+        for (size_t k = 1; k < 8; k++) {
+            tables[k][byte] = (tables[k - 1][byte] >> 8) ^ tables[0][tables[k - 1][byte] & 0xff];
+        }
+    }
+    return tables;
+}
+
+constexpr Tables TABLES = makeTables();
+
+using Folder = uint32_t (*)(uint32_t crc, const unsigned char* data, size_t length);
+
+/// @brief Updates a running, pre-inverted CRC with length bytes using the tables, eight bytes per step.
+uint32_t updateScalar(uint32_t crc, const unsigned char* data, size_t length) {
+    for (; length >= 8; data += 8, length -= 8) {
+        uint32_t low = crc ^ (static_cast<uint32_t>(data[0]) | static_cast<uint32_t>(data[1]) << 8 | static_cast<uint32_t>(data[2]) << 16 |
+                              static_cast<uint32_t>(data[3]) << 24);
+        crc = TABLES[7][low & 0xff] ^ TABLES[6][(low >> 8) & 0xff] ^ TABLES[5][(low >> 16) & 0xff] ^ TABLES[4][low >> 24] ^
+              TABLES[3][data[4]] ^ TABLES[2][data[5]] ^ TABLES[1][data[6]] ^ TABLES[0][data[7]];
+    }
+    for (; length > 0; data++, length--) {
+        crc = (crc >> 8) ^ TABLES[0][(crc ^ *data) & 0xff];
+    }
+    return crc;
+}
+
+#if defined(IGGY_HAVE_X86_SIMD)
+__m128i load(const unsigned char* at) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(at));
+}
+
+/// @brief Folds a 128-bit accumulator forward over the distance the constants encode and adds in the next block.
+__attribute__((target("pclmul"))) __m128i fold(__m128i accumulator, __m128i constants, __m128i next) {
+    __m128i low = _mm_clmulepi64_si128(accumulator, constants, 0x00);
+    __m128i high = _mm_clmulepi64_si128(accumulator, constants, 0x11);
+    return _mm_xor_si128(_mm_xor_si128(high, low), next);
+}
+
+/**
+ * @brief Updates a running, pre-inverted CRC by folding with carry-less multiplication, after Gopal et al., "Fast CRC
+ * Computation for Generic Polynomials Using PCLMULQDQ Instruction" (Intel, 2009).
+ *
+ * Four 128-bit accumulators are folded across each 64-byte block, then into one, then over any remaining 16-byte blocks,
+ * and finally reduced to 32 bits with a Barrett reduction; the bytes past the last whole 16-byte block go to the tables.
+ * The constants are the paper's bit-reflected powers of x modulo the polynomial.
+ */
+__attribute__((target("pclmul,sse4.1"))) uint32_t updatePclmul(uint32_t crc, const unsigned char* data, size_t length) {
+    if (length < 64) {
+        return updateScalar(crc, data, length);
+    }
+    __m128i x1 = _mm_xor_si128(load(data), _mm_cvtsi32_si128(static_cast<int>(crc)));
+    __m128i x2 = load(data + 16);
+    __m128i x3 = load(data + 32);
+    __m128i x4 = load(data + 48);
+    data += 64;
+    length -= 64;
+
+    const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+    for (; length >= 64; data += 64, length -= 64) {
+        x1 = fold(x1, k1k2, load(data));
+        x2 = fold(x2, k1k2, load(data + 16));
+        x3 = fold(x3, k1k2, load(data + 32));
+        x4 = fold(x4, k1k2, load(data + 48));
+    }
+
+    const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+    x1 = fold(x1, k3k4, x2);
+    x1 = fold(x1, k3k4, x3);
+    x1 = fold(x1, k3k4, x4);
+    for (; length >= 16; data += 16, length -= 16) {
+        x1 = fold(x1, k3k4, load(data));
+    }
+
+    // 128 bits down to 64
+    const __m128i low32 = _mm_setr_epi32(~0, 0, ~0, 0);
+    x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+    const __m128i k5 = _mm_set_epi64x(0, 0x0163cd6124);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(x1, low32), k5, 0x00), x2);
+
+    // Barrett reduction down to 32
+    const __m128i barrett = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+    x2 = _mm_clmulepi64_si128(_mm_and_si128(x1, low32), barrett, 0x10);
+    x2 = _mm_clmulepi64_si128(_mm_and_si128(x2, low32), barrett, 0x00);
+    crc = static_cast<uint32_t>(_mm_extract_epi32(_mm_xor_si128(x1, x2), 1));
+    return updateScalar(crc, data, length);
+}
+#endif
+
+/// @brief Picks the carry-less multiplication folder when the CPU supports it.
+Folder selectFolder() {
+#if defined(IGGY_HAVE_X86_SIMD)
+    if (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1")) {
+        return updatePclmul;
+    }
+#endif
+    return updateScalar;
+}
+}  // namespace
+
+uint32_t iggy::serialization::crc32::checksum(const unsigned char* data, size_t length) {
+    static const Folder update = selectFolder();
+    return ~update(~0u, data, length);
+}
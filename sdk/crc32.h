@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace iggy {
+namespace serialization {
+
+/**
+ * @namespace crc32
+ * @brief The CRC-32 the Iggy server stores as each message's checksum: the IEEE 802.3 polynomial, as in zlib and crc32fast.
+ */
+namespace crc32 {
+
+/**
+ * @brief Computes the checksum of length bytes.
+ *
+ * Folds 64 bytes at a time with carry-less multiplication (PCLMULQDQ) when the CPU has it and falls back to a
+ * slicing-by-8 table otherwise. Note that the SSE4.2 crc32 instruction cannot be used: it implements the Castagnoli
+ * polynomial (CRC-32C), which gives different checksums.
+ */
+uint32_t checksum(const unsigned char* data, size_t length);
+
+}  // namespace crc32
+}  // namespace serialization
+}  // namespace iggy
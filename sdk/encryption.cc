@@ -0,0 +1,443 @@
+#include "encryption.h"
+#include <fmt/format.h>
+#include <sodium.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include "compression.h"
+#include "serialization.h"
+
+namespace {
+using AeadEncrypt = int (*)(unsigned char* c,
+                            unsigned long long* clen,
+                            const unsigned char* m,
+                            unsigned long long mlen,
+                            const unsigned char* ad,
+                            unsigned long long adlen,
+                            const unsigned char* nsec,
+                            const unsigned char* npub,
+                            const unsigned char* k);
+using AeadDecrypt = int (*)(unsigned char* m,
+                            unsigned long long* mlen,
+                            unsigned char* nsec,
+                            const unsigned char* c,
+                            unsigned long long clen,
+                            const unsigned char* ad,
+                            unsigned long long adlen,
+                            const unsigned char* npub,
+                            const unsigned char* k);
+
+/// @brief The libsodium entry points and sizes of one AEAD cipher in combined mode.
+struct Aead {
+    size_t nonceLength;
+    size_t tagLength;
+    AeadEncrypt encrypt;
+    AeadDecrypt decrypt;
+};
+
+const Aead XCHACHA20_POLY1305 = {crypto_aead_xchacha20poly1305_ietf_NPUBBYTES, crypto_aead_xchacha20poly1305_ietf_ABYTES,
+                                 crypto_aead_xchacha20poly1305_ietf_encrypt, crypto_aead_xchacha20poly1305_ietf_decrypt};
+const Aead AES256_GCM = {crypto_aead_aes256gcm_NPUBBYTES, crypto_aead_aes256gcm_ABYTES, crypto_aead_aes256gcm_encrypt,
+                         crypto_aead_aes256gcm_decrypt};
+
+const Aead& getAead(iggy::serialization::encryption::Cipher cipher) {
+    return cipher == iggy::serialization::encryption::Cipher::AES256_GCM ? AES256_GCM : XCHACHA20_POLY1305;
+}
+
+/// @brief Views a string as the bytes of a header value or associated data.
+std::span<const unsigned char> asBytes(std::string_view value) {
+    return std::span<const unsigned char>(reinterpret_cast<const unsigned char*>(value.data()), value.size());
+}
+
+/// @brief Reads a STRING header of a polled message.
+std::optional<std::string_view> findString(const iggy::model::message::MessageView& message, std::string_view key) {
+    auto header = message.findHeader(key);
+    if (!header || header->getKind() != iggy::model::message::STRING) {
+        return std::nullopt;
+    }
+    return std::string_view(reinterpret_cast<const char*>(header->getValue().data()), header->getValue().size());
+}
+
+/**
+ * @brief Builds the associated data a payload is sealed with, which binds the sealed payload to its message: it fails to
+ * open once moved to another message, or once its message ID, key ID, cipher or codec header has been changed, removed or
+ * added. Every field is length-prefixed, so that no two different sets of fields encode the same.
+ * @param codec The kind and value of the message's codec header, if it has one.
+ */
+std::vector<unsigned char> makeAssociatedData(uint128_t id,
+                                              std::string_view keyId,
+                                              std::string_view cipherName,
+                                              const std::optional<iggy::model::message::HeaderValueView>& codec) {
+    iggy::serialization::ByteWriter out(16 + 4 + keyId.size() + 4 + cipherName.size() + 6 + (codec ? codec->getValue().size() : 0));
+    out.writeLittleEndian<uint64_t>(static_cast<uint64_t>(id));
+    out.writeLittleEndian<uint64_t>(static_cast<uint64_t>(id >> 64));
+    out.writeLittleEndian<uint32_t>(static_cast<uint32_t>(keyId.size()));
+    out.writeBytes(asBytes(keyId).data(), keyId.size());
+    out.writeLittleEndian<uint32_t>(static_cast<uint32_t>(cipherName.size()));
+    out.writeBytes(asBytes(cipherName).data(), cipherName.size());
+    out.writeLittleEndian<uint8_t>(codec ? 1 : 0);
+    if (codec) {
+        out.writeLittleEndian<uint8_t>(static_cast<uint8_t>(codec->getKind()));
+        out.writeLittleEndian<uint32_t>(static_cast<uint32_t>(codec->getValue().size()));
+        out.writeBytes(codec->getValue().data(), codec->getValue().size());
+    }
+    return out.take();
+}
+
+/// @brief What opens a sealed message of a polled batch.
+struct SealedMessage {
+    const Aead* aead;
+    const unsigned char* key;
+    std::string_view keyId;
+    std::string_view cipherName;
+};
+}  // namespace
+
+/**
+ * @brief Fixed pool of threads that run one batch at a time: every thread, the caller's included, claims message indices
+ * from a shared counter until the batch is done, so messages of uneven size still spread evenly.
+ */
+struct iggy::serialization::encryption::PayloadEncryptor::Workers {
+    std::vector<std::thread> threads;
+
+    // held by the caller for the whole batch; a caller that cannot take it runs its batch alone
+    std::mutex batchMutex;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    const std::function<void(size_t)>* task = nullptr;
+    size_t count = 0;
+    std::atomic<size_t> next = 0;
+    size_t running = 0;
+    uint64_t generation = 0;
+    bool stopping = false;
+    std::exception_ptr error;
+
+    explicit Workers(size_t threadCount) {
+        for (size_t i = 0; i < threadCount; i++) {
+            this->threads.emplace_back([this] { this->work(); });
+        }
+    }
+
+    ~Workers() {
+        {
+            std::lock_guard lock(this->mutex);
+            this->stopping = true;
+        }
+        this->wake.notify_all();
+        for (auto& thread : this->threads) {
+            thread.join();
+        }
+    }
+
+    void drain() {
+        for (size_t i = this->next++; i < this->count; i = this->next++) {
+            try {
+                (*this->task)(i);
+            } catch (...) {
+                std::lock_guard lock(this->mutex);
+                if (!this->error) {
+                    this->error = std::current_exception();
+                }
+                this->next = this->count;
+            }
+        }
+    }
+
+    void work() {
+        uint64_t seen = 0;
+        while (true) {
+            {
+                std::unique_lock lock(this->mutex);
+                this->wake.wait(lock, [this, seen] { return this->stopping || this->generation != seen; });
+                if (this->stopping) {
+                    return;
+                }
+                seen = this->generation;
+            }
+            this->drain();
+            std::lock_guard lock(this->mutex);
+            if (--this->running == 0) {
+                this->finished.notify_one();
+            }
+        }
+    }
+
+    void run(size_t batchCount, const std::function<void(size_t)>& batchTask) {
+        {
+            std::lock_guard lock(this->mutex);
+            this->task = &batchTask;
+            this->count = batchCount;
+            this->next = 0;
+            this->running = this->threads.size();
+            this->error = nullptr;
+            this->generation++;
+        }
+        this->wake.notify_all();
+        this->drain();
+
+        std::unique_lock lock(this->mutex);
+        this->finished.wait(lock, [this] { return this->running == 0; });
+        this->task = nullptr;
+        if (this->error) {
+            std::rethrow_exception(this->error);
+        }
+    }
+};
+
+std::string_view iggy::serialization::encryption::getCipherName(Cipher cipher) {
+    switch (cipher) {
+        case Cipher::XCHACHA20_POLY1305:
+            return "xchacha20-poly1305";
+        case Cipher::AES256_GCM:
+            return "aes-256-gcm";
+        default:
+            throw std::invalid_argument(fmt::format("Unknown cipher {}", static_cast<int>(cipher)));
+    }
+}
+
+std::optional<iggy::serialization::encryption::Cipher> iggy::serialization::encryption::findCipher(std::string_view name) {
+    for (Cipher cipher : {Cipher::XCHACHA20_POLY1305, Cipher::AES256_GCM}) {
+        if (getCipherName(cipher) == name) {
+            return cipher;
+        }
+    }
+    return std::nullopt;
+}
+
+bool iggy::serialization::encryption::isAvailable(Cipher cipher) {
+    return sodium_init() >= 0 && (cipher != Cipher::AES256_GCM || crypto_aead_aes256gcm_is_available());
+}
+
+iggy::serialization::encryption::PayloadEncryptor::PayloadEncryptor(Cipher cipher, std::optional<size_t> workerCount)
+    : cipher(cipher) {
+    if (sodium_init() < 0) {
+        throw std::runtime_error("Failed to initialize libsodium");
+    }
+    if (!isAvailable(cipher)) {
+        throw std::runtime_error(fmt::format("The {} cipher needs hardware support this CPU lacks", getCipherName(cipher)));
+    }
+    size_t cpus = std::max(std::thread::hardware_concurrency(), 1u);
+    this->workers = std::make_unique<Workers>(workerCount.value_or(cpus - 1));
+}
+
+iggy::serialization::encryption::PayloadEncryptor::~PayloadEncryptor() {
+    for (auto& [keyId, key] : this->keys) {
+        sodium_memzero(key.bytes.data(), key.bytes.size());
+    }
+}
+
+std::array<unsigned char, iggy::serialization::encryption::KEY_LENGTH> iggy::serialization::encryption::PayloadEncryptor::generateKey() {
+    if (sodium_init() < 0) {
+        throw std::runtime_error("Failed to initialize libsodium");
+    }
+    std::array<unsigned char, KEY_LENGTH> key;
+    randombytes_buf(key.data(), key.size());
+    return key;
+}
+
+uint64_t iggy::serialization::encryption::PayloadEncryptor::getSealLimit() const {
+    return this->cipher == Cipher::AES256_GCM ? MAX_AES256_GCM_SEALS : UINT64_MAX;
+}
+
+void iggy::serialization::encryption::PayloadEncryptor::addKey(const std::string& keyId,
+                                                                std::span<const unsigned char> key,
+                                                                uint64_t sealCount) {
+    if (keyId.empty()) {
+        throw std::invalid_argument("Key ID cannot be empty");
+    }
+    if (key.size() != KEY_LENGTH) {
+        throw std::invalid_argument(fmt::format("Key {} is {} bytes long, but must be {}", keyId, key.size(), KEY_LENGTH));
+    }
+    std::unique_lock lock(this->keysMutex);
+    auto [entry, added] = this->keys.try_emplace(keyId);
+    if (!added) {
+        throw std::invalid_argument(fmt::format("Key {} has already been added", keyId));
+    }
+    std::copy(key.begin(), key.end(), entry->second.bytes.begin());
+    entry->second.sealCount = sealCount;
+    if (this->activeKeyId.empty()) {
+        this->activeKeyId = keyId;
+    }
+}
+
+void iggy::serialization::encryption::PayloadEncryptor::setActiveKey(const std::string& keyId) {
+    std::unique_lock lock(this->keysMutex);
+    auto key = this->keys.find(keyId);
+    if (key == this->keys.end()) {
+        throw std::invalid_argument(fmt::format("No key with ID {}", keyId));
+    }
+    if (key->second.sealCount >= this->getSealLimit()) {
+        throw std::invalid_argument(
+            fmt::format("Key {} has sealed the {} payloads an {} key may seal", keyId, this->getSealLimit(), getCipherName(this->cipher)));
+    }
+    this->activeKeyId = keyId;
+}
+
+uint64_t iggy::serialization::encryption::PayloadEncryptor::getSealCount(const std::string& keyId) const {
+    std::shared_lock lock(this->keysMutex);
+    auto key = this->keys.find(keyId);
+    if (key == this->keys.end()) {
+        throw std::invalid_argument(fmt::format("No key with ID {}", keyId));
+    }
+    return key->second.sealCount;
+}
+
+void iggy::serialization::encryption::PayloadEncryptor::forEach(size_t count,
+                                                                 bool parallel,
+                                                                 const std::function<void(size_t)>& task) const {
+    if (parallel && count > 1 && !this->workers->threads.empty()) {
+        std::unique_lock batch(this->workers->batchMutex, std::try_to_lock);
+        if (batch) {
+            this->workers->run(count, task);
+            return;
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        task(i);
+    }
+}
+
+iggy::command::message::SendMessages iggy::serialization::encryption::PayloadEncryptor::seal(
+    const iggy::command::message::SendMessages& command) const {
+    std::shared_lock lock(this->keysMutex);
+    if (this->activeKeyId.empty()) {
+        throw std::invalid_argument("No encryption key has been added");
+    }
+    const Aead& aead = getAead(this->cipher);
+    const Key& active = this->keys.find(this->activeKeyId)->second;
+    const unsigned char* key = active.bytes.data();
+    auto keyId = asBytes(this->activeKeyId);
+    auto cipherName = getCipherName(this->cipher);
+
+    const auto& messages = command.getMessages();
+    std::vector<std::vector<unsigned char>> sealed(messages.size());
+    size_t total = 0;
+    uint64_t count = 0;
+    for (const auto& message : messages) {
+        if (!message.getHeaders().contains(CIPHER_HEADER)) {
+            total += message.getPayload().size();
+            count++;
+        }
+    }
+
+    // take the whole batch's nonces out of the key's budget before sealing any of it, so that a batch either fits or is
+    // not sealed at all
+    uint64_t limit = this->getSealLimit();
+    uint64_t sealCount = active.sealCount;
+    do {
+        if (sealCount > limit || limit - sealCount < count) {
+            throw std::runtime_error(fmt::format("Key {} cannot seal {} more payloads: an {} key may seal at most {}; add a new key "
+                                                 "and make it active",
+                                                 this->activeKeyId, count, getCipherName(this->cipher), limit));
+        }
+    } while (!active.sealCount.compare_exchange_weak(sealCount, sealCount + count));
+    this->forEach(messages.size(), total >= PARALLEL_THRESHOLD, [&](size_t i) {
+        if (messages[i].getHeaders().contains(CIPHER_HEADER)) {
+            return;
+        }
+        auto payload = messages[i].getPayload();
+        std::optional<iggy::model::message::HeaderValueView> codec;
+        if (const auto* header = messages[i].getHeaders().find(iggy::serialization::compression::CODEC_HEADER)) {
+            codec.emplace(header->getKind(), header->getValue());
+        }
+        auto associated = makeAssociatedData(messages[i].getId(), this->activeKeyId, cipherName, codec);
+        auto& out = sealed[i];
+        out.resize(aead.nonceLength + payload.size() + aead.tagLength);
+        randombytes_buf(out.data(), aead.nonceLength);
+        unsigned long long written = 0;
+        aead.encrypt(out.data() + aead.nonceLength, &written, payload.data(), payload.size(), associated.data(), associated.size(),
+                     nullptr, out.data(), key);
+    });
+
+    std::vector<iggy::model::message::Message> result;
+    result.reserve(messages.size());
+    for (size_t i = 0; i < messages.size(); i++) {
+        const auto& message = messages[i];
+        if (message.getHeaders().contains(CIPHER_HEADER)) {
+            result.push_back(iggy::model::message::Message::borrow(message));
+            continue;
+        }
+        iggy::model::message::Headers headers;
+        headers.reserve(message.getHeaders().size() + 2);
+        for (const auto& [name, value] : message.getHeaders()) {
+            headers.emplace(name, value);
+        }
+        headers.emplace(iggy::model::message::HeaderKey(CIPHER_HEADER),
+                        iggy::model::message::HeaderValue(iggy::model::message::STRING, asBytes(cipherName)));
+        headers.emplace(iggy::model::message::HeaderKey(KEY_ID_HEADER),
+                        iggy::model::message::HeaderValue(iggy::model::message::STRING, keyId));
+        auto length = static_cast<uint32_t>(sealed[i].size());
+        result.emplace_back(message.getId(), std::move(headers), length, std::move(sealed[i]));
+    }
+    return iggy::command::message::SendMessages(command.getStreamId(), command.getTopicId(), command.getPartitioning(), std::move(result));
+}
+
+iggy::model::message::PolledMessagesView iggy::serialization::encryption::PayloadEncryptor::open(
+    const iggy::model::message::PolledMessagesView& messages) const {
+    // most batches of an unencrypted topic carry no sealed messages at all, so look before allocating anything
+    const auto& views = messages.getMessages();
+    size_t first = 0;
+    while (first < views.size() && !views[first].findHeader(CIPHER_HEADER)) {
+        first++;
+    }
+    if (first == views.size()) {
+        return messages;
+    }
+
+    // resolve every key and the length of every plaintext up front, so that the payloads can then be opened in parallel
+    std::shared_lock lock(this->keysMutex);
+    std::vector<iggy::serialization::PayloadRewrite> rewrites;
+    std::vector<SealedMessage> sealed;
+    size_t sealedTotal = 0;
+    for (size_t i = first; i < views.size(); i++) {
+        const auto& view = views[i];
+        if (!view.findHeader(CIPHER_HEADER)) {
+            continue;
+        }
+        auto cipherName = findString(view, CIPHER_HEADER);
+        auto cipher = cipherName ? findCipher(*cipherName) : std::nullopt;
+        if (!cipher || (*cipher == Cipher::AES256_GCM && !crypto_aead_aes256gcm_is_available())) {
+            throw std::runtime_error(fmt::format("Message at offset {} is sealed with an unsupported cipher {}", view.getOffset(),
+                                                 cipherName.value_or("")));
+        }
+        auto keyId = findString(view, KEY_ID_HEADER);
+        auto key = keyId ? this->keys.find(*keyId) : this->keys.end();
+        if (key == this->keys.end()) {
+            throw std::runtime_error(
+                fmt::format("Message at offset {} is sealed with unknown key {}", view.getOffset(), keyId.value_or("")));
+        }
+        const Aead& aead = getAead(*cipher);
+        if (view.getPayload().size() < aead.nonceLength + aead.tagLength) {
+            throw std::runtime_error(fmt::format("Sealed payload at offset {} is too short", view.getOffset()));
+        }
+        rewrites.push_back(iggy::serialization::PayloadRewrite{i, view.getPayload().size() - aead.nonceLength - aead.tagLength});
+        sealed.push_back(SealedMessage{&aead, key->second.bytes.data(), *keyId, *cipherName});
+        sealedTotal += view.getPayload().size();
+    }
+
+    const std::string_view dropped[] = {CIPHER_HEADER, KEY_ID_HEADER};
+    auto openPayload = [&](size_t i, std::span<unsigned char> out) {
+        const auto& view = views[rewrites[i].index];
+        const auto& entry = sealed[i];
+        auto payload = view.getPayload();
+        auto codec = view.findHeader(iggy::serialization::compression::CODEC_HEADER);
+        auto associated = makeAssociatedData(view.getId(), entry.keyId, entry.cipherName, codec);
+        unsigned long long written = 0;
+        if (entry.aead->decrypt(out.data(), &written, nullptr, payload.data() + entry.aead->nonceLength,
+                                payload.size() - entry.aead->nonceLength, associated.data(), associated.size(), payload.data(),
+                                entry.key) != 0) {
+            throw std::runtime_error(fmt::format("Message at offset {} failed authentication", view.getOffset()));
+        }
+    };
+    bool parallel = sealedTotal >= PARALLEL_THRESHOLD;
+    return iggy::serialization::rewriteMessages(messages, rewrites, dropped, openPayload,
+                                                [this, parallel](size_t count, const std::function<void(size_t)>& task) {
+                                                    this->forEach(count, parallel, task);
+                                                });
+}
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "command.h"
+#include "model.h"
+
+namespace iggy {
+namespace serialization {
+
+/**
+ * @namespace encryption
+ * @brief End-to-end encryption of message payloads with libsodium AEAD ciphers, so that the server stores and serves
+ * payloads it cannot read.
+ *
+ * A sealed payload is the random nonce followed by the ciphertext and its authentication tag. The cipher and the ID of
+ * the key travel in the reserved @ref CIPHER_HEADER and @ref KEY_ID_HEADER STRING headers. Keys can be rotated by adding
+ * a new one and making it active; messages sealed with older keys still open as long as those stay in the encryptor.
+ * The message ID, the key ID, the cipher and the codec header are authenticated along with the payload, so a sealed payload
+ * moved to another message, or one whose codec header was tampered with, fails to open. Other headers are neither encrypted
+ * nor authenticated.
+ */
+namespace encryption {
+
+/**
+ * @brief The AEAD ciphers payloads can be sealed with.
+ *
+ * XChaCha20-Poly1305 runs everywhere and its 192-bit random nonces never realistically repeat. AES-256-GCM needs AES-NI
+ * and carry-less multiplication, and is faster on CPUs that have them, but with its 96-bit random nonces a key may seal
+ * at most @ref MAX_AES256_GCM_SEALS payloads.
+ */
+enum class Cipher { XCHACHA20_POLY1305 = 1, AES256_GCM = 2 };
+
+/**
+ * @brief Key of the header that records the cipher a payload was sealed with.
+ */
+const std::string_view CIPHER_HEADER = "iggy-encryption";
+
+/**
+ * @brief Key of the header that records the ID of the key a payload was sealed with.
+ */
+const std::string_view KEY_ID_HEADER = "iggy-encryption-key";
+
+/**
+ * @brief Length of the keys of every supported cipher.
+ */
+const size_t KEY_LENGTH = 32;
+
+/**
+ * @brief Most payloads one AES-256-GCM key may seal. With random 96-bit nonces, NIST SP 800-38D bounds the chance of two
+ * seals sharing a nonce, which would expose the key, to 2^-32 only up to 2^32 invocations per key.
+ */
+const uint64_t MAX_AES256_GCM_SEALS = uint64_t(1) << 32;
+
+/**
+ * @brief Total payload size from which a batch is sealed or opened on the worker pool rather than on the calling thread.
+ */
+const size_t PARALLEL_THRESHOLD = 256 * 1024;
+
+/**
+ * @brief Gets the name recorded in @ref CIPHER_HEADER for a cipher: xchacha20-poly1305 or aes-256-gcm.
+ */
+std::string_view getCipherName(Cipher cipher);
+
+/**
+ * @brief Looks up a cipher by the name recorded in @ref CIPHER_HEADER.
+ * @return The cipher, or nothing if the name is not one this client knows.
+ */
+std::optional<Cipher> findCipher(std::string_view name);
+
+/**
+ * @brief Tests whether the CPU can run a cipher; AES-256-GCM needs hardware support.
+ */
+bool isAvailable(Cipher cipher);
+
+/**
+ * @class PayloadEncryptor
+ * @brief Seals the payloads of batches about to be sent and opens those of polled batches, in parallel for large batches.
+ *
+ * Holds the keys by ID and seals with the active one, counting the payloads each key has sealed. Keys are zeroed when
+ * the encryptor is destroyed. One encryptor can be shared by any number of clients and threads. Concurrent batches each
+ * run on their calling thread when the worker pool is already busy with another.
+ */
+class PayloadEncryptor {
+private:
+    struct Workers;
+
+    /**
+     * @brief A key and the number of payloads sealed with it, which seals running under a shared lock update atomically.
+     */
+    struct Key {
+        std::array<unsigned char, KEY_LENGTH> bytes;
+        mutable std::atomic<uint64_t> sealCount = 0;
+    };
+
+    const Cipher cipher;
+    std::unique_ptr<Workers> workers;
+
+    mutable std::shared_mutex keysMutex;
+    std::map<std::string, Key, std::less<>> keys;
+    std::string activeKeyId;
+
+    /**
+     * @brief Gets the most payloads one key may seal with this encryptor's cipher.
+     */
+    uint64_t getSealLimit() const;
+
+    /**
+     * @brief Runs task(i) for every i below count, spread over the worker pool and the calling thread when parallel is set.
+     * Rethrows the first exception a task threw once they have all finished.
+     */
+    void forEach(size_t count, bool parallel, const std::function<void(size_t)>& task) const;
+
+public:
+    /**
+     * @param cipher The cipher new payloads are sealed with; payloads sealed with either cipher can be opened.
+     * @param workerCount Number of worker threads that seal and open large batches alongside the calling thread; defaults
+     * to one less than the number of CPUs.
+     * @throws std::runtime_error if libsodium cannot be initialized or the CPU cannot run the cipher.
+     */
+    explicit PayloadEncryptor(Cipher cipher = Cipher::XCHACHA20_POLY1305, std::optional<size_t> workerCount = std::nullopt);
+    PayloadEncryptor(const PayloadEncryptor& other) = delete;
+    PayloadEncryptor& operator=(const PayloadEncryptor& other) = delete;
+    ~PayloadEncryptor();
+
+    /**
+     * @brief Generates a random key, e.g. to store in a secrets manager; zero it with sodium_memzero once it has been added.
+     */
+    static std::array<unsigned char, KEY_LENGTH> generateKey();
+
+    /**
+     * @brief Adds a key that payloads can be opened with; the first key added becomes the active key.
+     *
+     * Seal counts are only kept in memory. For the AES-256-GCM limit to span restarts, store @ref getSealCount next to the
+     * key and pass it back here.
+     * @param sealCount Number of payloads the key has already sealed.
+     * @throws std::invalid_argument if the ID is empty or already taken, or the key is not @ref KEY_LENGTH bytes long.
+     */
+    void addKey(const std::string& keyId, std::span<const unsigned char> key, uint64_t sealCount = 0);
+
+    /**
+     * @brief Makes a key that was added the one new payloads are sealed with.
+     * @throws std::invalid_argument if there is no key with that ID, or it has already sealed @ref MAX_AES256_GCM_SEALS
+     * payloads and the cipher is AES-256-GCM.
+     */
+    void setActiveKey(const std::string& keyId);
+
+    /**
+     * @brief Gets the number of payloads a key has sealed, including the count it was added with.
+     * @throws std::invalid_argument if there is no key with that ID.
+     */
+    uint64_t getSealCount(const std::string& keyId) const;
+
+    Cipher getCipher() const { return cipher; }
+
+    /**
+     * @brief Seals the payloads of a batch about to be sent with the active key, recording the cipher and key ID in each
+     * message's headers.
+     *
+     * Messages that are already sealed, e.g. when forwarding polled messages that were not opened, are left as they are and
+ * borrow their payload from the given batch, which must outlive the result.
+     * Sealed messages drop any checksum they carried, which no longer matches their payload.
+     * @throws std::invalid_argument if no key has been added.
+     * @throws std::runtime_error if the cipher is AES-256-GCM and sealing the batch would take the active key past
+     * @ref MAX_AES256_GCM_SEALS; nothing is sealed, and a new key has to be added and made active first.
+     */
+    iggy::command::message::SendMessages seal(const iggy::command::message::SendMessages& command) const;
+
+    /**
+     * @brief Opens the sealed payloads of a polled batch.
+     *
+     * A batch without sealed messages is returned as it is. Otherwise the payloads are opened, with their headers minus the
+     * reserved ones, into one new buffer that also keeps the original alive, and those messages get the CRC-32 of their
+     * plaintext as their checksum.
+     * @throws std::runtime_error if a payload was sealed with a key or cipher this encryptor does not have, or fails
+     * authentication, e.g. because it was tampered with.
+     */
+    iggy::model::message::PolledMessagesView open(const iggy::model::message::PolledMessagesView& messages) const;
+};
+
+}  // namespace encryption
+}  // namespace serialization
+}  // namespace iggy
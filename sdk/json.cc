@@ -0,0 +1,521 @@
+#include "json.h"
+#include <fmt/format.h>
+#include <simdjson.h>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include "base64.h"
+
+namespace {
+namespace ondemand = simdjson::ondemand;
+
+/**
+ * @brief Iterates a response body with the calling thread's parser and hands the document to decode.
+ *
+ * simdjson reads up to SIMDJSON_PADDING bytes past the end of the input, so the padding is reserved in the body's own
+ * allocation rather than copying it into a padded string. Errors from simdjson come out as std::runtime_error, like every
+ * other decoding error in the SDK.
+ */
+template <typename Decode>
+auto parse(std::vector<unsigned char>& body, Decode&& decode) {
+    thread_local ondemand::parser parser;
+    body.reserve(body.size() + simdjson::SIMDJSON_PADDING);
+    try {
+        ondemand::document document = parser.iterate(body.data(), body.size(), body.capacity());
+        return decode(document);
+    } catch (const simdjson::simdjson_error& e) {
+        throw std::runtime_error(fmt::format("Malformed JSON response: {}", e.what()));
+    }
+}
+
+/// @brief Looks up a required field, naming it in the error if it is missing.
+ondemand::value field(ondemand::object& object, std::string_view key) {
+    auto result = object[key];
+    if (result.error() == simdjson::NO_SUCH_FIELD) {
+        throw std::runtime_error(fmt::format("JSON response has no {} field", key));
+    }
+    return result.value();
+}
+
+/// @brief Looks up a field that the server may leave out or set to null.
+std::optional<ondemand::value> optionalField(ondemand::object& object, std::string_view key) {
+    auto result = object[key];
+    if (result.error() == simdjson::NO_SUCH_FIELD) {
+        return std::nullopt;
+    }
+    ondemand::value value = result.value();
+    if (value.is_null()) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+template <typename T>
+T toUnsigned(ondemand::value value, std::string_view key) {
+    uint64_t number = value.get_uint64();
+    if (number > std::numeric_limits<T>::max()) {
+        throw std::runtime_error(fmt::format("JSON field {} is out of range: {}", key, number));
+    }
+    return static_cast<T>(number);
+}
+
+template <typename T>
+T getUnsigned(ondemand::object& object, std::string_view key) {
+    return toUnsigned<T>(field(object, key), key);
+}
+
+template <typename T>
+std::optional<T> getOptionalUnsigned(ondemand::object& object, std::string_view key) {
+    auto value = optionalField(object, key);
+    if (!value) {
+        return std::nullopt;
+    }
+    return toUnsigned<T>(*value, key);
+}
+
+std::string getString(ondemand::object& object, std::string_view key) {
+    return std::string(std::string_view(field(object, key).get_string()));
+}
+
+/**
+ * @brief Reads a 128-bit message id, which does not fit simdjson's 64-bit integers; the server writes it as a bare decimal
+ * number, but a quoted one is accepted as well.
+ */
+uint128_t getUint128(ondemand::object& object, std::string_view key) {
+    ondemand::value value = field(object, key);
+    std::string_view digits = value.type() == ondemand::json_type::string ? std::string_view(value.get_string()) : value.raw_json_token();
+    digits = digits.substr(0, digits.find_last_not_of(" \t\r\n") + 1);
+    if (digits.empty()) {
+        throw std::runtime_error(fmt::format("JSON field {} is not an unsigned integer", key));
+    }
+    uint128_t number = 0;
+    for (char c : digits) {
+        if (c < '0' || c > '9') {
+            throw std::runtime_error(fmt::format("JSON field {} is not an unsigned integer", key));
+        }
+        auto digit = static_cast<uint128_t>(c - '0');
+        if (number > (std::numeric_limits<uint128_t>::max() - digit) / 10) {
+            throw std::runtime_error(fmt::format("JSON field {} is out of range", key));
+        }
+        number = number * 10 + digit;
+    }
+    return number;
+}
+
+iggy::model::message::MessageState toMessageState(std::string_view name) {
+    using iggy::model::message::MessageState;
+    static constexpr std::pair<std::string_view, MessageState> STATES[] = {
+        {"available", MessageState::AVAILABLE},
+        {"unavailable", MessageState::UNAVAILABLE},
+        {"poisoned", MessageState::POISONED},
+        {"marked_for_deletion", MessageState::MARKED_FOR_DELETION},
+    };
+    for (const auto& [stateName, state] : STATES) {
+        if (stateName == name) {
+            return state;
+        }
+    }
+    throw std::runtime_error(fmt::format("Unknown message state in JSON response: {}", name));
+}
+
+/// @brief Names of the header kinds in the REST API, indexed by the kind's value less one.
+constexpr std::string_view HEADER_KIND_NAMES[] = {"raw",    "string", "bool",   "int8",    "int16",   "int32",   "int64",  "int128",
+                                                  "uint8",  "uint16", "uint32", "uint64",  "uint128", "float32", "float64"};
+
+iggy::model::message::HeaderKind toHeaderKind(std::string_view name) {
+    for (size_t i = 0; i < std::size(HEADER_KIND_NAMES); i++) {
+        if (HEADER_KIND_NAMES[i] == name) {
+            return static_cast<iggy::model::message::HeaderKind>(i + 1);
+        }
+    }
+    throw std::runtime_error(fmt::format("Unknown header kind in JSON response: {}", name));
+}
+
+std::string_view getHeaderKindName(iggy::model::message::HeaderKind kind) {
+    auto index = static_cast<size_t>(kind) - 1;
+    if (index >= std::size(HEADER_KIND_NAMES)) {
+        throw std::invalid_argument(fmt::format("Unknown header kind {}", static_cast<int>(kind)));
+    }
+    return HEADER_KIND_NAMES[index];
+}
+
+std::string_view getPartitioningKindName(iggy::command::message::PartitioningKind kind) {
+    switch (kind) {
+        case iggy::command::message::BALANCED:
+            return "balanced";
+        case iggy::command::message::PARITION_ID:
+            return "partition_id";
+        case iggy::command::message::MESSAGES_KEY:
+            return "messages_key";
+    }
+    throw std::invalid_argument(fmt::format("Unknown partitioning kind {}", static_cast<int>(kind)));
+}
+
+/// @brief Decodes base64 straight onto the end of the buffer, returning the number of bytes written.
+size_t appendBase64(iggy::serialization::ByteWriter& out, std::string_view encoded) {
+    size_t length = iggy::serialization::base64::decodedLength(encoded);
+    iggy::serialization::base64::decode(encoded, out.extend(length));
+    return length;
+}
+
+iggy::model::partition::Partition decodePartition(ondemand::object& object) {
+    auto id = getUnsigned<uint32_t>(object, "id");
+    auto createdAt = getUnsigned<uint64_t>(object, "created_at");
+    auto segmentsCount = getUnsigned<uint32_t>(object, "segments_count");
+    auto currentOffset = getUnsigned<uint64_t>(object, "current_offset");
+    auto sizeBytes = getUnsigned<uint64_t>(object, "size_bytes");
+    auto messagesCount = getUnsigned<uint64_t>(object, "messages_count");
+    return iggy::model::partition::Partition(id, createdAt, segmentsCount, currentOffset, sizeBytes, messagesCount);
+}
+
+iggy::model::topic::Topic decodeTopic(ondemand::object& object) {
+    auto id = getUnsigned<uint32_t>(object, "id");
+    auto createdAt = getUnsigned<uint64_t>(object, "created_at");
+    auto name = getString(object, "name");
+    auto sizeBytes = getUnsigned<uint64_t>(object, "size_bytes");
+    auto messageExpiry = getOptionalUnsigned<uint32_t>(object, "message_expiry");
+    auto maxTopicSize = getOptionalUnsigned<uint64_t>(object, "max_topic_size");
+    auto replicationFactor = getUnsigned<uint8_t>(object, "replication_factor");
+    auto messagesCount = getUnsigned<uint64_t>(object, "messages_count");
+    auto partitionsCount = getUnsigned<uint32_t>(object, "partitions_count");
+    return iggy::model::topic::Topic(id, createdAt, std::move(name), sizeBytes, messageExpiry, maxTopicSize, replicationFactor,
+                                     messagesCount, partitionsCount);
+}
+
+iggy::model::stream::Stream decodeStream(ondemand::object& object) {
+    auto id = getUnsigned<uint32_t>(object, "id");
+    auto createdAt = getUnsigned<uint64_t>(object, "created_at");
+    auto name = getString(object, "name");
+    auto sizeBytes = getUnsigned<uint64_t>(object, "size_bytes");
+    auto messagesCount = getUnsigned<uint64_t>(object, "messages_count");
+    auto topicsCount = getUnsigned<uint32_t>(object, "topics_count");
+    return iggy::model::stream::Stream(id, createdAt, std::move(name), sizeBytes, messagesCount, topicsCount);
+}
+
+/// @brief Decodes an array of objects, each with the given decoder.
+template <typename T, typename Decode>
+std::vector<T> decodeArray(ondemand::array array, Decode&& decode) {
+    std::vector<T> items;
+    for (auto item : array) {
+        ondemand::object object = item.get_object();
+        items.push_back(decode(object));
+    }
+    return items;
+}
+
+/// @brief Where a message's headers block and payload ended up in the decoding buffer.
+struct DecodedMessage {
+    uint64_t offset;
+    iggy::model::message::MessageState state;
+    uint64_t timestamp;
+    uint128_t id;
+    uint32_t checksum;
+    size_t headersStart;
+    size_t headersLength;
+    size_t payloadStart;
+    size_t payloadLength;
+};
+
+/// @brief Re-encodes a JSON headers object in the binary headers layout that @ref MessageView walks.
+void appendHeaders(iggy::serialization::ByteWriter& out, ondemand::object headers) {
+    for (auto item : headers) {
+        ondemand::field header = std::move(item);
+        std::string_view key = header.unescaped_key();
+        out.writeLittleEndian<uint32_t>(static_cast<uint32_t>(key.size()));
+        out.writeBytes(reinterpret_cast<const unsigned char*>(key.data()), key.size());
+        ondemand::object value = header.value().get_object();
+        auto kind = toHeaderKind(field(value, "kind").get_string());
+        out.writeLittleEndian<uint8_t>(static_cast<uint8_t>(kind));
+        std::string_view encoded = field(value, "value").get_string();
+        out.writeLittleEndian<uint32_t>(static_cast<uint32_t>(iggy::serialization::base64::decodedLength(encoded)));
+        appendBase64(out, encoded);
+    }
+}
+
+/**
+ * @brief JSON token writer that only counts, so a request body can be sized exactly before it is written.
+ */
+class JsonSizer {
+private:
+    size_t length = 0;
+
+public:
+    size_t size() const { return this->length; }
+    void literal(std::string_view text) { this->length += text.size(); }
+    void string(std::string_view value) {
+        this->length += 2;
+        for (char c : value) {
+            if (c == '"' || c == '\\') {
+                this->length += 2;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                this->length += 6;
+            } else {
+                this->length++;
+            }
+        }
+    }
+    void base64(const unsigned char*, size_t size) { this->length += 2 + iggy::serialization::base64::encodedLength(size); }
+    void number(uint128_t value) {
+        do {
+            this->length++;
+            value /= 10;
+        } while (value != 0);
+    }
+};
+
+/**
+ * @brief JSON token writer onto a buffer that has already been sized by a @ref JsonSizer pass, so nothing reallocates.
+ */
+class JsonWriter {
+private:
+    iggy::serialization::ByteWriter& out;
+
+public:
+    explicit JsonWriter(iggy::serialization::ByteWriter& out)
+        : out(out) {}
+
+    void literal(std::string_view text) { this->out.writeBytes(reinterpret_cast<const unsigned char*>(text.data()), text.size()); }
+    void string(std::string_view value) {
+        this->literal("\"");
+        for (char c : value) {
+            if (c == '"' || c == '\\') {
+                unsigned char escaped[] = {'\\', static_cast<unsigned char>(c)};
+                this->out.writeBytes(escaped, sizeof(escaped));
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                this->literal(fmt::format("\\u{:04x}", static_cast<int>(c)));
+            } else {
+                this->out.writeLittleEndian<uint8_t>(static_cast<uint8_t>(c));
+            }
+        }
+        this->literal("\"");
+    }
+    void base64(const unsigned char* data, size_t size) {
+        this->literal("\"");
+        auto encoded = this->out.extend(iggy::serialization::base64::encodedLength(size));
+        iggy::serialization::base64::encode(data, size, reinterpret_cast<char*>(encoded));
+        this->literal("\"");
+    }
+    void number(uint128_t value) {
+        char digits[40];
+        char* start = digits + sizeof(digits);
+        do {
+            *--start = static_cast<char>('0' + static_cast<int>(value % 10));
+            value /= 10;
+        } while (value != 0);
+        this->literal(std::string_view(start, digits + sizeof(digits) - start));
+    }
+};
+
+/**
+ * @brief Emits a SendMessages request body in the REST API's layout through either token writer.
+ */
+template <typename Json>
+void emitSendMessages(Json& json, const iggy::command::message::SendMessages& value) {
+    const auto& partitioning = value.getPartitioning();
+    const auto& partitionKey = partitioning.getValue();
+    json.literal(R"({"partitioning":{"kind":)");
+    json.string(getPartitioningKindName(partitioning.getKind()));
+    json.literal(R"(,"value":)");
+    json.base64(partitionKey.data(), partitionKey.size());
+    json.literal(R"(},"messages":[)");
+    bool first = true;
+    for (const auto& message : value.getMessages()) {
+        json.literal(first ? R"({"id":)" : R"(,{"id":)");
+        first = false;
+        json.number(message.getId());
+        const auto& headers = message.getHeaders();
+        if (!headers.empty()) {
+            json.literal(R"(,"headers":{)");
+            bool firstHeader = true;
+            for (const auto& [key, header] : headers) {
+                if (!firstHeader) {
+                    json.literal(",");
+                }
+                firstHeader = false;
+                json.string(key);
+                json.literal(R"(:{"kind":)");
+                json.string(getHeaderKindName(header.getKind()));
+                json.literal(R"(,"value":)");
+                auto headerValue = header.getValue();
+                json.base64(headerValue.data(), headerValue.size());
+                json.literal("}");
+            }
+            json.literal("}");
+        }
+        json.literal(R"(,"payload":)");
+        json.base64(message.getPayload().data(), message.getPayload().size());
+        json.literal("}");
+    }
+    json.literal("]}");
+}
+}  // namespace
+
+template <>
+iggy::model::system::Stats iggy::serialization::json::JsonWireFormat::read<iggy::model::system::Stats>(
+    std::vector<unsigned char> body) const {
+    return parse(body, [](ondemand::document& document) {
+        ondemand::object object = document.get_object();
+        auto processId = static_cast<pid_t>(getUnsigned<uint32_t>(object, "process_id"));
+        auto cpuUsage = static_cast<percent_t>(double(field(object, "cpu_usage").get_double()));
+        auto memoryUsage = getUnsigned<uint64_t>(object, "memory_usage");
+        auto totalMemory = getUnsigned<uint64_t>(object, "total_memory");
+        auto availableMemory = getUnsigned<uint64_t>(object, "available_memory");
+        auto runTime = getUnsigned<uint64_t>(object, "run_time");
+        auto startTime = getUnsigned<uint64_t>(object, "start_time");
+        auto readBytes = getUnsigned<uint64_t>(object, "read_bytes");
+        auto writtenBytes = getUnsigned<uint64_t>(object, "written_bytes");
+        auto messagesSizeBytes = getUnsigned<uint64_t>(object, "messages_size_bytes");
+        auto streamsCount = getUnsigned<uint32_t>(object, "streams_count");
+        auto topicsCount = getUnsigned<uint32_t>(object, "topics_count");
+        auto partitionsCount = getUnsigned<uint32_t>(object, "partitions_count");
+        auto segmentsCount = getUnsigned<uint32_t>(object, "segments_count");
+        auto messagesCount = getUnsigned<uint64_t>(object, "messages_count");
+        auto clientsCount = getUnsigned<uint32_t>(object, "clients_count");
+        auto consumerGroupsCount = getUnsigned<uint32_t>(object, "consumer_groups_count");
+        auto hostname = getString(object, "hostname");
+        auto osName = getString(object, "os_name");
+        auto osVersion = getString(object, "os_version");
+        auto kernelVersion = getString(object, "kernel_version");
+
+        return iggy::model::system::Stats(processId, cpuUsage, memoryUsage, totalMemory, availableMemory, runTime, startTime, readBytes,
+                                          writtenBytes, messagesSizeBytes, streamsCount, topicsCount, partitionsCount, segmentsCount,
+                                          messagesCount, clientsCount, consumerGroupsCount, hostname, osName, osVersion, kernelVersion);
+    });
+}
+
+template <>
+iggy::model::user::IdentityInfo iggy::serialization::json::JsonWireFormat::read<iggy::model::user::IdentityInfo>(
+    std::vector<unsigned char> body) const {
+    return parse(body, [](ondemand::document& document) {
+        ondemand::object object = document.get_object();
+        auto userId = getUnsigned<uint32_t>(object, "user_id");
+        std::optional<iggy::model::user::AccessToken> accessToken;
+        if (auto value = optionalField(object, "access_token")) {
+            ondemand::object tokenObject = value->get_object();
+            auto token = getString(tokenObject, "token");
+            accessToken.emplace(std::move(token), getUnsigned<uint64_t>(tokenObject, "expiry"));
+        }
+        return iggy::model::user::IdentityInfo(userId, std::move(accessToken));
+    });
+}
+
+template <>
+std::vector<iggy::model::stream::Stream> iggy::serialization::json::JsonWireFormat::read<std::vector<iggy::model::stream::Stream>>(
+    std::vector<unsigned char> body) const {
+    return parse(body, [](ondemand::document& document) {
+        return decodeArray<iggy::model::stream::Stream>(document.get_array(), decodeStream);
+    });
+}
+
+template <>
+iggy::model::stream::StreamDetails iggy::serialization::json::JsonWireFormat::read<iggy::model::stream::StreamDetails>(
+    std::vector<unsigned char> body) const {
+    return parse(body, [](ondemand::document& document) {
+        ondemand::object object = document.get_object();
+        auto stream = decodeStream(object);
+        auto topics = decodeArray<iggy::model::topic::Topic>(field(object, "topics").get_array(), decodeTopic);
+        return iggy::model::stream::StreamDetails(stream.getId(), stream.getCreatedAt(), stream.getName(), stream.getSizeBytes(),
+                                                  stream.getMessagesCount(), stream.getTopicsCount(), std::move(topics));
+    });
+}
+
+template <>
+std::vector<iggy::model::topic::Topic> iggy::serialization::json::JsonWireFormat::read<std::vector<iggy::model::topic::Topic>>(
+    std::vector<unsigned char> body) const {
+    return parse(body, [](ondemand::document& document) {
+        return decodeArray<iggy::model::topic::Topic>(document.get_array(), decodeTopic);
+    });
+}
+
+template <>
+iggy::model::topic::TopicDetails iggy::serialization::json::JsonWireFormat::read<iggy::model::topic::TopicDetails>(
+    std::vector<unsigned char> body) const {
+    return parse(body, [](ondemand::document& document) {
+        ondemand::object object = document.get_object();
+        auto topic = decodeTopic(object);
+        auto partitions = decodeArray<iggy::model::partition::Partition>(field(object, "partitions").get_array(), decodePartition);
+        return iggy::model::topic::TopicDetails(topic.getId(), topic.getCreatedAt(), topic.getName(), topic.getSizeBytes(),
+                                                topic.getMessageExpiry(), topic.getMaxTopicSize(), topic.getReplicationFactor(),
+                                                topic.getMessagesCount(), topic.getPartitionsCount(), std::move(partitions));
+    });
+}
+
+template <>
+iggy::model::message::PolledMessagesView iggy::serialization::json::JsonWireFormat::read<iggy::model::message::PolledMessagesView>(
+    std::vector<unsigned char> body) const {
+    return parse(body, [this, &body](ondemand::document& document) {
+        ondemand::object object = document.get_object();
+        auto partitionId = getUnsigned<uint32_t>(object, "partition_id");
+        auto currentOffset = getUnsigned<uint64_t>(object, "current_offset");
+
+        // base64 and the JSON around it always take more room than the bytes they decode to, so the body size bounds the
+        // buffer and it is allocated exactly once
+        iggy::serialization::ByteWriter buffer(body.size());
+        std::vector<DecodedMessage> decoded;
+        for (auto item : field(object, "messages").get_array()) {
+            ondemand::object message = item.get_object();
+            DecodedMessage entry;
+            entry.offset = getUnsigned<uint64_t>(message, "offset");
+            entry.state = toMessageState(field(message, "state").get_string());
+            entry.timestamp = getUnsigned<uint64_t>(message, "timestamp");
+            entry.id = getUint128(message, "id");
+            entry.checksum = getUnsigned<uint32_t>(message, "checksum");
+            entry.headersStart = buffer.size();
+            if (auto headers = optionalField(message, "headers")) {
+                appendHeaders(buffer, headers->get_object());
+            }
+            entry.headersLength = buffer.size() - entry.headersStart;
+            entry.payloadStart = buffer.size();
+            entry.payloadLength = appendBase64(buffer, field(message, "payload").get_string());
+
+            // checked straight after decoding, while the payload is still in cache
+            if (this->verifyChecksums) {
+                auto payload = buffer.view().subspan(entry.payloadStart, entry.payloadLength);
+                iggy::serialization::verifyChecksum(
+                    iggy::model::message::MessageView(entry.offset, entry.state, entry.timestamp, entry.id, entry.checksum, {}, payload));
+            }
+            decoded.push_back(entry);
+        }
+
+        // the spans can only be taken once the buffer has stopped moving
+        auto shared = std::make_shared<const std::vector<unsigned char>>(buffer.take());
+        std::span<const unsigned char> bytes(*shared);
+        std::vector<iggy::model::message::MessageView> messages;
+        messages.reserve(decoded.size());
+        for (const auto& entry : decoded) {
+            messages.emplace_back(entry.offset, entry.state, entry.timestamp, entry.id, entry.checksum,
+                                  bytes.subspan(entry.headersStart, entry.headersLength),
+                                  bytes.subspan(entry.payloadStart, entry.payloadLength));
+        }
+        return iggy::model::message::PolledMessagesView(std::move(shared), partitionId, currentOffset, std::move(messages));
+    });
+}
+
+template <>
+iggy::model::message::PolledMessages iggy::serialization::json::JsonWireFormat::read<iggy::model::message::PolledMessages>(
+    std::vector<unsigned char> body) const {
+    return this->read<iggy::model::message::PolledMessagesView>(std::move(body)).toPolledMessages();
+}
+
+template <>
+void iggy::serialization::json::JsonWireFormat::write<iggy::command::message::SendMessages>(
+    ByteWriter& out,
+    const iggy::command::message::SendMessages& value) const {
+    if (value.getMessages().empty()) {
+        throw std::invalid_argument("At least one message must be sent");
+    }
+    if (this->verifyChecksums) {
+        for (const auto& message : value.getMessages()) {
+            iggy::serialization::verifyChecksum(message);
+        }
+    }
+    JsonSizer sizer;
+    emitSendMessages(sizer, value);
+    out.reserve(sizer.size());
+    JsonWriter writer(out);
+    emitSendMessages(writer, value);
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <memory>
+#include <vector>
 #include "serialization.h"
 
 namespace iggy {
@@ -13,12 +15,83 @@ namespace json {
 
 /**
  * @class JsonWireFormat
- * @brief Binary serialization and deserialization for Iggy's protocol.
+ * @brief JSON serialization of Iggy's HTTP REST requests and deserialization of its responses.
+ *
+ * Responses are parsed with the simdjson On-Demand API, which validates the document with SIMD instructions and then lets
+ * the decoder pull each field straight into the model classes: there is no intermediate DOM, and the parser's buffers
+ * are kept per thread and reused across responses. Strings are guaranteed to be valid UTF-8, since simdjson rejects any
+ * document that is not.
  */
-class JsonWireFormat : iggy::serialization::WireFormat {
+class JsonWireFormat : public iggy::serialization::WireFormat {
+private:
+    bool verifyChecksums = false;
+
 public:
     JsonWireFormat() = default;
-}
+
+    /**
+     * @param verifyChecksums Whether to check payloads against their CRC-32 checksums, as for BinaryWireFormat.
+     */
+    explicit JsonWireFormat(bool verifyChecksums)
+        : verifyChecksums(verifyChecksums) {}
+
+    /**
+     * @brief Decodes a model object from a response body; only the specializations declared below are available.
+     *
+     * The body is taken over so that the parser's padding can be reserved in place, without copying it.
+     * @throws std::runtime_error if the body is not valid JSON or lacks a required field.
+     */
+    template <typename T>
+    T read(std::vector<unsigned char> body) const;
+
+    /**
+     * @brief Encodes a command as a request body; only the specializations declared below are available.
+     *
+     * The body is written in two passes over the same emitter: the first only counts bytes, so the second writes into a
+     * buffer reserved once at its exact size. That buffer is what the HTTP transport hands to libcurl as the upload.
+     * @throws std::invalid_argument if the command cannot be encoded, e.g. a batch without messages.
+     */
+    template <typename T>
+    void write(ByteWriter& out, const T& value) const;
+};
+
+template <>
+iggy::model::system::Stats JsonWireFormat::read<iggy::model::system::Stats>(std::vector<unsigned char> body) const;
+
+template <>
+iggy::model::user::IdentityInfo JsonWireFormat::read<iggy::model::user::IdentityInfo>(std::vector<unsigned char> body) const;
+
+template <>
+std::vector<iggy::model::stream::Stream> JsonWireFormat::read<std::vector<iggy::model::stream::Stream>>(
+    std::vector<unsigned char> body) const;
+
+template <>
+iggy::model::stream::StreamDetails JsonWireFormat::read<iggy::model::stream::StreamDetails>(std::vector<unsigned char> body) const;
+
+template <>
+std::vector<iggy::model::topic::Topic> JsonWireFormat::read<std::vector<iggy::model::topic::Topic>>(std::vector<unsigned char> body) const;
+
+template <>
+iggy::model::topic::TopicDetails JsonWireFormat::read<iggy::model::topic::TopicDetails>(std::vector<unsigned char> body) const;
+
+/**
+ * @brief Decodes polled messages into the same zero-copy view as the binary format.
+ *
+ * The base64 payloads and header values are decoded straight into one shared buffer, laid out as in the binary format,
+ * so a whole poll costs a single allocation for its message data however many messages it holds.
+ */
+template <>
+iggy::model::message::PolledMessagesView JsonWireFormat::read<iggy::model::message::PolledMessagesView>(
+    std::vector<unsigned char> body) const;
+
+template <>
+iggy::model::message::PolledMessages JsonWireFormat::read<iggy::model::message::PolledMessages>(std::vector<unsigned char> body) const;
+
+/**
+ * @brief Encodes messages to send, base64-encoding each payload and header value straight into the body with SIMD.
+ */
+template <>
+void JsonWireFormat::write<iggy::command::message::SendMessages>(ByteWriter& out, const iggy::command::message::SendMessages& value) const;
 
 }  // namespace json
 }  // namespace serialization
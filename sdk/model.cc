@@ -1 +1,187 @@
 #include "model.h"
+#include <fmt/format.h>
+#include <cstddef>
+#include <mutex>
+#include <stdexcept>
+#include "crc32.h"
+
+bool iggy::model::message::Headers::emplace(HeaderKey key, HeaderValue value) {
+    if (this->find(key) != nullptr) {
+        return false;
+    }
+    this->headers.push_back(Header{std::move(key), std::move(value)});
+    return true;
+}
+
+const iggy::model::message::HeaderValue* iggy::model::message::Headers::find(std::string_view key) const {
+    size_t hash = std::hash<std::string_view>{}(key);
+    for (const auto& header : this->headers) {
+        if (header.key.getHash() == hash && header.key.getName() == key) {
+            return &header.value;
+        }
+    }
+    return nullptr;
+}
+
+const iggy::model::message::HeaderValue& iggy::model::message::Headers::at(std::string_view key) const {
+    const HeaderValue* value = this->find(key);
+    if (value == nullptr) {
+        throw std::out_of_range(fmt::format("No header with key {}", key));
+    }
+    return *value;
+}
+
+std::optional<iggy::model::message::HeaderValueView> iggy::model::message::MessageView::findHeader(std::string_view key) const {
+    std::optional<HeaderValueView> found;
+    this->forEachHeader([&found, key](std::string_view headerKey, HeaderValueView value) {
+        if (!found && headerKey == key) {
+            found = value;
+        }
+    });
+    return found;
+}
+
+iggy::model::message::Message iggy::model::message::Message::borrow(const Message& other) {
+    Message borrowed(other.id, Headers(other.headers), other.length, {}, other.offset, other.state, other.timestamp, other.checksum);
+    // a batch-backed message shares its storage; otherwise an alias with no owner marks the payload as borrowed without
+    // keeping anything alive
+    borrowed.storage = other.storage ? other.storage : std::shared_ptr<const void>(std::shared_ptr<const void>(), &other);
+    borrowed.borrowedPayload = other.getPayload();
+    return borrowed;
+}
+
+bool iggy::model::message::Message::hasValidChecksum() const {
+    auto payload = this->getPayload();
+    return this->checksum.has_value() && *this->checksum == iggy::serialization::crc32::checksum(payload.data(), payload.size());
+}
+
+bool iggy::model::message::MessageView::hasValidChecksum() const {
+    return this->checksum == iggy::serialization::crc32::checksum(this->payload.data(), this->payload.size());
+}
+
+iggy::model::message::Message iggy::model::message::MessageView::toMessage() const {
+    size_t count = 0;
+    this->forEachHeader([&count](std::string_view, HeaderValueView) { count++; });
+    Headers ownedHeaders;
+    ownedHeaders.reserve(count);
+    this->forEachHeader([&ownedHeaders](std::string_view key, HeaderValueView value) {
+        ownedHeaders.emplace(HeaderKey(key), value.toHeaderValue());
+    });
+    return Message(this->id, std::move(ownedHeaders), static_cast<uint32_t>(this->payload.size()),
+                   std::vector<unsigned char>(this->payload.begin(), this->payload.end()), this->offset, this->state, this->timestamp,
+                   this->checksum);
+}
+
+iggy::model::message::Message iggy::model::message::MessageView::toMessage(std::shared_ptr<const void> storage,
+                                                                           std::pmr::memory_resource* arena) const {
+    size_t count = 0;
+    this->forEachHeader([&count](std::string_view, HeaderValueView) { count++; });
+    Headers arenaHeaders{std::pmr::polymorphic_allocator<Header>(arena)};
+    arenaHeaders.reserve(count);
+    this->forEachHeader([&arenaHeaders, arena](std::string_view key, HeaderValueView value) {
+        arenaHeaders.emplace(HeaderKey(key, arena), HeaderValue(value.getKind(), value.getValue(), arena));
+    });
+    return Message(std::move(storage), this->id, std::move(arenaHeaders), this->payload, this->offset, this->state, this->timestamp,
+                   this->checksum);
+}
+
+struct iggy::model::message::ArenaPool::Arena {
+    std::vector<std::byte> block;
+    std::pmr::monotonic_buffer_resource resource;
+
+    explicit Arena(size_t size)
+        : block(size)
+        , resource(block.data(), block.size()) {}
+};
+
+struct iggy::model::message::ArenaPool::State {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Arena>> idle;
+    size_t maxPooled;
+    bool open = true;
+
+    explicit State(size_t maxPooled)
+        : maxPooled(maxPooled) {}
+};
+
+iggy::model::message::ArenaPool::ArenaPool(size_t maxPooled)
+    : state(std::make_shared<State>(maxPooled)) {}
+
+iggy::model::message::ArenaPool::~ArenaPool() {
+    std::lock_guard lock(this->state->mutex);
+    this->state->open = false;
+    this->state->idle.clear();
+}
+
+std::shared_ptr<std::pmr::memory_resource> iggy::model::message::ArenaPool::acquire(size_t sizeHint) {
+    std::unique_ptr<Arena> arena;
+    {
+        std::lock_guard lock(this->state->mutex);
+        auto& idle = this->state->idle;
+        auto fit = std::find_if(idle.begin(), idle.end(),
+                                [sizeHint](const auto& candidate) { return candidate->block.size() >= sizeHint; });
+        if (fit != idle.end()) {
+            arena = std::move(*fit);
+            idle.erase(fit);
+        }
+    }
+    if (!arena) {
+        arena = std::make_unique<Arena>(std::max(sizeHint, DEFAULT_ARENA_SIZE));
+    }
+
+    // releasing the last reference resets the arena in one step, dropping everything allocated from it, and pools it again
+    std::shared_ptr<Arena> handle(arena.release(), [state = this->state](Arena* released) {
+        released->resource.release();
+        std::unique_ptr<Arena> owned(released);
+        std::lock_guard lock(state->mutex);
+        if (state->open && state->idle.size() < state->maxPooled) {
+            state->idle.push_back(std::move(owned));
+        }
+    });
+    return std::shared_ptr<std::pmr::memory_resource>(handle, &handle->resource);
+}
+
+size_t iggy::model::message::ArenaPool::getPooledCount() const {
+    std::lock_guard lock(this->state->mutex);
+    return this->state->idle.size();
+}
+
+iggy::model::message::PolledMessages iggy::model::message::PolledMessagesView::toPolledMessages(ArenaPool& pool) const {
+    // estimate the arena size from the header index up front, so that a batch rarely spills over to the heap
+    size_t sizeHint = 0;
+    for (const auto& message : this->messages) {
+        size_t count = 0;
+        message.forEachHeader([&count, &sizeHint](std::string_view key, HeaderValueView value) {
+            count++;
+            sizeHint += key.size() + alignof(std::max_align_t);
+            if (value.getValue().size() > HeaderValue::INLINE_CAPACITY) {
+                sizeHint += value.getValue().size() + alignof(std::max_align_t);
+            }
+        });
+        sizeHint += count * sizeof(Header) + alignof(std::max_align_t);
+    }
+
+    struct Storage {
+        std::shared_ptr<const std::vector<unsigned char>> buffer;
+        std::shared_ptr<std::pmr::memory_resource> arena;
+    };
+    auto arena = pool.acquire(sizeHint);
+    std::pmr::memory_resource* resource = arena.get();
+    std::shared_ptr<const void> storage = std::make_shared<Storage>(Storage{this->buffer, std::move(arena)});
+
+    std::vector<Message> owned;
+    owned.reserve(this->messages.size());
+    for (const auto& message : this->messages) {
+        owned.push_back(message.toMessage(storage, resource));
+    }
+    return PolledMessages(this->partitionId, this->currentOffset, std::move(owned));
+}
+
+iggy::model::message::PolledMessages iggy::model::message::PolledMessagesView::toPolledMessages() const {
+    std::vector<Message> owned;
+    owned.reserve(this->messages.size());
+    for (const auto& message : this->messages) {
+        owned.push_back(message.toMessage());
+    }
+    return PolledMessages(this->partitionId, this->currentOffset, std::move(owned));
+}
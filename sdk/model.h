@@ -1,9 +1,18 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <memory>
+#include <memory_resource>
 #include <optional>
+#include <span>
+#include <stdexcept>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <utility>
 #include <vector>
+#include "bytes.h"
 #include "types.h"
 
 namespace iggy {
@@ -31,22 +40,83 @@ namespace shared {
 enum IdKind { NUMERIC = 1, STRING = 2 };
 
 /**
- * @brief An identifier for a stream or a topic.
+ * @brief An identifier for a stream or a topic: a little-endian u32 or a name of up to 255 bytes.
+ *
+ * The value is stored inline, so identifiers never allocate and copy as plain bytes. Unlike the other models this is not
+ * derived from Model: a virtual destructor would stop it being a literal type, which the constexpr factories need.
  */
-class Identifier : Model {
+class Identifier {
+public:
+    /**
+     * @brief Longest value an identifier can carry; its length is a single byte on the wire.
+     */
+    static constexpr size_t MAX_LENGTH = 255;
+
 private:
     IdKind kind;
     uint8_t length;
-    std::vector<unsigned char> value;
+    std::array<unsigned char, MAX_LENGTH> value{};
 
 public:
-    Identifier(IdKind kind, uint8_t length, std::vector<unsigned char> value)
+    /**
+     * @throws std::invalid_argument if the value is empty or longer than MAX_LENGTH, or is numeric but not 4 bytes long.
+     */
+    constexpr Identifier(IdKind kind, std::span<const unsigned char> value)
         : kind(kind)
-        , length(length)
-        , value(value) {}
-    IdKind getKind() { return kind; }
-    uint8_t getLength() { return length; }
-    std::vector<unsigned char> getValue() { return value; }
+        , length(static_cast<uint8_t>(value.size())) {
+        if (value.empty() || value.size() > MAX_LENGTH) {
+            throw std::invalid_argument("Identifier must be between 1 and 255 bytes long");
+        }
+        if (kind == NUMERIC && value.size() != sizeof(uint32_t)) {
+            throw std::invalid_argument("Numeric identifier must be 4 bytes long");
+        }
+        std::copy(value.begin(), value.end(), this->value.begin());
+    }
+
+    /**
+     * @throws std::invalid_argument if length does not match the size of the value, or as for the span constructor.
+     */
+    Identifier(IdKind kind, uint8_t length, const std::vector<unsigned char>& value)
+        : Identifier(kind, std::span<const unsigned char>(value)) {
+        if (length != value.size()) {
+            throw std::invalid_argument("Identifier length does not match its value");
+        }
+    }
+
+    /**
+     * @brief Makes a numeric identifier.
+     */
+    static constexpr Identifier numeric(uint32_t id) {
+        const std::array<unsigned char, sizeof(uint32_t)> bytes{static_cast<unsigned char>(id), static_cast<unsigned char>(id >> 8),
+                                                                static_cast<unsigned char>(id >> 16), static_cast<unsigned char>(id >> 24)};
+        return Identifier(NUMERIC, bytes);
+    }
+
+    /**
+     * @brief Makes an identifier from a stream or topic name.
+     * @throws std::invalid_argument if the name is empty or longer than MAX_LENGTH bytes.
+     */
+    static constexpr Identifier named(std::string_view name) {
+        if (name.size() > MAX_LENGTH) {
+            throw std::invalid_argument("Identifier must be between 1 and 255 bytes long");
+        }
+        std::array<unsigned char, MAX_LENGTH> bytes{};
+        std::copy(name.begin(), name.end(), bytes.begin());
+        return Identifier(STRING, std::span<const unsigned char>(bytes.data(), name.size()));
+    }
+
+    constexpr IdKind getKind() const { return kind; }
+    constexpr uint8_t getLength() const { return length; }
+    constexpr std::span<const unsigned char> getValue() const { return std::span<const unsigned char>(value.data(), length); }
+    constexpr bool isNumeric() const { return kind == NUMERIC; }
+
+    /**
+     * @brief Decodes a numeric identifier's value; only meaningful when @ref isNumeric is true.
+     */
+    constexpr uint32_t getNumericValue() const {
+        return static_cast<uint32_t>(value[0]) | static_cast<uint32_t>(value[1]) << 8 | static_cast<uint32_t>(value[2]) << 16 |
+               static_cast<uint32_t>(value[3]) << 24;
+    }
 };
 
 /**
@@ -66,8 +136,8 @@ public:
     Consumer(ConsumerKind kind, uint32_t id)
         : kind(kind)
         , id(id) {}
-    ConsumerKind getKind() { return kind; }
-    uint32_t getId() { return id; }
+    ConsumerKind getKind() const { return kind; }
+    uint32_t getId() const { return id; }
 };
 };  // namespace shared
 
@@ -93,12 +163,12 @@ public:
         , currentOffset(currentOffset)
         , sizeBytes(sizeBytes)
         , messagesCount(messagesCount) {}
-    uint32_t getId() { return id; }
-    uint64_t getCreatedAt() { return createdAt; }
-    uint32_t getSegmentsCount() { return segmentsCount; }
-    uint64_t getCurrentOffset() { return currentOffset; }
-    uint64_t getSizeBytes() { return sizeBytes; }
-    uint64_t getMessagesCount() { return messagesCount; }
+    uint32_t getId() const { return id; }
+    uint64_t getCreatedAt() const { return createdAt; }
+    uint32_t getSegmentsCount() const { return segmentsCount; }
+    uint64_t getCurrentOffset() const { return currentOffset; }
+    uint64_t getSizeBytes() const { return sizeBytes; }
+    uint64_t getMessagesCount() const { return messagesCount; }
 };
 };  // namespace partition
 
@@ -134,22 +204,22 @@ public:
           uint32_t partitionsCount)
         : id(id)
         , createdAt(createdAt)
-        , name(name)
+        , name(std::move(name))
         , sizeBytes(sizeBytes)
         , messageExpiry(messageExpiry)
         , maxTopicSize(maxTopicSize)
         , replicationFactor(replicationFactor)
         , messagesCount(messagesCount)
         , partitionsCount(partitionsCount) {}
-    uint32_t getId() { return id; }
-    uint64_t getCreatedAt() { return createdAt; }
-    std::string getName() { return name; }
-    uint64_t getSizeBytes() { return sizeBytes; }
-    std::optional<uint32_t> getMessageExpiry() { return messageExpiry; }
-    std::optional<uint64_t> getMaxTopicSize() { return maxTopicSize; }
-    uint8_t getReplicationFactor() { return replicationFactor; }
-    uint64_t getMessagesCount() { return messagesCount; }
-    uint32_t getPartitionsCount() { return partitionsCount; }
+    uint32_t getId() const { return id; }
+    uint64_t getCreatedAt() const { return createdAt; }
+    const std::string& getName() const { return name; }
+    uint64_t getSizeBytes() const { return sizeBytes; }
+    std::optional<uint32_t> getMessageExpiry() const { return messageExpiry; }
+    std::optional<uint64_t> getMaxTopicSize() const { return maxTopicSize; }
+    uint8_t getReplicationFactor() const { return replicationFactor; }
+    uint64_t getMessagesCount() const { return messagesCount; }
+    uint32_t getPartitionsCount() const { return partitionsCount; }
 };
 
 /**
@@ -167,6 +237,43 @@ private:
     uint64_t messagesCount;
     uint32_t partitionsCount;
     std::vector<partition::Partition> partitions;
+
+public:
+    TopicDetails(uint32_t id,
+                 uint64_t createdAt,
+                 std::string name,
+                 uint64_t sizeBytes,
+                 std::optional<uint32_t> messageExpiry,
+                 std::optional<uint64_t> maxTopicSize,
+                 uint8_t replicationFactor,
+                 uint64_t messagesCount,
+                 uint32_t partitionsCount,
+                 std::vector<partition::Partition> partitions)
+        : id(id)
+        , createdAt(createdAt)
+        , name(std::move(name))
+        , sizeBytes(sizeBytes)
+        , messageExpiry(messageExpiry)
+        , maxTopicSize(maxTopicSize)
+        , replicationFactor(replicationFactor)
+        , messagesCount(messagesCount)
+        , partitionsCount(partitionsCount)
+        , partitions(std::move(partitions)) {}
+    uint32_t getId() const { return id; }
+    uint64_t getCreatedAt() const { return createdAt; }
+    const std::string& getName() const { return name; }
+    uint64_t getSizeBytes() const { return sizeBytes; }
+    std::optional<uint32_t> getMessageExpiry() const { return messageExpiry; }
+    std::optional<uint64_t> getMaxTopicSize() const { return maxTopicSize; }
+    uint8_t getReplicationFactor() const { return replicationFactor; }
+    uint64_t getMessagesCount() const { return messagesCount; }
+    uint32_t getPartitionsCount() const { return partitionsCount; }
+    const std::vector<partition::Partition>& getPartitions() const { return partitions; }
+
+    /**
+     * @brief Moves the partitions out of the topic, leaving it with none.
+     */
+    std::vector<partition::Partition> takePartitions() { return std::move(partitions); }
 };
 };  // namespace topic
 
@@ -175,6 +282,34 @@ private:
  */
 namespace stream {
 
+/**
+ * @brief Metadata describing a message stream at a summary level, as listed by GetStreams.
+ */
+class Stream : Model {
+private:
+    uint32_t id;
+    uint64_t createdAt;
+    std::string name;
+    uint64_t sizeBytes;
+    uint64_t messagesCount;
+    uint32_t topicsCount;
+
+public:
+    Stream(uint32_t id, uint64_t createdAt, std::string name, uint64_t sizeBytes, uint64_t messagesCount, uint32_t topicsCount)
+        : id(id)
+        , createdAt(createdAt)
+        , name(std::move(name))
+        , sizeBytes(sizeBytes)
+        , messagesCount(messagesCount)
+        , topicsCount(topicsCount) {}
+    uint32_t getId() const { return id; }
+    uint64_t getCreatedAt() const { return createdAt; }
+    const std::string& getName() const { return name; }
+    uint64_t getSizeBytes() const { return sizeBytes; }
+    uint64_t getMessagesCount() const { return messagesCount; }
+    uint32_t getTopicsCount() const { return topicsCount; }
+};
+
 /**
  * @brief Metadata describing a message stream including topic details.
  */
@@ -198,18 +333,23 @@ public:
                   std::vector<topic::Topic> topics)
         : id(id)
         , createdAt(createdAt)
-        , name(name)
+        , name(std::move(name))
         , sizeBytes(sizeBytes)
         , messagesCount(messagesCount)
         , topicsCount(topicsCount)
-        , topics(topics) {}
-    uint32_t getId() { return id; }
-    uint64_t getCreatedAt() { return createdAt; }
-    std::string getName() { return name; }
-    uint64_t getSizeBytes() { return sizeBytes; }
-    uint64_t getMessagesCount() { return messagesCount; }
-    uint32_t getTopicsCount() { return topicsCount; }
-    std::vector<topic::Topic> getTopics() { return topics; }
+        , topics(std::move(topics)) {}
+    uint32_t getId() const { return id; }
+    uint64_t getCreatedAt() const { return createdAt; }
+    const std::string& getName() const { return name; }
+    uint64_t getSizeBytes() const { return sizeBytes; }
+    uint64_t getMessagesCount() const { return messagesCount; }
+    uint32_t getTopicsCount() const { return topicsCount; }
+    const std::vector<topic::Topic>& getTopics() const { return topics; }
+
+    /**
+     * @brief Moves the topics out of the stream, leaving it with none.
+     */
+    std::vector<topic::Topic> takeTopics() { return std::move(topics); }
 };
 };  // namespace stream
 
@@ -223,7 +363,35 @@ namespace message {
  */
 enum MessageState { AVAILABLE = 1, UNAVAILABLE = 10, POISONED = 20, MARKED_FOR_DELETION = 30 };
 
-typedef std::string HeaderKey;
+/**
+ * @brief A header name with its hash computed once, when the key is made, so lookups in @ref Headers compare hashes before
+ * touching the bytes. Names up to the standard library's small-string capacity (15 bytes in libstdc++) need no allocation.
+ */
+class HeaderKey {
+private:
+    std::pmr::string name;
+    size_t hash;
+
+public:
+    /**
+     * @param allocator Where a name too long to be stored inline is kept; the heap unless the key is decoded into an arena.
+     */
+    HeaderKey(std::string_view name, std::pmr::polymorphic_allocator<char> allocator = {})
+        : name(name, allocator)
+        , hash(std::hash<std::string_view>{}(name)) {}
+    HeaderKey(const std::string& name)
+        : HeaderKey(std::string_view(name)) {}
+    HeaderKey(const char* name)
+        : HeaderKey(std::string_view(name)) {}
+
+    std::string_view getName() const { return name; }
+    size_t getHash() const { return hash; }
+    const char* data() const { return name.data(); }
+    size_t size() const { return name.size(); }
+    operator std::string_view() const { return name; }
+
+    bool operator==(const HeaderKey& other) const { return hash == other.hash && name == other.name; }
+};
 
 /**
  * @brief Discriminator to allow correct decoding of header value bytes representing different value types.
@@ -248,31 +416,183 @@ enum HeaderKind {
 
 /**
  * @brief A value of various types associated with the message header -- message metadata.
+ *
+ * The value bytes share their storage with a pointer: values up to @ref INLINE_CAPACITY are kept inside the object and
+ * longer ones in a buffer of exactly their length, so the whole object is 32 bytes. Like the standard pmr containers, a
+ * copy allocates from the default resource, a move takes the buffer along with its resource, and assignment keeps the
+ * resource the value was made with.
  */
-class HeaderValue : Model {
+class HeaderValue {
+public:
+    /**
+     * @brief Largest value kept inside the object rather than on the heap: enough for every numeric kind up to 128 bits.
+     */
+    static constexpr size_t INLINE_CAPACITY = 16;
+
 private:
     HeaderKind kind;
-    std::vector<unsigned char> value;
+    uint32_t length;
+    std::pmr::memory_resource* resource;
+    union {
+        std::array<unsigned char, INLINE_CAPACITY> inlineValue{};
+        unsigned char* heapValue;
+    };
+
+    bool isInline() const { return length <= INLINE_CAPACITY; }
+
+    void assign(HeaderKind kind, std::span<const unsigned char> value) {
+        this->release();
+        this->kind = kind;
+        this->length = static_cast<uint32_t>(value.size());
+        if (this->isInline()) {
+            std::copy(value.begin(), value.end(), this->inlineValue.begin());
+        } else {
+            this->heapValue = static_cast<unsigned char*>(this->resource->allocate(value.size(), 1));
+            std::copy(value.begin(), value.end(), this->heapValue);
+        }
+    }
+
+    void take(HeaderValue& other) {
+        this->kind = other.kind;
+        this->length = other.length;
+        if (this->isInline()) {
+            this->inlineValue = other.inlineValue;
+        } else {
+            this->heapValue = other.heapValue;
+        }
+        other.length = 0;
+    }
+
+    void release() {
+        if (!this->isInline()) {
+            this->resource->deallocate(this->heapValue, this->length, 1);
+            this->length = 0;
+        }
+    }
 
 public:
-    HeaderValue(HeaderKind kind, std::vector<unsigned char> value)
+    /**
+     * @param allocator Where a value too long to be stored inline is kept; the heap unless the value is decoded into an arena.
+     */
+    HeaderValue(HeaderKind kind, std::span<const unsigned char> value, std::pmr::polymorphic_allocator<unsigned char> allocator = {})
         : kind(kind)
-        , value(value) {}
+        , length(0)
+        , resource(allocator.resource()) {
+        this->assign(kind, value);
+    }
+    HeaderValue(HeaderKind kind, const std::vector<unsigned char>& value)
+        : HeaderValue(kind, std::span<const unsigned char>(value)) {}
+
+    HeaderValue(const HeaderValue& other)
+        : HeaderValue(other.kind, other.getValue()) {}
+    HeaderValue(HeaderValue&& other) noexcept
+        : kind(other.kind)
+        , length(0)
+        , resource(other.resource) {
+        this->take(other);
+    }
+    ~HeaderValue() { this->release(); }
+
+    HeaderValue& operator=(const HeaderValue& other) {
+        if (this != &other) {
+            this->assign(other.kind, other.getValue());
+        }
+        return *this;
+    }
+    HeaderValue& operator=(HeaderValue&& other) {
+        if (this == &other) {
+            return *this;
+        }
+        if (*this->resource != *other.resource) {
+            // as with pmr containers, a value from another resource is copied so that this one keeps allocating from its own
+            this->assign(other.kind, other.getValue());
+        } else {
+            this->release();
+            this->take(other);
+        }
+        return *this;
+    }
 
     HeaderKind getKind() const { return kind; }
-    std::vector<unsigned char> getValue() const { return value; }
+    std::span<const unsigned char> getValue() const {
+        return std::span<const unsigned char>(this->isInline() ? inlineValue.data() : heapValue, length);
+    }
+};
+
+/**
+ * @brief A single message header: a key and its value.
+ *
+ * Neither part, nor @ref Headers, derives from Model: a message can carry many headers, and a vtable pointer in each key
+ * and value would only make them bigger.
+ */
+struct Header {
+    HeaderKey key;
+    HeaderValue value;
+};
+
+/**
+ * @brief The headers of a @ref Message, kept in insertion order in one flat vector.
+ *
+ * Messages carry a handful of headers at most, so a linear scan over pre-hashed keys finds one faster than a hash table
+ * would, and a message with small keys and numeric values costs a single allocation for all of its headers instead of a
+ * node, key and value buffer for each. Copies always go to the heap, whatever the original was allocated from.
+ */
+class Headers {
+private:
+    std::pmr::vector<Header> headers;
+
+public:
+    using const_iterator = std::pmr::vector<Header>::const_iterator;
+
+    Headers() = default;
+
+    /**
+     * @brief Makes an empty set of headers that allocates from the given resource, e.g. the arena of a polled batch.
+     */
+    explicit Headers(std::pmr::polymorphic_allocator<Header> allocator)
+        : headers(allocator) {}
+
+    /**
+     * @brief Adds a header unless one with the same key is already present, like std::unordered_map::emplace.
+     * @return Whether the header was added.
+     */
+    bool emplace(HeaderKey key, HeaderValue value);
+
+    /**
+     * @brief Looks up a header by key.
+     * @return The value, or nullptr if there is no header with that key.
+     */
+    const HeaderValue* find(std::string_view key) const;
+
+    /**
+     * @brief Looks up a header by key.
+     * @throws std::out_of_range if there is no header with that key.
+     */
+    const HeaderValue& at(std::string_view key) const;
+
+    bool contains(std::string_view key) const { return find(key) != nullptr; }
+    void reserve(size_t count) { headers.reserve(count); }
+    size_t size() const { return headers.size(); }
+    bool empty() const { return headers.empty(); }
+    const_iterator begin() const { return headers.begin(); }
+    const_iterator end() const { return headers.end(); }
 };
 
 /**
  * @brief A message consumed or sent to the server, with binary payload and flexible metadata.
  */
-class Message : Model {
+class Message final : Model {
 private:
+    // keeps the receive buffer and arena of a batch-backed message alive; declared first so that it is released last,
+    // after the headers allocated from the arena
+    std::shared_ptr<const void> storage;
+
     // core message state
     uint128_t id;
-    std::unordered_map<HeaderKey, HeaderValue> headers;
+    Headers headers;
     uint32_t length;
     std::vector<unsigned char> payload;
+    std::span<const unsigned char> borrowedPayload;
 
     // message state set on the server-side
     std::optional<uint64_t> offset;
@@ -285,7 +605,7 @@ public:
      * @brief Fully-qualified message constructor; @ref isComplete will be true.
      */
     Message(uint128_t id,
-            std::unordered_map<HeaderKey, HeaderValue> headers,
+            Headers headers,
             uint32_t length,
             std::vector<unsigned char> payload,
             std::optional<uint64_t> offset,
@@ -293,9 +613,9 @@ public:
             std::optional<uint64_t> timestamp,
             std::optional<uint32_t> checksum)
         : id(id)
-        , headers(headers)
+        , headers(std::move(headers))
         , length(length)
-        , payload(payload)
+        , payload(std::move(payload))
         , offset(offset)
         , state(state)
         , timestamp(timestamp)
@@ -304,29 +624,100 @@ public:
     /**
      * @brief Simpler constructor for a message to be delivered to the server; @ref isComplete will be false.
      */
-    Message(uint128_t id, std::unordered_map<HeaderKey, HeaderValue> headers, uint32_t length, std::vector<unsigned char> payload)
+    Message(uint128_t id, Headers headers, uint32_t length, std::vector<unsigned char> payload)
         : Message(id,
-                  headers,
+                  std::move(headers),
                   length,
-                  payload,
+                  std::move(payload),
                   std::optional<uint64_t>(),
                   std::optional<MessageState>(),
                   std::optional<uint64_t>(),
                   std::optional<uint32_t>()) {}
 
+    /**
+     * @brief Constructor for a polled message whose payload, and headers if they were allocated from an arena, live in
+     * storage shared by the whole batch; the message keeps that storage alive. See @ref PolledMessagesView::toPolledMessages.
+     */
+    Message(std::shared_ptr<const void> storage,
+            uint128_t id,
+            Headers headers,
+            std::span<const unsigned char> payload,
+            uint64_t offset,
+            MessageState state,
+            uint64_t timestamp,
+            uint32_t checksum)
+        : storage(std::move(storage))
+        , id(id)
+        , headers(std::move(headers))
+        , length(static_cast<uint32_t>(payload.size()))
+        , borrowedPayload(payload)
+        , offset(offset)
+        , state(state)
+        , timestamp(timestamp)
+        , checksum(checksum) {}
+
+    Message(const Message& other) = default;
+    Message(Message&& other) noexcept = default;
+
+    /**
+     * @brief Makes a copy that shares the other message's payload instead of copying it, e.g. of a message that a payload
+     * stage passes through unchanged; the other message, or the batch it borrows from, must outlive the copy.
+     */
+    static Message borrow(const Message& other);
+
+    // the headers are rebuilt rather than assigned: a pmr container keeps its own allocator on assignment, so headers assigned
+    // into this message would go on allocating from an arena that its new storage no longer keeps alive. Moving them in
+    // brings the allocator along, and the old headers are destroyed before the storage they may live in is released.
+    Message& operator=(const Message& other) { return *this = Message(other); }
+    Message& operator=(Message&& other) noexcept {
+        if (this != &other) {
+            std::destroy_at(&this->headers);
+            std::construct_at(&this->headers, std::move(other.headers));
+            this->storage = std::move(other.storage);
+            this->id = other.id;
+            this->length = other.length;
+            this->payload = std::move(other.payload);
+            this->borrowedPayload = other.borrowedPayload;
+            this->offset = other.offset;
+            this->state = other.state;
+            this->timestamp = other.timestamp;
+            this->checksum = other.checksum;
+        }
+        return *this;
+    }
+
     uint128_t getId() const { return id; }
-    std::unordered_map<HeaderKey, HeaderValue> getHeaders() const { return headers; }
+    const Headers& getHeaders() const { return headers; }
     uint32_t getLength() const { return length; }
-    std::vector<unsigned char> getPayload() const { return payload; }
+    std::span<const unsigned char> getPayload() const { return storage ? borrowedPayload : std::span<const unsigned char>(payload); }
     std::optional<uint64_t> getOffset() const { return offset; }
     std::optional<MessageState> getState() const { return state; }
     std::optional<uint64_t> getTimestamp() const { return timestamp; }
     std::optional<uint32_t> getChecksum() const { return checksum; }
 
+    /**
+     * @brief Moves the headers out of the message, e.g. to forward them on a new one, leaving it with none. Headers of a
+     * batch-backed message are copied out instead, since they cannot outlive the batch.
+     */
+    Headers takeHeaders() { return storage ? Headers(headers) : std::move(headers); }
+
+    /**
+     * @brief Moves the payload out of the message, leaving it empty; the length field is not changed. The payload of a
+     * batch-backed message is copied out instead.
+     */
+    std::vector<unsigned char> takePayload() {
+        return storage ? std::vector<unsigned char>(borrowedPayload.begin(), borrowedPayload.end()) : std::move(payload);
+    }
+
     /**
      * @brief Check if the message has all the server-side fields set.
      */
     bool isComplete() const { return offset.has_value() && state.has_value() && timestamp.has_value() && checksum.has_value(); }
+
+    /**
+     * @brief Checks the payload against the server's CRC-32 checksum; false if the message has none, i.e. was not polled.
+     */
+    bool hasValidChecksum() const;
 };
 
 /**
@@ -342,11 +733,208 @@ public:
     PolledMessages(uint32_t partition_id, uint64_t current_offset, std::vector<Message> messages)
         : partition_id(partition_id)
         , current_offset(current_offset)
-        , messages(messages) {}
+        , messages(std::move(messages)) {}
 
     uint32_t getPartitionId() const { return partition_id; }
     uint64_t getCurrentOffset() const { return current_offset; }
-    std::vector<Message> getMessages() const { return messages; }
+    const std::vector<Message>& getMessages() const { return messages; }
+
+    /**
+     * @brief Moves the messages out of the batch, leaving it empty, e.g. to forward them in a SendMessages command.
+     */
+    std::vector<Message> takeMessages() { return std::move(messages); }
+};
+
+/**
+ * @brief A header value borrowed from the receive buffer of a @ref PolledMessagesView.
+ */
+class HeaderValueView : Model {
+private:
+    HeaderKind kind;
+    std::span<const unsigned char> value;
+
+public:
+    HeaderValueView(HeaderKind kind, std::span<const unsigned char> value)
+        : kind(kind)
+        , value(value) {}
+
+    HeaderKind getKind() const { return kind; }
+    std::span<const unsigned char> getValue() const { return value; }
+
+    /**
+     * @brief Copies the value out of the receive buffer.
+     */
+    HeaderValue toHeaderValue() const { return HeaderValue(kind, value); }
+};
+
+/**
+ * @brief A polled message whose payload and headers point into the receive buffer of the @ref PolledMessagesView that
+ * decoded it, so it is only valid for as long as that buffer is alive.
+ */
+class MessageView : Model {
+private:
+    uint64_t offset;
+    MessageState state;
+    uint64_t timestamp;
+    uint128_t id;
+    uint32_t checksum;
+
+    // the encoded headers block, validated when the batch was decoded and walked again on demand
+    std::span<const unsigned char> headers;
+    std::span<const unsigned char> payload;
+
+public:
+    MessageView(uint64_t offset,
+                MessageState state,
+                uint64_t timestamp,
+                uint128_t id,
+                uint32_t checksum,
+                std::span<const unsigned char> headers,
+                std::span<const unsigned char> payload)
+        : offset(offset)
+        , state(state)
+        , timestamp(timestamp)
+        , id(id)
+        , checksum(checksum)
+        , headers(headers)
+        , payload(payload) {}
+
+    uint64_t getOffset() const { return offset; }
+    MessageState getState() const { return state; }
+    uint64_t getTimestamp() const { return timestamp; }
+    uint128_t getId() const { return id; }
+    uint32_t getChecksum() const { return checksum; }
+    std::span<const unsigned char> getPayload() const { return payload; }
+
+    /**
+     * @brief Calls visit(std::string_view key, HeaderValueView value) for each header in wire order.
+     */
+    template <typename Visitor>
+    void forEachHeader(Visitor&& visit) const {
+        size_t pos = 0;
+        while (pos < headers.size()) {
+            uint32_t keyLength = iggy::serialization::loadLittleEndian<uint32_t>(headers.data() + pos);
+            std::string_view key(reinterpret_cast<const char*>(headers.data() + pos + 4), keyLength);
+            pos += 4 + keyLength;
+            auto kind = static_cast<HeaderKind>(headers[pos]);
+            uint32_t valueLength = iggy::serialization::loadLittleEndian<uint32_t>(headers.data() + pos + 1);
+            pos += 5;
+            visit(key, HeaderValueView(kind, headers.subspan(pos, valueLength)));
+            pos += valueLength;
+        }
+    }
+
+    /**
+     * @brief Looks up a header by key with a linear scan; messages carry few headers, so this beats building a map.
+     */
+    std::optional<HeaderValueView> findHeader(std::string_view key) const;
+
+    /**
+     * @brief Checks the payload against the server's CRC-32 checksum.
+     */
+    bool hasValidChecksum() const;
+
+    /**
+     * @brief Copies the message out of the receive buffer into an owning @ref Message.
+     */
+    Message toMessage() const;
+
+    /**
+     * @brief Makes a @ref Message that borrows its payload from the receive buffer and allocates its headers from an arena.
+     * @param storage Keeps the receive buffer and the arena alive for as long as the message, or any copy of it, exists.
+     * @param arena The resource the headers are allocated from.
+     */
+    Message toMessage(std::shared_ptr<const void> storage, std::pmr::memory_resource* arena) const;
+};
+
+/**
+ * @brief Recycles the monotonic arenas that hold the headers of polled batches.
+ *
+ * Each batch decoded with @ref PolledMessagesView::toPolledMessages(ArenaPool&) takes one arena from the pool and bump
+ * allocates all of its headers from it. Once the last message of the batch is gone the arena is reset in one step and goes
+ * back to the pool, so a steady stream of polls allocates nothing for headers after the first few batches. The pool may be
+ * destroyed before the batches it handed out; their arenas are then freed instead of returned.
+ */
+class ArenaPool {
+private:
+    struct Arena;
+    struct State;
+
+    std::shared_ptr<State> state;
+
+public:
+    /**
+     * @brief Default number of idle arenas kept for reuse.
+     */
+    static constexpr size_t DEFAULT_MAX_POOLED = 8;
+
+    /**
+     * @brief Default size of a new arena; batches that need more get a larger one.
+     */
+    static constexpr size_t DEFAULT_ARENA_SIZE = 64 * 1024;
+
+    explicit ArenaPool(size_t maxPooled = DEFAULT_MAX_POOLED);
+    ArenaPool(const ArenaPool& other) = delete;
+    ArenaPool& operator=(const ArenaPool& other) = delete;
+    ~ArenaPool();
+
+    /**
+     * @brief Takes an idle arena of at least sizeHint bytes, or makes a new one; it returns to the pool when released.
+     *
+     * The arena falls back to the heap if it runs out, so the hint only needs to be a good estimate. It is not thread-safe:
+     * allocate from it on one thread, then only read what was allocated.
+     */
+    std::shared_ptr<std::pmr::memory_resource> acquire(size_t sizeHint);
+
+    /**
+     * @brief Gets the number of idle arenas waiting to be reused.
+     */
+    size_t getPooledCount() const;
+};
+
+/**
+ * @brief Zero-copy alternative to @ref PolledMessages: the batch keeps the response payload alive in one ref-counted buffer
+ * and each @ref MessageView points into it, so decoding performs no per-message allocation or copy.
+ *
+ * Copies of the view share the buffer. Hold on to @ref getBuffer to keep individual message views valid after the batch
+ * itself is gone.
+ */
+class PolledMessagesView : Model {
+private:
+    std::shared_ptr<const std::vector<unsigned char>> buffer;
+    uint32_t partitionId;
+    uint64_t currentOffset;
+    std::vector<MessageView> messages;
+
+public:
+    PolledMessagesView(std::shared_ptr<const std::vector<unsigned char>> buffer,
+                       uint32_t partitionId,
+                       uint64_t currentOffset,
+                       std::vector<MessageView> messages)
+        : buffer(std::move(buffer))
+        , partitionId(partitionId)
+        , currentOffset(currentOffset)
+        , messages(std::move(messages)) {}
+
+    uint32_t getPartitionId() const { return partitionId; }
+    uint64_t getCurrentOffset() const { return currentOffset; }
+    const std::vector<MessageView>& getMessages() const { return messages; }
+    const std::shared_ptr<const std::vector<unsigned char>>& getBuffer() const { return buffer; }
+
+    /**
+     * @brief Copies every message out of the receive buffer into an owning @ref PolledMessages.
+     */
+    PolledMessages toPolledMessages() const;
+
+    /**
+     * @brief Turns the batch into an owning @ref PolledMessages without copying payloads or allocating per message.
+     *
+     * The messages borrow their payloads from the receive buffer and allocate their headers from one arena taken from the
+     * pool, so the whole batch costs the message array and a couple of small control blocks. Every message keeps the buffer
+     * and the arena alive; both are released together once the last of them is gone. Copies of the messages own their
+     * headers but still share the payload with the batch.
+     */
+    PolledMessages toPolledMessages(ArenaPool& pool) const;
 };
 
 }  // namespace message
@@ -370,9 +958,9 @@ public:
         : partitionId(partitionId)
         , currentOffset(currentOffset)
         , storedOffset(storedOffset) {}
-    uint32_t getPartitionId() { return partitionId; }
-    uint64_t getCurrentOffset() { return currentOffset; }
-    uint64_t getStoredOffset() { return storedOffset; }
+    uint32_t getPartitionId() const { return partitionId; }
+    uint64_t getCurrentOffset() const { return currentOffset; }
+    uint64_t getStoredOffset() const { return storedOffset; }
 };
 };  // namespace consumeroffset
 
@@ -391,10 +979,10 @@ public:
     ConsumerGroupMember(uint32_t id, uint32_t partitionsCount, std::vector<uint32_t> partitions)
         : id(id)
         , partitionsCount(partitionsCount)
-        , partitions(partitions) {}
-    uint32_t getId() { return id; }
-    uint32_t getPartitionsCount() { return partitionsCount; }
-    std::vector<uint32_t> getPartitions() { return partitions; }
+        , partitions(std::move(partitions)) {}
+    uint32_t getId() const { return id; }
+    uint32_t getPartitionsCount() const { return partitionsCount; }
+    const std::vector<uint32_t>& getPartitions() const { return partitions; }
 };
 
 class ConsumerGroupDetails : Model {
@@ -412,18 +1000,63 @@ public:
                          uint32_t membersCount,
                          std::vector<ConsumerGroupMember> members)
         : id(id)
-        , name(name)
+        , name(std::move(name))
         , paritionsCount(paritionsCount)
         , membersCount(membersCount)
-        , members(members) {}
-    uint32_t getId() { return id; }
-    std::string getName() { return name; }
-    uint32_t getParitionsCount() { return paritionsCount; }
-    uint32_t getMembersCount() { return membersCount; }
-    std::vector<ConsumerGroupMember> getMembers() { return members; }
+        , members(std::move(members)) {}
+    uint32_t getId() const { return id; }
+    const std::string& getName() const { return name; }
+    uint32_t getParitionsCount() const { return paritionsCount; }
+    uint32_t getMembersCount() const { return membersCount; }
+    const std::vector<ConsumerGroupMember>& getMembers() const { return members; }
+
+    /**
+     * @brief Moves the members out of the group details, leaving them with none.
+     */
+    std::vector<ConsumerGroupMember> takeMembers() { return std::move(members); }
 };
 };  // namespace consumergroup
 
+/**
+ * @brief Models related to users and how they authenticate.
+ */
+namespace user {
+
+/**
+ * @brief A token the HTTP REST API accepts in place of credentials, and the Unix time in seconds at which it expires.
+ */
+class AccessToken : Model {
+private:
+    std::string token;
+    uint64_t expiry;
+
+public:
+    AccessToken(std::string token, uint64_t expiry)
+        : token(std::move(token))
+        , expiry(expiry) {}
+    const std::string& getToken() const { return token; }
+    uint64_t getExpiry() const { return expiry; }
+};
+
+/**
+ * @brief The result of logging in: the user's ID and, over HTTP, the access token to send with every further request.
+ *
+ * @see [identity_info.rs](https://github.com/iggy-rs/iggy/blob/master/iggy/src/models/identity_info.rs)
+ */
+class IdentityInfo : Model {
+private:
+    uint32_t userId;
+    std::optional<AccessToken> accessToken;
+
+public:
+    IdentityInfo(uint32_t userId, std::optional<AccessToken> accessToken)
+        : userId(userId)
+        , accessToken(std::move(accessToken)) {}
+    uint32_t getUserId() const { return userId; }
+    const std::optional<AccessToken>& getAccessToken() const { return accessToken; }
+};
+};  // namespace user
+
 /**
  * @brief Models related to global system state.
  */
@@ -443,9 +1076,9 @@ public:
         : streamId(streamId)
         , topicId(topicId)
         , consumerGroupId(consumerGroupId) {}
-    uint32_t getStreamId() { return streamId; }
-    uint32_t getTopicId() { return topicId; }
-    uint32_t getConsumerGroupId() { return consumerGroupId; }
+    uint32_t getStreamId() const { return streamId; }
+    uint32_t getTopicId() const { return topicId; }
+    uint32_t getConsumerGroupId() const { return consumerGroupId; }
 };
 
 /**
@@ -469,16 +1102,21 @@ public:
                       std::vector<ConsumerGroupInfo> consumerGroups)
         : clientId(clientId)
         , userId(userId)
-        , address(address)
-        , transport(transport)
+        , address(std::move(address))
+        , transport(std::move(transport))
         , consumerGroupsCount(consumerGroupsCount)
-        , consumerGroups(consumerGroups) {}
-    uint32_t getClientId() { return clientId; }
-    std::optional<uint32_t> getUserId() { return userId; }
-    std::string getAddress() { return address; }
-    std::string getTransport() { return transport; }
-    uint32_t getConsumerGroupsCount() { return consumerGroupsCount; }
-    std::vector<ConsumerGroupInfo> getConsumerGroups() { return consumerGroups; }
+        , consumerGroups(std::move(consumerGroups)) {}
+    uint32_t getClientId() const { return clientId; }
+    std::optional<uint32_t> getUserId() const { return userId; }
+    const std::string& getAddress() const { return address; }
+    const std::string& getTransport() const { return transport; }
+    uint32_t getConsumerGroupsCount() const { return consumerGroupsCount; }
+    const std::vector<ConsumerGroupInfo>& getConsumerGroups() const { return consumerGroups; }
+
+    /**
+     * @brief Moves the consumer groups out of the client details, leaving them with none.
+     */
+    std::vector<ConsumerGroupInfo> takeConsumerGroups() { return std::move(consumerGroups); }
 };
 
 /**
@@ -515,9 +1153,54 @@ private:
     std::string kernel_version;
 
 public:
-    // TODO: when we add the full constructor ensure convertToUTF8() called on all strings
     Stats() = default;
 
+    /**
+     * @brief Fully-qualified constructor; wire formats are responsible for passing all strings through convertToUTF8() first.
+     */
+    Stats(pid_t process_id,
+          percent_t cpu_usage,
+          byte_cnt_t memory_usage,
+          byte_cnt_t total_memory,
+          byte_cnt_t available_memory,
+          time_val_t run_time,
+          time_val_t start_time,
+          byte_cnt_t read_bytes,
+          byte_cnt_t written_bytes,
+          byte_cnt_t messages_size_bytes,
+          obj_cnt_t streams_count,
+          obj_cnt_t topics_count,
+          obj_cnt_t partitions_count,
+          obj_cnt_t segments_count,
+          msg_cnt_t messages_count,
+          obj_cnt_t clients_count,
+          obj_cnt_t consumer_groups_count,
+          std::string hostname,
+          std::string os_name,
+          std::string os_version,
+          std::string kernel_version)
+        : process_id(process_id)
+        , cpu_usage(cpu_usage)
+        , memory_usage(memory_usage)
+        , total_memory(total_memory)
+        , available_memory(available_memory)
+        , run_time(run_time)
+        , start_time(start_time)
+        , read_bytes(read_bytes)
+        , written_bytes(written_bytes)
+        , messages_size_bytes(messages_size_bytes)
+        , streams_count(streams_count)
+        , topics_count(topics_count)
+        , partitions_count(partitions_count)
+        , segments_count(segments_count)
+        , messages_count(messages_count)
+        , clients_count(clients_count)
+        , consumer_groups_count(consumer_groups_count)
+        , hostname(std::move(hostname))
+        , os_name(std::move(os_name))
+        , os_version(std::move(os_version))
+        , kernel_version(std::move(kernel_version)) {}
+
     /// @brief Get the server process ID (PID)
     pid_t getProcessId() const { return process_id; }
 
@@ -570,16 +1253,16 @@ public:
     obj_cnt_t getConsumerGroupsCount() const { return consumer_groups_count; }
 
     /// @brief Get the name of the host that the server process is running on.
-    std::string getHostname() const { return hostname; }
+    const std::string& getHostname() const { return hostname; }
 
     /// @brief Get the name of the operating system that the server process is running on.
-    std::string getOsName() const { return os_name; }
+    const std::string& getOsName() const { return os_name; }
 
     /// @brief Get the version of the operating system that the server process is running on.
-    std::string getOsVersion() const { return os_version; }
+    const std::string& getOsVersion() const { return os_version; }
 
     /// @brief Get the version of the OS kernel that the server process is running on.
-    std::string getKernelVersion() const { return kernel_version; }
+    const std::string& getKernelVersion() const { return kernel_version; }
 };
 
 }  // namespace system
@@ -33,3 +33,7 @@ const uint16_t iggy::net::address::LogicalAddress::getPort() const {
         return port;
     }
 }
+
+const std::string iggy::net::address::LogicalAddress::toString() const {
+    return this->getProtocol() + "://" + this->getHost() + ":" + std::to_string(this->getPort());
+}
@@ -45,6 +45,12 @@ public:
      * @brief Gets the port to connect to; protocol default port will be substituted if not specified.
      */
     const uint16_t getPort() const;
+
+    /**
+     * @brief Gets the canonical protocol://host:port form with the default port filled in, so that equivalent addresses, e.g.
+     * with and without an explicit default port, compare equal; useful as a lookup key.
+     */
+    const std::string toString() const;
 };
 };  // namespace address
 };  // namespace net
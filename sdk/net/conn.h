@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <future>
+#include <utility>
+#include <vector>
+#include "../binary.h"
+
+namespace iggy {
+namespace net {
+
+/**
+ * @namespace conn
+ * @brief Transport-neutral abstractions for a client connection speaking the Iggy binary protocol.
+ */
+namespace conn {
+
+/**
+ * @brief Status code returned by the server when a command succeeded.
+ */
+const uint32_t STATUS_OK = 0;
+
+/**
+ * @brief A single decoded response frame: the server status code and the raw response payload.
+ */
+class Response {
+private:
+    uint32_t status;
+    std::vector<unsigned char> payload;
+
+public:
+    Response(uint32_t status, std::vector<unsigned char> payload)
+        : status(status)
+        , payload(std::move(payload)) {}
+
+    /**
+     * @brief Gets the status code; anything other than @ref STATUS_OK is an error code from the server.
+     */
+    uint32_t getStatus() const { return status; }
+
+    /**
+     * @brief Tests whether the server reported success for the command.
+     */
+    bool isOk() const { return status == STATUS_OK; }
+
+    /**
+     * @brief Gets the undecoded response payload; empty for commands without a response body.
+     */
+    const std::vector<unsigned char>& getPayload() const { return payload; }
+
+    /**
+     * @brief Moves the payload out of the response, e.g. to hand it to a decoder that keeps it as its backing buffer.
+     */
+    std::vector<unsigned char> takePayload() { return std::move(payload); }
+};
+
+/**
+ * @brief A connection to the Iggy server that sends command frames and asynchronously returns the matching responses.
+ *
+ * Implementations own their I/O threads and sockets; all public methods are safe to call from any thread.
+ */
+class Connection {
+public:
+    virtual ~Connection() = default;
+
+    /**
+     * @brief Establishes the connection, blocking until it is ready to send commands.
+     * @throws std::runtime_error if the server cannot be reached.
+     */
+    virtual void connect() = 0;
+
+    /**
+     * @brief Frames and sends a command, returning a future that is completed when the response arrives.
+     * @param command The command code that prefixes the frame.
+     * @param payload The already-encoded command body.
+     */
+    std::future<Response> send(iggy::serialization::binary::CommandCode command, std::vector<unsigned char> payload) {
+        return sendGathered(command, iggy::serialization::binary::GatherBuffer(std::move(payload)));
+    }
+
+    /**
+     * @brief Frames and sends a command whose body is written with a single gathered write straight from its segments.
+     * @param command The command code that prefixes the frame.
+     * @param payload The encoded command body; any memory it references must stay valid until the future is ready.
+     */
+    virtual std::future<Response> sendGathered(iggy::serialization::binary::CommandCode command,
+                                               iggy::serialization::binary::GatherBuffer payload) = 0;
+
+    /**
+     * @brief Closes the connection; any outstanding requests are failed with std::runtime_error.
+     */
+    virtual void close() = 0;
+};
+
+};  // namespace conn
+};  // namespace net
+};  // namespace iggy
@@ -69,4 +69,28 @@ void iggy::crypto::OCSP<WOLFSSL_CTX*>::configure(WOLFSSL_CTX* handle, const iggy
 
 template <>
 void iggy::crypto::CertificateAuthority<WOLFSSL_CTX*>::configure(WOLFSSL_CTX* handle,
-                                                                 const iggy::crypto::PKIEnvironment<WOLFSSL_CTX*>& pkiEnv) {}
+                                                                 const iggy::crypto::PKIEnvironment<WOLFSSL_CTX*>& pkiEnv) {
+    if (this->overrideCaCertificatePath.has_value()) {
+        auto caPath = this->overrideCaCertificatePath.value();
+        spdlog::debug("Loading CA certificates from {}", caPath);
+        if (wolfSSL_CTX_load_verify_locations(handle, caPath.c_str(), nullptr) != WOLFSSL_SUCCESS) {
+            throw std::runtime_error(fmt::format("Failed to load CA certificates from {}", caPath));
+        }
+    } else {
+#ifdef WOLFSSL_SYS_CA_CERTS
+        if (wolfSSL_CTX_load_system_CA_certs(handle) != WOLFSSL_SUCCESS) {
+            throw std::runtime_error("Failed to load the system CA certificates");
+        }
+#else
+        throw std::runtime_error("This build of WolfSSL cannot load the system CA certificates; set a CA certificate path");
+#endif
+    }
+
+    for (const auto& certPath : this->trustedPeerCertificatePaths) {
+        auto certData = pkiEnv.getCertificateStore().getCertificate(certPath);
+        if (wolfSSL_CTX_load_verify_buffer(handle, certData.data(), static_cast<long>(certData.size()), WOLFSSL_FILETYPE_PEM) !=
+            WOLFSSL_SUCCESS) {
+            throw std::runtime_error(fmt::format("Failed to load trusted peer certificate: {}", certPath));
+        }
+    }
+}
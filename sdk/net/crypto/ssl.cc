@@ -90,14 +90,11 @@ void iggy::ssl::SSLContext<WOLFSSL_CTX*>::raiseSSLError(const std::string& messa
 }
 
 template <>
-iggy::ssl::SSLContext<WOLFSSL_CTX*>::SSLContext(const SSLOptions<WOLFSSL_CTX*>& options,
-                                                const iggy::crypto::PKIEnvironment<WOLFSSL_CTX*>& pkiEnv)
-    : options(options)
-    , pkiEnv(pkiEnv) {
+void iggy::ssl::SSLContext<WOLFSSL_CTX*>::init() {
     // before we make any other wolfSSL calls, make sure library is initialized once and only once
     std::call_once(sslInitDone, []() { wolfSSL_Init(); });
 
-    auto protocolVersion = options.getMinimumSupportedProtocolVersion();
+    auto protocolVersion = this->options.getMinimumSupportedProtocolVersion();
     if (protocolVersion == iggy::ssl::ProtocolVersion::TLSV1_2) {
         this->ctx = wolfSSL_CTX_new(wolfTLSv1_2_client_method());
         if (!this->ctx) {
@@ -120,7 +117,7 @@ iggy::ssl::SSLContext<WOLFSSL_CTX*>::SSLContext(const SSLOptions<WOLFSSL_CTX*>&
     std::string delimiter = ":";
     std::string joinedCiphers;
 
-    auto supportedCiphers = options.getCiphers();
+    auto supportedCiphers = this->options.getCiphers();
     if (!supportedCiphers.empty()) {
         joinedCiphers = std::accumulate(std::next(supportedCiphers.begin()), supportedCiphers.end(), supportedCiphers[0],
                                         [delimiter](std::string a, std::string b) { return a + delimiter + b; });
@@ -128,8 +125,24 @@ iggy::ssl::SSLContext<WOLFSSL_CTX*>::SSLContext(const SSLOptions<WOLFSSL_CTX*>&
     int ret = wolfSSL_CTX_set_cipher_list(this->ctx, joinedCiphers.c_str());
     if (ret != SSL_SUCCESS) {
         char* errMsg = wolfSSL_ERR_error_string(wolfSSL_ERR_get_error(), nullptr);
+        wolfSSL_CTX_free(this->ctx);
+        this->ctx = nullptr;
         throw std::runtime_error(fmt::format("Failed to set cipher list: {}", errMsg));
     }
+
+#ifdef HAVE_SESSION_TICKET
+    // TLS 1.3 servers issue tickets unprompted, but TLS 1.2 servers only do so if asked
+    wolfSSL_CTX_UseSessionTicket(this->ctx);
+#endif
+}
+
+template <>
+iggy::ssl::SSLContext<WOLFSSL_CTX*>::SSLContext(const SSLOptions<WOLFSSL_CTX*>& options,
+                                                const iggy::crypto::PKIEnvironment<WOLFSSL_CTX*>& pkiEnv)
+    : options(options)
+    , pkiEnv(pkiEnv)
+    , sessionCache(std::make_shared<SessionCache>()) {
+    this->init();
 }
 
 template <>
@@ -147,15 +160,16 @@ void iggy::ssl::SSLOptions<WOLFSSL_CTX*>::validate(bool strict) const {
 template <>
 iggy::ssl::SSLContext<WOLFSSL_CTX*>::SSLContext(const SSLContext<WOLFSSL_CTX*>& other)
     : options(other.options)
-    , pkiEnv(other.pkiEnv) {
-    this->ctx = wolfSSL_CTX_new(wolfTLSv1_3_client_method());
-    this->cm = wolfSSL_CTX_GetCertManager(ctx);
+    , pkiEnv(other.pkiEnv)
+    , sessionCache(other.sessionCache) {
+    this->init();
 }
 
 template <>
 iggy::ssl::SSLContext<WOLFSSL_CTX*>::SSLContext(SSLContext<WOLFSSL_CTX*>&& other)
-    : options(other.options)
-    , pkiEnv(other.pkiEnv) {
+    : options(std::move(other.options))
+    , pkiEnv(other.pkiEnv)
+    , sessionCache(std::move(other.sessionCache)) {
     this->ctx = other.ctx;
     this->cm = other.cm;
     other.ctx = nullptr;
@@ -174,8 +188,11 @@ iggy::ssl::SSLContext<WOLFSSL_CTX*>& iggy::ssl::SSLContext<WOLFSSL_CTX*>::operat
     if (this != &other) {
         if (this->ctx) {
             wolfSSL_CTX_free(this->ctx);
+            this->ctx = nullptr;
         }
-        this->ctx = wolfSSL_CTX_new(wolfTLSv1_3_client_method());
+        this->options = other.options;
+        this->sessionCache = other.sessionCache;
+        this->init();
     }
     return *this;
 }
@@ -186,11 +203,64 @@ iggy::ssl::SSLContext<WOLFSSL_CTX*>& iggy::ssl::SSLContext<WOLFSSL_CTX*>::operat
         if (this->ctx) {
             wolfSSL_CTX_free(this->ctx);
         }
+        this->options = std::move(other.options);
+        this->sessionCache = std::move(other.sessionCache);
         this->ctx = other.ctx;
+        this->cm = other.cm;
         other.ctx = nullptr;
+        other.cm = nullptr;
     }
     return *this;
 }
 
 template <>
 std::once_flag iggy::ssl::SSLContext<WOLFSSL_CTX*>::sslInitDone = std::once_flag();
+
+void iggy::ssl::SessionCache::save(const iggy::net::address::LogicalAddress& address,
+                                   WOLFSSL* ssl,
+                                   std::vector<unsigned char> applicationData) {
+    WOLFSSL_SESSION* session = wolfSSL_get1_session(ssl);
+    if (!session) {
+        return;
+    }
+    Entry entry{std::shared_ptr<WOLFSSL_SESSION>(session, wolfSSL_SESSION_free), std::move(applicationData)};
+    auto key = address.toString();
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->sessions.insert_or_assign(key, std::move(entry));
+}
+
+bool iggy::ssl::SessionCache::resume(const iggy::net::address::LogicalAddress& address,
+                                     WOLFSSL* ssl,
+                                     std::vector<unsigned char>* applicationData) const {
+    auto key = address.toString();
+    Entry entry;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        auto found = this->sessions.find(key);
+        if (found == this->sessions.end()) {
+            return false;
+        }
+        entry = found->second;
+    }
+
+    // the session is copied into the connection, so holding our own reference for the duration of the call is enough
+    if (wolfSSL_set_session(ssl, entry.session.get()) != WOLFSSL_SUCCESS) {
+        return false;
+    }
+    if (applicationData) {
+        *applicationData = std::move(entry.applicationData);
+    }
+    return true;
+}
+
+void iggy::ssl::SessionCache::forget(const iggy::net::address::LogicalAddress& address) {
+    auto key = address.toString();
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->sessions.erase(key);
+}
+
+size_t iggy::ssl::SessionCache::size() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->sessions.size();
+}
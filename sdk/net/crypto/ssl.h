@@ -1,8 +1,12 @@
 #pragma once
 
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <string>
+#include <unordered_map>
+#include <vector>
+#include "../address.h"
 #include "crypto.h"
 #include "ssl_engine.h"
 
@@ -110,6 +114,53 @@ public:
     void configure(HandleType handle, const iggy::crypto::PKIEnvironment<HandleType>& pkiEnv) override;
 };
 
+/**
+ * @brief Resumable TLS sessions keyed by server address, so that reconnects can use an abbreviated handshake.
+ *
+ * One cache is shared by every connection made from an @ref SSLContext and its copies, and can be handed to other contexts,
+ * so after a server restart the whole reconnect storm can resume with the sessions and tickets of the previous connections
+ * instead of running a full key exchange each. If the
+ * server no longer accepts a session it simply falls back to a full handshake, whose session then replaces the stale one.
+ * All methods are thread-safe.
+ */
+class SessionCache {
+private:
+    struct Entry {
+        std::shared_ptr<WOLFSSL_SESSION> session;
+        std::vector<unsigned char> applicationData;
+    };
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, Entry> sessions;
+
+public:
+    /**
+     * @brief Remembers the session negotiated on a connection, replacing any earlier session for the same address.
+     * @param applicationData Transport state to restore along with the session, e.g. the QUIC transport parameters that
+     * bound 0-RTT early data.
+     */
+    void save(const iggy::net::address::LogicalAddress& address, WOLFSSL* ssl, std::vector<unsigned char> applicationData = {});
+
+    /**
+     * @brief Offers the cached session for the address, if any, to a connection that has not started its handshake yet.
+     * @param applicationData If not null, receives the data saved with the session.
+     * @return true if a session was offered; the server may still decline it.
+     */
+    bool resume(const iggy::net::address::LogicalAddress& address,
+                WOLFSSL* ssl,
+                std::vector<unsigned char>* applicationData = nullptr) const;
+
+    /**
+     * @brief Drops the cached session for the address, e.g. after a handshake that offered it failed.
+     */
+    void forget(const iggy::net::address::LogicalAddress& address);
+
+    /**
+     * @brief Gets the number of addresses with a cached session.
+     */
+    size_t size() const;
+};
+
 /**
  * @brief An SSL/TLS context for use in secure communication.
  *
@@ -122,14 +173,22 @@ class SSLContext {
 private:
     static std::once_flag sslInitDone;
 
-    const SSLOptions<HandleType>& options;
+    SSLOptions<HandleType> options;
     const iggy::crypto::PKIEnvironment<HandleType>& pkiEnv;
 
     WOLFSSL_CTX* ctx;
     WOLFSSL_CERT_MANAGER* cm;
 
+    // shared with copies, which are configured identically and so can resume the same sessions
+    std::shared_ptr<SessionCache> sessionCache;
+
     void raiseSSLError(const std::string& message) const;
 
+    /**
+     * @brief Allocates the native context and applies the options to it.
+     */
+    void init();
+
 public:
     explicit SSLContext(const SSLOptions<HandleType>& options = SSLOptions<HandleType>(),
                         const iggy::crypto::PKIEnvironment<HandleType>& pkiEnv = iggy::crypto::PKIEnvironment<HandleType>());
@@ -145,6 +204,21 @@ public:
      * that the expected handle type is used.
      */
     HandleType getNativeHandle() const { return this->ctx; }
+
+    /**
+     * @brief Gets the options the context was configured with.
+     */
+    const SSLOptions<HandleType>& getOptions() const { return this->options; }
+
+    /**
+     * @brief Gets the cache of resumable sessions shared by every connection created from this context and its copies.
+     */
+    SessionCache& getSessionCache() const { return *this->sessionCache; }
+
+    /**
+     * @brief Replaces the session cache, e.g. with one shared by several contexts for the same servers.
+     */
+    void setSessionCache(std::shared_ptr<SessionCache> sessionCache) { this->sessionCache = std::move(sessionCache); }
 };
 };  // namespace ssl
 };  // namespace iggy
@@ -0,0 +1,408 @@
+#include "conn.h"
+#include <fmt/format.h>
+#include <stdexcept>
+
+namespace {
+/// @brief Runs libcurl's global initialization once per process, which is not thread-safe on older libcurl builds.
+void initializeCurl() {
+    static std::once_flag once;
+    static CURLcode result = CURLE_OK;
+    std::call_once(once, []() { result = curl_global_init(CURL_GLOBAL_DEFAULT); });
+    if (result != CURLE_OK) {
+        throw std::runtime_error(fmt::format("Failed to initialize libcurl: {}", curl_easy_strerror(result)));
+    }
+}
+}  // namespace
+
+/// @brief One request from submission until its response is complete; owns everything libcurl reads while sending it.
+struct iggy::net::http::HttpConnection::Transfer {
+    Method method;
+    std::string url;
+    std::vector<unsigned char> body;
+    std::string authorization;
+    curl_slist* headers = nullptr;
+    std::vector<unsigned char> response;
+    std::promise<Response> promise;
+    char error[CURL_ERROR_SIZE] = {};
+
+    ~Transfer() { curl_slist_free_all(headers); }
+};
+
+/// @brief A socket libcurl asked the loop to watch.
+struct iggy::net::http::HttpConnection::Socket {
+    uv_poll_t poll;
+    curl_socket_t fd;
+    HttpConnection* connection;
+};
+
+iggy::net::http::HttpConnection::HttpConnection(const std::string& baseUrl,
+                                                 uint32_t maxConnections,
+                                                 uint32_t maxStreams,
+                                                 bool multiplexing,
+                                                 std::optional<std::string> caCertificatePath)
+    : baseUrl(baseUrl)
+    , maxConnections(maxConnections)
+    , maxStreams(maxStreams)
+    , multiplexing(multiplexing)
+    , caCertificatePath(std::move(caCertificatePath)) {
+    if (maxConnections == 0) {
+        throw std::invalid_argument("At least one connection must be allowed");
+    }
+    if (maxStreams == 0) {
+        throw std::invalid_argument("At least one request must be allowed in flight");
+    }
+}
+
+iggy::net::http::HttpConnection::~HttpConnection() {
+    this->close();
+}
+
+void iggy::net::http::HttpConnection::connect() {
+    {
+        std::lock_guard<std::mutex> lifecycleLock(this->lifecycleMutex);
+        if (this->loopOpen) {
+            throw std::logic_error("Connection has already been opened");
+        }
+        initializeCurl();
+
+        int rc = uv_loop_init(&this->loop);
+        if (rc < 0) {
+            throw std::runtime_error(fmt::format("Failed to initialize event loop: {}", uv_strerror(rc)));
+        }
+        this->multi = curl_multi_init();
+        if (!this->multi) {
+            uv_loop_close(&this->loop);
+            throw std::runtime_error("Failed to create libcurl multi handle");
+        }
+        this->loopOpen = true;
+
+        curl_multi_setopt(this->multi, CURLMOPT_SOCKETFUNCTION, onSocket);
+        curl_multi_setopt(this->multi, CURLMOPT_SOCKETDATA, this);
+        curl_multi_setopt(this->multi, CURLMOPT_TIMERFUNCTION, onTimeout);
+        curl_multi_setopt(this->multi, CURLMOPT_TIMERDATA, this);
+        curl_multi_setopt(this->multi, CURLMOPT_PIPELINING, this->multiplexing ? CURLPIPE_MULTIPLEX : CURLPIPE_NOTHING);
+        curl_multi_setopt(this->multi, CURLMOPT_MAX_HOST_CONNECTIONS, static_cast<long>(this->maxConnections));
+        curl_multi_setopt(this->multi, CURLMOPT_MAX_CONCURRENT_STREAMS, static_cast<long>(this->maxStreams));
+
+        // keep every connection we may open in the cache between requests, so none is closed just to make room
+        curl_multi_setopt(this->multi, CURLMOPT_MAXCONNECTS, static_cast<long>(this->maxConnections));
+
+        uv_timer_init(&this->loop, &this->timer);
+        this->timer.data = this;
+        uv_async_init(&this->loop, &this->wakeup, onWakeup);
+        this->wakeup.data = this;
+
+        {
+            std::lock_guard<std::mutex> lock(this->submitMutex);
+            this->started = true;
+        }
+        this->ioThread = std::thread([this]() { uv_run(&this->loop, UV_RUN_DEFAULT); });
+    }
+
+    // libcurl only multiplexes onto a connection once the server's HTTP/2 settings have arrived, and requests that queue up
+    // before then are released one at a time; a first request makes sure the connection is there for the ones that follow
+    try {
+        this->request(GET, "/ping").get();
+    } catch (const std::exception& e) {
+        this->close();
+        throw std::runtime_error(fmt::format("Failed to connect to {}: {}", this->baseUrl, e.what()));
+    }
+}
+
+std::future<iggy::net::http::Response> iggy::net::http::HttpConnection::request(Method method,
+                                                                               const std::string& path,
+                                                                               std::vector<unsigned char> body) {
+    auto transfer = std::make_unique<Transfer>();
+    transfer->method = method;
+    transfer->url = this->baseUrl + path;
+    transfer->body = std::move(body);
+    auto future = transfer->promise.get_future();
+
+    std::lock_guard<std::mutex> lock(this->submitMutex);
+    if (!this->started || this->closing) {
+        throw std::runtime_error("Connection is not open");
+    }
+    transfer->authorization = this->authorization;
+    this->submitted.push_back(std::move(transfer));
+    uv_async_send(&this->wakeup);
+    return future;
+}
+
+void iggy::net::http::HttpConnection::setAccessToken(const std::string& token) {
+    std::lock_guard<std::mutex> lock(this->submitMutex);
+    this->authorization = fmt::format("Authorization: Bearer {}", token);
+}
+
+void iggy::net::http::HttpConnection::close() {
+    std::lock_guard<std::mutex> lifecycleLock(this->lifecycleMutex);
+    {
+        std::lock_guard<std::mutex> lock(this->submitMutex);
+        if (this->started && !this->closing) {
+            this->closing = true;
+            uv_async_send(&this->wakeup);
+        }
+    }
+    if (this->ioThread.joinable()) {
+        this->ioThread.join();
+    }
+    if (this->loopOpen) {
+        uv_loop_close(&this->loop);
+        this->loopOpen = false;
+    }
+}
+
+int iggy::net::http::HttpConnection::onSocket(CURL* easy, curl_socket_t fd, int what, void* userData, void* socketData) {
+    auto self = static_cast<HttpConnection*>(userData);
+    auto socket = static_cast<Socket*>(socketData);
+    if (self->handlesClosed) {
+        // shutdown() has already closed every watcher
+        return 0;
+    }
+    if (what == CURL_POLL_REMOVE) {
+        if (socket) {
+            self->sockets.erase(socket);
+            uv_poll_stop(&socket->poll);
+            uv_close(reinterpret_cast<uv_handle_t*>(&socket->poll), [](uv_handle_t* handle) { delete static_cast<Socket*>(handle->data); });
+            curl_multi_assign(self->multi, fd, nullptr);
+        }
+        return 0;
+    }
+
+    if (!socket) {
+        socket = new Socket{{}, fd, self};
+        if (uv_poll_init_socket(&self->loop, &socket->poll, fd) < 0) {
+            delete socket;
+            return -1;
+        }
+        socket->poll.data = socket;
+        self->sockets.insert(socket);
+        curl_multi_assign(self->multi, fd, socket);
+    }
+    int events = 0;
+    if (what & CURL_POLL_IN) {
+        events |= UV_READABLE;
+    }
+    if (what & CURL_POLL_OUT) {
+        events |= UV_WRITABLE;
+    }
+    uv_poll_start(&socket->poll, events, onPoll);
+    return 0;
+}
+
+int iggy::net::http::HttpConnection::onTimeout(CURLM* multi, long timeoutMs, void* userData) {
+    auto self = static_cast<HttpConnection*>(userData);
+    if (self->handlesClosed) {
+        return 0;
+    }
+    if (timeoutMs < 0) {
+        uv_timer_stop(&self->timer);
+    } else {
+        // libcurl must not be re-entered from this callback, so even a zero timeout goes through the loop
+        uv_timer_start(&self->timer, onTimer, static_cast<uint64_t>(timeoutMs), 0);
+    }
+    return 0;
+}
+
+size_t iggy::net::http::HttpConnection::onBody(char* data, size_t size, size_t count, void* userData) {
+    auto transfer = static_cast<Transfer*>(userData);
+    transfer->response.insert(transfer->response.end(), data, data + size * count);
+    return size * count;
+}
+
+void iggy::net::http::HttpConnection::onWakeup(uv_async_t* handle) {
+    auto self = static_cast<HttpConnection*>(handle->data);
+    bool isClosing;
+    {
+        std::lock_guard<std::mutex> lock(self->submitMutex);
+        isClosing = self->closing;
+    }
+    if (isClosing) {
+        self->shutdown();
+        return;
+    }
+    self->drainSubmitted();
+}
+
+void iggy::net::http::HttpConnection::onTimer(uv_timer_t* handle) {
+    auto self = static_cast<HttpConnection*>(handle->data);
+    self->socketAction(CURL_SOCKET_TIMEOUT, 0);
+}
+
+void iggy::net::http::HttpConnection::onPoll(uv_poll_t* handle, int status, int events) {
+    auto socket = static_cast<Socket*>(handle->data);
+    int flags = 0;
+    if (status < 0) {
+        flags = CURL_CSELECT_ERR;
+    } else {
+        if (events & UV_READABLE) {
+            flags |= CURL_CSELECT_IN;
+        }
+        if (events & UV_WRITABLE) {
+            flags |= CURL_CSELECT_OUT;
+        }
+    }
+    socket->connection->socketAction(socket->fd, flags);
+}
+
+void iggy::net::http::HttpConnection::drainSubmitted() {
+    std::deque<std::unique_ptr<Transfer>> batch;
+    {
+        std::lock_guard<std::mutex> lock(this->submitMutex);
+        batch.swap(this->submitted);
+    }
+    for (auto& transfer : batch) {
+        this->start(std::move(transfer));
+    }
+}
+
+void iggy::net::http::HttpConnection::start(std::unique_ptr<Transfer> transfer) {
+    // handles keep their connection cache entries and DNS results warm, so reuse them rather than creating one per request
+    CURL* easy;
+    if (!this->idleHandles.empty()) {
+        easy = this->idleHandles.back();
+        this->idleHandles.pop_back();
+        curl_easy_reset(easy);
+    } else {
+        easy = curl_easy_init();
+        if (!easy) {
+            transfer->promise.set_exception(std::make_exception_ptr(std::runtime_error("Failed to create libcurl easy handle")));
+            return;
+        }
+    }
+
+    curl_easy_setopt(easy, CURLOPT_URL, transfer->url.c_str());
+    curl_easy_setopt(easy, CURLOPT_PRIVATE, transfer.get());
+    curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, onBody);
+    curl_easy_setopt(easy, CURLOPT_WRITEDATA, transfer.get());
+    curl_easy_setopt(easy, CURLOPT_ERRORBUFFER, transfer->error);
+    curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(easy, CURLOPT_TCP_NODELAY, 1L);
+    curl_easy_setopt(easy, CURLOPT_TCP_KEEPALIVE, 1L);
+    if (this->caCertificatePath) {
+        curl_easy_setopt(easy, CURLOPT_CAINFO, this->caCertificatePath->c_str());
+    }
+    if (this->multiplexing) {
+        bool secure = this->baseUrl.rfind("https://", 0) == 0;
+        curl_easy_setopt(easy, CURLOPT_HTTP_VERSION, secure ? CURL_HTTP_VERSION_2TLS : CURL_HTTP_VERSION_2_PRIOR_KNOWLEDGE);
+
+        // wait for the connection already being set up to confirm HTTP/2, rather than opening one per concurrent request
+        curl_easy_setopt(easy, CURLOPT_PIPEWAIT, 1L);
+    } else {
+        curl_easy_setopt(easy, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+    }
+
+    transfer->headers = curl_slist_append(transfer->headers, "Accept: application/json");
+    if (!transfer->authorization.empty()) {
+        transfer->headers = curl_slist_append(transfer->headers, transfer->authorization.c_str());
+    }
+    if (transfer->method != GET) {
+        // libcurl does not copy the body; the transfer owns it until the response is complete
+        const char* body = transfer->body.empty() ? "" : reinterpret_cast<const char*>(transfer->body.data());
+        curl_easy_setopt(easy, CURLOPT_POSTFIELDS, body);
+        curl_easy_setopt(easy, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(transfer->body.size()));
+        if (transfer->method == PUT) {
+            curl_easy_setopt(easy, CURLOPT_CUSTOMREQUEST, "PUT");
+        } else if (transfer->method == DELETE) {
+            curl_easy_setopt(easy, CURLOPT_CUSTOMREQUEST, "DELETE");
+        }
+        transfer->headers = curl_slist_append(transfer->headers, "Content-Type: application/json");
+
+        // large bodies would otherwise wait a round trip for 100 Continue
+        transfer->headers = curl_slist_append(transfer->headers, "Expect:");
+    }
+    curl_easy_setopt(easy, CURLOPT_HTTPHEADER, transfer->headers);
+
+    CURLMcode rc = curl_multi_add_handle(this->multi, easy);
+    if (rc != CURLM_OK) {
+        auto message = fmt::format("Failed to start HTTP request to {}: {}", transfer->url, curl_multi_strerror(rc));
+        transfer->promise.set_exception(std::make_exception_ptr(std::runtime_error(message)));
+        this->idleHandles.push_back(easy);
+        return;
+    }
+    this->running.emplace(easy, std::move(transfer));
+}
+
+void iggy::net::http::HttpConnection::socketAction(curl_socket_t fd, int events) {
+    int runningHandles;
+    curl_multi_socket_action(this->multi, fd, events, &runningHandles);
+    this->completeTransfers();
+}
+
+void iggy::net::http::HttpConnection::completeTransfers() {
+    CURLMsg* message;
+    int queued;
+    while ((message = curl_multi_info_read(this->multi, &queued))) {
+        if (message->msg != CURLMSG_DONE) {
+            continue;
+        }
+        // the message is only valid until the handle is removed
+        CURL* easy = message->easy_handle;
+        CURLcode result = message->data.result;
+        curl_multi_remove_handle(this->multi, easy);
+
+        auto it = this->running.find(easy);
+        auto transfer = std::move(it->second);
+        this->running.erase(it);
+        if (result == CURLE_OK) {
+            long status = 0;
+            curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &status);
+            transfer->promise.set_value(Response(status, std::move(transfer->response)));
+        } else {
+            auto reason = transfer->error[0] ? transfer->error : curl_easy_strerror(result);
+            auto error = fmt::format("HTTP request to {} failed: {}", transfer->url, reason);
+            transfer->promise.set_exception(std::make_exception_ptr(std::runtime_error(error)));
+        }
+
+        if (this->idleHandles.size() < static_cast<size_t>(this->maxConnections) * this->maxStreams) {
+            this->idleHandles.push_back(easy);
+        } else {
+            curl_easy_cleanup(easy);
+        }
+    }
+}
+
+void iggy::net::http::HttpConnection::failAll(const std::string& reason) {
+    std::deque<std::unique_ptr<Transfer>> batch;
+    {
+        std::lock_guard<std::mutex> lock(this->submitMutex);
+        batch.swap(this->submitted);
+    }
+    auto error = std::make_exception_ptr(std::runtime_error(reason));
+    for (auto& transfer : batch) {
+        transfer->promise.set_exception(error);
+    }
+    for (auto& [easy, transfer] : this->running) {
+        curl_multi_remove_handle(this->multi, easy);
+        curl_easy_cleanup(easy);
+        transfer->promise.set_exception(error);
+    }
+    this->running.clear();
+}
+
+void iggy::net::http::HttpConnection::shutdown() {
+    if (this->handlesClosed) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(this->submitMutex);
+        this->closing = true;
+    }
+    this->handlesClosed = true;
+    this->failAll("Connection closed");
+
+    // stop watching before libcurl closes the cached connections; it may not report them all as removed when cleaning up
+    for (auto socket : this->sockets) {
+        uv_poll_stop(&socket->poll);
+        uv_close(reinterpret_cast<uv_handle_t*>(&socket->poll), [](uv_handle_t* handle) { delete static_cast<Socket*>(handle->data); });
+    }
+    this->sockets.clear();
+    for (auto easy : this->idleHandles) {
+        curl_easy_cleanup(easy);
+    }
+    this->idleHandles.clear();
+    curl_multi_cleanup(this->multi);
+    this->multi = nullptr;
+
+    uv_close(reinterpret_cast<uv_handle_t*>(&this->timer), nullptr);
+    uv_close(reinterpret_cast<uv_handle_t*>(&this->wakeup), nullptr);
+}
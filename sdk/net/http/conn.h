@@ -0,0 +1,179 @@
+#pragma once
+
+#include <curl/curl.h>
+#include <uv.h>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace iggy {
+namespace net {
+
+/**
+ * @namespace http
+ * @brief REST transport over HTTP/2 and HTTP/1.1, built on the libcurl multi interface.
+ */
+namespace http {
+
+/**
+ * @brief Default number of concurrent requests multiplexed on one HTTP/2 connection.
+ */
+const uint32_t DEFAULT_MAX_STREAMS = 32;
+
+/**
+ * @brief HTTP request methods used by the Iggy REST API.
+ */
+enum Method { GET, POST, PUT, DELETE };
+
+/**
+ * @brief A completed HTTP exchange: the response status code and the undecoded body.
+ */
+class Response {
+private:
+    long status;
+    std::vector<unsigned char> body;
+
+public:
+    Response(long status, std::vector<unsigned char> body)
+        : status(status)
+        , body(std::move(body)) {}
+
+    /**
+     * @brief Gets the HTTP status code of the response.
+     */
+    long getStatus() const { return status; }
+
+    /**
+     * @brief Tests whether the status code is in the 2xx success range.
+     */
+    bool isOk() const { return status >= 200 && status < 300; }
+
+    /**
+     * @brief Gets the undecoded response body; empty for responses without one.
+     */
+    const std::vector<unsigned char>& getBody() const { return body; }
+
+    /**
+     * @brief Moves the body out of the response, e.g. to hand it to a decoder that keeps it as its backing buffer.
+     */
+    std::vector<unsigned char> takeBody() { return std::move(body); }
+};
+
+/**
+ * @brief Non-blocking client for the Iggy HTTP REST API on a single libcurl multi handle.
+ *
+ * Like the TCP and QUIC transports, the connection owns a private libuv loop on a dedicated I/O thread and callers submit
+ * requests through a queue. libcurl is driven through its socket interface: it tells the loop which sockets to watch and
+ * when to time out, so one thread serves any number of concurrent requests without a thread or a blocking call per request.
+ *
+ * All requests go through the one multi handle, whose connection cache keeps connections to the server alive between
+ * requests. With multiplexing on, concurrent requests share a single HTTP/2 connection as separate streams, up to
+ * maxStreams at once; plain http speaks HTTP/2 with prior knowledge and https negotiates it with ALPN, falling back to
+ * HTTP/1.1 if the server does not offer it. With multiplexing off, HTTP/1.1 is used and concurrent requests are spread
+ * over up to maxConnections keep-alive connections.
+ */
+class HttpConnection {
+private:
+    struct Transfer;
+    struct Socket;
+
+    const std::string baseUrl;
+    const uint32_t maxConnections;
+    const uint32_t maxStreams;
+    const bool multiplexing;
+    const std::optional<std::string> caCertificatePath;
+
+    uv_loop_t loop;
+    uv_timer_t timer;
+    uv_async_t wakeup;
+    std::thread ioThread;
+    std::mutex lifecycleMutex;
+    bool loopOpen = false;
+
+    // same protocol as TcpConnection: closing is guarded by the submit mutex so no caller signals a closed wakeup handle
+    std::mutex submitMutex;
+    std::deque<std::unique_ptr<Transfer>> submitted;
+    std::string authorization;
+    bool started = false;
+    bool closing = false;
+
+    // state below is only touched on the I/O thread once it is running
+    CURLM* multi = nullptr;
+    std::unordered_map<CURL*, std::unique_ptr<Transfer>> running;
+    std::vector<CURL*> idleHandles;
+    std::unordered_set<Socket*> sockets;
+    bool handlesClosed = false;
+
+    static int onSocket(CURL* easy, curl_socket_t fd, int what, void* userData, void* socketData);
+    static int onTimeout(CURLM* multi, long timeoutMs, void* userData);
+    static size_t onBody(char* data, size_t size, size_t count, void* userData);
+
+    static void onWakeup(uv_async_t* handle);
+    static void onTimer(uv_timer_t* handle);
+    static void onPoll(uv_poll_t* handle, int status, int events);
+
+    void drainSubmitted();
+    void start(std::unique_ptr<Transfer> transfer);
+    void socketAction(curl_socket_t fd, int events);
+    void completeTransfers();
+    void failAll(const std::string& reason);
+    void shutdown();
+
+public:
+    /**
+     * @param baseUrl Scheme, host and port of the server, e.g. http://localhost:3000; request paths are appended to it.
+     * @param maxConnections Maximum number of connections open to the server at once.
+     * @param maxStreams Maximum number of requests multiplexed on one HTTP/2 connection; further requests queue locally.
+     * @param multiplexing Whether to multiplex requests over HTTP/2 instead of using HTTP/1.1.
+     * @param caCertificatePath PEM file with the CA certificates that verify an https server; defaults to the system CA store.
+     */
+    HttpConnection(const std::string& baseUrl,
+                   uint32_t maxConnections = 1,
+                   uint32_t maxStreams = DEFAULT_MAX_STREAMS,
+                   bool multiplexing = true,
+                   std::optional<std::string> caCertificatePath = std::nullopt);
+    HttpConnection(const HttpConnection& other) = delete;
+    HttpConnection& operator=(const HttpConnection& other) = delete;
+    ~HttpConnection();
+
+    /**
+     * @brief Starts the I/O thread and opens the first connection to the server with a ping, blocking until it is answered.
+     *
+     * Further connections, up to maxConnections, are opened as requests need them.
+     * @throws std::runtime_error if the server cannot be reached.
+     */
+    void connect();
+
+    /**
+     * @brief Sends a request, returning a future that is completed when the whole response has arrived.
+     *
+     * The future fails with std::runtime_error if the request could not be completed, e.g. because the server cannot be
+     * reached; a response with an error status still completes it normally.
+     * @param method The HTTP method.
+     * @param path The request path and query, starting with a slash.
+     * @param body The request body, sent as JSON; ignored for GET.
+     */
+    std::future<Response> request(Method method, const std::string& path, std::vector<unsigned char> body = {});
+
+    /**
+     * @brief Sets the bearer token sent with every request submitted from now on, e.g. after logging in.
+     */
+    void setAccessToken(const std::string& token);
+
+    /**
+     * @brief Closes the connection; any outstanding requests are failed with std::runtime_error.
+     */
+    void close();
+};
+
+};  // namespace http
+};  // namespace net
+};  // namespace iggy
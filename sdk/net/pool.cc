@@ -0,0 +1,61 @@
+#include "pool.h"
+#include <sched.h>
+#include <atomic>
+#include <stdexcept>
+
+namespace {
+size_t getThreadOrdinal() {
+    static std::atomic<size_t> nextOrdinal = 0;
+    thread_local size_t ordinal = nextOrdinal.fetch_add(1, std::memory_order_relaxed);
+    return ordinal;
+}
+
+size_t getCpuOrdinal() {
+    int cpu = sched_getcpu();
+
+    // fall back to thread routing if the kernel cannot tell us
+    return cpu < 0 ? getThreadOrdinal() : static_cast<size_t>(cpu);
+}
+}  // namespace
+
+iggy::net::conn::ConnectionPool::ConnectionPool(size_t size,
+                                                ConnectionAffinity affinity,
+                                                const std::function<std::unique_ptr<Connection>()>& factory)
+    : affinity(affinity) {
+    if (size == 0) {
+        throw std::invalid_argument("Connection pool must contain at least one connection");
+    }
+    for (size_t i = 0; i < size; i++) {
+        this->connections.push_back(factory());
+    }
+}
+
+iggy::net::conn::Connection& iggy::net::conn::ConnectionPool::select() const {
+    if (this->connections.size() == 1) {
+        return *this->connections[0];
+    }
+    size_t ordinal = this->affinity == ConnectionAffinity::CPU ? getCpuOrdinal() : getThreadOrdinal();
+    return *this->connections[ordinal % this->connections.size()];
+}
+
+void iggy::net::conn::ConnectionPool::connect() {
+    try {
+        for (auto& connection : this->connections) {
+            connection->connect();
+        }
+    } catch (...) {
+        this->close();
+        throw;
+    }
+}
+
+std::future<iggy::net::conn::Response> iggy::net::conn::ConnectionPool::sendGathered(iggy::serialization::binary::CommandCode command,
+                                                                                     iggy::serialization::binary::GatherBuffer payload) {
+    return this->select().sendGathered(command, std::move(payload));
+}
+
+void iggy::net::conn::ConnectionPool::close() {
+    for (auto& connection : this->connections) {
+        connection->close();
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include "conn.h"
+
+namespace iggy {
+namespace net {
+namespace conn {
+
+/**
+ * @brief How a @ref ConnectionPool picks the connection for the calling thread.
+ */
+enum ConnectionAffinity {
+    /**
+     * @brief Each thread is given a stable ordinal on first use and always uses the same connection.
+     */
+    THREAD,
+
+    /**
+     * @brief The connection is chosen by the CPU the caller is currently running on; best when threads are pinned to cores.
+     */
+    CPU
+};
+
+/**
+ * @brief A fixed set of connections sharded by thread or core affinity.
+ *
+ * Routing is a lock-free modulo over a thread-local ordinal or the current CPU number, so with at least as many
+ * connections as busy threads no two callers ever contend on the same connection. Each connection keeps its own I/O
+ * thread, so syscall and TLS work also spreads across cores.
+ */
+class ConnectionPool : public Connection {
+private:
+    std::vector<std::unique_ptr<Connection>> connections;
+    ConnectionAffinity affinity;
+
+public:
+    /**
+     * @param size Number of connections to create.
+     * @param affinity Routing policy for callers.
+     * @param factory Creates each (not yet connected) connection.
+     */
+    ConnectionPool(size_t size, ConnectionAffinity affinity, const std::function<std::unique_ptr<Connection>()>& factory);
+
+    /**
+     * @brief Gets the number of connections in the pool.
+     */
+    size_t size() const { return connections.size(); }
+
+    /**
+     * @brief Gets the connection at a given index, e.g. to authenticate every connection after @ref connect.
+     */
+    Connection& at(size_t index) const { return *connections.at(index); }
+
+    /**
+     * @brief Gets the connection the calling thread is routed to.
+     */
+    Connection& select() const;
+
+    /**
+     * @brief Connects every connection in the pool; if any fails the ones already connected are closed again.
+     */
+    void connect() override;
+
+    /**
+     * @brief Sends on the connection selected for the calling thread.
+     */
+    std::future<Response> sendGathered(iggy::serialization::binary::CommandCode command,
+                                       iggy::serialization::binary::GatherBuffer payload) override;
+
+    void close() override;
+};
+
+};  // namespace conn
+};  // namespace net
+};  // namespace iggy
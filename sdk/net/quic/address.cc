@@ -0,0 +1,19 @@
+#include "address.h"
+#include <fmt/format.h>
+#include <sys/socket.h>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+iggy::net::quic::Path::Path(int fd) {
+    sockaddr_storage local;
+    sockaddr_storage remote;
+    socklen_t localLength = sizeof(local);
+    socklen_t remoteLength = sizeof(remote);
+    if (::getsockname(fd, reinterpret_cast<sockaddr*>(&local), &localLength) < 0 ||
+        ::getpeername(fd, reinterpret_cast<sockaddr*>(&remote), &remoteLength) < 0) {
+        throw std::runtime_error(fmt::format("Failed to get the addresses of the QUIC socket: {}", std::strerror(errno)));
+    }
+    ngtcp2_path_storage_init(&this->storage, reinterpret_cast<const sockaddr*>(&local), localLength,
+                             reinterpret_cast<const sockaddr*>(&remote), remoteLength, nullptr);
+}
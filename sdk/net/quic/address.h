@@ -1 +1,34 @@
 #pragma once
+
+#include <ngtcp2/ngtcp2.h>
+
+namespace iggy {
+namespace net {
+namespace quic {
+
+/**
+ * @brief The local and remote addresses of a connected UDP socket, in the form ngtcp2 takes with every packet.
+ */
+class Path {
+private:
+    // the path points into the storage's own address buffers, so it can be neither copied nor moved
+    ngtcp2_path_storage storage;
+
+public:
+    /**
+     * @brief Captures both ends of a socket that has already been connected.
+     * @throws std::runtime_error if the socket is not connected.
+     */
+    explicit Path(int fd);
+    Path(const Path& other) = delete;
+    Path& operator=(const Path& other) = delete;
+
+    /**
+     * @brief Gets the path to pass to ngtcp2 when reading or writing packets.
+     */
+    const ngtcp2_path* get() const { return &storage.path; }
+};
+
+};  // namespace quic
+};  // namespace net
+};  // namespace iggy
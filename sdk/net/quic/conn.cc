@@ -0,0 +1,688 @@
+#include "conn.h"
+#include <fmt/format.h>
+#include <ngtcp2/ngtcp2_crypto_wolfssl.h>
+#include <sodium.h>
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+/// @brief How long connect() waits for the handshake before giving up on an unreachable server.
+const ngtcp2_duration HANDSHAKE_TIMEOUT = 10 * NGTCP2_SECONDS;
+
+/// @brief How long the connection may go without any packets before it is considered dead.
+const ngtcp2_duration IDLE_TIMEOUT = 30 * NGTCP2_SECONDS;
+
+/// @brief How often to ping an otherwise idle connection; the server closes connections idle for 10 seconds by default.
+const ngtcp2_duration KEEP_ALIVE_INTERVAL = 5 * NGTCP2_SECONDS;
+
+/// @brief Response bytes the server may send on one stream before we have consumed them.
+const uint64_t STREAM_RECEIVE_WINDOW = 16 * 1024 * 1024;
+
+/// @brief Response bytes the server may send across all streams before we have consumed them.
+const uint64_t CONNECTION_RECEIVE_WINDOW = 64 * 1024 * 1024;
+
+/// @brief Length of the connection IDs we choose; the destination ID of the first packet must be at least 8 bytes.
+const size_t CONNECTION_ID_LENGTH = 18;
+
+/// @brief Room for the encoded transport parameters saved with a session, well above what any server announces.
+const size_t MAX_TRANSPORT_PARAMS_SIZE = 256;
+}  // namespace
+
+void iggy::net::quic::configureClientContext(iggy::ssl::SSLContext<WOLFSSL_CTX*>& context) {
+    if (ngtcp2_crypto_wolfssl_configure_client_context(context.getNativeHandle()) != 0) {
+        throw std::runtime_error("Failed to configure the TLS context for QUIC");
+    }
+}
+
+iggy::net::quic::QuicConnection::QuicConnection(const std::string& host,
+                                                uint16_t port,
+                                                const iggy::net::tcp::TlsEndpoint& tlsEndpoint,
+                                                uint32_t maxInFlight,
+                                                std::set<iggy::serialization::binary::CommandCode> earlyDataCommands,
+                                                bool batching)
+    : host(host)
+    , port(port)
+    , tlsEndpoint(tlsEndpoint)
+    , maxInFlight(maxInFlight)
+    , earlyDataCommands(std::move(earlyDataCommands))
+    , batching(batching) {
+    if (maxInFlight == 0) {
+        throw std::invalid_argument("At least one request must be allowed in flight");
+    }
+}
+
+iggy::net::quic::QuicConnection::~QuicConnection() {
+    this->close();
+}
+
+void iggy::net::quic::QuicConnection::connect() {
+    std::lock_guard<std::mutex> lifecycleLock(this->lifecycleMutex);
+    if (this->loopOpen) {
+        throw std::logic_error("Connection has already been opened");
+    }
+
+    int rc = uv_loop_init(&this->loop);
+    if (rc < 0) {
+        throw std::runtime_error(fmt::format("Failed to initialize event loop: {}", uv_strerror(rc)));
+    }
+    this->loopOpen = true;
+
+    struct addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_protocol = IPPROTO_UDP;
+    uv_getaddrinfo_t resolver;
+    auto service = std::to_string(this->port);
+    rc = uv_getaddrinfo(&this->loop, &resolver, nullptr, this->host.c_str(), service.c_str(), &hints);
+    if (rc < 0) {
+        uv_loop_close(&this->loop);
+        this->loopOpen = false;
+        throw std::runtime_error(fmt::format("Failed to resolve {}:{}: {}", this->host, this->port, uv_strerror(rc)));
+    }
+
+    try {
+        this->socket = std::make_unique<DatagramSocket>(resolver.addrinfo->ai_addr, this->batching);
+    } catch (const std::exception& e) {
+        uv_freeaddrinfo(resolver.addrinfo);
+        uv_loop_close(&this->loop);
+        this->loopOpen = false;
+        throw std::runtime_error(fmt::format("Failed to connect to {}:{}: {}", this->host, this->port, e.what()));
+    }
+    uv_freeaddrinfo(resolver.addrinfo);
+    uv_poll_init_socket(&this->loop, &this->poll, this->socket->getFd());
+    this->poll.data = this;
+    uv_timer_init(&this->loop, &this->timer);
+    this->timer.data = this;
+    uv_async_init(&this->loop, &this->wakeup, onWakeup);
+    this->wakeup.data = this;
+
+    // the loop is not running yet, so the session is set up and the first flight written on the caller's thread
+    std::string error;
+    try {
+        this->createSession();
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+    if (!error.empty()) {
+        // nothing has been sent, so there is nobody to say goodbye to
+        this->closeSilently = true;
+        this->shutdown();
+        uv_run(&this->loop, UV_RUN_DEFAULT);
+        uv_loop_close(&this->loop);
+        this->loopOpen = false;
+        this->freeSession();
+        throw std::runtime_error(error);
+    }
+    uv_poll_start(&this->poll, UV_READABLE, onPoll);
+    this->handshakePending = true;
+    this->writePackets();
+    if (this->earlyData && this->handshakePending) {
+        // the first flight carries the 0-RTT keys, so replay-safe commands can go at once; pump() holds back the rest
+        this->handshakePending = false;
+        this->connected.set_value();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->submitMutex);
+        this->started = true;
+    }
+    this->ioThread = std::thread([this]() { uv_run(&this->loop, UV_RUN_DEFAULT); });
+
+    try {
+        this->connected.get_future().get();
+    } catch (...) {
+        this->ioThread.join();
+        uv_loop_close(&this->loop);
+        this->loopOpen = false;
+        this->freeSession();
+        throw;
+    }
+}
+
+std::future<iggy::net::conn::Response> iggy::net::quic::QuicConnection::sendGathered(iggy::serialization::binary::CommandCode command,
+                                                                                     iggy::serialization::binary::GatherBuffer payload) {
+    auto stream = std::make_unique<Stream>(command, std::move(payload));
+    auto future = stream->getFuture();
+
+    std::lock_guard<std::mutex> lock(this->submitMutex);
+    if (!this->started || this->closing) {
+        throw std::runtime_error("Connection is not open");
+    }
+    this->submitted.push_back(std::move(stream));
+    uv_async_send(&this->wakeup);
+    return future;
+}
+
+void iggy::net::quic::QuicConnection::close() {
+    std::lock_guard<std::mutex> lifecycleLock(this->lifecycleMutex);
+    {
+        std::lock_guard<std::mutex> lock(this->submitMutex);
+        if (this->started && !this->closing) {
+            this->closing = true;
+            uv_async_send(&this->wakeup);
+        }
+    }
+    if (this->ioThread.joinable()) {
+        this->ioThread.join();
+    }
+    if (this->loopOpen) {
+        uv_loop_close(&this->loop);
+        this->loopOpen = false;
+    }
+    this->freeSession();
+}
+
+void iggy::net::quic::QuicConnection::createSession() {
+    this->path = std::make_unique<Path>(this->socket->getFd());
+
+    ngtcp2_cid dcid;
+    ngtcp2_cid scid;
+    dcid.datalen = CONNECTION_ID_LENGTH;
+    scid.datalen = CONNECTION_ID_LENGTH;
+    randombytes_buf(dcid.data, dcid.datalen);
+    randombytes_buf(scid.data, scid.datalen);
+
+    ngtcp2_callbacks callbacks = {};
+    callbacks.client_initial = ngtcp2_crypto_client_initial_cb;
+    callbacks.recv_crypto_data = ngtcp2_crypto_recv_crypto_data_cb;
+    callbacks.encrypt = ngtcp2_crypto_encrypt_cb;
+    callbacks.decrypt = ngtcp2_crypto_decrypt_cb;
+    callbacks.hp_mask = ngtcp2_crypto_hp_mask_cb;
+    callbacks.recv_retry = ngtcp2_crypto_recv_retry_cb;
+    callbacks.update_key = ngtcp2_crypto_update_key_cb;
+    callbacks.delete_crypto_aead_ctx = ngtcp2_crypto_delete_crypto_aead_ctx_cb;
+    callbacks.delete_crypto_cipher_ctx = ngtcp2_crypto_delete_crypto_cipher_ctx_cb;
+    callbacks.get_path_challenge_data = ngtcp2_crypto_get_path_challenge_data_cb;
+    callbacks.version_negotiation = ngtcp2_crypto_version_negotiation_cb;
+    callbacks.rand = onRandom;
+    callbacks.get_new_connection_id = onNewConnectionId;
+    callbacks.handshake_completed = onHandshakeCompleted;
+    callbacks.recv_stream_data = onStreamData;
+    callbacks.stream_close = onStreamClose;
+    callbacks.extend_max_stream_data = onExtendMaxStreamData;
+    callbacks.tls_early_data_rejected = onEarlyDataRejected;
+
+    ngtcp2_settings settings;
+    ngtcp2_settings_default(&settings);
+    settings.initial_ts = uv_hrtime();
+    settings.handshake_timeout = HANDSHAKE_TIMEOUT;
+
+    // the server never opens streams towards us, so only our own bidirectional streams need receive credit
+    ngtcp2_transport_params params;
+    ngtcp2_transport_params_default(&params);
+    params.initial_max_stream_data_bidi_local = STREAM_RECEIVE_WINDOW;
+    params.initial_max_data = CONNECTION_RECEIVE_WINDOW;
+    params.initial_max_streams_bidi = 0;
+    params.initial_max_streams_uni = 0;
+    params.max_idle_timeout = IDLE_TIMEOUT;
+
+    int rv = ngtcp2_conn_client_new(&this->conn, &dcid, &scid, this->path->get(), NGTCP2_PROTO_VER_V1, &callbacks, &settings, &params,
+                                    nullptr, this);
+    if (rv != 0) {
+        this->conn = nullptr;
+        throw std::runtime_error(fmt::format("Failed to create QUIC connection: {}", ngtcp2_strerror(rv)));
+    }
+    ngtcp2_conn_set_keep_alive_timeout(this->conn, KEEP_ALIVE_INTERVAL);
+    ngtcp2_ccerr_default(&this->closeError);
+
+    this->ssl = wolfSSL_new(this->tlsEndpoint.context.getNativeHandle());
+    if (!this->ssl) {
+        throw std::runtime_error("Failed to allocate WolfSSL session");
+    }
+    this->connRef.get_conn = getConn;
+    this->connRef.user_data = this;
+    wolfSSL_set_app_data(this->ssl, &this->connRef);
+    wolfSSL_set_connect_state(this->ssl);
+
+    auto serverName = this->tlsEndpoint.address.getHost();
+#ifdef HAVE_SNI
+    wolfSSL_UseSNI(this->ssl, WOLFSSL_SNI_HOST_NAME, serverName.data(), static_cast<unsigned short>(serverName.size()));
+#endif
+    if (wolfSSL_check_domain_name(this->ssl, serverName.c_str()) != WOLFSSL_SUCCESS) {
+        throw std::runtime_error(fmt::format("Failed to set the expected server name: {}", serverName));
+    }
+#ifdef HAVE_SESSION_TICKET
+    wolfSSL_set_SessionTicket_cb(this->ssl, onSessionTicket, this);
+#endif
+    ngtcp2_conn_set_tls_native_handle(this->conn, this->ssl);
+
+    // early data must respect the limits the server announced on the connection that saved the session
+    std::vector<unsigned char> transportParams;
+    bool resuming = this->tlsEndpoint.context.getSessionCache().resume(this->tlsEndpoint.address, this->ssl, &transportParams);
+#ifdef WOLFSSL_EARLY_DATA
+    if (resuming && !this->earlyDataCommands.empty() && !transportParams.empty() &&
+        ngtcp2_conn_decode_and_set_0rtt_transport_params(this->conn, transportParams.data(), transportParams.size()) == 0) {
+        wolfSSL_set_quic_early_data_enabled(this->ssl, 1);
+        this->earlyData = true;
+    }
+#endif
+}
+
+void iggy::net::quic::QuicConnection::freeSession() {
+    if (this->conn) {
+        ngtcp2_conn_del(this->conn);
+        this->conn = nullptr;
+    }
+    if (this->ssl) {
+        wolfSSL_free(this->ssl);
+        this->ssl = nullptr;
+    }
+    this->path.reset();
+    this->socket.reset();
+}
+
+void iggy::net::quic::QuicConnection::saveSession() {
+    std::vector<unsigned char> transportParams(MAX_TRANSPORT_PARAMS_SIZE);
+    ngtcp2_ssize length = ngtcp2_conn_encode_0rtt_transport_params(this->conn, transportParams.data(), transportParams.size());
+    transportParams.resize(length > 0 ? static_cast<size_t>(length) : 0);
+    this->tlsEndpoint.context.getSessionCache().save(this->tlsEndpoint.address, this->ssl, std::move(transportParams));
+}
+
+ngtcp2_conn* iggy::net::quic::QuicConnection::getConn(ngtcp2_crypto_conn_ref* connRef) {
+    return static_cast<QuicConnection*>(connRef->user_data)->conn;
+}
+
+void iggy::net::quic::QuicConnection::onRandom(uint8_t* dest, size_t length, const ngtcp2_rand_ctx* randCtx) {
+    randombytes_buf(dest, length);
+}
+
+int iggy::net::quic::QuicConnection::onNewConnectionId(ngtcp2_conn* conn,
+                                                       ngtcp2_cid* cid,
+                                                       uint8_t* token,
+                                                       size_t cidLength,
+                                                       void* userData) {
+    randombytes_buf(cid->data, cidLength);
+    cid->datalen = cidLength;
+    randombytes_buf(token, NGTCP2_STATELESS_RESET_TOKENLEN);
+    return 0;
+}
+
+int iggy::net::quic::QuicConnection::onHandshakeCompleted(ngtcp2_conn* conn, void* userData) {
+    // streams cannot be opened from inside a callback, so the queued commands go out once the packet has been processed
+    auto self = static_cast<QuicConnection*>(userData);
+    self->isReady = true;
+    self->sessionResumed = wolfSSL_session_reused(self->ssl) == 1;
+    self->earlyDataAccepted = self->earlyData;
+    if (self->handshakePending) {
+        self->handshakePending = false;
+        self->connected.set_value();
+    }
+    return 0;
+}
+
+int iggy::net::quic::QuicConnection::onStreamData(ngtcp2_conn* conn,
+                                                  uint32_t flags,
+                                                  int64_t streamId,
+                                                  uint64_t offset,
+                                                  const uint8_t* data,
+                                                  size_t length,
+                                                  void* userData,
+                                                  void* streamUserData) {
+    try {
+        static_cast<Stream*>(streamUserData)->receive(data, length);
+    } catch (const std::exception&) {
+        return NGTCP2_ERR_CALLBACK_FAILURE;
+    }
+
+    // the response is buffered in the stream, so the credit can be handed straight back to the server
+    ngtcp2_conn_extend_max_stream_offset(conn, streamId, length);
+    ngtcp2_conn_extend_max_offset(conn, length);
+    return 0;
+}
+
+int iggy::net::quic::QuicConnection::onStreamClose(ngtcp2_conn* conn,
+                                                   uint32_t flags,
+                                                   int64_t streamId,
+                                                   uint64_t appErrorCode,
+                                                   void* userData,
+                                                   void* streamUserData) {
+    // only now has the server acknowledged every byte of the request, so only now may the caller reuse the payload memory
+    auto self = static_cast<QuicConnection*>(userData);
+    auto found = self->open.find(streamId);
+    if (found == self->open.end()) {
+        return 0;
+    }
+    auto stream = std::move(found->second);
+    self->open.erase(found);
+    std::erase(self->writable, stream.get());
+    self->blocked.erase(stream.get());
+
+    if (flags & NGTCP2_STREAM_CLOSE_FLAG_APP_ERROR_CODE_SET) {
+        auto message = fmt::format("Server reset the stream with error code {}", appErrorCode);
+        stream->fail(std::make_exception_ptr(std::runtime_error(message)));
+    } else {
+        stream->complete();
+    }
+    return 0;
+}
+
+int iggy::net::quic::QuicConnection::onExtendMaxStreamData(ngtcp2_conn* conn,
+                                                           int64_t streamId,
+                                                           uint64_t maxData,
+                                                           void* userData,
+                                                           void* streamUserData) {
+    auto self = static_cast<QuicConnection*>(userData);
+    auto stream = static_cast<Stream*>(streamUserData);
+    if (self->blocked.erase(stream) > 0) {
+        self->writable.push_back(stream);
+    }
+    return 0;
+}
+
+int iggy::net::quic::QuicConnection::onEarlyDataRejected(ngtcp2_conn* conn, void* userData) {
+    // ngtcp2 discards every stream opened in 0-RTT without closing them, so their commands go again, first and in their
+    // original order, once the handshake has completed
+    auto self = static_cast<QuicConnection*>(userData);
+    self->earlyData = false;
+    std::vector<std::unique_ptr<Stream>> rejected;
+    for (auto& [streamId, stream] : self->open) {
+        rejected.push_back(std::move(stream));
+    }
+    std::sort(rejected.begin(), rejected.end(), [](const auto& a, const auto& b) { return a->getId() < b->getId(); });
+    self->open.clear();
+    self->writable.clear();
+    self->blocked.clear();
+    for (auto it = rejected.rbegin(); it != rejected.rend(); ++it) {
+        (*it)->rewind();
+        self->pending.push_front(std::move(*it));
+    }
+    return 0;
+}
+
+int iggy::net::quic::QuicConnection::onSessionTicket(WOLFSSL* ssl, const unsigned char* ticket, int ticketSize, void* ctx) {
+    // the ticket is not attached to the session until the callback returns, so only note that it has to be saved
+    static_cast<QuicConnection*>(ctx)->ticketReceived = true;
+    return 0;
+}
+
+void iggy::net::quic::QuicConnection::onWakeup(uv_async_t* handle) {
+    auto self = static_cast<QuicConnection*>(handle->data);
+    bool isClosing;
+    {
+        std::lock_guard<std::mutex> lock(self->submitMutex);
+        isClosing = self->closing;
+    }
+    if (isClosing) {
+        self->shutdown();
+        return;
+    }
+    self->drainSubmitted();
+    self->pump();
+}
+
+void iggy::net::quic::QuicConnection::onTimer(uv_timer_t* handle) {
+    auto self = static_cast<QuicConnection*>(handle->data);
+    int rv = ngtcp2_conn_handle_expiry(self->conn, uv_hrtime());
+    if (rv == NGTCP2_ERR_HANDSHAKE_TIMEOUT) {
+        self->closeSilently = true;
+        self->failConnection(fmt::format("Timed out connecting to {}:{}", self->host, self->port));
+        return;
+    }
+    if (rv == NGTCP2_ERR_IDLE_CLOSE) {
+        self->closeSilently = true;
+        self->failConnection("Connection timed out");
+        return;
+    }
+    if (rv != 0) {
+        ngtcp2_ccerr_set_liberr(&self->closeError, rv, nullptr, 0);
+        self->failConnection(fmt::format("QUIC connection failed: {}", ngtcp2_strerror(rv)));
+        return;
+    }
+
+    // expiry can also close streams, e.g. when it declares the last lost request data acknowledged, freeing window slots
+    self->pump();
+}
+
+void iggy::net::quic::QuicConnection::onPoll(uv_poll_t* handle, int status, int events) {
+    auto self = static_cast<QuicConnection*>(handle->data);
+    if (status < 0) {
+        self->failConnection(fmt::format("Failed to poll the QUIC socket: {}", uv_strerror(status)));
+        return;
+    }
+    if (events & UV_WRITABLE) {
+        // the socket buffer has room again for the packets that did not fit; once they are out, carry on writing
+        if (!self->flushPackets()) {
+            return;
+        }
+        uv_poll_start(&self->poll, UV_READABLE, onPoll);
+        if (!(events & UV_READABLE)) {
+            self->pump();
+            return;
+        }
+    }
+    if (events & UV_READABLE) {
+        self->receivePackets();
+    }
+}
+
+void iggy::net::quic::QuicConnection::receivePackets() {
+    int rc = this->socket->receive([this](const unsigned char* data, size_t length) {
+        if (!this->handlesClosed && length > 0) {
+            this->readPacket(data, length);
+        }
+    });
+    if (this->handlesClosed) {
+        return;
+    }
+    if (rc < 0) {
+        // on a connected socket this is typically an ICMP port unreachable: nothing is listening on the server port
+        this->failConnection(fmt::format("Failed to read from server: {}", uv_strerror(uv_translate_sys_error(-rc))));
+        return;
+    }
+    if (this->ticketReceived) {
+        this->ticketReceived = false;
+        this->saveSession();
+    }
+
+    // every packet of the batch has been processed, so the replies to all of them can go out together
+    this->pump();
+}
+
+bool iggy::net::quic::QuicConnection::readPacket(const unsigned char* data, size_t length) {
+    ngtcp2_pkt_info pi = {};
+    int rv = ngtcp2_conn_read_pkt(this->conn, this->path->get(), &pi, data, length, uv_hrtime());
+    if (rv == NGTCP2_ERR_DRAINING || rv == NGTCP2_ERR_CLOSING || rv == NGTCP2_ERR_DROP_CONN) {
+        this->closeSilently = true;
+        this->failConnection("Connection closed by server");
+        return false;
+    }
+    if (rv == NGTCP2_ERR_CRYPTO) {
+        // never offer a session that may be what the server just rejected
+        this->tlsEndpoint.context.getSessionCache().forget(this->tlsEndpoint.address);
+        ngtcp2_ccerr_set_liberr(&this->closeError, rv, nullptr, 0);
+        this->failConnection(fmt::format("QUIC handshake failed with TLS alert {}", ngtcp2_conn_get_tls_alert(this->conn)));
+        return false;
+    }
+    if (rv != 0) {
+        ngtcp2_ccerr_set_liberr(&this->closeError, rv, nullptr, 0);
+        this->failConnection(fmt::format("Failed to process QUIC packet: {}", ngtcp2_strerror(rv)));
+        return false;
+    }
+    return true;
+}
+
+void iggy::net::quic::QuicConnection::drainSubmitted() {
+    std::lock_guard<std::mutex> lock(this->submitMutex);
+    while (!this->submitted.empty()) {
+        this->pending.push_back(std::move(this->submitted.front()));
+        this->submitted.pop_front();
+    }
+}
+
+void iggy::net::quic::QuicConnection::pump() {
+    if (this->handlesClosed) {
+        return;
+    }
+    // until the handshake completes only replay-safe commands may go, as early data; the others keep their place in line
+    auto it = this->pending.begin();
+    while ((this->isReady || this->earlyData) && this->open.size() < this->maxInFlight && it != this->pending.end()) {
+        if (!this->isReady && !this->earlyDataCommands.contains((*it)->getCommand())) {
+            ++it;
+            continue;
+        }
+        int64_t streamId;
+        int rv = ngtcp2_conn_open_bidi_stream(this->conn, &streamId, it->get());
+        if (rv == NGTCP2_ERR_STREAM_ID_BLOCKED) {
+            // the server's stream limit; it raises the limit as our streams close and we come back here
+            break;
+        }
+        if (rv != 0) {
+            this->failConnection(fmt::format("Failed to open QUIC stream: {}", ngtcp2_strerror(rv)));
+            return;
+        }
+        auto stream = std::move(*it);
+        it = this->pending.erase(it);
+        stream->setId(streamId);
+        this->writable.push_back(stream.get());
+        this->open.emplace(streamId, std::move(stream));
+    }
+    this->writePackets();
+}
+
+void iggy::net::quic::QuicConnection::writePackets() {
+    // while packets wait for room in the socket buffer, writing more would only queue them up behind
+    if (this->handlesClosed || this->socket->hasQueued()) {
+        return;
+    }
+    ngtcp2_tstamp now = uv_hrtime();
+    size_t packetSize = ngtcp2_conn_get_max_tx_udp_payload_size(this->conn);
+    ngtcp2_path_storage ps;
+    ngtcp2_path_storage_zero(&ps);
+    ngtcp2_pkt_info pi;
+
+    // take one packet's worth from the stream at the front and move it to the back, so that streams share the congestion
+    // window round-robin; with MORE set, ngtcp2 keeps filling the same packet from the next stream when there is room
+    auto advance = [this](Stream* stream, ngtcp2_ssize written) {
+        stream->markSent(static_cast<size_t>(written));
+        this->writable.pop_front();
+        if (!stream->isFinSent()) {
+            this->writable.push_back(stream);
+        }
+    };
+    while (true) {
+        Stream* stream = this->writable.empty() ? nullptr : this->writable.front();
+        int64_t streamId = -1;
+        uint32_t flags = NGTCP2_WRITE_STREAM_FLAG_MORE;
+        std::span<const ngtcp2_vec> data;
+        if (stream) {
+            streamId = stream->getId();
+            flags |= NGTCP2_WRITE_STREAM_FLAG_FIN;
+            data = stream->getUnsent();
+        }
+
+        // packets are built straight in the socket's queue; the room stays put while ngtcp2 asks to write more into it
+        ngtcp2_ssize written = -1;
+        ngtcp2_ssize length = ngtcp2_conn_writev_stream(this->conn, &ps.path, &pi, this->socket->reserve(packetSize), packetSize,
+                                                        &written, flags, streamId, data.data(), data.size(), now);
+        if (length == NGTCP2_ERR_WRITE_MORE) {
+            if (stream && written >= 0) {
+                advance(stream, written);
+            }
+            continue;
+        }
+        if (length == NGTCP2_ERR_STREAM_DATA_BLOCKED) {
+            // out of credit for this stream only; it rejoins the rotation when the server extends it
+            this->writable.pop_front();
+            this->blocked.insert(stream);
+            continue;
+        }
+        if (length == NGTCP2_ERR_STREAM_SHUT_WR) {
+            // the server stopped reading; the stream is closed with an error shortly
+            this->writable.pop_front();
+            continue;
+        }
+        if (length < 0) {
+            ngtcp2_ccerr_set_liberr(&this->closeError, static_cast<int>(length), nullptr, 0);
+            this->failConnection(fmt::format("Failed to write QUIC packet: {}", ngtcp2_strerror(static_cast<int>(length))));
+            return;
+        }
+        if (stream && written >= 0) {
+            advance(stream, written);
+        }
+        if (length == 0) {
+            this->flushPackets();
+            break;
+        }
+        this->socket->commit(static_cast<size_t>(length));
+        if (this->socket->isBatchFull() && !this->flushPackets()) {
+            break;
+        }
+    }
+    ngtcp2_conn_update_pkt_tx_time(this->conn, now);
+    this->armTimer();
+}
+
+bool iggy::net::quic::QuicConnection::flushPackets() {
+    if (this->socket->flush()) {
+        return true;
+    }
+
+    // the socket buffer is full: hold on to the rest rather than wait a whole loss detection timeout for retransmissions
+    uv_poll_start(&this->poll, UV_READABLE | UV_WRITABLE, onPoll);
+    return false;
+}
+
+void iggy::net::quic::QuicConnection::armTimer() {
+    ngtcp2_tstamp expiry = ngtcp2_conn_get_expiry(this->conn);
+    if (expiry == UINT64_MAX) {
+        uv_timer_stop(&this->timer);
+        return;
+    }
+    ngtcp2_tstamp now = uv_hrtime();
+    uint64_t timeout = expiry <= now ? 0 : (expiry - now + NGTCP2_MILLISECONDS - 1) / NGTCP2_MILLISECONDS;
+    uv_timer_start(&this->timer, onTimer, timeout, 0);
+}
+
+void iggy::net::quic::QuicConnection::failConnection(const std::string& reason) {
+    if (this->handshakePending) {
+        this->handshakePending = false;
+        this->connected.set_exception(std::make_exception_ptr(std::runtime_error(reason)));
+    }
+    this->failAll(reason);
+    this->shutdown();
+}
+
+void iggy::net::quic::QuicConnection::failAll(const std::string& reason) {
+    this->drainSubmitted();
+    auto error = std::make_exception_ptr(std::runtime_error(reason));
+    for (auto& [streamId, stream] : this->open) {
+        stream->fail(error);
+    }
+    for (auto& stream : this->pending) {
+        stream->fail(error);
+    }
+    this->open.clear();
+    this->pending.clear();
+    this->writable.clear();
+    this->blocked.clear();
+}
+
+void iggy::net::quic::QuicConnection::shutdown() {
+    if (this->handlesClosed) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(this->submitMutex);
+        this->closing = true;
+    }
+    this->handlesClosed = true;
+    this->isReady = false;
+
+    // tell the server we are going so it can free the connection now rather than after its idle timeout
+    if (this->conn && !this->closeSilently && !ngtcp2_conn_in_closing_period(this->conn) && !ngtcp2_conn_in_draining_period(this->conn)) {
+        ngtcp2_path_storage ps;
+        ngtcp2_path_storage_zero(&ps);
+        ngtcp2_pkt_info pi;
+        size_t packetSize = ngtcp2_conn_get_max_tx_udp_payload_size(this->conn);
+        ngtcp2_ssize length = ngtcp2_conn_write_connection_close(this->conn, &ps.path, &pi, this->socket->reserve(packetSize), packetSize,
+                                                                 &this->closeError, uv_hrtime());
+        if (length > 0) {
+            this->socket->commit(static_cast<size_t>(length));
+        }
+        this->socket->flush();
+    }
+    uv_close(reinterpret_cast<uv_handle_t*>(&this->poll), nullptr);
+    uv_close(reinterpret_cast<uv_handle_t*>(&this->timer), nullptr);
+    uv_close(reinterpret_cast<uv_handle_t*>(&this->wakeup), nullptr);
+    this->failAll("Connection closed");
+}
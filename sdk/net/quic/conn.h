@@ -1 +1,171 @@
 #pragma once
+
+#include <ngtcp2/ngtcp2.h>
+#include <ngtcp2/ngtcp2_crypto.h>
+#include <uv.h>
+#include <atomic>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "../conn.h"
+#include "../tcp/tls.h"
+#include "address.h"
+#include "stream.h"
+#include "udp.h"
+
+namespace iggy {
+namespace net {
+
+/**
+ * @namespace quic
+ * @brief Binary protocol transport over QUIC, built on ngtcp2 with wolfSSL.
+ */
+namespace quic {
+
+/**
+ * @brief Default number of commands with an open stream at once on a connection.
+ */
+const uint32_t DEFAULT_MAX_IN_FLIGHT = 32;
+
+/**
+ * @brief Prepares a TLS context for QUIC; must be called once before the context is used by any @ref QuicConnection.
+ * @throws std::runtime_error if wolfSSL was built without QUIC support.
+ */
+void configureClientContext(iggy::ssl::SSLContext<WOLFSSL_CTX*>& context);
+
+/**
+ * @brief Non-blocking QUIC connection to the Iggy server built on ngtcp2 and libuv.
+ *
+ * Like the TCP transport, each connection owns a private libuv loop on a dedicated I/O thread and callers submit commands
+ * through a queue. Instead of sharing one ordered byte stream, every command gets a bidirectional QUIC stream of its own,
+ * see @ref Stream, so commands for independent partitions never wait on each other: a lost packet stalls only the
+ * streams whose data it carried, where on TCP it would stall every response behind it. Up to maxInFlight streams are open
+ * at once, and request data is written round-robin across them so one large send cannot starve the rest.
+ *
+ * QUIC always runs TLS 1.3. Sessions are saved to and resumed from the TLS context's session cache like on TCP, along
+ * with the transport parameters the server announced. Commands listed as early data commands are then sent as 0-RTT
+ * early data in the very first flight of a resumed connection, and @ref connect returns without waiting for the
+ * handshake; every other command waits for the handshake to complete. Otherwise the handshake completes before
+ * @ref connect returns.
+ */
+class QuicConnection : public iggy::net::conn::Connection {
+private:
+    const std::string host;
+    const uint16_t port;
+    const iggy::net::tcp::TlsEndpoint tlsEndpoint;
+    const uint32_t maxInFlight;
+    const std::set<iggy::serialization::binary::CommandCode> earlyDataCommands;
+    const bool batching;
+
+    uv_loop_t loop;
+    uv_poll_t poll;
+    uv_timer_t timer;
+    uv_async_t wakeup;
+    std::thread ioThread;
+    std::promise<void> connected;
+    std::mutex lifecycleMutex;
+    bool loopOpen = false;
+
+    // same protocol as TcpConnection: closing is guarded by the submit mutex so no caller signals a closed wakeup handle
+    std::mutex submitMutex;
+    std::deque<std::unique_ptr<Stream>> submitted;
+    bool started = false;
+    bool closing = false;
+
+    // state below is only touched on the I/O thread once it is running
+    std::unique_ptr<DatagramSocket> socket;
+    std::unique_ptr<Path> path;
+    ngtcp2_conn* conn = nullptr;
+    WOLFSSL* ssl = nullptr;
+    ngtcp2_crypto_conn_ref connRef;
+    std::deque<std::unique_ptr<Stream>> pending;
+    std::unordered_map<int64_t, std::unique_ptr<Stream>> open;
+    std::deque<Stream*> writable;
+    std::unordered_set<Stream*> blocked;
+    ngtcp2_ccerr closeError;
+    bool closeSilently = false;
+    bool handshakePending = false;
+    bool isReady = false;
+    bool earlyData = false;
+    bool ticketReceived = false;
+    bool handlesClosed = false;
+    std::atomic<bool> sessionResumed = false;
+    std::atomic<bool> earlyDataAccepted = false;
+
+    static ngtcp2_conn* getConn(ngtcp2_crypto_conn_ref* connRef);
+    static void onRandom(uint8_t* dest, size_t length, const ngtcp2_rand_ctx* randCtx);
+    static int onNewConnectionId(ngtcp2_conn* conn, ngtcp2_cid* cid, uint8_t* token, size_t cidLength, void* userData);
+    static int onHandshakeCompleted(ngtcp2_conn* conn, void* userData);
+    static int onStreamData(ngtcp2_conn* conn, uint32_t flags, int64_t streamId, uint64_t offset, const uint8_t* data, size_t length,
+                            void* userData, void* streamUserData);
+    static int onStreamClose(ngtcp2_conn* conn, uint32_t flags, int64_t streamId, uint64_t appErrorCode, void* userData,
+                             void* streamUserData);
+    static int onExtendMaxStreamData(ngtcp2_conn* conn, int64_t streamId, uint64_t maxData, void* userData, void* streamUserData);
+    static int onEarlyDataRejected(ngtcp2_conn* conn, void* userData);
+    static int onSessionTicket(WOLFSSL* ssl, const unsigned char* ticket, int ticketSize, void* ctx);
+
+    static void onWakeup(uv_async_t* handle);
+    static void onTimer(uv_timer_t* handle);
+    static void onPoll(uv_poll_t* handle, int status, int events);
+
+    void createSession();
+    void receivePackets();
+    bool readPacket(const unsigned char* data, size_t length);
+    void freeSession();
+    void saveSession();
+    void drainSubmitted();
+    void pump();
+    void writePackets();
+    bool flushPackets();
+    void armTimer();
+    void failConnection(const std::string& reason);
+    void failAll(const std::string& reason);
+    void shutdown();
+
+public:
+    /**
+     * @param host Hostname or IP address of the server.
+     * @param port UDP port of the server.
+     * @param tlsEndpoint TLS context, prepared with @ref configureClientContext, and the server address to verify.
+     * @param maxInFlight Maximum number of commands with an open stream; further commands queue locally.
+     * @param earlyDataCommands Commands that may be sent as 0-RTT early data on a resumed connection. The server may
+     * receive early data more than once if an attacker replays it, so list only commands that are safe to repeat; empty
+     * disables early data.
+     * @param batching Whether to batch packets into as few system calls as possible, see @ref DatagramSocket.
+     */
+    QuicConnection(const std::string& host,
+                   uint16_t port,
+                   const iggy::net::tcp::TlsEndpoint& tlsEndpoint,
+                   uint32_t maxInFlight = DEFAULT_MAX_IN_FLIGHT,
+                   std::set<iggy::serialization::binary::CommandCode> earlyDataCommands = {},
+                   bool batching = true);
+    QuicConnection(const QuicConnection& other) = delete;
+    QuicConnection& operator=(const QuicConnection& other) = delete;
+    ~QuicConnection() override;
+
+    void connect() override;
+    std::future<iggy::net::conn::Response> sendGathered(iggy::serialization::binary::CommandCode command,
+                                                        iggy::serialization::binary::GatherBuffer payload) override;
+    void close() override;
+
+    /**
+     * @brief Tests whether the handshake resumed a cached session rather than running a full key exchange.
+     */
+    bool isSessionResumed() const { return sessionResumed; }
+
+    /**
+     * @brief Tests whether the server accepted the commands sent as 0-RTT early data; false if none were attempted.
+     */
+    bool isEarlyDataAccepted() const { return earlyDataAccepted; }
+};
+
+};  // namespace quic
+};  // namespace net
+};  // namespace iggy
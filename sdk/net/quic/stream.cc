@@ -0,0 +1,88 @@
+#include "stream.h"
+#include <fmt/format.h>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+/// @brief Most a stream reserves for a response before its data has arrived; a larger response grows as the data does, so
+/// that streams a server announces much and sends little on cost no more than this each.
+const size_t MAX_RESPONSE_RESERVE = 1024 * 1024;
+}  // namespace
+
+iggy::net::quic::Stream::Stream(iggy::serialization::binary::CommandCode command, iggy::serialization::binary::GatherBuffer payload)
+    : command(command)
+    , payload(std::move(payload)) {
+    this->header = iggy::net::tcp::prepareRequestHeader(this->headerStorage, command, this->payload.size());
+    this->queueRequest();
+}
+
+void iggy::net::quic::Stream::queueRequest() {
+    // the stream is never moved, so these point at its own header and payload for as long as ngtcp2 may need them
+    this->unsent.clear();
+    this->unsentStart = 0;
+    // ngtcp2 never writes through the pointers, its vector type just is not const
+    this->unsent.push_back({const_cast<uint8_t*>(this->header), iggy::net::tcp::REQUEST_HEADER_SIZE});
+    this->payload.forEachSegment([this](const unsigned char* data, size_t length) {
+        this->unsent.push_back({const_cast<uint8_t*>(data), length});
+    });
+    this->unsentSize = iggy::net::tcp::REQUEST_HEADER_SIZE + this->payload.size();
+    this->finSent = false;
+}
+
+void iggy::net::quic::Stream::rewind() {
+    this->id = -1;
+    this->queueRequest();
+    this->responseHeaderSize = 0;
+    this->responsePayload.clear();
+}
+
+void iggy::net::quic::Stream::markSent(size_t length) {
+    this->unsentSize -= length;
+    while (length > 0) {
+        auto& segment = this->unsent[this->unsentStart];
+        if (length < segment.len) {
+            segment.base += length;
+            segment.len -= length;
+            break;
+        }
+        length -= segment.len;
+        this->unsentStart++;
+    }
+    this->finSent = this->unsentSize == 0;
+}
+
+void iggy::net::quic::Stream::receive(const uint8_t* data, size_t length) {
+    size_t headerPart = std::min(length, iggy::net::tcp::RESPONSE_HEADER_SIZE - this->responseHeaderSize);
+    if (headerPart > 0) {
+        std::memcpy(this->responseHeader.data() + this->responseHeaderSize, data, headerPart);
+        this->responseHeaderSize += headerPart;
+        data += headerPart;
+        length -= headerPart;
+        if (this->responseHeaderSize == iggy::net::tcp::RESPONSE_HEADER_SIZE) {
+            uint32_t announced = iggy::serialization::loadLittleEndian<uint32_t>(this->responseHeader.data() + 4);
+            if (announced > iggy::net::tcp::MAX_RESPONSE_SIZE) {
+                throw std::runtime_error(fmt::format("Server announced a response of {} bytes, more than the limit of {}", announced,
+                                                     iggy::net::tcp::MAX_RESPONSE_SIZE));
+            }
+            this->responsePayload.reserve(std::min<size_t>(announced, MAX_RESPONSE_RESERVE));
+        }
+    }
+    if (length == 0) {
+        return;
+    }
+    if (this->responsePayload.size() + length > iggy::serialization::loadLittleEndian<uint32_t>(this->responseHeader.data() + 4)) {
+        throw std::runtime_error("Server sent more data than the response frame announced");
+    }
+    this->responsePayload.insert(this->responsePayload.end(), data, data + length);
+}
+
+void iggy::net::quic::Stream::complete() {
+    if (this->responseHeaderSize < iggy::net::tcp::RESPONSE_HEADER_SIZE ||
+        this->responsePayload.size() != iggy::serialization::loadLittleEndian<uint32_t>(this->responseHeader.data() + 4)) {
+        this->fail(std::make_exception_ptr(std::runtime_error("Server closed the stream before sending a full response")));
+        return;
+    }
+    uint32_t status = iggy::serialization::loadLittleEndian<uint32_t>(this->responseHeader.data());
+    this->promise.set_value(iggy::net::conn::Response(status, std::move(this->responsePayload)));
+}
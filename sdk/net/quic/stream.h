@@ -1 +1,124 @@
 #pragma once
+
+#include <ngtcp2/ngtcp2.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <span>
+#include <vector>
+#include "../conn.h"
+#include "../tcp/frame.h"
+
+namespace iggy {
+namespace net {
+namespace quic {
+
+/**
+ * @brief One command and its response, carried on a bidirectional QUIC stream of its own.
+ *
+ * The server reads a request frame up to the stream's FIN and answers with a response frame on the same stream, so every
+ * command opens a fresh stream; the frames are the same as on TCP. Streams are retransmitted and flow-controlled
+ * independently, so a lost packet only delays the commands whose data it carried, and a large send to one partition
+ * cannot hold up a poll from another.
+ *
+ * ngtcp2 does not copy stream data but points into it until the server acknowledges it, so the stream keeps its request
+ * frame, including any caller memory the payload references, until it is closed.
+ */
+class Stream {
+private:
+    iggy::serialization::binary::CommandCode command;
+    // a static frame for parameterless commands, otherwise headerStorage
+    const unsigned char* header;
+    std::array<unsigned char, iggy::net::tcp::REQUEST_HEADER_SIZE> headerStorage;
+    iggy::serialization::binary::GatherBuffer payload;
+    std::promise<iggy::net::conn::Response> promise;
+    int64_t id = -1;
+
+    // request data not yet handed to ngtcp2: whole segments before unsentStart are done, the one at unsentStart is trimmed
+    std::vector<ngtcp2_vec> unsent;
+    size_t unsentStart = 0;
+    size_t unsentSize = 0;
+    bool finSent = false;
+
+    std::array<unsigned char, iggy::net::tcp::RESPONSE_HEADER_SIZE> responseHeader;
+    size_t responseHeaderSize = 0;
+    std::vector<unsigned char> responsePayload;
+
+    /**
+     * @brief Makes the whole request frame unsent.
+     */
+    void queueRequest();
+
+public:
+    Stream(iggy::serialization::binary::CommandCode command, iggy::serialization::binary::GatherBuffer payload);
+    Stream(const Stream& other) = delete;
+    Stream& operator=(const Stream& other) = delete;
+
+    /**
+     * @brief Gets the future completed with the response once the stream closes.
+     */
+    std::future<iggy::net::conn::Response> getFuture() { return promise.get_future(); }
+
+    /**
+     * @brief Gets the command the stream carries.
+     */
+    iggy::serialization::binary::CommandCode getCommand() const { return command; }
+
+    /**
+     * @brief Gets the QUIC stream ID, or -1 until the stream has been opened.
+     */
+    int64_t getId() const { return id; }
+
+    /**
+     * @brief Records the ID assigned when the stream was opened.
+     */
+    void setId(int64_t id) { this->id = id; }
+
+    /**
+     * @brief Gets the request data that has not been written yet; empty once it has all gone.
+     */
+    std::span<const ngtcp2_vec> getUnsent() const { return std::span(unsent).subspan(unsentStart); }
+
+    /**
+     * @brief Marks the first length bytes of the unsent data as written.
+     *
+     * The FIN is always requested along with the data and ngtcp2 sends it with the last byte, so once nothing is left the
+     * whole request has gone.
+     */
+    void markSent(size_t length);
+
+    /**
+     * @brief Tests whether the whole request, including its FIN, has been written.
+     */
+    bool isFinSent() const { return finSent; }
+
+    /**
+     * @brief Returns the stream to its unopened state so the request can be sent again on a new stream.
+     *
+     * Used when the server rejects 0-RTT early data, which discards every stream opened before the handshake completed.
+     */
+    void rewind();
+
+    /**
+     * @brief Appends response data received on the stream.
+     * @throws std::runtime_error if the response frame announces more than @ref iggy::net::tcp::MAX_RESPONSE_SIZE, or the
+     * server sends more than it announced.
+     */
+    void receive(const uint8_t* data, size_t length);
+
+    /**
+     * @brief Completes the future with the received response, or with an error if it is incomplete.
+     */
+    void complete();
+
+    /**
+     * @brief Completes the future with the given error.
+     */
+    void fail(std::exception_ptr error) { promise.set_exception(error); }
+};
+
+};  // namespace quic
+};  // namespace net
+};  // namespace iggy
@@ -0,0 +1,234 @@
+#include "udp.h"
+#include <fmt/format.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__linux__) && defined(UDP_SEGMENT) && defined(UDP_GRO)
+#define IGGY_HAVE_UDP_OFFLOAD 1
+#endif
+
+namespace {
+/// @brief Large enough for any UDP datagram, and for the largest GRO merge the kernel hands back.
+const size_t RECEIVE_BUFFER_SIZE = 64 * 1024;
+
+/// @brief Datagrams, or merged GRO buffers, read with one recvmmsg.
+const size_t RECEIVE_BATCH = 8;
+
+/// @brief System calls one receive() makes at most, so a flood of packets cannot starve the connection's timers.
+const int MAX_RECEIVE_ROUNDS = 16;
+
+/// @brief The largest UDP payload one GSO send may carry in total.
+const size_t MAX_GSO_BYTES = 65507;
+}  // namespace
+
+iggy::net::quic::DatagramSocket::DatagramSocket(const sockaddr* remote, bool batching)
+    : batching(batching) {
+    this->fd = ::socket(remote->sa_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_UDP);
+    if (this->fd < 0) {
+        throw std::runtime_error(fmt::format("Failed to create UDP socket: {}", std::strerror(errno)));
+    }
+    socklen_t remoteLength = remote->sa_family == AF_INET6 ? sizeof(sockaddr_in6) : sizeof(sockaddr_in);
+    if (::connect(this->fd, remote, remoteLength) < 0) {
+        int err = errno;
+        ::close(this->fd);
+        throw std::runtime_error(fmt::format("Failed to connect UDP socket: {}", std::strerror(err)));
+    }
+
+#if defined(IGGY_HAVE_UDP_OFFLOAD)
+    if (batching) {
+        // kernels before 4.18 (GSO) and 5.0 (GRO) reject the options; batching then falls back to sendmmsg and recvmmsg
+        int segmentSize = 0;
+        socklen_t optionLength = sizeof(segmentSize);
+        this->gso = ::getsockopt(this->fd, SOL_UDP, UDP_SEGMENT, &segmentSize, &optionLength) == 0;
+        int enable = 1;
+        this->gro = ::setsockopt(this->fd, SOL_UDP, UDP_GRO, &enable, sizeof(enable)) == 0;
+    }
+#endif
+    this->receiveBuffers.resize(batching ? RECEIVE_BATCH : 1, std::vector<unsigned char>(RECEIVE_BUFFER_SIZE));
+}
+
+iggy::net::quic::DatagramSocket::~DatagramSocket() {
+    ::close(this->fd);
+}
+
+unsigned char* iggy::net::quic::DatagramSocket::reserve(size_t capacity) {
+    if (this->queued.size() < this->queuedBytes + capacity) {
+        this->queued.resize(this->queuedBytes + capacity);
+    }
+    return this->queued.data() + this->queuedBytes;
+}
+
+void iggy::net::quic::DatagramSocket::commit(size_t length) {
+    this->packets.push_back({this->queuedBytes, length});
+    this->queuedBytes += length;
+}
+
+bool iggy::net::quic::DatagramSocket::flush() {
+    while (this->sentPackets < this->packets.size()) {
+        size_t sent = this->sendSome();
+        if (sent == 0) {
+            return false;
+        }
+        this->sentPackets += sent;
+    }
+    this->packets.clear();
+    this->sentPackets = 0;
+    this->queuedBytes = 0;
+    return true;
+}
+
+size_t iggy::net::quic::DatagramSocket::sendSome() {
+    const Packet& first = this->packets[this->sentPackets];
+    size_t remaining = this->packets.size() - this->sentPackets;
+    ssize_t rc;
+    if (!this->batching || remaining == 1) {
+        rc = ::send(this->fd, this->queued.data() + first.offset, first.length, 0);
+        if (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return 0;
+        }
+        return 1;
+    }
+
+#if defined(IGGY_HAVE_UDP_OFFLOAD)
+    if (this->gso) {
+        // a run of packets of the first one's size, optionally ended by one shorter packet, is segmented by the kernel
+        size_t maxSegments = std::min(MAX_BATCH_PACKETS, MAX_GSO_BYTES / first.length);
+        size_t count = 1;
+        size_t length = first.length;
+        while (count < std::min(remaining, maxSegments)) {
+            const Packet& next = this->packets[this->sentPackets + count];
+            if (next.length > first.length) {
+                break;
+            }
+            count++;
+            length += next.length;
+            if (next.length < first.length) {
+                break;
+            }
+        }
+        if (count > 1) {
+            iovec iov = {this->queued.data() + first.offset, length};
+            alignas(cmsghdr) unsigned char control[CMSG_SPACE(sizeof(uint16_t))] = {};
+            msghdr msg = {};
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+            cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+            cmsg->cmsg_level = SOL_UDP;
+            cmsg->cmsg_type = UDP_SEGMENT;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            uint16_t segmentSize = static_cast<uint16_t>(first.length);
+            std::memcpy(CMSG_DATA(cmsg), &segmentSize, sizeof(segmentSize));
+
+            rc = ::sendmsg(this->fd, &msg, 0);
+            if (rc >= 0) {
+                return count;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return 0;
+            }
+            if (errno != EIO && errno != EINVAL) {
+                return count;
+            }
+
+            // the route's device cannot checksum segments for us; sendmmsg still saves the per-packet system calls
+            this->gso = false;
+        }
+    }
+#endif
+
+#if defined(__linux__)
+    std::array<mmsghdr, MAX_BATCH_PACKETS> messages = {};
+    std::array<iovec, MAX_BATCH_PACKETS> iovs;
+    size_t count = std::min(remaining, MAX_BATCH_PACKETS);
+    for (size_t i = 0; i < count; i++) {
+        const Packet& packet = this->packets[this->sentPackets + i];
+        iovs[i] = {this->queued.data() + packet.offset, packet.length};
+        messages[i].msg_hdr.msg_iov = &iovs[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+    }
+    int sent = ::sendmmsg(this->fd, messages.data(), static_cast<unsigned int>(count), 0);
+    if (sent > 0) {
+        return static_cast<size_t>(sent);
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return 0;
+    }
+    return 1;
+#else
+    rc = ::send(this->fd, this->queued.data() + first.offset, first.length, 0);
+    if (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return 0;
+    }
+    return 1;
+#endif
+}
+
+int iggy::net::quic::DatagramSocket::receive(const DatagramHandler& onDatagram) {
+    for (int round = 0; round < MAX_RECEIVE_ROUNDS; round++) {
+        if (!this->batching) {
+            auto& buffer = this->receiveBuffers[0];
+            ssize_t n = ::recv(this->fd, buffer.data(), buffer.size(), 0);
+            if (n < 0) {
+                return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -errno;
+            }
+            onDatagram(buffer.data(), static_cast<size_t>(n));
+            continue;
+        }
+
+#if defined(__linux__)
+        std::array<mmsghdr, RECEIVE_BATCH> messages = {};
+        std::array<iovec, RECEIVE_BATCH> iovs;
+        alignas(cmsghdr) unsigned char control[RECEIVE_BATCH][CMSG_SPACE(sizeof(int))];
+        for (size_t i = 0; i < RECEIVE_BATCH; i++) {
+            iovs[i] = {this->receiveBuffers[i].data(), this->receiveBuffers[i].size()};
+            messages[i].msg_hdr.msg_iov = &iovs[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+            messages[i].msg_hdr.msg_control = control[i];
+            messages[i].msg_hdr.msg_controllen = sizeof(control[i]);
+        }
+        int received = ::recvmmsg(this->fd, messages.data(), RECEIVE_BATCH, 0, nullptr);
+        if (received < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -errno;
+        }
+        for (int i = 0; i < received; i++) {
+            const unsigned char* data = this->receiveBuffers[i].data();
+            size_t length = messages[i].msg_len;
+
+            // with GRO the buffer may hold several datagrams of the announced size, the last one possibly shorter
+            size_t segmentSize = length;
+#if defined(IGGY_HAVE_UDP_OFFLOAD)
+            for (cmsghdr* cmsg = CMSG_FIRSTHDR(&messages[i].msg_hdr); cmsg; cmsg = CMSG_NXTHDR(&messages[i].msg_hdr, cmsg)) {
+                if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+                    int announced;
+                    std::memcpy(&announced, CMSG_DATA(cmsg), sizeof(announced));
+                    segmentSize = static_cast<size_t>(announced);
+                }
+            }
+#endif
+            for (size_t offset = 0; offset < length && segmentSize > 0; offset += segmentSize) {
+                onDatagram(data + offset, std::min(segmentSize, length - offset));
+            }
+        }
+        if (static_cast<size_t>(received) < RECEIVE_BATCH) {
+            return 0;
+        }
+#else
+        auto& buffer = this->receiveBuffers[0];
+        ssize_t n = ::recv(this->fd, buffer.data(), buffer.size(), 0);
+        if (n < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -errno;
+        }
+        onDatagram(buffer.data(), static_cast<size_t>(n));
+#endif
+    }
+    return 0;
+}
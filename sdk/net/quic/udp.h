@@ -0,0 +1,121 @@
+#pragma once
+
+#include <sys/socket.h>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace iggy {
+namespace net {
+namespace quic {
+
+/**
+ * @brief Most packets handed to the kernel in one system call when batching.
+ *
+ * This is also the kernel's limit on segments in one GSO send.
+ */
+const size_t MAX_BATCH_PACKETS = 64;
+
+/**
+ * @brief Non-blocking UDP socket connected to a single server, which can batch its datagram I/O.
+ *
+ * Userspace QUIC otherwise pays a system call per packet in each direction, which caps its throughput well below TCP.
+ * With batching on, outgoing packets are queued and then handed to the kernel together: runs of equal-sized packets
+ * go as one generic segmentation offload (GSO) send with UDP_SEGMENT, and anything else goes through sendmmsg.
+ * Incoming datagrams are read with recvmmsg, and with generic receive offload (GRO) the kernel also merges back-to-back
+ * datagrams from the server into one buffer. If the kernel or the NIC does not support GSO or GRO, the socket quietly
+ * falls back to sendmmsg and plain recvmmsg. With batching off, every packet is sent and received on its own.
+ */
+class DatagramSocket {
+public:
+    /**
+     * @brief Called once for every datagram received.
+     */
+    using DatagramHandler = std::function<void(const unsigned char* data, size_t length)>;
+
+private:
+    struct Packet {
+        size_t offset;
+        size_t length;
+    };
+
+    int fd = -1;
+    const bool batching;
+    bool gso = false;
+    bool gro = false;
+
+    // outgoing packets back to back; those before sentPackets have already gone to the kernel
+    std::vector<unsigned char> queued;
+    size_t queuedBytes = 0;
+    std::vector<Packet> packets;
+    size_t sentPackets = 0;
+
+    std::vector<std::vector<unsigned char>> receiveBuffers;
+
+    /**
+     * @brief Hands the next packets to the kernel with a single system call.
+     * @return The number of packets sent or dropped, or 0 if the socket buffer is full.
+     */
+    size_t sendSome();
+
+public:
+    /**
+     * @param remote The server address, which the socket is connected to.
+     * @param batching Whether to batch datagram I/O; otherwise every packet takes a system call of its own.
+     * @throws std::runtime_error if the socket cannot be created or connected.
+     */
+    DatagramSocket(const sockaddr* remote, bool batching);
+    DatagramSocket(const DatagramSocket& other) = delete;
+    DatagramSocket& operator=(const DatagramSocket& other) = delete;
+    ~DatagramSocket();
+
+    /**
+     * @brief Gets the native socket, e.g. to watch it for readiness.
+     */
+    int getFd() const { return fd; }
+
+    /**
+     * @brief Tests whether batching is on and the kernel segments equal-sized packets for us.
+     */
+    bool isSegmentationOffloaded() const { return gso; }
+
+    /**
+     * @brief Gets room at the end of the queue to build a packet of up to capacity bytes in.
+     *
+     * The pointer is only valid until the next call; pass the packet's actual length to @ref commit.
+     */
+    unsigned char* reserve(size_t capacity);
+
+    /**
+     * @brief Queues the packet just built in the room from @ref reserve.
+     */
+    void commit(size_t length);
+
+    /**
+     * @brief Tests whether enough packets are queued that they should be flushed before building more.
+     */
+    bool isBatchFull() const { return packets.size() - sentPackets >= (batching ? MAX_BATCH_PACKETS : 1); }
+
+    /**
+     * @brief Tests whether packets are still waiting for room in the socket buffer.
+     */
+    bool hasQueued() const { return sentPackets < packets.size(); }
+
+    /**
+     * @brief Sends every queued packet, or as many as the socket buffer takes.
+     *
+     * Send errors other than a full buffer drop the packets concerned; QUIC recovers from that as from any other loss.
+     * @return true if the queue is now empty, false if the rest has to wait until the socket is writable.
+     */
+    bool flush();
+
+    /**
+     * @brief Reads the datagrams waiting on the socket, up to a bounded number of system calls.
+     * @return 0, or the negated errno if reading failed, e.g. ECONNREFUSED when nothing listens on the server port.
+     */
+    int receive(const DatagramHandler& onDatagram);
+};
+
+};  // namespace quic
+};  // namespace net
+};  // namespace iggy
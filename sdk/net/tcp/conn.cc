@@ -0,0 +1,510 @@
+#include "conn.h"
+#include <fmt/format.h>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "spdlog/spdlog.h"
+
+namespace {
+/// @brief Minimum free space offered to libuv for each socket read.
+const size_t READ_CHUNK_SIZE = 64 * 1024;
+
+/// @brief A userspace-encrypted write, which owns its ciphertext until libuv is done with it.
+struct CiphertextWrite {
+    uv_write_t req;
+    std::vector<unsigned char> ciphertext;
+    iggy::net::tcp::TcpConnection* connection;
+};
+}  // namespace
+
+iggy::net::tcp::TcpConnection::TcpConnection(const std::string& host,
+                                             uint16_t port,
+                                             uint32_t maxInFlight,
+                                             std::optional<TlsEndpoint> tlsEndpoint,
+                                             bool kernelTls)
+    : host(host)
+    , port(port)
+    , maxInFlight(maxInFlight)
+    , tlsEndpoint(std::move(tlsEndpoint))
+    , kernelTls(kernelTls) {
+    if (maxInFlight == 0) {
+        throw std::invalid_argument("At least one request must be allowed in flight");
+    }
+}
+
+iggy::net::tcp::TcpConnection::~TcpConnection() {
+    this->close();
+}
+
+void iggy::net::tcp::TcpConnection::connect() {
+    std::lock_guard<std::mutex> lifecycleLock(this->lifecycleMutex);
+    if (this->loopOpen) {
+        throw std::logic_error("Connection has already been opened");
+    }
+
+    int rc = uv_loop_init(&this->loop);
+    if (rc < 0) {
+        throw std::runtime_error(fmt::format("Failed to initialize event loop: {}", uv_strerror(rc)));
+    }
+    this->loopOpen = true;
+
+    // resolve synchronously: the loop is not running yet, so this is still safe to do on the caller's thread
+    struct addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+    uv_getaddrinfo_t resolver;
+    auto service = std::to_string(this->port);
+    rc = uv_getaddrinfo(&this->loop, &resolver, nullptr, this->host.c_str(), service.c_str(), &hints);
+    if (rc < 0) {
+        uv_loop_close(&this->loop);
+        this->loopOpen = false;
+        throw std::runtime_error(fmt::format("Failed to resolve {}:{}: {}", this->host, this->port, uv_strerror(rc)));
+    }
+
+    uv_tcp_init(&this->loop, &this->socket);
+    this->socket.data = this;
+    uv_async_init(&this->loop, &this->wakeup, onWakeup);
+    this->wakeup.data = this;
+    this->connectReq.data = this;
+    rc = uv_tcp_connect(&this->connectReq, &this->socket, resolver.addrinfo->ai_addr, onConnect);
+    uv_freeaddrinfo(resolver.addrinfo);
+    if (rc < 0) {
+        // no I/O thread yet, so drive the loop here just long enough to finish closing the handles
+        this->shutdown();
+        uv_run(&this->loop, UV_RUN_DEFAULT);
+        uv_loop_close(&this->loop);
+        this->loopOpen = false;
+        throw std::runtime_error(fmt::format("Failed to connect to {}:{}: {}", this->host, this->port, uv_strerror(rc)));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->submitMutex);
+        this->started = true;
+    }
+    this->ioThread = std::thread([this]() { uv_run(&this->loop, UV_RUN_DEFAULT); });
+
+    try {
+        this->connected.get_future().get();
+    } catch (...) {
+        // the I/O thread has already closed its handles, so the loop is exiting on its own
+        this->ioThread.join();
+        uv_loop_close(&this->loop);
+        this->loopOpen = false;
+        throw;
+    }
+}
+
+std::future<iggy::net::conn::Response> iggy::net::tcp::TcpConnection::sendGathered(iggy::serialization::binary::CommandCode command,
+                                                                                    iggy::serialization::binary::GatherBuffer payload) {
+    auto request = std::make_unique<Request>();
+    request->header = prepareRequestHeader(request->headerStorage, command, payload.size());
+    request->payload = std::move(payload);
+    auto future = request->promise.get_future();
+
+    std::lock_guard<std::mutex> lock(this->submitMutex);
+    if (!this->started || this->closing) {
+        throw std::runtime_error("Connection is not open");
+    }
+    this->submitted.push_back(std::move(request));
+    uv_async_send(&this->wakeup);
+    return future;
+}
+
+void iggy::net::tcp::TcpConnection::close() {
+    std::lock_guard<std::mutex> lifecycleLock(this->lifecycleMutex);
+    {
+        std::lock_guard<std::mutex> lock(this->submitMutex);
+        if (this->started && !this->closing) {
+            this->closing = true;
+            uv_async_send(&this->wakeup);
+        }
+    }
+    if (this->ioThread.joinable()) {
+        this->ioThread.join();
+    }
+    if (this->loopOpen) {
+        uv_loop_close(&this->loop);
+        this->loopOpen = false;
+    }
+}
+
+void iggy::net::tcp::TcpConnection::onConnect(uv_connect_t* req, int status) {
+    auto self = static_cast<TcpConnection*>(req->data);
+    if (status < 0) {
+        auto message = fmt::format("Failed to connect to {}:{}: {}", self->host, self->port, uv_strerror(status));
+        self->connected.set_exception(std::make_exception_ptr(std::runtime_error(message)));
+        self->shutdown();
+        return;
+    }
+
+    // requests are small and latency-sensitive, so never wait to coalesce them
+    uv_tcp_nodelay(&self->socket, 1);
+    uv_read_start(reinterpret_cast<uv_stream_t*>(&self->socket), onAlloc, onRead);
+    self->isConnected = true;
+    if (self->tlsEndpoint) {
+        self->startTls();
+        return;
+    }
+    self->isReady = true;
+    self->connected.set_value();
+    self->drainSubmitted();
+    self->pump();
+}
+
+void iggy::net::tcp::TcpConnection::onWakeup(uv_async_t* handle) {
+    auto self = static_cast<TcpConnection*>(handle->data);
+    bool isClosing;
+    {
+        std::lock_guard<std::mutex> lock(self->submitMutex);
+        isClosing = self->closing;
+    }
+    if (isClosing) {
+        self->shutdown();
+        return;
+    }
+    self->drainSubmitted();
+    self->pump();
+}
+
+void iggy::net::tcp::TcpConnection::onAlloc(uv_handle_t* handle, size_t suggestedSize, uv_buf_t* buf) {
+    auto self = static_cast<TcpConnection*>(handle->data);
+    size_t wanted = std::max(suggestedSize, READ_CHUNK_SIZE);
+    if (self->tls) {
+        // ciphertext only passes through on its way into the TLS session, so one chunk-sized buffer is reused for every read
+        self->cipherBuffer.resize(wanted);
+        *buf = uv_buf_init(reinterpret_cast<char*>(self->cipherBuffer.data()), static_cast<unsigned int>(wanted));
+        return;
+    }
+
+    // the rest of a response whose header has been read goes straight into the payload buffer handed to the caller
+    if (self->readingBody) {
+        *buf = uv_buf_init(reinterpret_cast<char*>(self->responseBody.data() + self->responseBodyFilled),
+                           static_cast<unsigned int>(self->responseBody.size() - self->responseBodyFilled));
+        return;
+    }
+
+    // anything else is read into the tail of the frame buffer, so that small responses can be de-framed in place
+    if (self->readBuffer.size() - self->readEnd < wanted) {
+        self->readBuffer.resize(self->readEnd + wanted);
+    }
+    *buf = uv_buf_init(reinterpret_cast<char*>(self->readBuffer.data() + self->readEnd),
+                       static_cast<unsigned int>(self->readBuffer.size() - self->readEnd));
+}
+
+void iggy::net::tcp::TcpConnection::onRead(uv_stream_t* stream, ssize_t nread, const uv_buf_t* buf) {
+    auto self = static_cast<TcpConnection*>(stream->data);
+    if (nread > 0 && self->tls) {
+        self->receiveCiphertext(static_cast<size_t>(nread));
+    } else if (nread > 0 && self->readingBody) {
+        self->receiveBody(static_cast<size_t>(nread));
+        self->processFrames();
+    } else if (nread > 0) {
+        self->readEnd += static_cast<size_t>(nread);
+        self->processFrames();
+    } else if (nread < 0) {
+        auto reason = nread == UV_EOF ? std::string("Connection closed by server")
+                                      : fmt::format("Failed to read from server: {}", uv_strerror(static_cast<int>(nread)));
+        self->failConnection(reason);
+    }
+}
+
+void iggy::net::tcp::TcpConnection::onWrite(uv_write_t* req, int status) {
+    auto self = static_cast<TcpConnection*>(req->data);
+    delete req;
+    if (status < 0 && status != UV_ECANCELED) {
+        self->failConnection(fmt::format("Failed to write to server: {}", uv_strerror(status)));
+    }
+}
+
+void iggy::net::tcp::TcpConnection::onCiphertextWritten(uv_write_t* req, int status) {
+    auto write = static_cast<CiphertextWrite*>(req->data);
+    auto self = write->connection;
+    delete write;
+    if (status < 0 && status != UV_ECANCELED) {
+        self->failConnection(fmt::format("Failed to write to server: {}", uv_strerror(status)));
+    }
+}
+
+void iggy::net::tcp::TcpConnection::startTls() {
+    this->handshakePending = true;
+    try {
+        this->tls = std::make_unique<TlsSession>(*this->tlsEndpoint);
+        this->tls->handshake();
+    } catch (const std::exception& e) {
+        this->failConnection(e.what());
+        return;
+    }
+    this->writeCiphertext();
+}
+
+void iggy::net::tcp::TcpConnection::receiveCiphertext(size_t length) {
+    try {
+        this->tls->receive(this->cipherBuffer.data(), length);
+        if (this->handshakePending) {
+            bool done = this->tls->handshake();
+            this->writeCiphertext();
+            if (!done) {
+                return;
+            }
+            this->completeHandshake();
+            if (this->handlesClosed) {
+                return;
+            }
+        }
+
+        // decrypt where a plain read would have gone: into the payload buffer of a response whose header has been read, or
+        // the tail of the frame buffer, de-framing as we go so that a large response switches to its own buffer early
+        while (true) {
+            if (this->readingBody) {
+                size_t decrypted = this->tls->decrypt(this->responseBody.data() + this->responseBodyFilled,
+                                                      this->responseBody.size() - this->responseBodyFilled);
+                if (decrypted == 0) {
+                    break;
+                }
+                this->receiveBody(decrypted);
+                continue;
+            }
+            if (this->readBuffer.size() - this->readEnd < READ_CHUNK_SIZE) {
+                this->readBuffer.resize(this->readEnd + READ_CHUNK_SIZE);
+            }
+            size_t decrypted = this->tls->decrypt(this->readBuffer.data() + this->readEnd, this->readBuffer.size() - this->readEnd);
+            if (decrypted == 0) {
+                break;
+            }
+            this->readEnd += decrypted;
+            if (!this->deframe()) {
+                return;
+            }
+        }
+
+        // reading can make the session answer a post-handshake message, e.g. a key update; once the kernel owns the
+        // transmit keys we can no longer send such a record or follow the key change
+        if (this->tls->hasOutgoing() && this->tls->isTransmitOffloaded()) {
+            throw std::runtime_error("Server requested a TLS key update, which is not supported with kernel TLS offload");
+        }
+    } catch (const std::exception& e) {
+        this->failConnection(e.what());
+        return;
+    }
+    this->writeCiphertext();
+    this->processFrames();
+}
+
+void iggy::net::tcp::TcpConnection::writeCiphertext() {
+    if (this->handlesClosed || !this->tls->hasOutgoing()) {
+        return;
+    }
+    auto write = new CiphertextWrite;
+    write->ciphertext = this->tls->takeOutgoing();
+    write->connection = this;
+    write->req.data = write;
+    auto buf = uv_buf_init(reinterpret_cast<char*>(write->ciphertext.data()), static_cast<unsigned int>(write->ciphertext.size()));
+    int rc = uv_write(&write->req, reinterpret_cast<uv_stream_t*>(&this->socket), &buf, 1, onCiphertextWritten);
+    if (rc < 0) {
+        delete write;
+        this->failConnection(fmt::format("Failed to write to server: {}", uv_strerror(rc)));
+    }
+}
+
+void iggy::net::tcp::TcpConnection::completeHandshake() {
+    this->handshakePending = false;
+
+    // the kernel only encrypts what is written after TLS_TX is installed, so our Finished message must already have left
+    // libuv's queue; it is tiny and the socket buffer is empty at this point, so in practice it always has
+    uv_os_fd_t fd;
+    if (!this->kernelTls) {
+        this->transmitOffload = TransmitOffload::DISABLED;
+    } else if (uv_stream_get_write_queue_size(reinterpret_cast<uv_stream_t*>(&this->socket)) > 0) {
+        this->transmitOffload = TransmitOffload::SKIPPED;
+        spdlog::warn("TLS handshake with {}:{} still had data queued, encrypting in userspace instead of kernel TLS", this->host,
+                     this->port);
+    } else if (uv_fileno(reinterpret_cast<uv_handle_t*>(&this->socket), &fd) == 0 && this->tls->offloadTransmit(fd)) {
+        this->transmitOffload = TransmitOffload::OFFLOADED;
+    } else {
+        this->transmitOffload = TransmitOffload::UNSUPPORTED;
+        spdlog::debug("Kernel TLS is not available for the connection to {}:{}, encrypting in userspace", this->host, this->port);
+    }
+    this->isReady = true;
+    this->connected.set_value();
+    this->drainSubmitted();
+    this->pump();
+}
+
+void iggy::net::tcp::TcpConnection::drainSubmitted() {
+    std::lock_guard<std::mutex> lock(this->submitMutex);
+    while (!this->submitted.empty()) {
+        this->pending.push_back(std::move(this->submitted.front()));
+        this->submitted.pop_front();
+    }
+}
+
+void iggy::net::tcp::TcpConnection::pump() {
+    if (!this->isReady) {
+        return;
+    }
+    bool encryptInUserspace = this->tls && !this->tls->isTransmitOffloaded();
+
+    // the server answers requests on a connection strictly in order, so we can keep up to maxInFlight requests on the wire
+    // and match each response to the oldest outstanding request; everything that fits in the window goes out in a single
+    // gathered write rather than one write per request
+    size_t batchStart = this->inFlight.size();
+    this->writeBufs.clear();
+    while (this->inFlight.size() < this->maxInFlight && !this->pending.empty()) {
+        auto request = std::move(this->pending.front());
+        this->pending.pop_front();
+
+        // the request owns the header and payload memory (or the caller keeps referenced payloads alive) and outlives the
+        // write, since it is only released once the response arrives or the connection fails
+        if (encryptInUserspace) {
+            try {
+                this->tls->encrypt(request->header, REQUEST_HEADER_SIZE);
+                request->payload.forEachSegment([this](const unsigned char* data, size_t length) { this->tls->encrypt(data, length); });
+            } catch (const std::exception& e) {
+                this->inFlight.push_back(std::move(request));
+                this->failConnection(e.what());
+                return;
+            }
+        } else {
+            this->writeBufs.push_back(uv_buf_init(const_cast<char*>(reinterpret_cast<const char*>(request->header)), REQUEST_HEADER_SIZE));
+            request->payload.forEachSegment([this](const unsigned char* data, size_t length) {
+                this->writeBufs.push_back(uv_buf_init(const_cast<char*>(reinterpret_cast<const char*>(data)), length));
+            });
+        }
+        this->inFlight.push_back(std::move(request));
+    }
+    if (encryptInUserspace) {
+        this->writeCiphertext();
+        return;
+    }
+    if (this->writeBufs.empty()) {
+        return;
+    }
+
+    auto writeReq = new uv_write_t;
+    writeReq->data = this;
+    int rc = uv_write(writeReq, reinterpret_cast<uv_stream_t*>(&this->socket), this->writeBufs.data(),
+                      static_cast<unsigned int>(this->writeBufs.size()), onWrite);
+    if (rc < 0) {
+        delete writeReq;
+        auto error = std::make_exception_ptr(std::runtime_error(fmt::format("Failed to write to server: {}", uv_strerror(rc))));
+        while (this->inFlight.size() > batchStart) {
+            this->inFlight.back()->promise.set_exception(error);
+            this->inFlight.pop_back();
+        }
+    }
+}
+
+bool iggy::net::tcp::TcpConnection::deframe() {
+    while (!this->readingBody && this->readEnd - this->readStart >= RESPONSE_HEADER_SIZE) {
+        const unsigned char* frame = this->readBuffer.data() + this->readStart;
+        uint32_t status = iggy::serialization::loadLittleEndian<uint32_t>(frame);
+        uint32_t length = iggy::serialization::loadLittleEndian<uint32_t>(frame + 4);
+        if (length > MAX_RESPONSE_SIZE) {
+            this->failConnection(
+                fmt::format("Server announced a response of {} bytes, more than the limit of {}", length, MAX_RESPONSE_SIZE));
+            return false;
+        }
+        if (this->inFlight.empty()) {
+            this->failAll("Received a response with no matching request");
+            this->shutdown();
+            return false;
+        }
+
+        // the payload bytes that arrived along with the header are copied out of the frame buffer once; if that is not the
+        // whole payload, the rest is read straight into the same buffer, which becomes the response's
+        const unsigned char* payload = frame + RESPONSE_HEADER_SIZE;
+        size_t buffered = std::min<size_t>(this->readEnd - this->readStart - RESPONSE_HEADER_SIZE, length);
+        this->readStart += RESPONSE_HEADER_SIZE + buffered;
+        if (buffered == length) {
+            auto request = std::move(this->inFlight.front());
+            this->inFlight.pop_front();
+            request->promise.set_value(iggy::net::conn::Response(status, std::vector<unsigned char>(payload, payload + length)));
+            continue;
+        }
+        this->responseBody = std::vector<unsigned char>(length);
+        std::memcpy(this->responseBody.data(), payload, buffered);
+        this->responseBodyFilled = buffered;
+        this->responseStatus = status;
+        this->readingBody = true;
+    }
+
+    // compact any partial header to the front of the buffer, which therefore never grows much beyond one read
+    if (this->readStart == this->readEnd) {
+        this->readStart = 0;
+        this->readEnd = 0;
+    } else if (this->readStart > 0) {
+        std::memmove(this->readBuffer.data(), this->readBuffer.data() + this->readStart, this->readEnd - this->readStart);
+        this->readEnd -= this->readStart;
+        this->readStart = 0;
+    }
+    return true;
+}
+
+void iggy::net::tcp::TcpConnection::receiveBody(size_t length) {
+    this->responseBodyFilled += length;
+    if (this->responseBodyFilled < this->responseBody.size()) {
+        return;
+    }
+    this->readingBody = false;
+    auto request = std::move(this->inFlight.front());
+    this->inFlight.pop_front();
+    request->promise.set_value(iggy::net::conn::Response(this->responseStatus, std::move(this->responseBody)));
+    this->responseBody = {};
+}
+
+void iggy::net::tcp::TcpConnection::processFrames() {
+    if (this->deframe()) {
+        this->pump();
+    }
+}
+
+void iggy::net::tcp::TcpConnection::failConnection(const std::string& reason) {
+    if (this->handshakePending) {
+        // connect() is still waiting for the TLS handshake
+        this->handshakePending = false;
+        this->connected.set_exception(std::make_exception_ptr(std::runtime_error(reason)));
+    }
+    this->failAll(reason);
+    this->shutdown();
+}
+
+void iggy::net::tcp::TcpConnection::failAll(const std::string& reason) {
+    this->drainSubmitted();
+    auto error = std::make_exception_ptr(std::runtime_error(reason));
+    for (auto& request : this->inFlight) {
+        request->promise.set_exception(error);
+    }
+    for (auto& request : this->pending) {
+        request->promise.set_exception(error);
+    }
+    this->inFlight.clear();
+    this->pending.clear();
+}
+
+void iggy::net::tcp::TcpConnection::shutdown() {
+    if (this->handlesClosed) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(this->submitMutex);
+        this->closing = true;
+    }
+    this->handlesClosed = true;
+    if (this->isConnected) {
+        uv_read_stop(reinterpret_cast<uv_stream_t*>(&this->socket));
+        this->isConnected = false;
+    }
+    this->isReady = false;
+    uv_close(reinterpret_cast<uv_handle_t*>(&this->socket), nullptr);
+    uv_close(reinterpret_cast<uv_handle_t*>(&this->wakeup), nullptr);
+    this->failAll("Connection closed");
+}
+
+bool iggy::net::tcp::TcpConnection::isTransmitOffloaded() const {
+    return this->tls && this->tls->isTransmitOffloaded();
+}
+
+bool iggy::net::tcp::TcpConnection::isSessionResumed() const {
+    return this->tls && this->tls->isResumed();
+}
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <uv.h>
+#include <array>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../conn.h"
+#include "frame.h"
+#include "tls.h"
+
+namespace iggy {
+namespace net {
+
+/**
+ * @namespace tcp
+ * @brief Binary protocol transport over plain TCP/IP sockets.
+ */
+namespace tcp {
+
+/**
+ * @brief Default pipelining window for a connection.
+ */
+const uint32_t DEFAULT_MAX_IN_FLIGHT = 32;
+
+/**
+ * @brief Whether a connection's outgoing TLS records are encrypted by the kernel, and if not, why.
+ */
+enum class TransmitOffload {
+    /**
+     * @brief A plain connection, or one created with kernel TLS turned off.
+     */
+    DISABLED = 0,
+    /**
+     * @brief The kernel encrypts outgoing records.
+     */
+    OFFLOADED = 1,
+    /**
+     * @brief The kernel lacks the tls module or a record layer for the negotiated version and cipher.
+     */
+    UNSUPPORTED = 2,
+    /**
+     * @brief The last handshake flight was still queued in userspace when the handshake completed, so the keys could not
+     * be handed over without the kernel encrypting it a second time.
+     */
+    SKIPPED = 3
+};
+
+/**
+ * @brief Non-blocking TCP connection to the Iggy server built on libuv.
+ *
+ * Each connection owns a private libuv loop running on a dedicated I/O thread. Callers on any thread submit framed commands
+ * into a queue and wake the loop with a uv_async_t; the loop writes each request, reads and de-frames the responses and
+ * completes the caller's future.
+ *
+ * Requests are pipelined: up to maxInFlight of them are written back-to-back without waiting for earlier responses. The
+ * server answers each connection's requests in order, so responses are correlated to callers in FIFO order. A window of one
+ * gives strict request/response lock-step.
+ *
+ * Responses are read into a shared frame buffer until their header is complete. A response whose payload arrived with its
+ * header is copied out of that buffer; otherwise the payload gets a buffer of its announced size, any bytes already read are
+ * copied in, and the rest is read (or decrypted) straight into it, so a large response is not copied again.
+ *
+ * Given a TLS context, the connection runs a TLS handshake on the loop before it reports itself connected. If the kernel
+ * supports it, record encryption for outgoing data is then offloaded to kTLS so that requests, including gathered message
+ * payloads, are written to the socket as plaintext exactly as on a plain connection; otherwise each window of requests is
+ * encrypted in userspace into a single ciphertext write. Incoming records are always decrypted in userspace, since the
+ * server's post-handshake messages (session tickets, key updates) cannot be consumed by a plain socket read.
+ */
+class TcpConnection : public iggy::net::conn::Connection {
+private:
+    struct Request {
+        // a static frame for parameterless commands, otherwise headerStorage
+        const unsigned char* header;
+        std::array<unsigned char, REQUEST_HEADER_SIZE> headerStorage;
+        iggy::serialization::binary::GatherBuffer payload;
+        std::promise<iggy::net::conn::Response> promise;
+    };
+
+    const std::string host;
+    const uint16_t port;
+    const uint32_t maxInFlight;
+    const std::optional<TlsEndpoint> tlsEndpoint;
+    const bool kernelTls;
+
+    uv_loop_t loop;
+    uv_tcp_t socket;
+    uv_async_t wakeup;
+    uv_connect_t connectReq;
+    std::thread ioThread;
+    std::promise<void> connected;
+    std::mutex lifecycleMutex;
+    bool loopOpen = false;
+
+    // requests submitted by callers but not yet picked up by the I/O thread; closing is guarded by the same mutex so that
+    // no caller can signal the wakeup handle after the I/O thread has closed it
+    std::mutex submitMutex;
+    std::deque<std::unique_ptr<Request>> submitted;
+    bool started = false;
+    bool closing = false;
+
+    // state below is only touched on the I/O thread
+    std::deque<std::unique_ptr<Request>> pending;
+    std::deque<std::unique_ptr<Request>> inFlight;
+    std::vector<uv_buf_t> writeBufs;
+    std::vector<unsigned char> readBuffer;
+    size_t readStart = 0;
+    size_t readEnd = 0;
+    // the payload of a response that was not complete in the frame buffer, read straight into its own buffer from then on
+    std::vector<unsigned char> responseBody;
+    size_t responseBodyFilled = 0;
+    uint32_t responseStatus = 0;
+    bool readingBody = false;
+    std::unique_ptr<TlsSession> tls;
+    std::vector<unsigned char> cipherBuffer;
+    TransmitOffload transmitOffload = TransmitOffload::DISABLED;
+    bool isConnected = false;
+    bool handshakePending = false;
+    bool isReady = false;
+    bool handlesClosed = false;
+
+    static void onConnect(uv_connect_t* req, int status);
+    static void onWakeup(uv_async_t* handle);
+    static void onAlloc(uv_handle_t* handle, size_t suggestedSize, uv_buf_t* buf);
+    static void onRead(uv_stream_t* stream, ssize_t nread, const uv_buf_t* buf);
+    static void onWrite(uv_write_t* req, int status);
+    static void onCiphertextWritten(uv_write_t* req, int status);
+
+    void startTls();
+    void receiveCiphertext(size_t length);
+    void writeCiphertext();
+    void completeHandshake();
+    void drainSubmitted();
+    void pump();
+    bool deframe();
+    void receiveBody(size_t length);
+    void processFrames();
+    void failConnection(const std::string& reason);
+    void failAll(const std::string& reason);
+    void shutdown();
+
+public:
+    /**
+     * @param host Hostname or IP address of the server.
+     * @param port TCP port of the server.
+     * @param maxInFlight Maximum number of requests written but not yet answered; further requests queue locally.
+     * @param tlsEndpoint If set, the connection is wrapped in TLS with this context and server address.
+     * @param kernelTls Whether to try offloading outgoing TLS records to the kernel after the handshake.
+     */
+    TcpConnection(const std::string& host,
+                  uint16_t port,
+                  uint32_t maxInFlight = DEFAULT_MAX_IN_FLIGHT,
+                  std::optional<TlsEndpoint> tlsEndpoint = std::nullopt,
+                  bool kernelTls = true);
+    TcpConnection(const TcpConnection& other) = delete;
+    TcpConnection& operator=(const TcpConnection& other) = delete;
+    ~TcpConnection() override;
+
+    void connect() override;
+    std::future<iggy::net::conn::Response> sendGathered(iggy::serialization::binary::CommandCode command,
+                                                        iggy::serialization::binary::GatherBuffer payload) override;
+    void close() override;
+
+    /**
+     * @brief Tests whether outgoing TLS records are encrypted by the kernel; always false for a plain connection.
+     *
+     * Only meaningful once @ref connect has returned.
+     */
+    bool isTransmitOffloaded() const;
+
+    /**
+     * @brief Gets whether outgoing TLS records are encrypted by the kernel, and if not, why.
+     *
+     * Only meaningful once @ref connect has returned.
+     */
+    TransmitOffload getTransmitOffload() const { return transmitOffload; }
+
+    /**
+     * @brief Tests whether the TLS handshake resumed a cached session; always false for a plain connection.
+     *
+     * Only meaningful once @ref connect has returned.
+     */
+    bool isSessionResumed() const;
+};
+
+};  // namespace tcp
+};  // namespace net
+};  // namespace iggy
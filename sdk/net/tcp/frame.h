@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "../../binary.h"
+
+namespace iggy {
+namespace net {
+namespace tcp {
+
+/**
+ * @brief Size of the request frame prefix: a 4-byte length followed by a 4-byte command code.
+ */
+const size_t REQUEST_HEADER_SIZE = 8;
+
+/**
+ * @brief Size of the response frame prefix: a 4-byte status followed by a 4-byte payload length.
+ */
+const size_t RESPONSE_HEADER_SIZE = 8;
+
+/**
+ * @brief Largest response payload a connection accepts. A frame header announcing more, from a corrupt or out-of-sync
+ * stream or a hostile server, fails the connection before anything is buffered for it.
+ */
+const uint32_t MAX_RESPONSE_SIZE = 256 * 1024 * 1024;
+
+/**
+ * @brief Writes the request prefix; the length field covers the command code and the payload.
+ */
+inline void writeRequestHeader(unsigned char* out, uint32_t command, size_t payloadLength) {
+    iggy::serialization::storeLittleEndian<uint32_t>(out, static_cast<uint32_t>(payloadLength + 4));
+    iggy::serialization::storeLittleEndian<uint32_t>(out + 4, command);
+}
+
+/**
+ * @brief Encodes at compile time the complete request frame of a command that has no payload.
+ */
+constexpr std::array<unsigned char, REQUEST_HEADER_SIZE> encodeEmptyRequest(uint32_t command) {
+    return {4,
+            0,
+            0,
+            0,
+            static_cast<unsigned char>(command),
+            static_cast<unsigned char>(command >> 8),
+            static_cast<unsigned char>(command >> 16),
+            static_cast<unsigned char>(command >> 24)};
+}
+
+/**
+ * @brief Pre-encoded request frame of a parameterless command, which always serializes to the same bytes.
+ */
+template <iggy::serialization::binary::CommandCode Command>
+inline constexpr std::array<unsigned char, REQUEST_HEADER_SIZE> EMPTY_REQUEST = encodeEmptyRequest(Command);
+
+/**
+ * @brief Gets the request prefix to send ahead of a payload.
+ *
+ * Parameterless commands such as PING, which health checks send on every connection, are written straight from their
+ * read-only @ref EMPTY_REQUEST frame; any other prefix is encoded into storage, which must live as long as the request.
+ */
+inline const unsigned char* prepareRequestHeader(std::array<unsigned char, REQUEST_HEADER_SIZE>& storage,
+                                                 iggy::serialization::binary::CommandCode command,
+                                                 size_t payloadLength) {
+    if (payloadLength == 0) {
+        switch (command) {
+            case iggy::serialization::binary::PING:
+                return EMPTY_REQUEST<iggy::serialization::binary::PING>.data();
+            case iggy::serialization::binary::GET_STATS:
+                return EMPTY_REQUEST<iggy::serialization::binary::GET_STATS>.data();
+            case iggy::serialization::binary::GET_ME:
+                return EMPTY_REQUEST<iggy::serialization::binary::GET_ME>.data();
+            case iggy::serialization::binary::GET_CLIENTS:
+                return EMPTY_REQUEST<iggy::serialization::binary::GET_CLIENTS>.data();
+            case iggy::serialization::binary::GET_STREAMS:
+                return EMPTY_REQUEST<iggy::serialization::binary::GET_STREAMS>.data();
+            default:
+                break;
+        }
+    }
+    writeRequestHeader(storage.data(), static_cast<uint32_t>(command), payloadLength);
+    return storage.data();
+}
+
+};  // namespace tcp
+};  // namespace net
+};  // namespace iggy
@@ -0,0 +1,278 @@
+#include "tls.h"
+#include <fmt/format.h>
+#include <sodium.h>
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__linux__)
+#include <linux/tls.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+#endif
+
+namespace {
+#if defined(__linux__)
+template <typename CryptoInfo>
+std::vector<unsigned char> packCryptoInfo(uint16_t version,
+                                          uint16_t cipherType,
+                                          std::span<const unsigned char> key,
+                                          std::span<const unsigned char> salt,
+                                          std::span<const unsigned char> nonce,
+                                          uint64_t sequence) {
+    CryptoInfo info = {};
+    info.info.version = version;
+    info.info.cipher_type = cipherType;
+    std::memcpy(info.key, key.data(), sizeof(info.key));
+    std::memcpy(info.salt, salt.data(), sizeof(info.salt));
+    std::memcpy(info.iv, nonce.data(), sizeof(info.iv));
+    for (size_t i = 0; i < sizeof(info.rec_seq); i++) {
+        info.rec_seq[i] = static_cast<unsigned char>(sequence >> (8 * (sizeof(info.rec_seq) - 1 - i)));
+    }
+
+    std::vector<unsigned char> packed(reinterpret_cast<const unsigned char*>(&info), reinterpret_cast<const unsigned char*>(&info) + sizeof(info));
+    sodium_memzero(&info, sizeof(info));
+    return packed;
+}
+#endif
+}  // namespace
+
+std::optional<std::vector<unsigned char>> iggy::net::tcp::makeKernelTlsCryptoInfo(int version,
+                                                                                  int bulkCipher,
+                                                                                  std::span<const unsigned char> key,
+                                                                                  std::span<const unsigned char> iv,
+                                                                                  uint64_t sequence) {
+#if defined(__linux__)
+    uint16_t kernelVersion;
+    if (version == WOLFSSL_TLSV1_2) {
+        kernelVersion = TLS_1_2_VERSION;
+    } else if (version == WOLFSSL_TLSV1_3) {
+        kernelVersion = TLS_1_3_VERSION;
+    } else {
+        return std::nullopt;
+    }
+
+    if (bulkCipher == wolfssl_aes_gcm) {
+        // the kernel nonce is a 4-byte salt plus 8 bytes that are either the TLS 1.2 explicit nonce, which we seed from the
+        // sequence number as OpenSSL does, or the tail of the TLS 1.3 static IV
+        std::array<unsigned char, 8> explicitNonce;
+        std::span<const unsigned char> salt;
+        std::span<const unsigned char> nonce;
+        if (version == WOLFSSL_TLSV1_2 && iv.size() == 4) {
+            for (size_t i = 0; i < explicitNonce.size(); i++) {
+                explicitNonce[i] = static_cast<unsigned char>(sequence >> (8 * (explicitNonce.size() - 1 - i)));
+            }
+            salt = iv;
+            nonce = explicitNonce;
+        } else if (version == WOLFSSL_TLSV1_3 && iv.size() == 12) {
+            salt = iv.first(4);
+            nonce = iv.subspan(4);
+        } else {
+            return std::nullopt;
+        }
+
+        if (key.size() == TLS_CIPHER_AES_GCM_128_KEY_SIZE) {
+            return packCryptoInfo<tls12_crypto_info_aes_gcm_128>(kernelVersion, TLS_CIPHER_AES_GCM_128, key, salt, nonce, sequence);
+        }
+#ifdef TLS_CIPHER_AES_GCM_256
+        if (key.size() == TLS_CIPHER_AES_GCM_256_KEY_SIZE) {
+            return packCryptoInfo<tls12_crypto_info_aes_gcm_256>(kernelVersion, TLS_CIPHER_AES_GCM_256, key, salt, nonce, sequence);
+        }
+#endif
+        return std::nullopt;
+    }
+
+#ifdef TLS_CIPHER_CHACHA20_POLY1305
+    if (bulkCipher == wolfssl_chacha && key.size() == TLS_CIPHER_CHACHA20_POLY1305_KEY_SIZE &&
+        iv.size() == TLS_CIPHER_CHACHA20_POLY1305_IV_SIZE) {
+        return packCryptoInfo<tls12_crypto_info_chacha20_poly1305>(kernelVersion, TLS_CIPHER_CHACHA20_POLY1305, key, {}, iv, sequence);
+    }
+#endif
+#endif
+    return std::nullopt;
+}
+
+iggy::net::tcp::TlsSession::TlsSession(const TlsEndpoint& endpoint)
+    : sessionCache(endpoint.context.getSessionCache())
+    , address(endpoint.address) {
+    this->ssl = wolfSSL_new(endpoint.context.getNativeHandle());
+    if (!this->ssl) {
+        throw std::runtime_error("Failed to allocate WolfSSL session");
+    }
+    wolfSSL_SSLSetIORecv(this->ssl, onReceive);
+    wolfSSL_SSLSetIOSend(this->ssl, onSend);
+    wolfSSL_SetIOReadCtx(this->ssl, this);
+    wolfSSL_SetIOWriteCtx(this->ssl, this);
+#ifdef HAVE_SESSION_TICKET
+    wolfSSL_set_SessionTicket_cb(this->ssl, onSessionTicket, this);
+#endif
+
+    auto host = this->address.getHost();
+#ifdef HAVE_SNI
+    wolfSSL_UseSNI(this->ssl, WOLFSSL_SNI_HOST_NAME, host.data(), static_cast<unsigned short>(host.size()));
+#endif
+    if (wolfSSL_check_domain_name(this->ssl, host.c_str()) != WOLFSSL_SUCCESS) {
+        wolfSSL_free(this->ssl);
+        throw std::runtime_error(fmt::format("Failed to set the expected server name: {}", host));
+    }
+    this->sessionCache.resume(this->address, this->ssl);
+}
+
+iggy::net::tcp::TlsSession::~TlsSession() {
+    wolfSSL_free(this->ssl);
+}
+
+int iggy::net::tcp::TlsSession::onReceive(WOLFSSL* ssl, char* buf, int size, void* ctx) {
+    auto self = static_cast<TlsSession*>(ctx);
+    size_t available = self->incoming.size() - self->incomingStart;
+    if (available == 0) {
+        return WOLFSSL_CBIO_ERR_WANT_READ;
+    }
+    size_t length = std::min(available, static_cast<size_t>(size));
+    std::memcpy(buf, self->incoming.data() + self->incomingStart, length);
+    self->incomingStart += length;
+    if (self->incomingStart == self->incoming.size()) {
+        self->incoming.clear();
+        self->incomingStart = 0;
+    }
+    return static_cast<int>(length);
+}
+
+int iggy::net::tcp::TlsSession::onSend(WOLFSSL* ssl, char* buf, int size, void* ctx) {
+    auto self = static_cast<TlsSession*>(ctx);
+    self->outgoing.insert(self->outgoing.end(), buf, buf + size);
+    return size;
+}
+
+int iggy::net::tcp::TlsSession::onSessionTicket(WOLFSSL* ssl, const unsigned char* ticket, int ticketSize, void* ctx) {
+    // the ticket is not attached to the session until the callback returns, so only note that it has to be saved
+    static_cast<TlsSession*>(ctx)->ticketReceived = true;
+    return 0;
+}
+
+void iggy::net::tcp::TlsSession::raiseSSLError(const std::string& message, int ret) const {
+    // the message buffer must be ours: every connection runs its session on its own I/O thread
+    char errMsg[WOLFSSL_MAX_ERROR_SZ];
+    wolfSSL_ERR_error_string_n(wolfSSL_get_error(this->ssl, ret), errMsg, sizeof(errMsg));
+    throw std::runtime_error(fmt::format("{}: {}", message, errMsg));
+}
+
+void iggy::net::tcp::TlsSession::receive(const unsigned char* data, size_t length) {
+    this->incoming.insert(this->incoming.end(), data, data + length);
+}
+
+bool iggy::net::tcp::TlsSession::handshake() {
+    if (this->handshakeDone) {
+        return true;
+    }
+    int ret = wolfSSL_connect(this->ssl);
+    if (ret == WOLFSSL_SUCCESS) {
+        this->handshakeDone = true;
+
+        // TLS 1.3 sessions only become resumable once a ticket arrives after the handshake, see decrypt()
+        if (wolfSSL_GetVersion(this->ssl) != WOLFSSL_TLSV1_3) {
+            this->sessionCache.save(this->address, this->ssl);
+        }
+        return true;
+    }
+    int err = wolfSSL_get_error(this->ssl, ret);
+    if (err == WOLFSSL_ERROR_WANT_READ || err == WOLFSSL_ERROR_WANT_WRITE) {
+        return false;
+    }
+
+    // never offer a session that may be what the server just rejected
+    this->sessionCache.forget(this->address);
+    this->raiseSSLError("TLS handshake failed", ret);
+    return false;
+}
+
+size_t iggy::net::tcp::TlsSession::decrypt(unsigned char* out, size_t capacity) {
+    int ret = wolfSSL_read(this->ssl, out, static_cast<int>(std::min<size_t>(capacity, INT_MAX)));
+    if (this->ticketReceived) {
+        this->ticketReceived = false;
+        this->sessionCache.save(this->address, this->ssl);
+    }
+    if (ret > 0) {
+        return static_cast<size_t>(ret);
+    }
+    int err = wolfSSL_get_error(this->ssl, ret);
+    if (err == WOLFSSL_ERROR_WANT_READ) {
+        return 0;
+    }
+    if (err == WOLFSSL_ERROR_ZERO_RETURN) {
+        throw std::runtime_error("Connection closed by server");
+    }
+    this->raiseSSLError("Failed to decrypt TLS record", ret);
+    return 0;
+}
+
+void iggy::net::tcp::TlsSession::encrypt(const unsigned char* data, size_t length) {
+    if (this->transmitOffloaded) {
+        throw std::logic_error("Outgoing records are encrypted by the kernel");
+    }
+    while (length > 0) {
+        int chunk = static_cast<int>(std::min<size_t>(length, INT_MAX));
+        int ret = wolfSSL_write(this->ssl, data, chunk);
+        if (ret <= 0) {
+            this->raiseSSLError("Failed to encrypt TLS record", ret);
+        }
+        data += ret;
+        length -= static_cast<size_t>(ret);
+    }
+}
+
+std::vector<unsigned char> iggy::net::tcp::TlsSession::takeOutgoing() {
+    std::vector<unsigned char> ciphertext;
+    ciphertext.swap(this->outgoing);
+    return ciphertext;
+}
+
+bool iggy::net::tcp::TlsSession::offloadTransmit(int fd) {
+#if defined(__linux__)
+    if (!this->handshakeDone || this->transmitOffloaded || this->hasOutgoing()) {
+        return false;
+    }
+
+    bool isClient = wolfSSL_GetSide(this->ssl) == WOLFSSL_CLIENT_END;
+    const unsigned char* key = isClient ? wolfSSL_GetClientWriteKey(this->ssl) : wolfSSL_GetServerWriteKey(this->ssl);
+    const unsigned char* iv = isClient ? wolfSSL_GetClientWriteIV(this->ssl) : wolfSSL_GetServerWriteIV(this->ssl);
+    int keySize = wolfSSL_GetKeySize(this->ssl);
+    int ivSize = wolfSSL_GetIVSize(this->ssl);
+    if (!key || !iv || keySize <= 0 || ivSize <= 0) {
+        return false;
+    }
+
+    // TLS 1.3 application traffic keys start from sequence zero, whereas in TLS 1.2 our Finished message already used it
+    int version = wolfSSL_GetVersion(this->ssl);
+    uint64_t sequence = version == WOLFSSL_TLSV1_3 ? 0 : 1;
+    auto info = makeKernelTlsCryptoInfo(version, wolfSSL_GetBulkCipher(this->ssl), std::span(key, static_cast<size_t>(keySize)),
+                                        std::span(iv, static_cast<size_t>(ivSize)), sequence);
+    if (!info) {
+        return false;
+    }
+
+    // ENOENT here means the tls module is not loaded; if the ULP attaches but TLS_TX is refused, the socket stays in its
+    // pass-through base mode, so either way we can carry on encrypting in userspace
+    bool installed = setsockopt(fd, SOL_TCP, TCP_ULP, "tls", sizeof("tls")) == 0 &&
+                     setsockopt(fd, SOL_TLS, TLS_TX, info->data(), static_cast<socklen_t>(info->size())) == 0;
+    sodium_memzero(info->data(), info->size());
+    this->transmitOffloaded = installed;
+    return installed;
+#else
+    return false;
+#endif
+}
+
+bool iggy::net::tcp::TlsSession::isResumed() const {
+    return wolfSSL_session_reused(this->ssl) == 1;
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+#include "../address.h"
+#include "../crypto/ssl.h"
+
+namespace iggy {
+namespace net {
+namespace tcp {
+
+/**
+ * @brief Builds the crypto_info block passed to setsockopt(SOL_TLS, TLS_TX) for one direction of a TLS session.
+ * @param version The negotiated protocol version, as returned by wolfSSL_GetVersion().
+ * @param bulkCipher The negotiated bulk cipher, as returned by wolfSSL_GetBulkCipher().
+ * @param key The traffic key for the direction being offloaded.
+ * @param iv The write IV for that direction: the 4-byte implicit nonce for TLS 1.2 AES-GCM, otherwise the full 12 bytes.
+ * @param sequence The sequence number of the next record the kernel will encrypt.
+ * @return std::nullopt if the kernel has no record layer for this protocol version, cipher and key size.
+ */
+std::optional<std::vector<unsigned char>> makeKernelTlsCryptoInfo(int version,
+                                                                  int bulkCipher,
+                                                                  std::span<const unsigned char> key,
+                                                                  std::span<const unsigned char> iv,
+                                                                  uint64_t sequence);
+
+/**
+ * @brief Where and how a connection secures itself with TLS; both referenced objects must outlive the connection.
+ */
+struct TlsEndpoint {
+    /**
+     * @brief Context shared by every connection of a client, including its session resumption cache.
+     */
+    iggy::ssl::SSLContext<WOLFSSL_CTX*>& context;
+
+    /**
+     * @brief Address of the server, used for SNI, certificate verification and as the session cache key.
+     */
+    const iggy::net::address::LogicalAddress& address;
+};
+
+/**
+ * @brief Client side of a TLS session whose records are exchanged through memory buffers rather than a socket.
+ *
+ * The owning connection feeds it ciphertext as it arrives and writes out whatever ciphertext it produces, so the session
+ * can be driven from a non-blocking event loop. Once the handshake completes, record encryption for outgoing data can be
+ * handed to the kernel with @ref offloadTransmit, after which the connection writes plaintext straight to the socket.
+ *
+ * The session offers the context's cached session for the server before its handshake, and saves its own once it is
+ * resumable: straight after the handshake for TLS 1.2, or when the server's first ticket arrives for TLS 1.3.
+ */
+class TlsSession {
+private:
+    WOLFSSL* ssl;
+    iggy::ssl::SessionCache& sessionCache;
+    const iggy::net::address::LogicalAddress& address;
+    std::vector<unsigned char> incoming;
+    size_t incomingStart = 0;
+    std::vector<unsigned char> outgoing;
+    bool handshakeDone = false;
+    bool transmitOffloaded = false;
+    bool ticketReceived = false;
+
+    static int onReceive(WOLFSSL* ssl, char* buf, int size, void* ctx);
+    static int onSend(WOLFSSL* ssl, char* buf, int size, void* ctx);
+    static int onSessionTicket(WOLFSSL* ssl, const unsigned char* ticket, int ticketSize, void* ctx);
+
+    void raiseSSLError(const std::string& message, int ret) const;
+
+public:
+    /**
+     * @param endpoint Context and server address; both must outlive the session.
+     */
+    explicit TlsSession(const TlsEndpoint& endpoint);
+    TlsSession(const TlsSession& other) = delete;
+    TlsSession& operator=(const TlsSession& other) = delete;
+    ~TlsSession();
+
+    /**
+     * @brief Buffers ciphertext read from the socket.
+     */
+    void receive(const unsigned char* data, size_t length);
+
+    /**
+     * @brief Advances the handshake with whatever ciphertext has been received so far.
+     * @return true once the handshake has completed.
+     * @throws std::runtime_error if the handshake fails, e.g. because the server certificate does not verify.
+     */
+    bool handshake();
+
+    /**
+     * @brief Decrypts buffered records into the given buffer.
+     * @return The number of plaintext bytes written; zero if more ciphertext is needed.
+     * @throws std::runtime_error if the server closed the session or sent a bad record.
+     */
+    size_t decrypt(unsigned char* out, size_t capacity);
+
+    /**
+     * @brief Encrypts plaintext into records, appending them to the outgoing ciphertext.
+     */
+    void encrypt(const unsigned char* data, size_t length);
+
+    /**
+     * @brief Tests whether there is ciphertext waiting to be written to the socket.
+     */
+    bool hasOutgoing() const { return !outgoing.empty(); }
+
+    /**
+     * @brief Moves the outgoing ciphertext out of the session so the caller can keep it alive until it has been written.
+     */
+    std::vector<unsigned char> takeOutgoing();
+
+    /**
+     * @brief Installs kernel TLS on the socket for outgoing records using the traffic keys from the completed handshake.
+     *
+     * Must be called before any application data is encrypted and with no handshake ciphertext still queued in userspace.
+     * @return false if the kernel does not support TLS offload for the negotiated cipher, in which case the session keeps
+     * encrypting in userspace and the socket is left untouched for writes.
+     */
+    bool offloadTransmit(int fd);
+
+    /**
+     * @brief Tests whether the kernel encrypts outgoing records, so plaintext can be written straight to the socket.
+     */
+    bool isTransmitOffloaded() const { return transmitOffloaded; }
+
+    /**
+     * @brief Tests whether the handshake resumed a cached session rather than running a full key exchange.
+     */
+    bool isResumed() const;
+};
+
+};  // namespace tcp
+};  // namespace net
+};  // namespace iggy
@@ -0,0 +1,495 @@
+#if defined(IGGY_HAVE_IO_URING)
+#include "uring.h"
+#include <fmt/format.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+const unsigned RING_ENTRIES = 64;
+const unsigned RECV_BUFFER_COUNT = 64;
+const size_t RECV_BUFFER_SIZE = 16 * 1024;
+const size_t SEND_ARENA_SIZE = 256 * 1024;
+const int RECV_BUFFER_GROUP = 0;
+const unsigned SEND_ARENA_INDEX = 0;
+
+// user_data tags identifying which operation a completion belongs to
+const uint64_t TAG_WAKEUP = 1;
+const uint64_t TAG_RECV = 2;
+const uint64_t TAG_SEND = 3;
+const uint64_t TAG_CANCEL = 4;
+}  // namespace
+
+iggy::net::tcp::UringConnection::UringConnection(const std::string& host, uint16_t port, uint32_t maxInFlight)
+    : host(host)
+    , port(port)
+    , maxInFlight(maxInFlight) {
+    if (maxInFlight == 0) {
+        throw std::invalid_argument("At least one request must be allowed in flight");
+    }
+}
+
+iggy::net::tcp::UringConnection::~UringConnection() {
+    this->close();
+}
+
+void iggy::net::tcp::UringConnection::connect() {
+    std::lock_guard<std::mutex> lifecycleLock(this->lifecycleMutex);
+    if (this->fd >= 0) {
+        throw std::logic_error("Connection has already been opened");
+    }
+
+    // connect synchronously on the caller's thread; only steady-state traffic goes through the ring
+    struct addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+    struct addrinfo* addresses = nullptr;
+    auto service = std::to_string(this->port);
+    int rc = getaddrinfo(this->host.c_str(), service.c_str(), &hints, &addresses);
+    if (rc != 0) {
+        throw std::runtime_error(fmt::format("Failed to resolve {}:{}: {}", this->host, this->port, gai_strerror(rc)));
+    }
+    int sock = ::socket(addresses->ai_family, addresses->ai_socktype | SOCK_CLOEXEC, addresses->ai_protocol);
+    if (sock < 0 || ::connect(sock, addresses->ai_addr, addresses->ai_addrlen) < 0) {
+        int error = errno;
+        if (sock >= 0) {
+            ::close(sock);
+        }
+        freeaddrinfo(addresses);
+        throw std::runtime_error(fmt::format("Failed to connect to {}:{}: {}", this->host, this->port, std::strerror(error)));
+    }
+    freeaddrinfo(addresses);
+    int noDelay = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    this->fd = sock;
+
+    // IORING_SETUP_SINGLE_ISSUER ties the ring to the thread that creates it, so set-up happens on the I/O thread itself
+    std::promise<void> ready;
+    auto readyFuture = ready.get_future();
+    this->ioThread = std::thread([this, &ready]() {
+        try {
+            this->setupRing();
+        } catch (...) {
+            ready.set_exception(std::current_exception());
+            return;
+        }
+        ready.set_value();
+        this->run();
+    });
+    try {
+        readyFuture.get();
+    } catch (...) {
+        this->ioThread.join();
+        this->teardown();
+        throw;
+    }
+
+    std::lock_guard<std::mutex> lock(this->submitMutex);
+    this->started = true;
+}
+
+void iggy::net::tcp::UringConnection::setupRing() {
+    this->wakeupFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (this->wakeupFd < 0) {
+        throw std::runtime_error(fmt::format("Failed to create eventfd: {}", std::strerror(errno)));
+    }
+
+    struct io_uring_params params = {};
+    params.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_COOP_TASKRUN;
+    int rc = io_uring_queue_init_params(RING_ENTRIES, &this->ring, &params);
+    if (rc < 0) {
+        throw std::runtime_error(fmt::format("Failed to set up io_uring: {}", std::strerror(-rc)));
+    }
+    this->ringOpen = true;
+
+    // a single registered buffer backs all coalesced sends
+    this->sendArena.resize(SEND_ARENA_SIZE);
+    struct iovec sendIovec = {this->sendArena.data(), this->sendArena.size()};
+    rc = io_uring_register_buffers(&this->ring, &sendIovec, 1);
+    if (rc < 0) {
+        throw std::runtime_error(fmt::format("Failed to register send buffer: {}", std::strerror(-rc)));
+    }
+
+    // provided buffers that the multishot receive fills in turn
+    this->recvArena.resize(RECV_BUFFER_COUNT * RECV_BUFFER_SIZE);
+    this->recvBufferRing = io_uring_setup_buf_ring(&this->ring, RECV_BUFFER_COUNT, RECV_BUFFER_GROUP, 0, &rc);
+    if (!this->recvBufferRing) {
+        throw std::runtime_error(fmt::format("Failed to register receive buffer ring: {}", std::strerror(-rc)));
+    }
+    int mask = io_uring_buf_ring_mask(RECV_BUFFER_COUNT);
+    for (unsigned i = 0; i < RECV_BUFFER_COUNT; i++) {
+        io_uring_buf_ring_add(this->recvBufferRing, this->recvArena.data() + i * RECV_BUFFER_SIZE, RECV_BUFFER_SIZE, i, mask, i);
+    }
+    io_uring_buf_ring_advance(this->recvBufferRing, RECV_BUFFER_COUNT);
+}
+
+std::future<iggy::net::conn::Response> iggy::net::tcp::UringConnection::sendGathered(
+    iggy::serialization::binary::CommandCode command,
+    iggy::serialization::binary::GatherBuffer payload) {
+    auto request = std::make_unique<Request>();
+    request->header = prepareRequestHeader(request->headerStorage, command, payload.size());
+    request->payload = std::move(payload);
+    auto future = request->promise.get_future();
+
+    bool wake;
+    {
+        std::lock_guard<std::mutex> lock(this->submitMutex);
+        if (!this->started || this->closing) {
+            throw std::runtime_error("Connection is not open");
+        }
+        this->submitted.push_back(std::move(request));
+        wake = this->sleeping;
+        this->sleeping = false;
+    }
+    if (wake) {
+        eventfd_write(this->wakeupFd, 1);
+    }
+    return future;
+}
+
+void iggy::net::tcp::UringConnection::close() {
+    std::lock_guard<std::mutex> lifecycleLock(this->lifecycleMutex);
+    {
+        std::lock_guard<std::mutex> lock(this->submitMutex);
+        if (this->started && !this->closing) {
+            this->closing = true;
+            eventfd_write(this->wakeupFd, 1);
+        }
+    }
+    if (this->ioThread.joinable()) {
+        this->ioThread.join();
+    }
+    this->teardown();
+}
+
+void iggy::net::tcp::UringConnection::run() {
+    this->armWakeup();
+    this->armRecv();
+
+    while (true) {
+        this->drainSubmitted();
+        {
+            std::lock_guard<std::mutex> lock(this->submitMutex);
+            if (this->closing) {
+                break;
+            }
+        }
+        this->startWrite();
+        {
+            // only ask callers for an eventfd wakeup if there is genuinely nothing left to pick up
+            std::lock_guard<std::mutex> lock(this->submitMutex);
+            this->sleeping = this->submitted.empty();
+        }
+
+        // one syscall both submits everything queued above and waits for at least one completion
+        int rc = io_uring_submit_and_wait(&this->ring, 1);
+        {
+            std::lock_guard<std::mutex> lock(this->submitMutex);
+            this->sleeping = false;
+        }
+        if (rc < 0 && rc != -EINTR) {
+            this->failAll(fmt::format("io_uring submission failed: {}", std::strerror(-rc)));
+            break;
+        }
+
+        unsigned head;
+        unsigned count = 0;
+        struct io_uring_cqe* cqe;
+        io_uring_for_each_cqe(&this->ring, head, cqe) {
+            count++;
+            switch (io_uring_cqe_get_data64(cqe)) {
+                case TAG_WAKEUP: {
+                    eventfd_t value;
+                    eventfd_read(this->wakeupFd, &value);
+                    if (!(cqe->flags & IORING_CQE_F_MORE)) {
+                        this->wakeupArmed = false;
+                        this->armWakeup();
+                    }
+                    break;
+                }
+                case TAG_RECV:
+                    this->onRecv(cqe);
+                    break;
+                case TAG_SEND:
+                    this->onWriteComplete(cqe->res);
+                    break;
+                default:
+                    break;
+            }
+        }
+        io_uring_cq_advance(&this->ring, count);
+        if (this->failed) {
+            break;
+        }
+    }
+
+    // reject new callers, then make sure the kernel is done with every buffer before the ring is torn down
+    {
+        std::lock_guard<std::mutex> lock(this->submitMutex);
+        this->closing = true;
+    }
+    ::shutdown(this->fd, SHUT_RDWR);
+    if (this->wakeupArmed) {
+        auto sqe = this->getSqe();
+        io_uring_prep_cancel64(sqe, TAG_WAKEUP, 0);
+        io_uring_sqe_set_data64(sqe, TAG_CANCEL);
+    }
+    while (this->recvArmed || this->writeActive || this->wakeupArmed) {
+        struct io_uring_cqe* cqe;
+        if (io_uring_submit_and_wait(&this->ring, 1) < 0 || io_uring_peek_cqe(&this->ring, &cqe) < 0) {
+            break;
+        }
+        uint64_t tag = io_uring_cqe_get_data64(cqe);
+        bool more = cqe->flags & IORING_CQE_F_MORE;
+        if (tag == TAG_RECV && !more) {
+            this->recvArmed = false;
+        } else if (tag == TAG_SEND) {
+            this->writeActive = false;
+        } else if (tag == TAG_WAKEUP && !more) {
+            this->wakeupArmed = false;
+        }
+        io_uring_cqe_seen(&this->ring, cqe);
+    }
+    this->failAll("Connection closed");
+}
+
+struct io_uring_sqe* iggy::net::tcp::UringConnection::getSqe() {
+    auto sqe = io_uring_get_sqe(&this->ring);
+    if (!sqe) {
+        // the submission queue is full, so flush it to the kernel to make room
+        io_uring_submit(&this->ring);
+        sqe = io_uring_get_sqe(&this->ring);
+    }
+    return sqe;
+}
+
+void iggy::net::tcp::UringConnection::armWakeup() {
+    auto sqe = this->getSqe();
+    io_uring_prep_poll_multishot(sqe, this->wakeupFd, POLLIN);
+    io_uring_sqe_set_data64(sqe, TAG_WAKEUP);
+    this->wakeupArmed = true;
+}
+
+void iggy::net::tcp::UringConnection::armRecv() {
+    auto sqe = this->getSqe();
+    io_uring_prep_recv_multishot(sqe, this->fd, nullptr, 0, 0);
+    sqe->flags |= IOSQE_BUFFER_SELECT;
+    sqe->buf_group = RECV_BUFFER_GROUP;
+    io_uring_sqe_set_data64(sqe, TAG_RECV);
+    this->recvArmed = true;
+}
+
+void iggy::net::tcp::UringConnection::startWrite() {
+    // a stream socket must only ever have one send outstanding, or the kernel could interleave the bytes
+    if (this->writeActive || this->failed) {
+        return;
+    }
+
+    size_t batchStart = this->inFlight.size();
+    size_t total = 0;
+    while (this->inFlight.size() < this->maxInFlight && !this->pending.empty()) {
+        total += REQUEST_HEADER_SIZE + this->pending.front()->payload.size();
+        this->inFlight.push_back(std::move(this->pending.front()));
+        this->pending.pop_front();
+    }
+    if (this->inFlight.size() == batchStart) {
+        return;
+    }
+
+    this->writeOffset = 0;
+    this->writeLength = total;
+    this->writeFixed = total <= this->sendArena.size();
+    if (this->writeFixed) {
+        unsigned char* out = this->sendArena.data();
+        for (size_t i = batchStart; i < this->inFlight.size(); i++) {
+            const auto& request = this->inFlight[i];
+            std::memcpy(out, request->header, REQUEST_HEADER_SIZE);
+            out += REQUEST_HEADER_SIZE;
+            request->payload.forEachSegment([&out](const unsigned char* data, size_t length) {
+                std::memcpy(out, data, length);
+                out += length;
+            });
+        }
+    } else {
+        // too big to stage, so gather directly from the requests, which stay alive in inFlight until answered
+        this->writeIovecs.clear();
+        this->writeIovecIndex = 0;
+        for (size_t i = batchStart; i < this->inFlight.size(); i++) {
+            auto& request = this->inFlight[i];
+            this->writeIovecs.push_back({const_cast<unsigned char*>(request->header), REQUEST_HEADER_SIZE});
+            request->payload.forEachSegment([this](const unsigned char* data, size_t length) {
+                this->writeIovecs.push_back({const_cast<unsigned char*>(data), length});
+            });
+        }
+    }
+    this->writeActive = true;
+    this->continueWrite();
+}
+
+void iggy::net::tcp::UringConnection::continueWrite() {
+    auto sqe = this->getSqe();
+    if (this->writeFixed) {
+        io_uring_prep_write_fixed(sqe, this->fd, this->sendArena.data() + this->writeOffset,
+                                  static_cast<unsigned>(this->writeLength - this->writeOffset), 0, SEND_ARENA_INDEX);
+    } else {
+        this->writeMsg = {};
+        this->writeMsg.msg_iov = this->writeIovecs.data() + this->writeIovecIndex;
+        // sendmsg rejects more than IOV_MAX segments; the rest goes out as a continuation of the short write
+        this->writeMsg.msg_iovlen = std::min<size_t>(this->writeIovecs.size() - this->writeIovecIndex, IOV_MAX);
+        io_uring_prep_sendmsg(sqe, this->fd, &this->writeMsg, MSG_NOSIGNAL);
+    }
+    io_uring_sqe_set_data64(sqe, TAG_SEND);
+}
+
+void iggy::net::tcp::UringConnection::onWriteComplete(int result) {
+    this->writeActive = false;
+    if (result < 0) {
+        this->failAll(fmt::format("Failed to write to server: {}", std::strerror(-result)));
+        return;
+    }
+
+    // short writes are resumed from where the kernel stopped
+    this->writeOffset += static_cast<size_t>(result);
+    if (this->writeOffset < this->writeLength) {
+        if (!this->writeFixed) {
+            size_t remaining = static_cast<size_t>(result);
+            while (remaining > 0) {
+                auto& iov = this->writeIovecs[this->writeIovecIndex];
+                if (remaining >= iov.iov_len) {
+                    remaining -= iov.iov_len;
+                    this->writeIovecIndex++;
+                } else {
+                    iov.iov_base = static_cast<unsigned char*>(iov.iov_base) + remaining;
+                    iov.iov_len -= remaining;
+                    remaining = 0;
+                }
+            }
+        }
+        this->writeActive = true;
+        this->continueWrite();
+    }
+}
+
+void iggy::net::tcp::UringConnection::onRecv(const struct io_uring_cqe* cqe) {
+    bool more = cqe->flags & IORING_CQE_F_MORE;
+    if (!more) {
+        this->recvArmed = false;
+    }
+
+    if (cqe->res > 0) {
+        unsigned bufferId = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+        unsigned char* data = this->recvArena.data() + bufferId * RECV_BUFFER_SIZE;
+        this->consume(data, static_cast<size_t>(cqe->res));
+
+        // hand the buffer straight back to the kernel for the next receive
+        io_uring_buf_ring_add(this->recvBufferRing, data, RECV_BUFFER_SIZE, bufferId, io_uring_buf_ring_mask(RECV_BUFFER_COUNT), 0);
+        io_uring_buf_ring_advance(this->recvBufferRing, 1);
+    } else if (cqe->res == 0) {
+        this->failAll("Connection closed by server");
+        return;
+    } else if (cqe->res != -ENOBUFS) {
+        this->failAll(fmt::format("Failed to read from server: {}", std::strerror(-cqe->res)));
+        return;
+    }
+
+    // multishot stops when it runs out of provided buffers or the kernel otherwise ends it; just start another
+    if (!this->recvArmed && !this->failed) {
+        this->armRecv();
+    }
+}
+
+void iggy::net::tcp::UringConnection::consume(const unsigned char* data, size_t length) {
+    if (this->readBuffer.empty()) {
+        // common case: whole frames inside a single provided buffer are de-framed in place
+        size_t consumed = this->processFrames(data, length);
+        this->readBuffer.assign(data + consumed, data + length);
+    } else {
+        this->readBuffer.insert(this->readBuffer.end(), data, data + length);
+        size_t consumed = this->processFrames(this->readBuffer.data(), this->readBuffer.size());
+        this->readBuffer.erase(this->readBuffer.begin(), this->readBuffer.begin() + consumed);
+    }
+    this->startWrite();
+}
+
+size_t iggy::net::tcp::UringConnection::processFrames(const unsigned char* data, size_t length) {
+    size_t offset = 0;
+    while (length - offset >= RESPONSE_HEADER_SIZE) {
+        const unsigned char* frame = data + offset;
+        uint32_t status = iggy::serialization::loadLittleEndian<uint32_t>(frame);
+        uint32_t payloadLength = iggy::serialization::loadLittleEndian<uint32_t>(frame + 4);
+        if (payloadLength > MAX_RESPONSE_SIZE) {
+            this->failAll(
+                fmt::format("Server announced a response of {} bytes, more than the limit of {}", payloadLength, MAX_RESPONSE_SIZE));
+            return length;
+        }
+        if (length - offset < RESPONSE_HEADER_SIZE + payloadLength) {
+            break;
+        }
+        if (this->inFlight.empty()) {
+            this->failAll("Received a response with no matching request");
+            return length;
+        }
+
+        auto request = std::move(this->inFlight.front());
+        this->inFlight.pop_front();
+        const unsigned char* payload = frame + RESPONSE_HEADER_SIZE;
+        request->promise.set_value(iggy::net::conn::Response(status, std::vector<unsigned char>(payload, payload + payloadLength)));
+        offset += RESPONSE_HEADER_SIZE + payloadLength;
+    }
+    return offset;
+}
+
+void iggy::net::tcp::UringConnection::drainSubmitted() {
+    std::lock_guard<std::mutex> lock(this->submitMutex);
+    while (!this->submitted.empty()) {
+        this->pending.push_back(std::move(this->submitted.front()));
+        this->submitted.pop_front();
+    }
+}
+
+void iggy::net::tcp::UringConnection::failAll(const std::string& reason) {
+    this->failed = true;
+    {
+        std::lock_guard<std::mutex> lock(this->submitMutex);
+        this->closing = true;
+    }
+    this->drainSubmitted();
+    auto error = std::make_exception_ptr(std::runtime_error(reason));
+    for (auto& request : this->inFlight) {
+        request->promise.set_exception(error);
+    }
+    for (auto& request : this->pending) {
+        request->promise.set_exception(error);
+    }
+    this->inFlight.clear();
+    this->pending.clear();
+}
+
+void iggy::net::tcp::UringConnection::teardown() {
+    if (this->ringOpen) {
+        if (this->recvBufferRing) {
+            io_uring_free_buf_ring(&this->ring, this->recvBufferRing, RECV_BUFFER_COUNT, RECV_BUFFER_GROUP);
+            this->recvBufferRing = nullptr;
+        }
+        io_uring_queue_exit(&this->ring);
+        this->ringOpen = false;
+    }
+    if (this->wakeupFd >= 0) {
+        ::close(this->wakeupFd);
+        this->wakeupFd = -1;
+    }
+    if (this->fd >= 0) {
+        ::close(this->fd);
+        this->fd = -1;
+    }
+}
+#endif  // IGGY_HAVE_IO_URING
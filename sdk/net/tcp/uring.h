@@ -0,0 +1,113 @@
+#pragma once
+
+#include <liburing.h>
+#include <sys/socket.h>
+#include <array>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "conn.h"
+
+namespace iggy {
+namespace net {
+namespace tcp {
+
+/**
+ * @brief TCP connection to the Iggy server driven by Linux io_uring instead of libuv.
+ *
+ * Functionally identical to @ref TcpConnection -- pipelined requests with FIFO response correlation -- but the I/O thread
+ * submits and reaps all socket operations through a single ring, so one io_uring_enter call covers every send, receive
+ * and wakeup in a loop iteration:
+ *
+ * - small request batches are coalesced into a registered (fixed) send buffer and written with WRITE_FIXED, so the kernel
+ *   does not have to pin and map user pages for every send; batches too large for it are sent straight from the request
+ *   memory with a gathered SENDMSG instead
+ * - responses arrive through a single multishot RECV that draws from a ring of provided buffers, so there is no receive
+ *   request to re-submit per read; frames contained in one buffer are de-framed in place
+ * - callers only pay for an eventfd write when the I/O thread is actually asleep
+ */
+class UringConnection : public iggy::net::conn::Connection {
+private:
+    struct Request {
+        // a static frame for parameterless commands, otherwise headerStorage
+        const unsigned char* header;
+        std::array<unsigned char, REQUEST_HEADER_SIZE> headerStorage;
+        iggy::serialization::binary::GatherBuffer payload;
+        std::promise<iggy::net::conn::Response> promise;
+    };
+
+    const std::string host;
+    const uint16_t port;
+    const uint32_t maxInFlight;
+
+    int fd = -1;
+    int wakeupFd = -1;
+    struct io_uring ring;
+    bool ringOpen = false;
+    struct io_uring_buf_ring* recvBufferRing = nullptr;
+    std::vector<unsigned char> recvArena;
+    std::vector<unsigned char> sendArena;
+    std::thread ioThread;
+    std::mutex lifecycleMutex;
+
+    // guarded by submitMutex; sleeping tells callers that the I/O thread needs an eventfd wakeup
+    std::mutex submitMutex;
+    std::deque<std::unique_ptr<Request>> submitted;
+    bool started = false;
+    bool closing = false;
+    bool sleeping = false;
+
+    // state below is only touched on the I/O thread
+    std::deque<std::unique_ptr<Request>> pending;
+    std::deque<std::unique_ptr<Request>> inFlight;
+    std::vector<unsigned char> readBuffer;
+    std::vector<struct iovec> writeIovecs;
+    struct msghdr writeMsg = {};
+    size_t writeOffset = 0;
+    size_t writeLength = 0;
+    size_t writeIovecIndex = 0;
+    bool writeFixed = false;
+    bool writeActive = false;
+    bool recvArmed = false;
+    bool wakeupArmed = false;
+    bool failed = false;
+
+    void setupRing();
+    void run();
+    void armWakeup();
+    void armRecv();
+    void startWrite();
+    void continueWrite();
+    void onWriteComplete(int result);
+    void onRecv(const struct io_uring_cqe* cqe);
+    void consume(const unsigned char* data, size_t length);
+    size_t processFrames(const unsigned char* data, size_t length);
+    struct io_uring_sqe* getSqe();
+    void drainSubmitted();
+    void failAll(const std::string& reason);
+    void teardown();
+
+public:
+    /**
+     * @param host Hostname or IP address of the server.
+     * @param port TCP port of the server.
+     * @param maxInFlight Maximum number of requests written but not yet answered; further requests queue locally.
+     */
+    UringConnection(const std::string& host, uint16_t port, uint32_t maxInFlight = DEFAULT_MAX_IN_FLIGHT);
+    UringConnection(const UringConnection& other) = delete;
+    UringConnection& operator=(const UringConnection& other) = delete;
+    ~UringConnection() override;
+
+    void connect() override;
+    std::future<iggy::net::conn::Response> sendGathered(iggy::serialization::binary::CommandCode command,
+                                                        iggy::serialization::binary::GatherBuffer payload) override;
+    void close() override;
+};
+
+};  // namespace tcp
+};  // namespace net
+};  // namespace iggy
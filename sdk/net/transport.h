@@ -26,6 +26,21 @@ enum Transport {
     TCP
 };
 
+/**
+ * @brief Available I/O backends for the TCP transport.
+ */
+enum TcpBackend {
+    /**
+     * @brief Portable readiness-based I/O on libuv; epoll on Linux.
+     */
+    LIBUV,
+
+    /**
+     * @brief Completion-based I/O on Linux io_uring with registered buffers and multishot receive. Requires Linux 6.0+.
+     */
+    IO_URING
+};
+
 };  // namespace transport
 };  // namespace net
 };  // namespace iggy
@@ -1,19 +1,248 @@
 #include "serialization.h"
 #include <fmt/format.h>
-#include <utf8h/utf8.h>
+#include <cstdint>
+#include <algorithm>
+#include <cstring>
+#include <memory>
 #include <stdexcept>
+#include "crc32.h"
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define IGGY_HAVE_X86_SIMD 1
+#endif
 
-std::string iggy::serialization::convertToUTF8(const std::string& source, bool strict) {
-    if (utf8valid(source.c_str()) == 0) {
+namespace {
+/// @brief Written in place of every byte that does not start a well-formed sequence when repairing a string.
+const char REPLACEMENT_CHARACTER = '?';
+
+using AsciiScanner = size_t (*)(const unsigned char* data, size_t pos, size_t size);
+
+/**
+ * @brief Gets the position of the first non-ASCII byte at or after pos, or size if there is none.
+ */
+size_t skipAsciiScalar(const unsigned char* data, size_t pos, size_t size) {
+    for (; pos + sizeof(uint64_t) <= size; pos += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, data + pos, sizeof(word));
+        if (word & 0x8080808080808080ULL) {
+            break;
+        }
+    }
+    while (pos < size && data[pos] < 0x80) {
+        pos++;
+    }
+    return pos;
+}
+
+#if defined(IGGY_HAVE_X86_SIMD)
+size_t skipAsciiSse2(const unsigned char* data, size_t pos, size_t size) {
+    for (; pos + 16 <= size; pos += 16) {
+        int mask = _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos)));
+        if (mask != 0) {
+            return pos + static_cast<size_t>(__builtin_ctz(static_cast<unsigned int>(mask)));
+        }
+    }
+    return skipAsciiScalar(data, pos, size);
+}
+
+__attribute__((target("avx2"))) size_t skipAsciiAvx2(const unsigned char* data, size_t pos, size_t size) {
+    for (; pos + 32 <= size; pos += 32) {
+        int mask = _mm256_movemask_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos)));
+        if (mask != 0) {
+            return pos + static_cast<size_t>(__builtin_ctz(static_cast<unsigned int>(mask)));
+        }
+    }
+    return skipAsciiSse2(data, pos, size);
+}
+#endif
+
+/// @brief Picks the widest ASCII scanner the CPU supports; SSE2 is always there on x86-64.
+AsciiScanner selectAsciiScanner() {
+#if defined(IGGY_HAVE_X86_SIMD)
+    return __builtin_cpu_supports("avx2") ? skipAsciiAvx2 : skipAsciiSse2;
+#else
+    return skipAsciiScalar;
+#endif
+}
+
+/**
+ * @brief Gets the length of the well-formed sequence starting at pos, or 0 if the bytes there are not one.
+ *
+ * Follows the well-formed byte sequence table of RFC 3629, so overlong encodings, UTF-16 surrogates and code points past
+ * U+10FFFF are all rejected.
+ */
+size_t sequenceLength(const unsigned char* data, size_t pos, size_t size) {
+    unsigned char lead = data[pos];
+    size_t length;
+    unsigned char min = 0x80;
+    unsigned char max = 0xbf;
+    if (lead < 0x80) {
+        return 1;
+    } else if (lead >= 0xc2 && lead <= 0xdf) {
+        length = 2;
+    } else if (lead >= 0xe0 && lead <= 0xef) {
+        length = 3;
+        min = lead == 0xe0 ? 0xa0 : min;
+        max = lead == 0xed ? 0x9f : max;
+    } else if (lead >= 0xf0 && lead <= 0xf4) {
+        length = 4;
+        min = lead == 0xf0 ? 0x90 : min;
+        max = lead == 0xf4 ? 0x8f : max;
+    } else {
+        return 0;
+    }
+    if (size - pos < length || data[pos + 1] < min || data[pos + 1] > max) {
+        return 0;
+    }
+    for (size_t i = 2; i < length; i++) {
+        if ((data[pos + i] & 0xc0) != 0x80) {
+            return 0;
+        }
+    }
+    return length;
+}
+
+/**
+ * @brief Gets the position of the first byte at or after pos that does not start a well-formed sequence, or size.
+ *
+ * Names and other metadata are nearly always ASCII, so runs of it are skipped a vector at a time and only the multi-byte
+ * sequences in between are checked byte by byte.
+ */
+size_t findInvalid(const unsigned char* data, size_t pos, size_t size) {
+    static const AsciiScanner skipAscii = selectAsciiScanner();
+    while (pos < size) {
+        pos = skipAscii(data, pos, size);
+        while (pos < size && data[pos] >= 0x80) {
+            size_t length = sequenceLength(data, pos, size);
+            if (length == 0) {
+                return pos;
+            }
+            pos += length;
+        }
+    }
+    return size;
+}
+
+/// @brief A rebuilt buffer together with the receive buffer it was made from, whose bytes it still refers to.
+struct RewrittenBuffer {
+    std::shared_ptr<const std::vector<unsigned char>> original;
+    std::vector<unsigned char> bytes;
+};
+
+/// @brief Where a rewritten message's headers block and payload ended up in the new buffer.
+struct Placement {
+    size_t headersStart;
+    size_t headersLength;
+    size_t payloadStart;
+    uint32_t checksum;
+};
+}  // namespace
+
+bool iggy::serialization::isValidUTF8(std::string_view value) {
+    return findInvalid(reinterpret_cast<const unsigned char*>(value.data()), 0, value.size()) == value.size();
+}
+
+std::string iggy::serialization::convertToUTF8(std::string source, bool strict) {
+    auto data = reinterpret_cast<unsigned char*>(source.data());
+    size_t size = source.size();
+    size_t pos = findInvalid(data, 0, size);
+    if (pos == size) {
         return source;
+    }
+    if (strict) {
+        throw std::invalid_argument(fmt::format("The input string is not a valid UTF-8 string: byte {:#04x} at offset {}", data[pos], pos));
+    }
+
+    // a replacement is one byte for one byte, so the string is repaired in place and keeps its length
+    for (; pos < size; pos = findInvalid(data, pos + 1, size)) {
+        data[pos] = REPLACEMENT_CHARACTER;
+    }
+    return source;
+}
+
+void iggy::serialization::verifyChecksum(const iggy::model::message::MessageView& message) {
+    if (!message.hasValidChecksum()) {
+        throw std::runtime_error(fmt::format("Checksum mismatch for message at offset {}: payload of {} bytes does not match {:#010x}",
+                                             message.getOffset(), message.getPayload().size(), message.getChecksum()));
+    }
+}
+
+void iggy::serialization::verifyChecksum(const iggy::model::message::Message& message) {
+    if (message.getChecksum() && !message.hasValidChecksum()) {
+        throw std::invalid_argument(fmt::format("Checksum mismatch for message to send: payload of {} bytes does not match {:#010x}",
+                                                message.getPayload().size(), *message.getChecksum()));
+    }
+}
+
+iggy::model::message::PolledMessagesView iggy::serialization::rewriteMessages(
+    const iggy::model::message::PolledMessagesView& messages,
+    const std::vector<PayloadRewrite>& rewrites,
+    std::span<const std::string_view> droppedHeaders,
+    const std::function<void(size_t, std::span<unsigned char>)>& writePayload,
+    const std::function<void(size_t, const std::function<void(size_t)>&)>& forEach) {
+    const auto& views = messages.getMessages();
+    auto kept = [droppedHeaders](std::string_view key) { return std::ranges::find(droppedHeaders, key) == droppedHeaders.end(); };
+
+    // size the buffer up front, so that it is allocated once and has stopped moving by the time the payloads are written
+    size_t total = 0;
+    for (const auto& rewrite : rewrites) {
+        views[rewrite.index].forEachHeader([&](std::string_view key, iggy::model::message::HeaderValueView value) {
+            if (kept(key)) {
+                total += HEADER_ENTRY_OVERHEAD + key.size() + value.getValue().size();
+            }
+        });
+        total += rewrite.payloadLength;
+    }
+
+    ByteWriter buffer(total);
+    std::vector<Placement> placements(rewrites.size());
+    for (size_t i = 0; i < rewrites.size(); i++) {
+        auto& placement = placements[i];
+        placement.headersStart = buffer.size();
+        views[rewrites[i].index].forEachHeader([&](std::string_view key, iggy::model::message::HeaderValueView value) {
+            if (!kept(key)) {
+                return;
+            }
+            buffer.writeLittleEndian<uint32_t>(static_cast<uint32_t>(key.size()));
+            buffer.writeBytes(reinterpret_cast<const unsigned char*>(key.data()), key.size());
+            buffer.writeLittleEndian<uint8_t>(static_cast<uint8_t>(value.getKind()));
+            buffer.writeLittleEndian<uint32_t>(static_cast<uint32_t>(value.getValue().size()));
+            buffer.writeBytes(value.getValue().data(), value.getValue().size());
+        });
+        placement.headersLength = buffer.size() - placement.headersStart;
+        placement.payloadStart = buffer.size();
+        buffer.extend(rewrites[i].payloadLength);
+    }
+
+    // each task writes its own disjoint slice of the buffer
+    auto shared = std::make_shared<RewrittenBuffer>(RewrittenBuffer{messages.getBuffer(), buffer.take()});
+    unsigned char* bytes = shared->bytes.data();
+    std::function<void(size_t)> task = [&](size_t i) {
+        std::span<unsigned char> payload(bytes + placements[i].payloadStart, rewrites[i].payloadLength);
+        writePayload(i, payload);
+        placements[i].checksum = iggy::serialization::crc32::checksum(payload.data(), payload.size());
+    };
+    if (forEach) {
+        forEach(rewrites.size(), task);
     } else {
-        if (strict) {
-            throw std::invalid_argument(fmt::format("The input string is not a valid UTF-8 string: '{}'", source));
-        } else {
-            char* data = new char[source.size() + 1];
-            std::snprintf(data, source.size() + 1, "%s", source.c_str());
-            utf8makevalid(data, '?');
-            return std::string(data);
+        for (size_t i = 0; i < rewrites.size(); i++) {
+            task(i);
         }
     }
+
+    // the new buffer shares ownership with the original, which the messages that were not rewritten still point into
+    std::span<const unsigned char> rewritten(shared->bytes);
+    std::vector<iggy::model::message::MessageView> result(views);
+    for (size_t i = 0; i < rewrites.size(); i++) {
+        const auto& view = views[rewrites[i].index];
+        const auto& placement = placements[i];
+        result[rewrites[i].index] = iggy::model::message::MessageView(
+            view.getOffset(), view.getState(), view.getTimestamp(), view.getId(), placement.checksum,
+            rewritten.subspan(placement.headersStart, placement.headersLength),
+            rewritten.subspan(placement.payloadStart, rewrites[i].payloadLength));
+    }
+    return iggy::model::message::PolledMessagesView(std::shared_ptr<const std::vector<unsigned char>>(shared, &shared->bytes),
+                                                    messages.getPartitionId(), messages.getCurrentOffset(), std::move(result));
 }
+
+iggy::serialization::WireFormat::~WireFormat() = default;
@@ -1,23 +1,209 @@
 #pragma once
 
+#include <fmt/format.h>
+#include <cstddef>
+#include <functional>
+#include <span>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <vector>
+#include "bytes.h"
 #include "command.h"
 #include "model.h"
 
 namespace iggy {
 namespace serialization {
 
-std::string convertToUTF8(const std::string& source, bool strict = true);
+/**
+ * @brief Tests whether a byte string is well-formed UTF-8; embedded NULs are valid and do not end the string.
+ */
+bool isValidUTF8(std::string_view value);
+
+/**
+ * @brief Validates a string received from the server as UTF-8, optionally repairing it.
+ *
+ * Repairing replaces every byte that does not start a well-formed sequence with '?', in place, so the result has the same
+ * length as the input.
+ * @param source The string to check; pass a temporary to have it checked and repaired without a copy.
+ * @param strict Whether to reject malformed input rather than repair it.
+ * @throws std::invalid_argument if strict and the input is not well-formed UTF-8.
+ */
+std::string convertToUTF8(std::string source, bool strict = true);
+
+/**
+ * @brief Rejects a polled message whose payload does not match the server's checksum, e.g. after corruption in transit.
+ * @throws std::runtime_error on a mismatch.
+ */
+void verifyChecksum(const iggy::model::message::MessageView& message);
+
+/**
+ * @brief Rejects a message about to be sent whose payload no longer matches the checksum it carries, e.g. one that was
+ * polled and is being forwarded; messages without a checksum pass.
+ * @throws std::invalid_argument on a mismatch.
+ */
+void verifyChecksum(const iggy::model::message::Message& message);
+
+/**
+ * @brief Bytes each message header adds to the headers block besides its key and value: a u32 key length, a u8 value kind
+ * and a u32 value length.
+ */
+constexpr size_t HEADER_ENTRY_OVERHEAD = sizeof(uint32_t) + sizeof(uint8_t) + sizeof(uint32_t);
+
+/**
+ * @brief A message of a polled batch that @ref rewriteMessages gives a new payload: its index in the batch and the length
+ * of that payload.
+ */
+struct PayloadRewrite {
+    size_t index;
+    size_t payloadLength;
+};
+
+/**
+ * @brief Rebuilds messages of a polled batch around new payloads, as the client-side payload stages do to undo on poll what
+ * they did on send.
+ *
+ * The rewritten messages are copied into one new buffer, allocated once, with their headers minus the dropped ones, and
+ * writePayload(i, out) then fills in the new payload of rewrites[i], exactly as long as it said. Those messages get the
+ * CRC-32 of their new payload as their checksum; the others keep pointing into the original buffer, which the new one keeps
+ * alive.
+ * @param forEach Runs task(i) for each i below count, e.g. on worker threads; the payloads are disjoint slices of a buffer
+ * that no longer grows, so the tasks may run concurrently. If empty, they run in order on the calling thread.
+ */
+iggy::model::message::PolledMessagesView rewriteMessages(
+    const iggy::model::message::PolledMessagesView& messages,
+    const std::vector<PayloadRewrite>& rewrites,
+    std::span<const std::string_view> droppedHeaders,
+    const std::function<void(size_t, std::span<unsigned char>)>& writePayload,
+    const std::function<void(size_t, const std::function<void(size_t)>&)>& forEach = {});
+
+/**
+ * @class ByteWriter
+ * @brief Growable contiguous buffer that wire formats encode into, with inlined little-endian primitives.
+ *
+ * Unlike an ostream there is no virtual dispatch, locale or sentry per write: each primitive is a bounds-free append to a
+ * vector, which the caller takes over as the request payload once encoding is done.
+ */
+class ByteWriter {
+private:
+    std::vector<unsigned char> bytes;
+
+public:
+    ByteWriter() = default;
+
+    /**
+     * @brief Creates a writer with room for capacity bytes, so encoding a frame of known size never reallocates.
+     */
+    explicit ByteWriter(size_t capacity) { this->bytes.reserve(capacity); }
+
+    /**
+     * @brief Makes room for additional more bytes, so a frame whose size is computed up front is encoded without reallocating.
+     */
+    void reserve(size_t additional) { this->bytes.reserve(this->bytes.size() + additional); }
+
+    /**
+     * @brief Appends an unsigned integer in little-endian byte order.
+     */
+    template <typename T>
+    void writeLittleEndian(T value) {
+        unsigned char encoded[sizeof(T)];
+        storeLittleEndian(encoded, value);
+        this->bytes.insert(this->bytes.end(), encoded, encoded + sizeof(T));
+    }
+
+    /**
+     * @brief Appends raw bytes.
+     */
+    void writeBytes(const unsigned char* data, size_t length) { this->bytes.insert(this->bytes.end(), data, data + length); }
+
+    /**
+     * @brief Appends length bytes for the caller to fill in, e.g. by decoding straight into the buffer.
+     * @return Where the new bytes start; valid until the next write.
+     */
+    unsigned char* extend(size_t length) {
+        size_t at = this->bytes.size();
+        this->bytes.resize(at + length);
+        return this->bytes.data() + at;
+    }
+
+    /**
+     * @brief Gets the number of bytes written so far.
+     */
+    size_t size() const { return this->bytes.size(); }
+
+    /**
+     * @brief Gets the number of bytes that can be written before the buffer has to grow.
+     */
+    size_t capacity() const { return this->bytes.capacity(); }
+
+    /**
+     * @brief Gets the bytes written so far.
+     */
+    std::span<const unsigned char> view() const { return this->bytes; }
+
+    /**
+     * @brief Moves the encoded bytes out of the writer, leaving it empty.
+     */
+    std::vector<unsigned char> take() { return std::move(this->bytes); }
+};
+
+/**
+ * @class ByteReader
+ * @brief Bounds-checked little-endian cursor over a payload that hands out spans into it rather than copies.
+ *
+ * The reader never owns the payload; it must outlive the reader and any span taken from it.
+ */
+class ByteReader {
+private:
+    std::span<const unsigned char> data;
+    size_t pos = 0;
+
+public:
+    explicit ByteReader(std::span<const unsigned char> data)
+        : data(data) {}
+
+    /**
+     * @brief Tests whether the whole payload has been consumed.
+     */
+    bool atEnd() const { return this->pos == this->data.size(); }
+
+    /**
+     * @brief Gets the number of bytes left to read.
+     */
+    size_t remaining() const { return this->data.size() - this->pos; }
+
+    /**
+     * @brief Consumes the next length bytes, returning a span into the payload.
+     * @throws std::runtime_error if fewer than length bytes are left.
+     */
+    std::span<const unsigned char> take(size_t length) {
+        if (this->remaining() < length) {
+            throw std::runtime_error(fmt::format("Unexpected end of payload reading {} bytes", length));
+        }
+        auto bytes = this->data.subspan(this->pos, length);
+        this->pos += length;
+        return bytes;
+    }
+
+    /**
+     * @brief Consumes an unsigned integer stored in little-endian byte order.
+     * @throws std::runtime_error if the payload ends first.
+     */
+    template <typename T>
+    T readLittleEndian() {
+        return loadLittleEndian<T>(this->take(sizeof(T)).data());
+    }
+};
 
 class WireFormat {
 public:
     virtual ~WireFormat() = 0;
 
     template <typename T, typename std::enable_if<std::is_base_of<iggy::model::Model, T>::value>::type* = nullptr>
-    T read(std::istream& in);
+    T read(ByteReader& in);
 
     template <typename T, typename std::enable_if<std::is_base_of<iggy::command::Command, T>::value>::type* = nullptr>
-    void write(std::ostream& out, const T& value);
+    void write(ByteWriter& out, const T& value);
 };
 }  // namespace serialization
 }  // namespace iggy
@@ -1,9 +1,320 @@
+#include <fmt/format.h>
+#include <algorithm>
+#include <functional>
 #include "../sdk/client.h"
 #include "unit_testutils.h"
 
-TEST_CASE("client connection", UT_TAG) {
+namespace {
+/// @brief Four messages without headers, whose payloads are made from their index.
+std::vector<iggy::model::message::Message> makeMessages(const std::function<std::vector<unsigned char>(int)>& makePayload) {
+    std::vector<iggy::model::message::Message> messages;
+    for (int i = 0; i < 4; i++) {
+        auto payload = makePayload(i);
+        auto length = static_cast<uint32_t>(payload.size());
+        messages.emplace_back(i, iggy::model::message::Headers(), length, std::move(payload));
+    }
+    return messages;
+}
+
+/// @brief Records the last batch a stub server received and answers its polls with a batch the test chooses, so that a
+/// section can check what a client sends and what it makes of what comes back.
+class MessageExchange {
+private:
+    iggy::testutil::StubIggyServer& server;
+    std::vector<unsigned char> received;
+
+public:
+    explicit MessageExchange(iggy::testutil::StubIggyServer& server)
+        : server(server) {
+        this->server.setHandler(iggy::serialization::binary::SEND_MESSAGES, [this](const std::vector<unsigned char>& payload) {
+            this->received = payload;
+            return std::make_pair(0u, std::vector<unsigned char>());
+        });
+    }
+
+    const std::vector<unsigned char>& getReceived() const { return this->received; }
+
+    /// @brief Answers every following poll with the given batch, as the server would return it after storing it.
+    void serve(const iggy::command::message::SendMessages& command) {
+        auto payload = iggy::testutil::StubIggyServer::encodePolledMessages(command.getMessages());
+        this->server.setHandler(iggy::serialization::binary::POLL_MESSAGES,
+                                [payload](const std::vector<unsigned char>&) { return std::make_pair(0u, payload); });
+    }
+
+    /// @brief Polls the served batch through the given client.
+    iggy::model::message::PolledMessages poll(iggy::client::Client& client) {
+        auto topic = iggy::model::shared::Identifier::numeric(1);
+        iggy::command::message::PollMessages command(iggy::model::shared::Consumer(iggy::model::shared::CONSUMER, 1), topic, topic, 1,
+                                                     iggy::command::message::PollingStrategy(iggy::command::message::NEXT, 0), 4, true);
+        return client.pollMessages(command);
+    }
+};
+}  // namespace
+
+TEST_CASE_METHOD(iggy::testutil::StubIggyServer, "client connection", UT_TAG) {
     iggy::client::Options options;
+    options.hostname = "127.0.0.1";
+    options.port = getPort();
     auto client = iggy::client::Client(options);
-    auto stats = client.getStats();
-    REQUIRE(&stats != nullptr);
+
+    SECTION("ping") {
+        REQUIRE_NOTHROW(client.ping());
+    }
+
+    SECTION("get stats") {
+        auto stats = client.getStats();
+        REQUIRE(stats.getProcessId() == 1234);
+        REQUIRE(stats.getCpuUsage() == 0.5f);
+        REQUIRE(stats.getStreamsCount() == 1);
+        REQUIRE(stats.getConsumerGroupsCount() == 7);
+        REQUIRE(stats.getHostname() == "localhost");
+        REQUIRE(stats.getKernelVersion() == "6.1.0");
+    }
+
+    SECTION("connection pool") {
+        options.connectionCount = 3;
+        auto pooled = iggy::client::Client(options);
+        pooled.ping();
+
+        // the first client's connection plus one per pooled connection, each of which logged in
+        REQUIRE(getConnectionCount() == 4);
+    }
+
+    SECTION("io_uring backend") {
+        options.tcpBackend = iggy::net::transport::TcpBackend::IO_URING;
+#if defined(IGGY_HAVE_IO_URING)
+        auto uring = iggy::client::Client(options);
+        REQUIRE_NOTHROW(uring.ping());
+#else
+        REQUIRE_THROWS_AS(iggy::client::Client(options), std::invalid_argument);
+#endif
+    }
+
+    SECTION("TLS requires the libuv backend") {
+        options.tls = true;
+        options.tcpBackend = iggy::net::transport::TcpBackend::IO_URING;
+        REQUIRE_THROWS_AS(options.validate(), std::invalid_argument);
+    }
+
+    SECTION("send messages") {
+        std::vector<unsigned char> received;
+        setHandler(iggy::serialization::binary::SEND_MESSAGES, [&received](const std::vector<unsigned char>& payload) {
+            received = payload;
+            return std::make_pair(0u, std::vector<unsigned char>());
+        });
+        std::vector<iggy::model::message::Message> messages;
+        for (int i = 0; i < 4; i++) {
+            messages.emplace_back(i, iggy::model::message::Headers(), 65536,
+                                  std::vector<unsigned char>(65536, static_cast<unsigned char>(i)));
+        }
+        iggy::command::message::SendMessages command(iggy::model::shared::Identifier(iggy::model::shared::NUMERIC, 4, {1, 0, 0, 0}),
+                                                     iggy::model::shared::Identifier(iggy::model::shared::NUMERIC, 4, {1, 0, 0, 0}),
+                                                     iggy::command::message::Partitioning(iggy::command::message::BALANCED, 0, {}),
+                                                     std::move(messages));
+        client.sendMessages(command);
+
+        iggy::serialization::binary::GatherBuffer expected;
+        iggy::serialization::binary::BinaryWireFormat().write(expected, command);
+        REQUIRE(received == expected.flatten());
+    }
+
+    SECTION("poll messages") {
+        setHandler(iggy::serialization::binary::POLL_MESSAGES, [](const std::vector<unsigned char>&) {
+            return std::make_pair(0u, iggy::testutil::StubIggyServer::encodePolledMessages(100, 4096));
+        });
+        iggy::command::message::PollMessages command(iggy::model::shared::Consumer(iggy::model::shared::CONSUMER, 1),
+                                                     iggy::model::shared::Identifier(iggy::model::shared::NUMERIC, 4, {1, 0, 0, 0}),
+                                                     iggy::model::shared::Identifier(iggy::model::shared::NUMERIC, 4, {1, 0, 0, 0}), 1,
+                                                     iggy::command::message::PollingStrategy(iggy::command::message::NEXT, 0), 100, true);
+
+        auto view = client.pollMessagesView(command);
+        REQUIRE(view.getMessages().size() == 100);
+        REQUIRE(view.getMessages()[99].getPayload()[0] == 99);
+
+        auto owned = client.pollMessages(command);
+        REQUIRE(owned.getMessages().size() == 100);
+        REQUIRE(std::ranges::equal(owned.getMessages()[99].getPayload(), std::vector<unsigned char>(4096, 99)));
+
+        options.verifyChecksums = true;
+        auto verifying = iggy::client::Client(options);
+        REQUIRE(verifying.pollMessagesView(command).getMessages().size() == 100);
+    }
+
+    SECTION("compressed messages") {
+        MessageExchange exchange(*this);
+        auto command = iggy::testutil::makeBatch(
+            makeMessages([](int i) { return std::vector<unsigned char>(65536, static_cast<unsigned char>(i)); }));
+        options.compression = iggy::serialization::compression::Codec::ZSTD;
+        options.compressionLevel = 3;
+        auto compressing = iggy::client::Client(options);
+        compressing.sendMessages(command);
+        REQUIRE(exchange.getReceived().size() < 4096);
+
+        // polls decompress whatever the client's own setting
+        auto compressed = iggy::serialization::compression::compressMessages(command, iggy::serialization::compression::Codec::LZ4, 0);
+        exchange.serve(*compressed);
+        auto polled = exchange.poll(client);
+        REQUIRE(polled.getMessages().size() == 4);
+        REQUIRE(std::ranges::equal(polled.getMessages()[2].getPayload(), command.getMessages()[2].getPayload()));
+        REQUIRE(polled.getMessages()[2].getHeaders().empty());
+
+        options.compressionLevel = 42;
+        REQUIRE_THROWS_AS(options.validate(), std::invalid_argument);
+    }
+
+    SECTION("encrypted messages") {
+        MessageExchange exchange(*this);
+        auto command = iggy::testutil::makeBatch(makeMessages([](int) { return std::vector<unsigned char>(4096, 'x'); }));
+        auto encryptor = std::make_shared<iggy::serialization::encryption::PayloadEncryptor>();
+        encryptor->addKey("primary", iggy::serialization::encryption::PayloadEncryptor::generateKey());
+        options.encryption = encryptor;
+        auto encrypting = iggy::client::Client(options);
+        encrypting.sendMessages(command);
+        REQUIRE(exchange.getReceived().size() > 4 * 4096);
+        REQUIRE(std::ranges::search(exchange.getReceived(), std::vector<unsigned char>(64, 'x')).empty());
+
+        // sealed after compression, and opened before decompression
+        auto compressed = iggy::serialization::compression::compressMessages(command, iggy::serialization::compression::Codec::LZ4, 0);
+        auto sealed = encryptor->seal(*compressed);
+        exchange.serve(sealed);
+        auto polled = exchange.poll(encrypting);
+        REQUIRE(polled.getMessages().size() == 4);
+        REQUIRE(std::ranges::equal(polled.getMessages()[1].getPayload(), command.getMessages()[1].getPayload()));
+        REQUIRE(polled.getMessages()[1].getHeaders().empty());
+
+        // a client without the encryptor leaves them sealed
+        auto opaque = exchange.poll(client);
+        REQUIRE(opaque.getMessages()[1].getPayload().size() == sealed.getMessages()[1].getPayload().size());
+    }
+
+    SECTION("server error status") {
+        setHandler(iggy::serialization::binary::PING,
+                   [](const std::vector<unsigned char>&) { return std::make_pair(42u, std::vector<unsigned char>()); });
+        REQUIRE_THROWS_AS(client.ping(), std::runtime_error);
+    }
+}
+
+TEST_CASE_METHOD(iggy::testutil::StubQuicServer, "client QUIC connection", UT_TAG) {
+    iggy::client::Options options;
+    options.transport = iggy::net::transport::Transport::QUIC;
+    options.hostname = "localhost";
+    options.port = getQuicPort();
+    options.tlsCaCertificatePath = getCertificatePath().string();
+
+    SECTION("ping") {
+        auto client = iggy::client::Client(options);
+        REQUIRE_NOTHROW(client.ping());
+        REQUIRE(getQuicConnectionCount() == 1);
+    }
+
+    SECTION("connection pool") {
+        options.connectionCount = 3;
+        auto pooled = iggy::client::Client(options);
+        pooled.ping();
+        REQUIRE(getQuicConnectionCount() == 3);
+    }
+}
+
+TEST_CASE_METHOD(iggy::testutil::StubHttpServer, "client HTTP connection", UT_TAG) {
+    iggy::client::Options options;
+    options.transport = iggy::net::transport::Transport::HTTP;
+    options.hostname = "127.0.0.1";
+    options.port = getPort();
+
+    SECTION("ping") {
+        auto client = iggy::client::Client(options);
+        REQUIRE_NOTHROW(client.ping());
+        REQUIRE(getLastAuthorization() == fmt::format("Bearer {}", ACCESS_TOKEN));
+        REQUIRE(getHttp2ConnectionCount() == 1);
+    }
+
+    SECTION("HTTP/1.1") {
+        options.httpMultiplexing = false;
+        auto client = iggy::client::Client(options);
+        REQUIRE_NOTHROW(client.ping());
+        REQUIRE(getConnectionCount() == 1);
+        REQUIRE(getHttp2ConnectionCount() == 0);
+    }
+
+    SECTION("get stats") {
+        setHandler("GET", "/stats", [](const Request&) {
+            return std::make_pair(200, std::string(R"({"process_id": 1234, "cpu_usage": 0.5, "memory_usage": 1, "total_memory": 2,
+                "available_memory": 1, "run_time": 3, "start_time": 4, "read_bytes": 5, "written_bytes": 6, "messages_size_bytes": 7,
+                "streams_count": 1, "topics_count": 1, "partitions_count": 1, "segments_count": 1, "messages_count": 8,
+                "clients_count": 1, "consumer_groups_count": 7, "hostname": "stub", "os_name": "Linux", "os_version": "6",
+                "kernel_version": "6.1"})"));
+        });
+        auto client = iggy::client::Client(options);
+        auto stats = client.getStats();
+        REQUIRE(stats.getProcessId() == 1234);
+        REQUIRE(stats.getConsumerGroupsCount() == 7);
+        REQUIRE(stats.getHostname() == "stub");
+    }
+
+    SECTION("poll messages") {
+        std::string path;
+        setHandler("GET", "/streams/orders%20eu/topics/2/messages", [&path](const Request& request) {
+            path = request.path;
+            return std::make_pair(200, std::string(R"({"partition_id": 1, "current_offset": 0, "messages": [{"offset": 0,
+                "state": "available", "timestamp": 1, "id": 1, "checksum": 0, "headers": null, "length": 4, "payload": "c3R1Yg=="}]})"));
+        });
+        auto client = iggy::client::Client(options);
+        auto streamName = std::string("orders eu");
+        iggy::command::message::PollMessages command(
+            iggy::model::shared::Consumer(iggy::model::shared::CONSUMER, 5),
+            iggy::model::shared::Identifier(iggy::model::shared::STRING, streamName.size(), {streamName.begin(), streamName.end()}),
+            iggy::model::shared::Identifier(iggy::model::shared::NUMERIC, 4, {2, 0, 0, 0}), 1,
+            iggy::command::message::PollingStrategy(iggy::command::message::OFFSET, 0), 10, true);
+        auto polled = client.pollMessagesView(command);
+        REQUIRE(path ==
+                "/streams/orders%20eu/topics/2/messages?consumer_id=5&partition_id=1&kind=offset&value=0&count=10&auto_commit=true");
+        REQUIRE(polled.getMessages().size() == 1);
+        auto payload = polled.getMessages()[0].getPayload();
+        REQUIRE(std::string(payload.begin(), payload.end()) == "stub");
+    }
+
+    SECTION("send messages") {
+        std::string body;
+        setHandler("POST", "/streams/1/topics/orders/messages", [&body](const Request& request) {
+            body = request.body;
+            return std::make_pair(201, std::string());
+        });
+        auto client = iggy::client::Client(options);
+        std::vector<iggy::model::message::Message> messages;
+        messages.emplace_back(1, iggy::model::message::Headers(), 4, std::vector<unsigned char>{'s', 't', 'u', 'b'});
+        iggy::command::message::SendMessages command(
+            iggy::model::shared::Identifier(iggy::model::shared::NUMERIC, 4, {1, 0, 0, 0}),
+            iggy::model::shared::Identifier(iggy::model::shared::STRING, 6, {'o', 'r', 'd', 'e', 'r', 's'}),
+            iggy::command::message::Partitioning(iggy::command::message::BALANCED, 0, {}), std::move(messages));
+        REQUIRE_NOTHROW(client.sendMessages(command));
+        REQUIRE(body == R"({"partitioning":{"kind":"balanced","value":""},"messages":[{"id":1,"payload":"c3R1Yg=="}]})");
+    }
+
+    SECTION("rejected credentials") {
+        setHandler("POST", "/users/login", [](const Request&) { return std::make_pair(401, std::string()); });
+        REQUIRE_THROWS_AS(iggy::client::Client(options), std::runtime_error);
+    }
+}
+
+TEST_CASE("client connection failures", UT_TAG) {
+    iggy::client::Options options;
+    options.hostname = "127.0.0.1";
+
+    SECTION("connection refused") {
+        {
+            // grab an ephemeral port that is guaranteed to be closed once the server goes away
+            iggy::testutil::StubIggyServer server;
+            options.port = server.getPort();
+        }
+        REQUIRE_THROWS_AS(iggy::client::Client(options), std::runtime_error);
+    }
+
+    SECTION("HTTP connection refused") {
+        {
+            iggy::testutil::StubHttpServer server;
+            options.port = server.getPort();
+        }
+        options.transport = iggy::net::transport::Transport::HTTP;
+        REQUIRE_THROWS_AS(iggy::client::Client(options), std::runtime_error);
+    }
 }
@@ -0,0 +1,149 @@
+#include <fmt/format.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../sdk/compression.h"
+#include "unit_testutils.h"
+
+namespace {
+using iggy::serialization::compression::Codec;
+using iggy::testutil::makeBatch;
+using iggy::testutil::pollBack;
+
+/// @brief A JSON-like payload that compresses well, like the documents most producers send.
+std::vector<unsigned char> makeDocument(int seed) {
+    std::string document;
+    for (int i = 0; i < 64; i++) {
+        document += fmt::format(R"({{"order":{},"customer":"customer-{}","status":"shipped","items":[{{"sku":"A-{}","qty":1}}]}})",
+                                seed * 64 + i, seed, i % 7);
+    }
+    return std::vector<unsigned char>(document.begin(), document.end());
+}
+}  // namespace
+
+TEST_CASE("payload compression", UT_TAG) {
+    auto document = makeDocument(0);
+
+    SECTION("round trip") {
+        for (auto [codec, level] : {std::pair(Codec::LZ4, 0), std::pair(Codec::LZ4, 9), std::pair(Codec::ZSTD, 0),
+                                    std::pair(Codec::ZSTD, -5), std::pair(Codec::ZSTD, 19)}) {
+            auto compressed = iggy::serialization::compression::compress(codec, level, document);
+            REQUIRE(compressed.size() * 5 < document.size());
+            REQUIRE(iggy::serialization::compression::decompress(codec, compressed) == document);
+        }
+    }
+
+    SECTION("codec names") {
+        REQUIRE(iggy::serialization::compression::getCodecName(Codec::ZSTD) == "zstd");
+        REQUIRE(iggy::serialization::compression::findCodec("lz4") == Codec::LZ4);
+        REQUIRE_FALSE(iggy::serialization::compression::findCodec("gzip").has_value());
+    }
+
+    SECTION("levels") {
+        REQUIRE_NOTHROW(iggy::serialization::compression::validateLevel(Codec::LZ4, 12));
+        REQUIRE_NOTHROW(iggy::serialization::compression::validateLevel(Codec::ZSTD, -1));
+        REQUIRE_THROWS_AS(iggy::serialization::compression::validateLevel(Codec::LZ4, 13), std::invalid_argument);
+        REQUIRE_THROWS_AS(iggy::serialization::compression::validateLevel(Codec::ZSTD, 23), std::invalid_argument);
+        REQUIRE_THROWS_AS(iggy::serialization::compression::validateLevel(Codec::NONE, 1), std::invalid_argument);
+    }
+
+    SECTION("corrupt frames") {
+        for (auto codec : {Codec::LZ4, Codec::ZSTD}) {
+            auto compressed = iggy::serialization::compression::compress(codec, 0, document);
+            auto truncated = std::vector<unsigned char>(compressed.begin(), compressed.end() - 8);
+            REQUIRE_THROWS_AS(iggy::serialization::compression::decompress(codec, truncated), std::runtime_error);
+            REQUIRE_THROWS_AS(iggy::serialization::compression::decompress(codec, std::vector<unsigned char>{1, 2, 3, 4, 5, 6, 7, 8}),
+                              std::runtime_error);
+        }
+    }
+}
+
+TEST_CASE("batch compression", UT_TAG) {
+    std::vector<iggy::model::message::Message> messages;
+    for (int i = 0; i < 8; i++) {
+        iggy::model::message::Headers headers;
+        headers.emplace("source", iggy::model::message::HeaderValue(iggy::model::message::STRING, {'a', 'p', 'p'}));
+        auto document = makeDocument(i);
+        auto length = static_cast<uint32_t>(document.size());
+        messages.emplace_back(i + 1, std::move(headers), length, std::move(document));
+    }
+    // too short to gain anything from compression
+    messages.emplace_back(9, iggy::model::message::Headers(), 4, std::vector<unsigned char>{'p', 'i', 'n', 'g'});
+    auto command = makeBatch(messages);
+
+    SECTION("round trip through the server") {
+        for (auto codec : {Codec::LZ4, Codec::ZSTD}) {
+            auto compressed = *iggy::serialization::compression::compressMessages(command, codec, 0);
+            const auto& sent = compressed.getMessages();
+            REQUIRE(sent.size() == 9);
+            REQUIRE(sent[0].getPayload().size() * 5 < messages[0].getPayload().size());
+            REQUIRE(sent[0].getHeaders().at("iggy-compression").getKind() == iggy::model::message::STRING);
+            REQUIRE(sent[0].getHeaders().contains("source"));
+            REQUIRE(sent[0].getLength() == sent[0].getPayload().size());
+            REQUIRE_FALSE(sent[8].getHeaders().contains("iggy-compression"));
+            REQUIRE(sent[8].getPayload().data() == command.getMessages()[8].getPayload().data());
+
+            // already compressed messages, e.g. forwarded ones, are not compressed twice, so the batch is sent as it is
+            REQUIRE_FALSE(iggy::serialization::compression::compressMessages(compressed, codec, 0).has_value());
+
+            auto polled = iggy::serialization::compression::decompressMessages(pollBack(compressed));
+            REQUIRE(polled.getMessages().size() == 9);
+            for (size_t i = 0; i < messages.size(); i++) {
+                const auto& message = polled.getMessages()[i];
+                REQUIRE(std::ranges::equal(message.getPayload(), messages[i].getPayload()));
+                REQUIRE(message.hasValidChecksum());
+                REQUIRE_FALSE(message.findHeader("iggy-compression").has_value());
+                REQUIRE(message.getId() == i + 1);
+            }
+            auto source = polled.getMessages()[0].findHeader("source");
+            REQUIRE(source.has_value());
+            REQUIRE(source->getValue().size() == 3);
+
+            // messages borrowing from the view keep both the decompressed buffer and the original receive buffer alive
+            iggy::model::message::ArenaPool pool;
+            auto owned = polled.toPolledMessages(pool);
+            polled = iggy::model::message::PolledMessagesView(nullptr, 0, 0, {});
+            REQUIRE(std::ranges::equal(owned.getMessages()[3].getPayload(), messages[3].getPayload()));
+            REQUIRE(std::ranges::equal(owned.getMessages()[8].getPayload(), messages[8].getPayload()));
+        }
+    }
+
+    SECTION("batches that do not shrink are not copied") {
+        std::vector<iggy::model::message::Message> incompressible;
+        incompressible.push_back(messages[8]);
+        auto batch = makeBatch(std::move(incompressible));
+        REQUIRE_FALSE(iggy::serialization::compression::compressMessages(batch, Codec::LZ4, 0).has_value());
+        REQUIRE_FALSE(iggy::serialization::compression::compressMessages(command, Codec::NONE, 0).has_value());
+    }
+
+    SECTION("batches claiming too much in total are rejected") {
+        // each frame is within the per-message limit, but together they claim more than a batch may take
+        const size_t messageLimit = iggy::serialization::compression::MAX_DECOMPRESSED_LENGTH;
+        auto frame = iggy::serialization::compression::compress(Codec::ZSTD, 0, std::vector<unsigned char>(messageLimit));
+        size_t count = iggy::serialization::compression::MAX_DECOMPRESSED_BATCH_LENGTH / messageLimit + 1;
+        std::vector<iggy::model::message::Message> bombs;
+        for (size_t i = 0; i < count; i++) {
+            iggy::model::message::Headers headers;
+            headers.emplace("iggy-compression", iggy::model::message::HeaderValue(iggy::model::message::STRING, {'z', 's', 't', 'd'}));
+            bombs.emplace_back(i + 1, std::move(headers), static_cast<uint32_t>(frame.size()), frame);
+        }
+        REQUIRE_THROWS_AS(iggy::serialization::compression::decompressMessages(pollBack(makeBatch(std::move(bombs)))), std::runtime_error);
+    }
+
+    SECTION("uncompressed batches are passed through") {
+        auto polled = pollBack(command);
+        auto decompressed = iggy::serialization::compression::decompressMessages(polled);
+        REQUIRE(decompressed.getBuffer() == polled.getBuffer());
+    }
+
+    SECTION("unknown codecs are left alone") {
+        iggy::model::message::Headers headers;
+        headers.emplace("iggy-compression", iggy::model::message::HeaderValue(iggy::model::message::STRING, {'b', 'r'}));
+        std::vector<iggy::model::message::Message> unknown;
+        unknown.emplace_back(1, std::move(headers), 3, std::vector<unsigned char>{1, 2, 3});
+        auto polled = iggy::serialization::compression::decompressMessages(pollBack(makeBatch(std::move(unknown))));
+        REQUIRE(polled.getMessages()[0].findHeader("iggy-compression").has_value());
+        REQUIRE(polled.getMessages()[0].getPayload().size() == 3);
+    }
+}
@@ -6,8 +6,8 @@
 #include <vector>
 
 IggyRunner::IggyRunner() {
-    // start the Docker process with stdout redirected to parent process
-    std::vector<std::string> arguments = {"docker", "run", "-d", "--name", "iggy_test", "iggyrs/iggy:latest"};
+    // start the Docker process with stdout redirected to parent process, publishing the TCP port the client connects to
+    std::vector<std::string> arguments = {"docker", "run", "-d", "--name", "iggy_test", "-p", "8090:8090", "iggyrs/iggy:latest"};
     reproc::options options;
     options.redirect.parent = true;
     auto err = process.start(arguments, options);
@@ -0,0 +1,273 @@
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../sdk/compression.h"
+#include "../sdk/encryption.h"
+#include "unit_testutils.h"
+
+namespace {
+using iggy::serialization::encryption::Cipher;
+using iggy::serialization::encryption::PayloadEncryptor;
+using iggy::testutil::makeBatch;
+using iggy::testutil::pollBack;
+
+std::vector<iggy::model::message::Message> makeMessages(size_t count, size_t length) {
+    std::vector<iggy::model::message::Message> messages;
+    for (size_t i = 0; i < count; i++) {
+        iggy::model::message::Headers headers;
+        headers.emplace("source", iggy::model::message::HeaderValue(iggy::model::message::STRING, {'a', 'p', 'p'}));
+        std::vector<unsigned char> payload(length);
+        for (size_t j = 0; j < length; j++) {
+            payload[j] = static_cast<unsigned char>(i * 31 + j);
+        }
+        messages.emplace_back(i + 1, std::move(headers), static_cast<uint32_t>(length), std::move(payload));
+    }
+    return messages;
+}
+
+void requireOpened(const iggy::model::message::PolledMessagesView& polled, const std::vector<iggy::model::message::Message>& messages) {
+    REQUIRE(polled.getMessages().size() == messages.size());
+    for (size_t i = 0; i < messages.size(); i++) {
+        const auto& message = polled.getMessages()[i];
+        REQUIRE(std::ranges::equal(message.getPayload(), messages[i].getPayload()));
+        REQUIRE(message.hasValidChecksum());
+        REQUIRE(message.getId() == i + 1);
+        REQUIRE_FALSE(message.findHeader(iggy::serialization::encryption::CIPHER_HEADER).has_value());
+        REQUIRE_FALSE(message.findHeader(iggy::serialization::encryption::KEY_ID_HEADER).has_value());
+        REQUIRE(message.findHeader("source").has_value());
+    }
+}
+}  // namespace
+
+TEST_CASE("payload encryption", UT_TAG) {
+    auto messages = makeMessages(8, 1000);
+    auto command = makeBatch(messages);
+
+    SECTION("round trip through the server") {
+        for (auto cipher : {Cipher::XCHACHA20_POLY1305, Cipher::AES256_GCM}) {
+            if (!iggy::serialization::encryption::isAvailable(cipher)) {
+                continue;
+            }
+            PayloadEncryptor encryptor(cipher);
+            auto key = PayloadEncryptor::generateKey();
+            encryptor.addKey("primary", key);
+
+            auto sealed = encryptor.seal(command);
+            const auto& sent = sealed.getMessages();
+            REQUIRE(sent.size() == 8);
+            REQUIRE(sent[0].getPayload().size() > messages[0].getPayload().size());
+            REQUIRE_FALSE(std::ranges::equal(sent[0].getPayload().last(1000), messages[0].getPayload()));
+            auto cipherName = sent[0].getHeaders().at(iggy::serialization::encryption::CIPHER_HEADER).getValue();
+            REQUIRE(std::string(cipherName.begin(), cipherName.end()) == iggy::serialization::encryption::getCipherName(cipher));
+
+            // already sealed messages, e.g. forwarded ones, are not sealed twice
+            auto twice = encryptor.seal(sealed);
+            REQUIRE(twice.getMessages()[0].getPayload().data() == sent[0].getPayload().data());
+
+            auto polled = encryptor.open(pollBack(sealed));
+            requireOpened(polled, messages);
+
+            // messages borrowing from the view keep both the opened buffer and the original receive buffer alive
+            iggy::model::message::ArenaPool pool;
+            auto owned = polled.toPolledMessages(pool);
+            polled = iggy::model::message::PolledMessagesView(nullptr, 0, 0, {});
+            REQUIRE(std::ranges::equal(owned.getMessages()[5].getPayload(), messages[5].getPayload()));
+        }
+    }
+
+    SECTION("payloads are sealed with fresh nonces") {
+        PayloadEncryptor encryptor;
+        encryptor.addKey("primary", PayloadEncryptor::generateKey());
+        auto first = encryptor.seal(command);
+        auto second = encryptor.seal(command);
+        REQUIRE_FALSE(std::ranges::equal(first.getMessages()[0].getPayload(), second.getMessages()[0].getPayload()));
+    }
+
+    SECTION("key rotation") {
+        PayloadEncryptor encryptor;
+        encryptor.addKey("2024", PayloadEncryptor::generateKey());
+        auto old = encryptor.seal(command);
+        encryptor.addKey("2025", PayloadEncryptor::generateKey());
+        encryptor.setActiveKey("2025");
+        auto current = encryptor.seal(command);
+        auto keyId = current.getMessages()[0].getHeaders().at(iggy::serialization::encryption::KEY_ID_HEADER).getValue();
+        REQUIRE(std::string(keyId.begin(), keyId.end()) == "2025");
+
+        requireOpened(encryptor.open(pollBack(old)), messages);
+        requireOpened(encryptor.open(pollBack(current)), messages);
+
+        PayloadEncryptor rotated;
+        rotated.addKey("2025", PayloadEncryptor::generateKey());
+        REQUIRE_THROWS_AS(rotated.open(pollBack(old)), std::runtime_error);
+    }
+
+    SECTION("tampered payloads fail authentication") {
+        PayloadEncryptor encryptor;
+        encryptor.addKey("primary", PayloadEncryptor::generateKey());
+        auto sealed = encryptor.seal(command);
+        auto original = sealed.getMessages()[3].getPayload();
+        auto payload = std::vector<unsigned char>(original.begin(), original.end());
+        payload[payload.size() / 2] ^= 1;
+        std::vector<iggy::model::message::Message> tampered = sealed.getMessages();
+        tampered[3] = iggy::model::message::Message(4, tampered[3].getHeaders(), static_cast<uint32_t>(payload.size()), std::move(payload));
+        REQUIRE_THROWS_AS(encryptor.open(pollBack(makeBatch(std::move(tampered)))), std::runtime_error);
+    }
+
+    SECTION("tampered headers and moved payloads fail authentication") {
+        PayloadEncryptor encryptor;
+        encryptor.addKey("primary", PayloadEncryptor::generateKey());
+        std::vector<iggy::model::message::Message> documents;
+        for (uint128_t id = 1; id <= 2; id++) {
+            documents.emplace_back(id, iggy::model::message::Headers(), 65536, std::vector<unsigned char>(65536, 'x'));
+        }
+        auto compressed = iggy::serialization::compression::compressMessages(makeBatch(std::move(documents)),
+                                                                            iggy::serialization::compression::Codec::LZ4, 0);
+        auto sealed = encryptor.seal(*compressed);
+        auto plain = encryptor.seal(makeBatch(makeMessages(1, 100)));
+
+        // copies a sealed message into a batch of its own with another ID, codec header or payload
+        auto rebuild = [](const iggy::model::message::Message& original, uint128_t id, std::optional<std::string_view> codec,
+                          std::span<const unsigned char> payload) {
+            iggy::model::message::Headers headers;
+            for (const auto& [key, value] : original.getHeaders()) {
+                if (key.getName() != iggy::serialization::compression::CODEC_HEADER) {
+                    headers.emplace(key, value);
+                }
+            }
+            if (codec) {
+                std::vector<unsigned char> name(codec->begin(), codec->end());
+                headers.emplace(iggy::model::message::HeaderKey(iggy::serialization::compression::CODEC_HEADER),
+                                iggy::model::message::HeaderValue(iggy::model::message::STRING, name));
+            }
+            std::vector<iggy::model::message::Message> messages;
+            messages.emplace_back(id, std::move(headers), static_cast<uint32_t>(payload.size()),
+                                  std::vector<unsigned char>(payload.begin(), payload.end()));
+            return pollBack(makeBatch(std::move(messages)));
+        };
+        const auto& first = sealed.getMessages()[0];
+        REQUIRE_NOTHROW(encryptor.open(rebuild(first, 1, "lz4", first.getPayload())));
+
+        // the codec header is authenticated, so a payload cannot be made to decompress wrongly or not at all
+        REQUIRE_THROWS_AS(encryptor.open(rebuild(first, 1, "zstd", first.getPayload())), std::runtime_error);
+        REQUIRE_THROWS_AS(encryptor.open(rebuild(first, 1, std::nullopt, first.getPayload())), std::runtime_error);
+        const auto& uncompressed = plain.getMessages()[0];
+        REQUIRE_THROWS_AS(encryptor.open(rebuild(uncompressed, 1, "lz4", uncompressed.getPayload())), std::runtime_error);
+
+        // and so is the message ID, so a payload cannot be moved to another message sealed with the same key
+        REQUIRE_THROWS_AS(encryptor.open(rebuild(first, 2, "lz4", first.getPayload())), std::runtime_error);
+        REQUIRE_THROWS_AS(encryptor.open(rebuild(first, 1, "lz4", sealed.getMessages()[1].getPayload())), std::runtime_error);
+    }
+
+    SECTION("keys") {
+        PayloadEncryptor encryptor;
+        REQUIRE_THROWS_AS(encryptor.seal(command), std::invalid_argument);
+        REQUIRE_THROWS_AS(encryptor.addKey("short", std::vector<unsigned char>(16)), std::invalid_argument);
+        REQUIRE_THROWS_AS(encryptor.addKey("", PayloadEncryptor::generateKey()), std::invalid_argument);
+        encryptor.addKey("primary", PayloadEncryptor::generateKey());
+        REQUIRE_THROWS_AS(encryptor.addKey("primary", PayloadEncryptor::generateKey()), std::invalid_argument);
+        REQUIRE_THROWS_AS(encryptor.setActiveKey("missing"), std::invalid_argument);
+    }
+
+    SECTION("seal counts") {
+        PayloadEncryptor encryptor;
+        encryptor.addKey("primary", PayloadEncryptor::generateKey());
+        auto sealed = encryptor.seal(command);
+        encryptor.seal(sealed);
+        REQUIRE(encryptor.getSealCount("primary") == 8);
+        REQUIRE_THROWS_AS(encryptor.getSealCount("missing"), std::invalid_argument);
+    }
+
+    SECTION("AES-256-GCM keys stop sealing at the nonce limit") {
+        if (!iggy::serialization::encryption::isAvailable(Cipher::AES256_GCM)) {
+            return;
+        }
+        const uint64_t limit = iggy::serialization::encryption::MAX_AES256_GCM_SEALS;
+        PayloadEncryptor encryptor(Cipher::AES256_GCM);
+        encryptor.addKey("2024", PayloadEncryptor::generateKey(), limit - 12);
+        encryptor.seal(command);
+        REQUIRE(encryptor.getSealCount("2024") == limit - 4);
+
+        // a batch that does not fit is not sealed at all
+        REQUIRE_THROWS_AS(encryptor.seal(command), std::runtime_error);
+        REQUIRE(encryptor.getSealCount("2024") == limit - 4);
+        std::vector<iggy::model::message::Message> four(messages.begin(), messages.begin() + 4);
+        requireOpened(encryptor.open(pollBack(encryptor.seal(makeBatch(four)))), four);
+        REQUIRE(encryptor.getSealCount("2024") == limit);
+
+        // an exhausted key still opens what it sealed, but cannot be made active again
+        encryptor.addKey("2025", PayloadEncryptor::generateKey());
+        encryptor.setActiveKey("2025");
+        REQUIRE_THROWS_AS(encryptor.setActiveKey("2024"), std::invalid_argument);
+        REQUIRE(encryptor.seal(command).getMessages().size() == 8);
+
+        // the limit does not apply to XChaCha20-Poly1305, whose nonces are long enough to draw at random indefinitely
+        PayloadEncryptor xchacha;
+        xchacha.addKey("primary", PayloadEncryptor::generateKey(), limit);
+        REQUIRE(xchacha.seal(command).getMessages().size() == 8);
+    }
+
+    SECTION("unencrypted batches are passed through") {
+        PayloadEncryptor encryptor;
+        auto polled = pollBack(command);
+        REQUIRE(encryptor.open(polled).getBuffer() == polled.getBuffer());
+    }
+
+    SECTION("sealed after compression") {
+        PayloadEncryptor encryptor;
+        encryptor.addKey("primary", PayloadEncryptor::generateKey());
+        std::vector<iggy::model::message::Message> documents;
+        documents.emplace_back(1, iggy::model::message::Headers(), 65536, std::vector<unsigned char>(65536, 'x'));
+        auto repetitive = makeBatch(std::move(documents));
+        auto compressed = iggy::serialization::compression::compressMessages(repetitive, iggy::serialization::compression::Codec::LZ4, 0);
+        auto sealed = encryptor.seal(*compressed);
+        REQUIRE(sealed.getMessages()[0].getPayload().size() < 1024);
+
+        auto polled = iggy::serialization::compression::decompressMessages(encryptor.open(pollBack(sealed)));
+        REQUIRE(std::ranges::equal(polled.getMessages()[0].getPayload(), repetitive.getMessages()[0].getPayload()));
+        REQUIRE_FALSE(polled.getMessages()[0].findHeader(iggy::serialization::compression::CODEC_HEADER).has_value());
+    }
+}
+
+TEST_CASE("parallel payload encryption", UT_TAG) {
+    // well above the threshold, so that both directions run on the worker pool
+    auto messages = makeMessages(64, 16 * 1024);
+    auto command = makeBatch(messages);
+    PayloadEncryptor encryptor(Cipher::XCHACHA20_POLY1305, 3);
+    encryptor.addKey("primary", PayloadEncryptor::generateKey());
+
+    SECTION("round trip") {
+        auto sealed = encryptor.seal(command);
+        requireOpened(encryptor.open(pollBack(sealed)), messages);
+    }
+
+    SECTION("concurrent batches") {
+        std::vector<std::thread> threads;
+        std::vector<int> results(4, 0);
+        for (size_t t = 0; t < results.size(); t++) {
+            threads.emplace_back([&, t]() {
+                for (int round = 0; round < 4; round++) {
+                    auto opened = encryptor.open(pollBack(encryptor.seal(command)));
+                    if (std::ranges::equal(opened.getMessages()[63].getPayload(), messages[63].getPayload())) {
+                        results[t]++;
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        REQUIRE(results == std::vector<int>(4, 4));
+    }
+
+    SECTION("failures are reported once every message has been processed") {
+        auto sealed = encryptor.seal(command);
+        auto other = PayloadEncryptor(Cipher::XCHACHA20_POLY1305, 3);
+        other.addKey("primary", PayloadEncryptor::generateKey());
+        REQUIRE_THROWS_AS(other.open(pollBack(sealed)), std::runtime_error);
+        // the pool is still usable afterwards
+        requireOpened(encryptor.open(pollBack(sealed)), messages);
+    }
+}
@@ -0,0 +1,123 @@
+#include <fmt/format.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../sdk/net/http/conn.h"
+#include "unit_testutils.h"
+
+namespace {
+std::string toString(const std::vector<unsigned char>& body) {
+    return std::string(body.begin(), body.end());
+}
+}  // namespace
+
+TEST_CASE_METHOD(iggy::testutil::StubHttpServer, "HTTP connection", UT_TAG) {
+    auto baseUrl = fmt::format("http://127.0.0.1:{}", getPort());
+
+    SECTION("HTTP/2 multiplexing") {
+        iggy::net::http::HttpConnection conn(baseUrl);
+        conn.connect();
+
+        // hold up the first response so that the stub only reads the next requests once they have all been sent
+        std::atomic<bool> first = true;
+        setHandler("GET", "/ping", [&first](const Request&) {
+            if (first.exchange(false)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+            return std::make_pair(200, std::string("pong"));
+        });
+        std::vector<std::future<iggy::net::http::Response>> responses;
+        for (int i = 0; i < 100; i++) {
+            responses.push_back(conn.request(iggy::net::http::GET, "/ping"));
+        }
+        for (auto& future : responses) {
+            auto response = future.get();
+            REQUIRE(response.getStatus() == 200);
+            REQUIRE(toString(response.getBody()) == "pong");
+        }
+        REQUIRE(getRequestCount() == 101);
+        REQUIRE(getConnectionCount() == 1);
+        REQUIRE(getHttp2ConnectionCount() == 1);
+        REQUIRE(getMaxConcurrentStreams() > 1);
+    }
+
+    SECTION("HTTP/1.1 keep-alive") {
+        iggy::net::http::HttpConnection conn(baseUrl, 1, iggy::net::http::DEFAULT_MAX_STREAMS, false);
+        conn.connect();
+        for (int i = 0; i < 10; i++) {
+            REQUIRE(conn.request(iggy::net::http::GET, "/ping").get().isOk());
+        }
+        REQUIRE(getConnectionCount() == 1);
+        REQUIRE(getHttp2ConnectionCount() == 0);
+    }
+
+    SECTION("HTTP/1.1 connection limit") {
+        iggy::net::http::HttpConnection conn(baseUrl, 2, iggy::net::http::DEFAULT_MAX_STREAMS, false);
+        conn.connect();
+        std::vector<std::future<iggy::net::http::Response>> responses;
+        for (int i = 0; i < 20; i++) {
+            responses.push_back(conn.request(iggy::net::http::GET, "/ping"));
+        }
+        for (auto& future : responses) {
+            REQUIRE(future.get().isOk());
+        }
+        REQUIRE(getConnectionCount() <= 2);
+    }
+
+    SECTION("request body and access token") {
+        setHandler("POST", "/echo", [](const Request& request) { return std::make_pair(201, request.body); });
+        iggy::net::http::HttpConnection conn(baseUrl);
+        conn.connect();
+        conn.setAccessToken("secret");
+        std::string body = R"({"name":"test"})";
+        auto response = conn.request(iggy::net::http::POST, "/echo", {body.begin(), body.end()}).get();
+        REQUIRE(response.getStatus() == 201);
+        REQUIRE(toString(response.getBody()) == body);
+        REQUIRE(getLastAuthorization() == "Bearer secret");
+    }
+
+    SECTION("large response") {
+        std::string large(4 * 1024 * 1024, 'x');
+        setHandler("GET", "/large", [&large](const Request&) { return std::make_pair(200, large); });
+        iggy::net::http::HttpConnection conn(baseUrl);
+        conn.connect();
+        auto response = conn.request(iggy::net::http::GET, "/large?count=1").get();
+        REQUIRE(response.getBody().size() == large.size());
+        REQUIRE(toString(response.takeBody()) == large);
+    }
+
+    SECTION("error status") {
+        iggy::net::http::HttpConnection conn(baseUrl);
+        conn.connect();
+        auto response = conn.request(iggy::net::http::GET, "/missing").get();
+        REQUIRE(response.getStatus() == 404);
+        REQUIRE_FALSE(response.isOk());
+    }
+
+    SECTION("send after close") {
+        iggy::net::http::HttpConnection conn(baseUrl);
+        conn.connect();
+        conn.close();
+        REQUIRE_THROWS_AS(conn.request(iggy::net::http::GET, "/ping"), std::runtime_error);
+    }
+}
+
+TEST_CASE("HTTP connection failures", UT_TAG) {
+    SECTION("connection refused") {
+        uint16_t port;
+        {
+            // grab an ephemeral port that is guaranteed to be closed once the server goes away
+            iggy::testutil::StubHttpServer server;
+            port = server.getPort();
+        }
+        iggy::net::http::HttpConnection conn(fmt::format("http://127.0.0.1:{}", port));
+        REQUIRE_THROWS_AS(conn.connect(), std::runtime_error);
+    }
+
+    SECTION("empty window") {
+        REQUIRE_THROWS_AS(iggy::net::http::HttpConnection("http://127.0.0.1:3000", 1, 0), std::invalid_argument);
+    }
+}
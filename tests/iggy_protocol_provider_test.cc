@@ -30,5 +30,10 @@ TEST_CASE("Iggy protocols", UT_TAG) {
         REQUIRE(addr.getProtocol() == protocolName);
         REQUIRE(addr.getHost() == host);
         REQUIRE(addr.getPort() == port);
+        REQUIRE(addr.toString() == protocolName + "://" + host + ":" + std::to_string(port));
+    }
+
+    SECTION("canonical form fills in the default port") {
+        REQUIRE(provider.createAddress("tcp+tls://localhost").toString() == provider.createAddress("tcp+tls://localhost:8090").toString());
     }
 }
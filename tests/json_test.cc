@@ -0,0 +1,266 @@
+#include <fmt/format.h>
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "../sdk/json.h"
+#include "unit_testutils.h"
+
+namespace {
+std::vector<unsigned char> toBody(std::string_view json) {
+    return std::vector<unsigned char>(json.begin(), json.end());
+}
+
+const char STATS_JSON[] = R"({
+    "process_id": 1234, "cpu_usage": 0.5, "total_cpu_usage": 0.75, "memory_usage": 100, "total_memory": 200,
+    "available_memory": 50, "run_time": 60, "start_time": 1700000000, "read_bytes": 1024, "written_bytes": 2048,
+    "messages_size_bytes": 4096, "streams_count": 1, "topics_count": 2, "partitions_count": 3, "segments_count": 4,
+    "messages_count": 5, "clients_count": 6, "consumer_groups_count": 7, "hostname": "iggy", "os_name": "Linux",
+    "os_version": "6.1", "kernel_version": "6.1.0-café"
+})";
+
+const char TOPIC_JSON[] = R"({
+    "id": 2, "created_at": 1700000000, "name": "orders", "size_bytes": 300, "message_expiry": null,
+    "max_topic_size": 1048576, "replication_factor": 1, "messages_count": 10, "partitions_count": 2
+})";
+
+const char POLLED_JSON[] = R"({
+    "partition_id": 1,
+    "current_offset": 1,
+    "messages": [
+        {
+            "offset": 0, "state": "available", "timestamp": 1700000000000000, "id": 340282366920938463463374607431768211455,
+            "checksum": 42, "headers": {"source": {"kind": "string", "value": "c3R1Yg=="}}, "length": 5, "payload": "aGVsbG8="
+        },
+        {
+            "offset": 1, "state": "marked_for_deletion", "timestamp": 1700000000000001, "id": "7", "checksum": 43,
+            "headers": null, "length": 0, "payload": ""
+        }
+    ]
+})";
+}  // namespace
+
+TEST_CASE("JSON wire format", UT_TAG) {
+    iggy::serialization::json::JsonWireFormat format;
+
+    SECTION("stats") {
+        auto stats = format.read<iggy::model::system::Stats>(toBody(STATS_JSON));
+        REQUIRE(stats.getProcessId() == 1234);
+        REQUIRE(stats.getCpuUsage() == 0.5f);
+        REQUIRE(stats.getStartTime() == 1700000000);
+        REQUIRE(stats.getMessagesCount() == 5);
+        REQUIRE(stats.getConsumerGroupsCount() == 7);
+        REQUIRE(stats.getHostname() == "iggy");
+        REQUIRE(stats.getKernelVersion() == "6.1.0-caf\xc3\xa9");
+    }
+
+    SECTION("identity info") {
+        // the token is read from access_token only, unescaped, and never from a decoy field elsewhere in the document
+        auto identity = format.read<iggy::model::user::IdentityInfo>(toBody(
+            R"({"user_id": 1, "note": {"token": "decoy"}, "access_token": {"token": "a\"b\\c", "expiry": 1700000000}})"));
+        REQUIRE(identity.getUserId() == 1);
+        REQUIRE(identity.getAccessToken().has_value());
+        REQUIRE(identity.getAccessToken()->getToken() == "a\"b\\c");
+        REQUIRE(identity.getAccessToken()->getExpiry() == 1700000000);
+
+        auto binaryLogin = format.read<iggy::model::user::IdentityInfo>(toBody(R"({"user_id": 2, "access_token": null})"));
+        REQUIRE(binaryLogin.getUserId() == 2);
+        REQUIRE_FALSE(binaryLogin.getAccessToken().has_value());
+
+        REQUIRE_THROWS_WITH(format.read<iggy::model::user::IdentityInfo>(toBody(R"({"user_id": 3, "access_token": {"expiry": 1}})")),
+                            "JSON response has no token field");
+    }
+
+    SECTION("streams") {
+        auto streams = format.read<std::vector<iggy::model::stream::Stream>>(toBody(
+            R"([{"id": 1, "created_at": 10, "name": "first", "size_bytes": 0, "messages_count": 0, "topics_count": 0},
+                {"id": 2, "created_at": 20, "name": "second", "size_bytes": 100, "messages_count": 3, "topics_count": 1}])"));
+        REQUIRE(streams.size() == 2);
+        REQUIRE(streams[0].getName() == "first");
+        REQUIRE(streams[1].getId() == 2);
+        REQUIRE(streams[1].getMessagesCount() == 3);
+    }
+
+    SECTION("stream details") {
+        auto stream = format.read<iggy::model::stream::StreamDetails>(toBody(fmt::format(
+            R"({{"id": 1, "created_at": 10, "name": "shop", "size_bytes": 300, "messages_count": 10, "topics_count": 1, "topics": [{}]}})",
+            TOPIC_JSON)));
+        REQUIRE(stream.getName() == "shop");
+        REQUIRE(stream.getTopics().size() == 1);
+        REQUIRE(stream.getTopics()[0].getName() == "orders");
+    }
+
+    SECTION("topic details") {
+        std::string json(TOPIC_JSON);
+        json.insert(json.rfind('}'), R"(, "partitions": [
+            {"id": 1, "created_at": 10, "segments_count": 1, "current_offset": 4, "size_bytes": 150, "messages_count": 5},
+            {"id": 2, "created_at": 10, "segments_count": 1, "current_offset": 4, "size_bytes": 150, "messages_count": 5}])");
+        auto topic = format.read<iggy::model::topic::TopicDetails>(toBody(json));
+        REQUIRE(topic.getId() == 2);
+        REQUIRE_FALSE(topic.getMessageExpiry().has_value());
+        REQUIRE(topic.getMaxTopicSize() == 1048576);
+        REQUIRE(topic.getPartitionsCount() == 2);
+        REQUIRE(topic.getPartitions().size() == 2);
+        REQUIRE(topic.getPartitions()[1].getCurrentOffset() == 4);
+    }
+
+    SECTION("topics with fields left out") {
+        auto topics = format.read<std::vector<iggy::model::topic::Topic>>(toBody(
+            R"([{"id": 1, "created_at": 10, "name": "t", "size_bytes": 0, "message_expiry": 60, "replication_factor": 1,
+                 "messages_count": 0, "partitions_count": 1}])"));
+        REQUIRE(topics.size() == 1);
+        REQUIRE(topics[0].getMessageExpiry() == 60);
+        REQUIRE_FALSE(topics[0].getMaxTopicSize().has_value());
+    }
+
+    SECTION("polled messages") {
+        auto polled = format.read<iggy::model::message::PolledMessagesView>(toBody(POLLED_JSON));
+        REQUIRE(polled.getPartitionId() == 1);
+        REQUIRE(polled.getCurrentOffset() == 1);
+        const auto& messages = polled.getMessages();
+        REQUIRE(messages.size() == 2);
+
+        REQUIRE(messages[0].getId() == ~static_cast<uint128_t>(0));
+        REQUIRE(messages[0].getState() == iggy::model::message::AVAILABLE);
+        REQUIRE(messages[0].getChecksum() == 42);
+        auto payload = messages[0].getPayload();
+        REQUIRE(std::string(payload.begin(), payload.end()) == "hello");
+        auto header = messages[0].findHeader("source");
+        REQUIRE(header.has_value());
+        REQUIRE(header->getKind() == iggy::model::message::STRING);
+        REQUIRE(std::string(header->getValue().begin(), header->getValue().end()) == "stub");
+
+        REQUIRE(messages[1].getId() == 7);
+        REQUIRE(messages[1].getState() == iggy::model::message::MARKED_FOR_DELETION);
+        REQUIRE(messages[1].getPayload().empty());
+        REQUIRE_FALSE(messages[1].findHeader("source").has_value());
+
+        // headers and payloads are decoded into the one shared buffer
+        REQUIRE(polled.getBuffer()->size() == 4 + 6 + 1 + 4 + 4 + 5);
+    }
+
+    SECTION("polled messages copied out") {
+        auto polled = format.read<iggy::model::message::PolledMessages>(toBody(POLLED_JSON));
+        auto messages = polled.getMessages();
+        REQUIRE(messages.size() == 2);
+        REQUIRE(std::ranges::equal(messages[0].getPayload(), std::string_view("hello")));
+        REQUIRE(messages[0].getHeaders().at("source").getKind() == iggy::model::message::STRING);
+    }
+
+    SECTION("malformed JSON") {
+        REQUIRE_THROWS_AS(format.read<iggy::model::system::Stats>(toBody(R"({"process_id": )")), std::runtime_error);
+        REQUIRE_THROWS_AS(format.read<iggy::model::system::Stats>(toBody("")), std::runtime_error);
+        REQUIRE_THROWS_AS(format.read<std::vector<iggy::model::stream::Stream>>(toBody(R"({"id": 1})")), std::runtime_error);
+    }
+
+    SECTION("missing field") {
+        std::string json(STATS_JSON);
+        json.replace(json.find("\"hostname\""), 10, "\"host\"");
+        REQUIRE_THROWS_WITH(format.read<iggy::model::system::Stats>(toBody(json)), "JSON response has no hostname field");
+    }
+
+    SECTION("out of range") {
+        std::string json(TOPIC_JSON);
+        json.replace(json.find("\"replication_factor\": 1"), 23, "\"replication_factor\": 256");
+        REQUIRE_THROWS_AS(format.read<std::vector<iggy::model::topic::Topic>>(toBody("[" + json + "]")), std::runtime_error);
+    }
+
+    SECTION("invalid base64") {
+        std::string json(POLLED_JSON);
+        json.replace(json.find("aGVsbG8="), 8, "aGVs*G8=");
+        REQUIRE_THROWS_AS(format.read<iggy::model::message::PolledMessagesView>(toBody(json)), std::runtime_error);
+    }
+
+    SECTION("checksum verification") {
+        iggy::serialization::json::JsonWireFormat verifying(true);
+        REQUIRE_THROWS_AS(verifying.read<iggy::model::message::PolledMessagesView>(toBody(POLLED_JSON)), std::runtime_error);
+
+        // CRC-32 of "hello" and of the empty payload
+        std::string json(POLLED_JSON);
+        json.replace(json.find("\"checksum\": 42"), 14, "\"checksum\": 907060870");
+        json.replace(json.find("\"checksum\": 43"), 14, "\"checksum\": 0");
+        auto polled = verifying.read<iggy::model::message::PolledMessagesView>(toBody(json));
+        REQUIRE(polled.getMessages()[0].hasValidChecksum());
+        REQUIRE(polled.getMessages()[1].hasValidChecksum());
+    }
+
+    SECTION("unknown message state") {
+        std::string json(POLLED_JSON);
+        json.replace(json.find("\"available\""), 11, "\"expired\"");
+        REQUIRE_THROWS_AS(format.read<iggy::model::message::PolledMessagesView>(toBody(json)), std::runtime_error);
+    }
+}
+
+TEST_CASE("JSON SendMessages encoding", UT_TAG) {
+    iggy::serialization::json::JsonWireFormat format;
+    iggy::model::shared::Identifier streamId(iggy::model::shared::NUMERIC, 4, {1, 0, 0, 0});
+    iggy::model::shared::Identifier topicId(iggy::model::shared::STRING, 1, {'t'});
+
+    SECTION("layout") {
+        iggy::model::message::Headers headers;
+        headers.emplace("say \"hi\"", iggy::model::message::HeaderValue(iggy::model::message::STRING, {'s', 't', 'u', 'b'}));
+        std::vector<iggy::model::message::Message> messages;
+        messages.emplace_back(~static_cast<uint128_t>(0), headers, 5, std::vector<unsigned char>{'h', 'e', 'l', 'l', 'o'});
+        messages.emplace_back(7, iggy::model::message::Headers(), 0, std::vector<unsigned char>());
+        iggy::command::message::SendMessages command(
+            streamId, topicId, iggy::command::message::Partitioning(iggy::command::message::PARITION_ID, 4, {2, 0, 0, 0}),
+            std::move(messages));
+
+        iggy::serialization::ByteWriter out;
+        format.write(out, command);
+        REQUIRE(out.capacity() == out.size());
+        auto body = out.take();
+        REQUIRE(std::string(body.begin(), body.end()) ==
+                R"({"partitioning":{"kind":"partition_id","value":"AgAAAA=="},"messages":[)"
+                R"({"id":340282366920938463463374607431768211455,"headers":{"say \"hi\"":{"kind":"string","value":"c3R1Yg=="}},)"
+                R"("payload":"aGVsbG8="},{"id":7,"payload":""}]})");
+    }
+
+    SECTION("large payloads") {
+        std::vector<iggy::model::message::Message> messages;
+        for (int i = 0; i < 4; i++) {
+            messages.emplace_back(i, iggy::model::message::Headers(), 64 * 1024,
+                                  std::vector<unsigned char>(64 * 1024 + i, static_cast<unsigned char>(i * 51)));
+        }
+        iggy::command::message::SendMessages command(
+            streamId, topicId, iggy::command::message::Partitioning(iggy::command::message::BALANCED, 0, {}), messages);
+
+        iggy::serialization::ByteWriter out;
+        format.write(out, command);
+        REQUIRE(out.capacity() == out.size());
+
+        // read the body back as if it were a poll response, reusing the decoder's base64 handling
+        std::string body(reinterpret_cast<const char*>(out.view().data()), out.size());
+        body.replace(0, body.find("\"messages\""), R"({"partition_id":1,"current_offset":0,)");
+        size_t at = 0;
+        for (int i = 0; i < 4; i++) {
+            at = body.find(fmt::format(R"({{"id":{},)", i), at);
+            body.insert(at + 1, fmt::format(R"("offset":{},"state":"available","timestamp":0,"checksum":0,)", i));
+        }
+        auto polled = format.read<iggy::model::message::PolledMessagesView>(toBody(body));
+        REQUIRE(polled.getMessages().size() == 4);
+        for (int i = 0; i < 4; i++) {
+            auto payload = polled.getMessages()[i].getPayload();
+            REQUIRE(std::ranges::equal(payload, messages[i].getPayload()));
+        }
+    }
+
+    SECTION("forwarded message with a stale checksum") {
+        std::vector<iggy::model::message::Message> messages;
+        messages.emplace_back(1, iggy::model::message::Headers(), 5, std::vector<unsigned char>{'h', 'e', 'l', 'l', 'o'}, 0,
+                              iggy::model::message::AVAILABLE, 0, 42);
+        iggy::command::message::SendMessages command(
+            streamId, topicId, iggy::command::message::Partitioning(iggy::command::message::BALANCED, 0, {}), std::move(messages));
+        iggy::serialization::ByteWriter out;
+        format.write(out, command);
+        REQUIRE_THROWS_AS(iggy::serialization::json::JsonWireFormat(true).write(out, command), std::invalid_argument);
+    }
+
+    SECTION("empty batch") {
+        iggy::command::message::SendMessages command(
+            streamId, topicId, iggy::command::message::Partitioning(iggy::command::message::BALANCED, 0, {}), {});
+        iggy::serialization::ByteWriter out;
+        REQUIRE_THROWS_AS(format.write(out, command), std::invalid_argument);
+    }
+}
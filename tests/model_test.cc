@@ -1,7 +1,268 @@
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "../sdk/binary.h"
 #include "../sdk/model.h"
 #include "unit_testutils.h"
 
+namespace {
+// counted per thread so that allocations on the stub servers' I/O threads don't leak into a test's count
+thread_local size_t allocationCount = 0;
+}  // namespace
+
+// replaces the global allocator for the whole test binary; everything else still goes through malloc as before
+void* operator new(size_t size) {
+    allocationCount++;
+    if (void* memory = std::malloc(size == 0 ? 1 : size)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    std::free(memory);
+}
+
+// std::pmr::new_delete_resource allocates through the aligned overloads, so they are counted as well
+void* operator new(size_t size, std::align_val_t alignment) {
+    allocationCount++;
+    size_t align = static_cast<size_t>(alignment);
+    if (void* memory = std::aligned_alloc(align, (size + align - 1) / align * align)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
 TEST_CASE("model objects", UT_TAG) {
     iggy::model::system::Stats stats;
     REQUIRE(&stats != nullptr);
 }
+
+TEST_CASE("identifiers", UT_TAG) {
+    using iggy::model::shared::Identifier;
+
+    SECTION("numeric") {
+        static constexpr Identifier id = Identifier::numeric(0x01020304);
+        static_assert(id.isNumeric() && id.getLength() == 4 && id.getNumericValue() == 0x01020304);
+        REQUIRE(std::vector<unsigned char>(id.getValue().begin(), id.getValue().end()) == std::vector<unsigned char>{4, 3, 2, 1});
+        REQUIRE(Identifier(iggy::model::shared::NUMERIC, 4, {7, 0, 0, 0}).getNumericValue() == 7);
+    }
+
+    SECTION("named") {
+        static constexpr Identifier id = Identifier::named("orders");
+        static_assert(id.getKind() == iggy::model::shared::STRING && id.getLength() == 6);
+        REQUIRE(std::string(id.getValue().begin(), id.getValue().end()) == "orders");
+        REQUIRE(Identifier::named(std::string(255, 'x')).getLength() == 255);
+    }
+
+    SECTION("stored inline") {
+        STATIC_REQUIRE(std::is_trivially_copyable_v<Identifier>);
+        auto id = Identifier::named("orders");
+        auto copy = id;
+        REQUIRE(copy.getValue().data() != id.getValue().data());
+        REQUIRE(std::string(copy.getValue().begin(), copy.getValue().end()) == "orders");
+    }
+
+    SECTION("invalid values") {
+        REQUIRE_THROWS_AS(Identifier::named(""), std::invalid_argument);
+        REQUIRE_THROWS_AS(Identifier::named(std::string(256, 'x')), std::invalid_argument);
+        REQUIRE_THROWS_AS(Identifier(iggy::model::shared::NUMERIC, 2, {1, 0}), std::invalid_argument);
+        REQUIRE_THROWS_AS(Identifier(iggy::model::shared::STRING, 3, {'a', 'b'}), std::invalid_argument);
+    }
+}
+
+TEST_CASE("message headers", UT_TAG) {
+    iggy::model::message::Headers headers;
+    REQUIRE(headers.empty());
+    REQUIRE(headers.emplace("count", iggy::model::message::HeaderValue(iggy::model::message::UINT32, {7, 0, 0, 0})));
+    REQUIRE(headers.emplace("source", iggy::model::message::HeaderValue(iggy::model::message::STRING, {'s', 't', 'u', 'b'})));
+    std::vector<unsigned char> large(100, 'x');
+    REQUIRE(headers.emplace("trace", iggy::model::message::HeaderValue(iggy::model::message::RAW, large)));
+
+    SECTION("lookup") {
+        REQUIRE(headers.size() == 3);
+        REQUIRE(headers.contains("source"));
+        REQUIRE(headers.find("missing") == nullptr);
+        REQUIRE(headers.at("count").getKind() == iggy::model::message::UINT32);
+        REQUIRE(headers.at("count").getValue()[0] == 7);
+        REQUIRE(headers.at(std::string("trace")).getValue().size() == 100);
+        REQUIRE_THROWS_AS(headers.at("missing"), std::out_of_range);
+    }
+
+    SECTION("duplicate keys are ignored") {
+        REQUIRE_FALSE(headers.emplace("count", iggy::model::message::HeaderValue(iggy::model::message::UINT32, {8, 0, 0, 0})));
+        REQUIRE(headers.size() == 3);
+        REQUIRE(headers.at("count").getValue()[0] == 7);
+    }
+
+    SECTION("insertion order") {
+        std::vector<std::string> keys;
+        for (const auto& [key, value] : headers) {
+            keys.emplace_back(key.getName());
+        }
+        REQUIRE(keys == std::vector<std::string>{"count", "source", "trace"});
+    }
+
+    SECTION("small values are stored inline") {
+        // the value spans point into the header objects themselves, so copies must re-point them
+        auto copy = headers;
+        const auto& value = copy.at("count");
+        auto bytes = value.getValue();
+        REQUIRE(static_cast<const void*>(bytes.data()) >= static_cast<const void*>(&value));
+        REQUIRE(static_cast<const void*>(bytes.data()) < static_cast<const void*>(&value + 1));
+        REQUIRE(bytes[0] == 7);
+        REQUIRE(copy.at("trace").getValue().data() != headers.at("trace").getValue().data());
+    }
+
+    SECTION("compact layout") {
+        // a kind, a length, a resource pointer and 16 bytes shared by the inline value and the heap pointer; no vtable
+        STATIC_REQUIRE(sizeof(iggy::model::message::HeaderValue) == 32);
+        STATIC_REQUIRE_FALSE(std::is_polymorphic_v<iggy::model::message::HeaderKey>);
+        STATIC_REQUIRE_FALSE(std::is_polymorphic_v<iggy::model::message::HeaderValue>);
+
+        // a long value keeps its buffer through moves and assignment from the same resource
+        iggy::model::message::HeaderValue value(iggy::model::message::RAW, large);
+        const unsigned char* buffer = value.getValue().data();
+        iggy::model::message::HeaderValue moved(std::move(value));
+        REQUIRE(moved.getValue().data() == buffer);
+        iggy::model::message::HeaderValue assigned(iggy::model::message::UINT32, {1, 0, 0, 0});
+        assigned = std::move(moved);
+        REQUIRE(assigned.getValue().data() == buffer);
+        assigned = headers.at("count");
+        REQUIRE(assigned.getKind() == iggy::model::message::UINT32);
+        REQUIRE(assigned.getValue()[0] == 7);
+    }
+
+    SECTION("arena allocation") {
+        // the arena has no upstream, so anything that does not fit in the buffer fails loudly instead of using the heap
+        std::array<std::byte, 4096> buffer;
+        std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+        auto inArena = [&buffer](const void* pointer) {
+            return pointer >= static_cast<const void*>(buffer.data()) && pointer < static_cast<const void*>(buffer.data() + buffer.size());
+        };
+        iggy::model::message::Headers arenaHeaders{std::pmr::polymorphic_allocator<iggy::model::message::Header>(&arena)};
+        std::string longKey(40, 'k');
+        arenaHeaders.emplace(iggy::model::message::HeaderKey(longKey, &arena),
+                             iggy::model::message::HeaderValue(iggy::model::message::RAW, large, &arena));
+        REQUIRE(inArena(arenaHeaders.begin()->key.data()));
+        REQUIRE(inArena(arenaHeaders.at(longKey).getValue().data()));
+
+        auto copy = arenaHeaders;
+        REQUIRE_FALSE(inArena(copy.begin()->key.data()));
+        REQUIRE_FALSE(inArena(copy.at(longKey).getValue().data()));
+        REQUIRE(std::ranges::equal(copy.at(longKey).getValue(), large));
+    }
+}
+
+TEST_CASE("model accessors do not copy", UT_TAG) {
+    auto payload =
+        std::make_shared<const std::vector<unsigned char>>(iggy::testutil::StubIggyServer::encodePolledMessages(100, 4096));
+    auto polled = iggy::serialization::binary::BinaryWireFormat()
+                      .read<iggy::model::message::PolledMessagesView>(payload)
+                      .toPolledMessages();
+
+    SECTION("iterating a polled batch") {
+        size_t before = allocationCount;
+        size_t bytes = 0;
+        for (const auto& message : polled.getMessages()) {
+            bytes += message.getPayload().size() + message.getHeaders().at("source").getValue().size();
+        }
+        REQUIRE(allocationCount == before);
+        REQUIRE(bytes == 100 * (4096 + 4));
+    }
+
+    SECTION("taking the messages out of a batch") {
+        const unsigned char* first = polled.getMessages()[0].getPayload().data();
+        size_t before = allocationCount;
+        auto messages = polled.takeMessages();
+        auto body = messages[0].takePayload();
+        REQUIRE(allocationCount == before);
+        REQUIRE(body.data() == first);
+        REQUIRE(polled.getMessages().empty());
+        REQUIRE(messages[0].getPayload().empty());
+    }
+}
+
+TEST_CASE("polled batches decoded into an arena", UT_TAG) {
+    auto payload =
+        std::make_shared<const std::vector<unsigned char>>(iggy::testutil::StubIggyServer::encodePolledMessages(100, 64));
+    auto view = iggy::serialization::binary::BinaryWireFormat().read<iggy::model::message::PolledMessagesView>(payload);
+    iggy::model::message::ArenaPool pool;
+
+    SECTION("allocations per batch") {
+        size_t before = allocationCount;
+        auto heap = view.toPolledMessages();
+        size_t heapAllocations = allocationCount - before;
+
+        before = allocationCount;
+        auto first = view.toPolledMessages(pool);
+        size_t coldAllocations = allocationCount - before;
+        REQUIRE(pool.getPooledCount() == 0);
+        first = iggy::model::message::PolledMessages(0, 0, {});
+        REQUIRE(pool.getPooledCount() == 1);
+
+        before = allocationCount;
+        auto second = view.toPolledMessages(pool);
+        size_t warmAllocations = allocationCount - before;
+        REQUIRE(pool.getPooledCount() == 0);
+
+        // a payload and a header array per message on the heap, against the message array and a few blocks in total
+        REQUIRE(heapAllocations >= 200);
+        REQUIRE(coldAllocations <= 5);
+        REQUIRE(warmAllocations < coldAllocations);
+        REQUIRE(std::ranges::equal(second.getMessages()[42].getPayload(), heap.getMessages()[42].getPayload()));
+    }
+
+    SECTION("messages outlive the batch") {
+        auto polled = view.toPolledMessages(pool);
+        const unsigned char* borrowed = polled.getMessages()[7].getPayload().data();
+        REQUIRE(borrowed >= payload->data());
+        REQUIRE(borrowed < payload->data() + payload->size());
+
+        auto copy = polled.getMessages()[7];
+        iggy::model::message::Message assigned(1, iggy::model::message::Headers(), 0, {});
+        assigned = polled.getMessages()[8];
+        auto messages = polled.takeMessages();
+        auto kept = std::move(messages[9]);
+        auto headers = messages[10].takeHeaders();
+        messages.clear();
+        view = iggy::model::message::PolledMessagesView(nullptr, 0, 0, {});
+        payload.reset();
+        REQUIRE(pool.getPooledCount() == 0);
+
+        REQUIRE(copy.getPayload().data() == borrowed);
+        REQUIRE(copy.hasValidChecksum());
+        REQUIRE(copy.getHeaders().at("source").getValue().size() == 4);
+        REQUIRE(assigned.getOffset() == 8);
+        REQUIRE(assigned.getPayload()[0] == 8);
+        REQUIRE(kept.getHeaders().contains("source"));
+        REQUIRE(headers.emplace("extra", iggy::model::message::HeaderValue(iggy::model::message::RAW, std::vector<unsigned char>(64))));
+
+        copy = assigned;
+        assigned = iggy::model::message::Message(1, iggy::model::message::Headers(), 0, {});
+        kept = copy;
+        REQUIRE(kept.getPayload()[0] == 8);
+        copy = assigned;
+        kept = assigned;
+        REQUIRE(pool.getPooledCount() == 1);
+    }
+}
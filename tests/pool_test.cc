@@ -0,0 +1,49 @@
+#include <set>
+#include <thread>
+#include <vector>
+#include "../sdk/net/pool.h"
+#include "../sdk/net/tcp/conn.h"
+#include "unit_testutils.h"
+
+TEST_CASE_METHOD(iggy::testutil::StubIggyServer, "connection pool", UT_TAG) {
+    auto factory = [this]() { return std::make_unique<iggy::net::tcp::TcpConnection>("127.0.0.1", getPort()); };
+
+    SECTION("connects every connection") {
+        iggy::net::conn::ConnectionPool pool(4, iggy::net::conn::ConnectionAffinity::THREAD, factory);
+        pool.connect();
+        REQUIRE(pool.size() == 4);
+        for (size_t i = 0; i < pool.size(); i++) {
+            REQUIRE(pool.at(i).send(iggy::serialization::binary::PING, {}).get().isOk());
+        }
+        REQUIRE(getConnectionCount() == 4);
+    }
+
+    SECTION("thread affinity is stable and spreads threads") {
+        iggy::net::conn::ConnectionPool pool(4, iggy::net::conn::ConnectionAffinity::THREAD, factory);
+        pool.connect();
+        REQUIRE(&pool.select() == &pool.select());
+
+        std::vector<iggy::net::conn::Connection*> selected(4);
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < 4; i++) {
+            threads.emplace_back([&pool, &selected, i]() {
+                selected[i] = &pool.select();
+                pool.send(iggy::serialization::binary::PING, {}).get();
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        REQUIRE(std::set<iggy::net::conn::Connection*>(selected.begin(), selected.end()).size() == 4);
+    }
+
+    SECTION("CPU affinity") {
+        iggy::net::conn::ConnectionPool pool(2, iggy::net::conn::ConnectionAffinity::CPU, factory);
+        pool.connect();
+        REQUIRE(pool.send(iggy::serialization::binary::PING, {}).get().isOk());
+    }
+
+    SECTION("empty pool rejected") {
+        REQUIRE_THROWS_AS(iggy::net::conn::ConnectionPool(0, iggy::net::conn::ConnectionAffinity::THREAD, factory), std::invalid_argument);
+    }
+}
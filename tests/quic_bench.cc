@@ -0,0 +1,50 @@
+#include <unordered_map>
+#include <vector>
+#include "../sdk/client.h"
+#include "unit_testutils.h"
+
+namespace {
+iggy::command::message::SendMessages makeSendMessages(int count, size_t payloadSize) {
+    std::vector<iggy::model::message::Message> messages;
+    for (int i = 0; i < count; i++) {
+        messages.emplace_back(i, iggy::model::message::Headers(), payloadSize,
+                              std::vector<unsigned char>(payloadSize, static_cast<unsigned char>(i)));
+    }
+    return iggy::command::message::SendMessages(iggy::model::shared::Identifier(iggy::model::shared::NUMERIC, 4, {1, 0, 0, 0}),
+                                                iggy::model::shared::Identifier(iggy::model::shared::NUMERIC, 4, {1, 0, 0, 0}),
+                                                iggy::command::message::Partitioning(iggy::command::message::BALANCED, 0, {}),
+                                                std::move(messages));
+}
+}  // namespace
+
+// the stub answers packet by packet either way, so this measures what batching saves on the client's side of the link
+TEST_CASE_METHOD(iggy::testutil::StubQuicServer, "QUIC datagram batching", BENCH_TAG) {
+    setHandler(iggy::serialization::binary::SEND_MESSAGES,
+               [](const std::vector<unsigned char>&) { return std::make_pair(0u, std::vector<unsigned char>()); });
+    setHandler(iggy::serialization::binary::POLL_MESSAGES, [](const std::vector<unsigned char>&) {
+        return std::make_pair(0u, iggy::testutil::StubIggyServer::encodePolledMessages(1024, 4096));
+    });
+    auto command = makeSendMessages(1024, 4096);
+    iggy::command::message::PollMessages poll(iggy::model::shared::Consumer(iggy::model::shared::CONSUMER, 1),
+                                              iggy::model::shared::Identifier(iggy::model::shared::NUMERIC, 4, {1, 0, 0, 0}),
+                                              iggy::model::shared::Identifier(iggy::model::shared::NUMERIC, 4, {1, 0, 0, 0}), 1,
+                                              iggy::command::message::PollingStrategy(iggy::command::message::NEXT, 0), 1024, false);
+
+    iggy::client::Options options;
+    options.transport = iggy::net::transport::Transport::QUIC;
+    options.hostname = "localhost";
+    options.port = getQuicPort();
+    options.tlsCaCertificatePath = getCertificatePath().string();
+
+    options.quicBatchedIo = GENERATE(true, false);
+    std::string name = options.quicBatchedIo ? "batched" : "unbatched";
+    auto client = iggy::client::Client(options);
+
+    BENCHMARK(name + ": send 4MB of messages") {
+        client.sendMessages(command);
+    };
+
+    BENCHMARK(name + ": poll 4MB of messages") {
+        return client.pollMessages(poll).getMessages().size();
+    };
+}
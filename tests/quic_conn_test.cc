@@ -0,0 +1,192 @@
+#include <fmt/format.h>
+#include <chrono>
+#include <future>
+#include <string>
+#include <vector>
+#include "../sdk/net/crypto/ssl.h"
+#include "../sdk/net/iggy.h"
+#include "../sdk/net/quic/conn.h"
+#include "unit_testutils.h"
+
+namespace {
+/// @brief Outlives every address created from it, which keep a pointer back to it.
+const iggy::net::IggyProtocolProvider protocolProvider;
+
+/// @brief Client TLS setup trusting the stub server's self-signed certificate, as the client builds it for QUIC.
+struct QuicClientTls {
+    iggy::ssl::SSLOptions<WOLFSSL_CTX*> sslOptions;
+    iggy::crypto::CertificateAuthority<WOLFSSL_CTX*> certAuth;
+    iggy::crypto::PKIEnvironment<WOLFSSL_CTX*> pkiEnv;
+    iggy::ssl::SSLContext<WOLFSSL_CTX*> context;
+    iggy::net::address::LogicalAddress address;
+
+    QuicClientTls(const std::filesystem::path& caPath, const std::string& host, uint16_t port)
+        : certAuth(caPath, nullptr)
+        , pkiEnv(certAuth)
+        , context(sslOptions, pkiEnv)
+        , address(protocolProvider.createAddress(fmt::format("quic://{}:{}", host, port))) {
+        this->pkiEnv.configure(this->context.getNativeHandle(), this->pkiEnv);
+        iggy::net::quic::configureClientContext(this->context);
+    }
+
+    iggy::net::tcp::TlsEndpoint endpoint() { return iggy::net::tcp::TlsEndpoint{this->context, this->address}; }
+};
+}  // namespace
+
+TEST_CASE_METHOD(iggy::testutil::StubQuicServer, "QUIC connection", UT_TAG) {
+    QuicClientTls tls(getCertificatePath(), "localhost", getQuicPort());
+    iggy::net::quic::QuicConnection conn("localhost", getQuicPort(), tls.endpoint());
+    conn.connect();
+    REQUIRE(getQuicConnectionCount() == 1);
+
+    SECTION("single round trip") {
+        auto response = conn.send(iggy::serialization::binary::PING, {}).get();
+        REQUIRE(response.isOk());
+        REQUIRE(response.getPayload().empty());
+    }
+
+    SECTION("request payload delivered intact") {
+        setHandler(iggy::serialization::binary::GET_CLIENT,
+                   [](const std::vector<unsigned char>& payload) { return std::make_pair(0u, payload); });
+        std::vector<unsigned char> payload = {1, 2, 3, 4};
+        auto response = conn.send(iggy::serialization::binary::GET_CLIENT, payload).get();
+        REQUIRE(response.getPayload() == payload);
+    }
+
+    SECTION("large response split across packets") {
+        setHandler(iggy::serialization::binary::GET_STREAMS, [](const std::vector<unsigned char>&) {
+            return std::make_pair(0u, std::vector<unsigned char>(4 * 1024 * 1024, 0x5a));
+        });
+        auto response = conn.send(iggy::serialization::binary::GET_STREAMS, {}).get();
+        REQUIRE(response.getPayload().size() == 4 * 1024 * 1024);
+        REQUIRE(response.getPayload().back() == 0x5a);
+    }
+
+    SECTION("more queued requests than streams in flight") {
+        std::vector<std::future<iggy::net::conn::Response>> futures;
+        for (int i = 0; i < 100; i++) {
+            futures.push_back(conn.send(iggy::serialization::binary::PING, {}));
+        }
+        for (auto& future : futures) {
+            REQUIRE(future.get().isOk());
+        }
+        REQUIRE(getRequestCount() == 100);
+    }
+
+    SECTION("large request interleaved with small ones") {
+        setHandler(iggy::serialization::binary::SEND_MESSAGES, [](const std::vector<unsigned char>& payload) {
+            return std::make_pair(0u, std::vector<unsigned char>{payload.front(), payload.back()});
+        });
+        std::vector<unsigned char> large(2 * 1024 * 1024, 0x33);
+        large.front() = 0x11;
+        auto send = conn.send(iggy::serialization::binary::SEND_MESSAGES, large);
+        std::vector<std::future<iggy::net::conn::Response>> pings;
+        for (int i = 0; i < 10; i++) {
+            pings.push_back(conn.send(iggy::serialization::binary::PING, {}));
+        }
+        for (auto& ping : pings) {
+            REQUIRE(ping.get().isOk());
+        }
+        REQUIRE(send.get().getPayload() == std::vector<unsigned char>{0x11, 0x33});
+    }
+
+    SECTION("oversized response length fails the request") {
+        setAnnouncedLength(iggy::serialization::binary::GET_STREAMS, iggy::net::tcp::MAX_RESPONSE_SIZE + 1);
+        auto response = conn.send(iggy::serialization::binary::GET_STREAMS, {});
+        REQUIRE(response.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+        REQUIRE_THROWS_AS(response.get(), std::runtime_error);
+    }
+
+    SECTION("response cut short of its announced length") {
+        // within the limit, but the data never comes; a full window of such streams reserves 1 MiB each rather than the
+        // 8 GiB announced in total, and every one of them fails once its stream closes
+        setAnnouncedLength(iggy::serialization::binary::GET_STREAMS, iggy::net::tcp::MAX_RESPONSE_SIZE);
+        std::vector<std::future<iggy::net::conn::Response>> responses;
+        for (int i = 0; i < 32; i++) {
+            responses.push_back(conn.send(iggy::serialization::binary::GET_STREAMS, {}));
+        }
+        for (auto& response : responses) {
+            REQUIRE_THROWS_AS(response.get(), std::runtime_error);
+        }
+    }
+
+    SECTION("send after close") {
+        conn.close();
+        REQUIRE_THROWS_AS(conn.send(iggy::serialization::binary::PING, {}), std::runtime_error);
+    }
+}
+
+TEST_CASE_METHOD(iggy::testutil::StubQuicServer, "QUIC connection failures", UT_TAG) {
+    SECTION("server name does not match the certificate") {
+        QuicClientTls tls(getCertificatePath(), "example.com", getQuicPort());
+        iggy::net::quic::QuicConnection conn("localhost", getQuicPort(), tls.endpoint());
+        REQUIRE_THROWS_AS(conn.connect(), std::runtime_error);
+    }
+
+    SECTION("empty window rejected") {
+        QuicClientTls tls(getCertificatePath(), "localhost", getQuicPort());
+        REQUIRE_THROWS_AS(iggy::net::quic::QuicConnection("localhost", getQuicPort(), tls.endpoint(), 0), std::invalid_argument);
+    }
+}
+
+TEST_CASE_METHOD(iggy::testutil::StubQuicServer, "QUIC session resumption", UT_TAG) {
+    QuicClientTls tls(getCertificatePath(), "localhost", getQuicPort());
+    {
+        iggy::net::quic::QuicConnection first("localhost", getQuicPort(), tls.endpoint());
+        first.connect();
+        REQUIRE(first.send(iggy::serialization::binary::PING, {}).get().isOk());
+        REQUIRE_FALSE(first.isSessionResumed());
+    }
+    REQUIRE(tls.context.getSessionCache().size() == 1);
+
+    SECTION("abbreviated handshake without early data") {
+        iggy::net::quic::QuicConnection conn("localhost", getQuicPort(), tls.endpoint());
+        conn.connect();
+        REQUIRE(conn.send(iggy::serialization::binary::PING, {}).get().isOk());
+        REQUIRE(conn.isSessionResumed());
+        REQUIRE_FALSE(conn.isEarlyDataAccepted());
+        REQUIRE(getEarlyRequestCount() == 0);
+    }
+
+    SECTION("replay-safe commands in the first flight") {
+        setHandler(iggy::serialization::binary::GET_CLIENT,
+                   [](const std::vector<unsigned char>& payload) { return std::make_pair(0u, payload); });
+        iggy::net::quic::QuicConnection conn("localhost", getQuicPort(), tls.endpoint(), iggy::net::quic::DEFAULT_MAX_IN_FLIGHT,
+                                             {iggy::serialization::binary::PING});
+        conn.connect();
+        auto ping = conn.send(iggy::serialization::binary::PING, {});
+        auto echo = conn.send(iggy::serialization::binary::GET_CLIENT, {7});
+        REQUIRE(ping.get().isOk());
+        REQUIRE(echo.get().getPayload() == std::vector<unsigned char>{7});
+        REQUIRE(conn.isSessionResumed());
+        REQUIRE(conn.isEarlyDataAccepted());
+        REQUIRE(getEarlyRequestCount() == 1);
+    }
+
+    SECTION("rejected early data is sent again") {
+        auto requestsBefore = getRequestCount();
+        setHandler(iggy::serialization::binary::GET_CLIENT,
+                   [](const std::vector<unsigned char>& payload) { return std::make_pair(0u, payload); });
+        setEarlyDataAccepted(false);
+        iggy::net::quic::QuicConnection conn("localhost", getQuicPort(), tls.endpoint(), iggy::net::quic::DEFAULT_MAX_IN_FLIGHT,
+                                             {iggy::serialization::binary::PING, iggy::serialization::binary::GET_CLIENT});
+        conn.connect();
+        std::vector<std::future<iggy::net::conn::Response>> responses;
+        for (unsigned char i = 0; i < 4; i++) {
+            responses.push_back(conn.send(iggy::serialization::binary::PING, {}));
+            responses.push_back(conn.send(iggy::serialization::binary::GET_CLIENT, {i}));
+        }
+        for (size_t i = 0; i < responses.size(); i++) {
+            auto response = responses[i].get();
+            REQUIRE(response.isOk());
+            if (i % 2 == 1) {
+                REQUIRE(response.getPayload() == std::vector<unsigned char>{static_cast<unsigned char>(i / 2)});
+            }
+        }
+        REQUIRE(conn.isSessionResumed());
+        REQUIRE_FALSE(conn.isEarlyDataAccepted());
+        REQUIRE(getEarlyRequestCount() == 0);
+        // the server could not read the early data, so every request reached it exactly once, after the handshake
+        REQUIRE(getRequestCount() == requestsBefore + 8);
+    }
+}
@@ -0,0 +1,91 @@
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../sdk/base64.h"
+#include "../sdk/binary.h"
+#include "../sdk/json.h"
+#include "unit_testutils.h"
+
+namespace {
+iggy::model::shared::Identifier numericId(unsigned char id) {
+    return iggy::model::shared::Identifier(iggy::model::shared::NUMERIC, 4, {id, 0, 0, 0});
+}
+
+template <typename T>
+void benchmarkEncode(const std::string& name, const T& command) {
+    iggy::serialization::binary::BinaryWireFormat wireFormat;
+    BENCHMARK(name + ": encode") {
+        iggy::serialization::ByteWriter out;
+        wireFormat.write(out, command);
+        return out.take();
+    };
+}
+}  // namespace
+
+TEST_CASE("binary command encoding", BENCH_TAG) {
+    iggy::model::shared::Identifier topicName(iggy::model::shared::STRING, 6, {'o', 'r', 'd', 'e', 'r', 's'});
+    iggy::model::shared::Consumer consumer(iggy::model::shared::CONSUMER, 1);
+
+    benchmarkEncode("GetClient", iggy::command::system::GetClient(42));
+    benchmarkEncode("GetStream", iggy::command::stream::GetStream(numericId(1)));
+    benchmarkEncode("CreateTopic", iggy::command::topic::CreateTopic(numericId(1), 2, 8, std::nullopt, "orders"));
+    iggy::command::message::PollingStrategy next(iggy::command::message::NEXT, 0);
+    benchmarkEncode("PollMessages", iggy::command::message::PollMessages(consumer, numericId(1), topicName, 1, next, 100, true));
+    benchmarkEncode("StoreConsumerOffset", iggy::command::consumeroffset::StoreConsumerOffset(consumer, numericId(1), topicName, 1, 1000));
+    benchmarkEncode("JoinConsumerGroup", iggy::command::consumergroup::JoinConsumerGroup(numericId(1), topicName, 3));
+
+    std::vector<iggy::model::message::Message> messages;
+    for (int i = 0; i < 100; i++) {
+        iggy::model::message::Headers headers;
+        headers.emplace("source", iggy::model::message::HeaderValue(iggy::model::message::STRING, {'b', 'e', 'n', 'c', 'h'}));
+        messages.emplace_back(i, headers, 256, std::vector<unsigned char>(256, static_cast<unsigned char>(i)));
+    }
+    iggy::command::message::SendMessages sendMessages(numericId(1), topicName,
+                                                      iggy::command::message::Partitioning(iggy::command::message::BALANCED, 0, {}),
+                                                      std::move(messages));
+    iggy::serialization::binary::BinaryWireFormat wireFormat;
+    BENCHMARK("SendMessages: encode 100 x 256B with a header") {
+        iggy::serialization::binary::GatherBuffer out;
+        wireFormat.write(out, sendMessages);
+        return out.size();
+    };
+}
+
+TEST_CASE("JSON versus binary SendMessages encoding", BENCH_TAG) {
+    iggy::model::shared::Identifier topicName(iggy::model::shared::STRING, 6, {'o', 'r', 'd', 'e', 'r', 's'});
+    std::vector<iggy::model::message::Message> messages;
+    for (int i = 0; i < 16; i++) {
+        iggy::model::message::Headers headers;
+        headers.emplace("source", iggy::model::message::HeaderValue(iggy::model::message::STRING, {'b', 'e', 'n', 'c', 'h'}));
+        messages.emplace_back(i, headers, 64 * 1024, std::vector<unsigned char>(64 * 1024, static_cast<unsigned char>(i)));
+    }
+    iggy::command::message::SendMessages sendMessages(numericId(1), topicName,
+                                                      iggy::command::message::Partitioning(iggy::command::message::BALANCED, 0, {}),
+                                                      std::move(messages));
+
+    iggy::serialization::binary::BinaryWireFormat binaryFormat;
+    BENCHMARK("SendMessages: binary, 16 x 64KB gathered") {
+        iggy::serialization::binary::GatherBuffer out;
+        binaryFormat.write(out, sendMessages);
+        return out.size();
+    };
+    BENCHMARK("SendMessages: binary, 16 x 64KB flattened") {
+        iggy::serialization::binary::GatherBuffer out;
+        binaryFormat.write(out, sendMessages);
+        return out.flatten();
+    };
+
+    iggy::serialization::json::JsonWireFormat jsonFormat;
+    BENCHMARK("SendMessages: JSON, 16 x 64KB") {
+        iggy::serialization::ByteWriter out;
+        jsonFormat.write(out, sendMessages);
+        return out.take();
+    };
+
+    std::vector<unsigned char> payload(64 * 1024, 0x5a);
+    std::string encoded(iggy::serialization::base64::encodedLength(payload.size()), '\0');
+    BENCHMARK("base64: encode 64KB") {
+        iggy::serialization::base64::encode(payload.data(), payload.size(), encoded.data());
+        return encoded.size();
+    };
+}
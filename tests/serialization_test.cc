@@ -1,3 +1,10 @@
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <string_view>
+#include "../sdk/base64.h"
+#include "../sdk/binary.h"
+#include "../sdk/crc32.h"
 #include "../sdk/serialization.h"
 #include "unit_testutils.h"
 
@@ -13,4 +20,378 @@ TEST_CASE("serialization utilities", UT_TAG) {
         auto utf8 = iggy::serialization::convertToUTF8("hello \x80 world", false);
         REQUIRE(utf8 == "hello ? world");
     }
+    SECTION("multi-byte sequences") {
+        REQUIRE(iggy::serialization::isValidUTF8("caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80"));
+        REQUIRE_FALSE(iggy::serialization::isValidUTF8("\xc0\xaf"));
+        REQUIRE_FALSE(iggy::serialization::isValidUTF8("\xe0\x80\xaf"));
+        REQUIRE_FALSE(iggy::serialization::isValidUTF8("\xed\xa0\x80"));
+        REQUIRE_FALSE(iggy::serialization::isValidUTF8("\xf4\x90\x80\x80"));
+        REQUIRE_FALSE(iggy::serialization::isValidUTF8("\xe2\x82"));
+    }
+    SECTION("embedded NULs") {
+        std::string value("a\0b\x80", 4);
+        REQUIRE(iggy::serialization::isValidUTF8(std::string_view(value.data(), 3)));
+        REQUIRE(iggy::serialization::convertToUTF8(value, false) == std::string("a\0b?", 4));
+    }
+    SECTION("truncated sequence repaired byte by byte") {
+        REQUIRE(iggy::serialization::convertToUTF8("ab\xe2\x82", false) == "ab??");
+    }
+    SECTION("invalid byte found at any offset in long strings") {
+        for (size_t offset = 0; offset < 100; offset++) {
+            std::string value(100, 'x');
+            value[offset] = '\xff';
+            REQUIRE_FALSE(iggy::serialization::isValidUTF8(value));
+            auto repaired = iggy::serialization::convertToUTF8(value, false);
+            REQUIRE(repaired.size() == 100);
+            REQUIRE(repaired[offset] == '?');
+        }
+        REQUIRE(iggy::serialization::isValidUTF8(std::string(100, 'x') + "\xc3\xa9" + std::string(100, 'y')));
+    }
+}
+
+TEST_CASE("byte buffers", UT_TAG) {
+    iggy::serialization::ByteWriter out;
+    out.writeLittleEndian<uint8_t>(0x01);
+    out.writeLittleEndian<uint32_t>(0x05040302);
+    out.writeLittleEndian<uint64_t>(0x0d0c0b0a09080706);
+    out.writeBytes(reinterpret_cast<const unsigned char*>("xyz"), 3);
+    REQUIRE(out.size() == 16);
+    auto bytes = out.take();
+    REQUIRE(out.size() == 0);
+
+    SECTION("little-endian layout") {
+        REQUIRE(bytes == std::vector<unsigned char>{1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 'x', 'y', 'z'});
+    }
+
+    SECTION("round trip") {
+        iggy::serialization::ByteReader in(bytes);
+        REQUIRE(in.readLittleEndian<uint8_t>() == 0x01);
+        REQUIRE(in.readLittleEndian<uint32_t>() == 0x05040302);
+        REQUIRE(in.readLittleEndian<uint64_t>() == 0x0d0c0b0a09080706);
+        REQUIRE(in.remaining() == 3);
+        auto tail = in.take(3);
+        REQUIRE(tail.data() == bytes.data() + 13);
+        REQUIRE(in.atEnd());
+    }
+
+    SECTION("reads past the end") {
+        iggy::serialization::ByteReader in(bytes);
+        in.take(14);
+        REQUIRE_THROWS_AS(in.readLittleEndian<uint32_t>(), std::runtime_error);
+        REQUIRE_THROWS_AS(in.take(3), std::runtime_error);
+        REQUIRE(in.remaining() == 2);
+    }
+}
+
+TEST_CASE("base64", UT_TAG) {
+    auto encode = [](std::string_view data) {
+        std::string encoded(iggy::serialization::base64::encodedLength(data.size()), '\0');
+        iggy::serialization::base64::encode(reinterpret_cast<const unsigned char*>(data.data()), data.size(), encoded.data());
+        return encoded;
+    };
+
+    SECTION("RFC 4648 test vectors") {
+        REQUIRE(encode("") == "");
+        REQUIRE(encode("f") == "Zg==");
+        REQUIRE(encode("fo") == "Zm8=");
+        REQUIRE(encode("foo") == "Zm9v");
+        REQUIRE(encode("foob") == "Zm9vYg==");
+        REQUIRE(encode("fooba") == "Zm9vYmE=");
+        REQUIRE(encode("foobar") == "Zm9vYmFy");
+    }
+
+    SECTION("round trip across the vector block sizes") {
+        // lengths around 12 and 24 bytes exercise the hand-over from the vector loops to the scalar tail
+        for (size_t length = 0; length < 100; length++) {
+            std::string data(length, '\0');
+            for (size_t i = 0; i < length; i++) {
+                data[i] = static_cast<char>(i * 37 + length);
+            }
+            auto encoded = encode(data);
+            std::string decoded(iggy::serialization::base64::decodedLength(encoded), '\0');
+            iggy::serialization::base64::decode(encoded, reinterpret_cast<unsigned char*>(decoded.data()));
+            REQUIRE(decoded == data);
+        }
+    }
+
+    SECTION("every alphabet character") {
+        const std::string alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::string decoded(iggy::serialization::base64::decodedLength(alphabet), '\0');
+        iggy::serialization::base64::decode(alphabet, reinterpret_cast<unsigned char*>(decoded.data()));
+        REQUIRE(encode(decoded) == alphabet);
+    }
+
+    SECTION("invalid input") {
+        unsigned char out[8];
+        REQUIRE_THROWS_AS(iggy::serialization::base64::decodedLength("abc"), std::runtime_error);
+        REQUIRE_THROWS_AS(iggy::serialization::base64::decode("ab*d", out), std::runtime_error);
+        REQUIRE_THROWS_AS(iggy::serialization::base64::decode("a===", out), std::runtime_error);
+    }
+}
+
+TEST_CASE("CRC-32", UT_TAG) {
+    auto checksum = [](std::string_view data) {
+        return iggy::serialization::crc32::checksum(reinterpret_cast<const unsigned char*>(data.data()), data.size());
+    };
+
+    SECTION("check values") {
+        REQUIRE(checksum("") == 0);
+        REQUIRE(checksum("a") == 0xe8b7be43);
+        REQUIRE(checksum("123456789") == 0xcbf43926);
+        REQUIRE(checksum("The quick brown fox jumps over the lazy dog") == 0x414fa339);
+    }
+
+    SECTION("folded lengths match the bitwise definition") {
+        // lengths around the 64-byte folding threshold and its 16-byte steps exercise the hand-over to the table tail
+        for (size_t length = 0; length < 300; length++) {
+            std::string data(length, '\0');
+            uint32_t expected = ~0u;
+            for (size_t i = 0; i < length; i++) {
+                data[i] = static_cast<char>(i * 37 + length);
+                expected ^= static_cast<unsigned char>(data[i]);
+                for (int bit = 0; bit < 8; bit++) {
+                    expected = (expected >> 1) ^ (0xedb88320 & (0 - (expected & 1)));
+                }
+            }
+            REQUIRE(checksum(data) == ~expected);
+        }
+    }
+}
+
+TEST_CASE("binary SendMessages encoding", UT_TAG) {
+    iggy::serialization::binary::BinaryWireFormat wireFormat;
+    iggy::model::shared::Identifier streamId(iggy::model::shared::NUMERIC, 4, {1, 0, 0, 0});
+    iggy::model::shared::Identifier topicId(iggy::model::shared::STRING, 1, {'t'});
+    iggy::command::message::Partitioning partitioning(iggy::command::message::PARITION_ID, 4, {2, 0, 0, 0});
+
+    SECTION("frame layout") {
+        std::vector<iggy::model::message::Message> messages;
+        messages.emplace_back(7, iggy::model::message::Headers(), 3, std::vector<unsigned char>{'a', 'b', 'c'});
+        iggy::serialization::binary::GatherBuffer out;
+        wireFormat.write(out, iggy::command::message::SendMessages(streamId, topicId, partitioning, std::move(messages)));
+
+        std::vector<unsigned char> expected = {1, 4, 1, 0, 0, 0, 2, 1, 't', 2, 4, 2, 0, 0, 0};
+        expected.insert(expected.end(), {7, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0});
+        expected.insert(expected.end(), {0, 0, 0, 0, 3, 0, 0, 0, 'a', 'b', 'c'});
+        REQUIRE(out.flatten() == expected);
+
+        // nothing is large enough to be worth its own iovec
+        REQUIRE(out.segmentCount() == 1);
+    }
+
+    SECTION("headers") {
+        iggy::model::message::Headers headers;
+        headers.emplace("k", iggy::model::message::HeaderValue(iggy::model::message::BOOL, {1}));
+        std::vector<iggy::model::message::Message> messages;
+        messages.emplace_back(1, headers, 1, std::vector<unsigned char>{'x'});
+        iggy::serialization::binary::GatherBuffer out;
+        wireFormat.write(out, iggy::command::message::SendMessages(streamId, topicId, partitioning, std::move(messages)));
+
+        auto bytes = out.flatten();
+        std::vector<unsigned char> headerBlock = {11, 0, 0, 0, 1, 0, 0, 0, 'k', 3, 1, 0, 0, 0, 1};
+        REQUIRE(std::search(bytes.begin(), bytes.end(), headerBlock.begin(), headerBlock.end()) != bytes.end());
+        REQUIRE(bytes.size() == 15 + 16 + headerBlock.size() + 4 + 1);
+    }
+
+    SECTION("large payloads are referenced, not copied") {
+        std::vector<iggy::model::message::Message> messages;
+        for (int i = 0; i < 3; i++) {
+            messages.emplace_back(i, iggy::model::message::Headers(), 16384,
+                                  std::vector<unsigned char>(16384, static_cast<unsigned char>(i)));
+        }
+        iggy::command::message::SendMessages command(streamId, topicId, partitioning, std::move(messages));
+        iggy::serialization::binary::GatherBuffer out;
+        wireFormat.write(out, command);
+
+        // prefix, payload, message header, payload, message header, payload
+        REQUIRE(out.segmentCount() == 6);
+        std::vector<const unsigned char*> referenced;
+        out.forEachSegment([&referenced](const unsigned char* data, size_t length) {
+            if (length == 16384) {
+                referenced.push_back(data);
+            }
+        });
+        REQUIRE(referenced.size() == 3);
+        for (size_t i = 0; i < 3; i++) {
+            REQUIRE(referenced[i] == command.getMessages()[i].getPayload().data());
+        }
+        REQUIRE(out.size() == out.flatten().size());
+    }
+
+    SECTION("forwarded messages keep their checksum") {
+        std::vector<unsigned char> payload{'a', 'b', 'c'};
+        uint32_t checksum = iggy::serialization::crc32::checksum(payload.data(), payload.size());
+        auto forward = [&](std::vector<unsigned char> body) {
+            std::vector<iggy::model::message::Message> messages;
+            messages.emplace_back(1, iggy::model::message::Headers(), 3, std::move(body), 0, iggy::model::message::AVAILABLE, 0, checksum);
+            return iggy::command::message::SendMessages(streamId, topicId, partitioning, std::move(messages));
+        };
+        iggy::serialization::binary::BinaryWireFormat verifying(true);
+        iggy::serialization::binary::GatherBuffer out;
+        verifying.write(out, forward(payload));
+        REQUIRE_THROWS_AS(verifying.write(out, forward({'a', 'b', 'd'})), std::invalid_argument);
+    }
+
+    SECTION("empty batch rejected") {
+        iggy::serialization::binary::GatherBuffer out;
+        REQUIRE_THROWS_AS(wireFormat.write(out, iggy::command::message::SendMessages(streamId, topicId, partitioning, {})),
+                          std::invalid_argument);
+    }
+}
+
+TEST_CASE("binary PollMessages encoding", UT_TAG) {
+    iggy::serialization::binary::BinaryWireFormat wireFormat;
+    iggy::command::message::PollMessages command(iggy::model::shared::Consumer(iggy::model::shared::CONSUMER, 5),
+                                                 iggy::model::shared::Identifier(iggy::model::shared::NUMERIC, 4, {1, 0, 0, 0}),
+                                                 iggy::model::shared::Identifier(iggy::model::shared::NUMERIC, 4, {2, 0, 0, 0}), 3,
+                                                 iggy::command::message::PollingStrategy(iggy::command::message::OFFSET, 42), 10, true);
+    iggy::serialization::ByteWriter out;
+    wireFormat.write(out, command);
+    REQUIRE(out.capacity() == out.size());
+
+    std::vector<unsigned char> expected = {1, 5, 0, 0, 0, 1, 4, 1, 0, 0, 0, 1, 4, 2, 0, 0, 0, 3, 0, 0, 0};
+    expected.insert(expected.end(), {1, 42, 0, 0, 0, 0, 0, 0, 0, 10, 0, 0, 0, 1});
+    REQUIRE(out.take() == expected);
+}
+
+TEST_CASE("binary command encoding", UT_TAG) {
+    iggy::serialization::binary::BinaryWireFormat wireFormat;
+    iggy::model::shared::Identifier streamId(iggy::model::shared::NUMERIC, 4, {1, 0, 0, 0});
+    iggy::model::shared::Identifier topicId(iggy::model::shared::STRING, 2, {'t', 'x'});
+    iggy::model::shared::Consumer consumer(iggy::model::shared::CONSUMER_GROUP, 9);
+    iggy::serialization::ByteWriter out;
+
+    SECTION("GetStream") {
+        wireFormat.write(out, iggy::command::stream::GetStream(streamId));
+        REQUIRE(out.capacity() == out.size());
+        REQUIRE(out.take() == std::vector<unsigned char>{1, 4, 1, 0, 0, 0});
+    }
+
+    SECTION("GetClient") {
+        wireFormat.write(out, iggy::command::system::GetClient(7));
+        REQUIRE(out.capacity() == out.size());
+        REQUIRE(out.take() == std::vector<unsigned char>{7, 0, 0, 0});
+    }
+
+    SECTION("StoreConsumerOffset") {
+        wireFormat.write(out, iggy::command::consumeroffset::StoreConsumerOffset(consumer, streamId, topicId, 3, 258));
+        REQUIRE(out.capacity() == out.size());
+        std::vector<unsigned char> expected = {2, 9, 0, 0, 0, 1, 4, 1, 0, 0, 0, 2, 2, 't', 'x', 3, 0, 0, 0};
+        expected.insert(expected.end(), {2, 1, 0, 0, 0, 0, 0, 0});
+        REQUIRE(out.take() == expected);
+    }
+
+    SECTION("JoinConsumerGroup") {
+        wireFormat.write(out, iggy::command::consumergroup::JoinConsumerGroup(streamId, topicId, 5));
+        REQUIRE(out.capacity() == out.size());
+        REQUIRE(out.take() == std::vector<unsigned char>{1, 4, 1, 0, 0, 0, 2, 2, 't', 'x', 5, 0, 0, 0});
+    }
+
+    SECTION("CreateTopic") {
+        wireFormat.write(out, iggy::command::topic::CreateTopic(streamId, 2, 3, std::nullopt, "abc"));
+        REQUIRE(out.capacity() == out.size());
+        std::vector<unsigned char> expected = {1, 4, 1, 0, 0, 0, 2, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 3, 'a', 'b', 'c'};
+        REQUIRE(out.take() == expected);
+    }
+
+    SECTION("CreateStream") {
+        wireFormat.write(out, iggy::command::stream::CreateStream(streamId, "s"));
+        REQUIRE(out.take() == std::vector<unsigned char>{1, 0, 0, 0, 1, 's'});
+        REQUIRE_THROWS_AS(wireFormat.write(out, iggy::command::stream::CreateStream(topicId, "s")), std::invalid_argument);
+        REQUIRE_THROWS_AS(wireFormat.write(out, iggy::command::stream::CreateStream(streamId, std::string(256, 's'))),
+                          std::invalid_argument);
+    }
+
+    SECTION("commands without a payload") {
+        wireFormat.write(out, iggy::command::system::Ping());
+        wireFormat.write(out, iggy::command::system::GetStats());
+        wireFormat.write(out, iggy::command::stream::GetStreams());
+        REQUIRE(out.size() == 0);
+    }
+}
+
+TEST_CASE("binary PolledMessages decoding", UT_TAG) {
+    iggy::serialization::binary::BinaryWireFormat wireFormat;
+    auto payload = std::make_shared<const std::vector<unsigned char>>(iggy::testutil::StubIggyServer::encodePolledMessages(3, 1024));
+
+    SECTION("view borrows from the payload") {
+        auto view = wireFormat.read<iggy::model::message::PolledMessagesView>(payload);
+        REQUIRE(view.getPartitionId() == 1);
+        REQUIRE(view.getCurrentOffset() == 2);
+        REQUIRE(view.getMessages().size() == 3);
+
+        const auto& message = view.getMessages()[2];
+        REQUIRE(message.getOffset() == 2);
+        REQUIRE(message.getState() == iggy::model::message::AVAILABLE);
+        REQUIRE(message.getId() == 3);
+        REQUIRE(message.getChecksum() == iggy::serialization::crc32::checksum(message.getPayload().data(), 1024));
+        REQUIRE(message.hasValidChecksum());
+        REQUIRE(message.getPayload().size() == 1024);
+        REQUIRE(message.getPayload()[0] == 2);
+        REQUIRE(message.getPayload().data() >= payload->data());
+        REQUIRE(message.getPayload().data() + 1024 <= payload->data() + payload->size());
+
+        auto source = message.findHeader("source");
+        REQUIRE(source.has_value());
+        REQUIRE(source->getKind() == iggy::model::message::STRING);
+        REQUIRE(std::string(source->getValue().begin(), source->getValue().end()) == "stub");
+        REQUIRE_FALSE(message.findHeader("missing").has_value());
+    }
+
+    SECTION("views outlive the batch through the shared buffer") {
+        std::shared_ptr<const std::vector<unsigned char>> buffer;
+        std::span<const unsigned char> body;
+        {
+            auto view = wireFormat.read<iggy::model::message::PolledMessagesView>(payload);
+            buffer = view.getBuffer();
+            body = view.getMessages()[1].getPayload();
+        }
+        payload.reset();
+        REQUIRE(buffer.use_count() == 1);
+        REQUIRE(body[1023] == 1);
+    }
+
+    SECTION("owned copy") {
+        auto view = wireFormat.read<iggy::model::message::PolledMessagesView>(payload);
+        auto owned = view.toPolledMessages();
+        REQUIRE(owned.getMessages().size() == 3);
+        auto message = owned.getMessages()[1];
+        REQUIRE(message.isComplete());
+        REQUIRE(std::ranges::equal(message.getPayload(), std::vector<unsigned char>(1024, 1)));
+        auto source = message.getHeaders().at("source").getValue();
+        REQUIRE(std::string(source.begin(), source.end()) == "stub");
+    }
+
+    SECTION("checksum verification") {
+        iggy::serialization::binary::BinaryWireFormat verifying(true);
+        REQUIRE(verifying.read<iggy::model::message::PolledMessagesView>(payload).getMessages().size() == 3);
+
+        auto corrupt = std::make_shared<std::vector<unsigned char>>(*payload);
+        corrupt->back() ^= 1;
+        auto view = wireFormat.read<iggy::model::message::PolledMessagesView>(corrupt);
+        REQUIRE(view.getMessages()[1].hasValidChecksum());
+        REQUIRE_FALSE(view.getMessages()[2].hasValidChecksum());
+        REQUIRE_FALSE(view.toPolledMessages().getMessages()[2].hasValidChecksum());
+        REQUIRE_THROWS_AS(verifying.read<iggy::model::message::PolledMessagesView>(corrupt), std::runtime_error);
+    }
+
+    SECTION("truncated payload") {
+        auto truncated = std::make_shared<const std::vector<unsigned char>>(payload->begin(), payload->end() - 1);
+        REQUIRE_THROWS_AS(wireFormat.read<iggy::model::message::PolledMessagesView>(truncated), std::runtime_error);
+    }
+
+    SECTION("malformed headers block") {
+        auto corrupt = std::make_shared<std::vector<unsigned char>>(*payload);
+        // the first headers block follows the 16-byte batch prefix and 41 bytes of fixed message fields; point the first
+        // key length past the end of the block
+        (*corrupt)[16 + 41] = 0xff;
+        REQUIRE_THROWS_AS(wireFormat.read<iggy::model::message::PolledMessagesView>(corrupt), std::runtime_error);
+    }
+
+    SECTION("message count larger than the payload") {
+        auto header = std::make_shared<std::vector<unsigned char>>(payload->begin(), payload->begin() + 16);
+        (*header)[12] = 0xff;
+        (*header)[15] = 0xff;
+        REQUIRE_THROWS_AS(wireFormat.read<iggy::model::message::PolledMessagesView>(header), std::runtime_error);
+    }
 }
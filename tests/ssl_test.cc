@@ -1,4 +1,5 @@
 #include "../sdk/net/crypto/ssl.h"
+#include "../sdk/net/iggy.h"
 #include "unit_testutils.h"
 
 TEST_CASE("SSL configuration", UT_TAG) {
@@ -104,6 +105,10 @@ TEST_CASE_METHOD(iggy::testutil::SelfSignedCertificate, "SSL context init", UT_T
             auto sslCtxNew = sslCtx;
             REQUIRE(sslCtx.getNativeHandle() != sslCtxNew.getNativeHandle());
 
+            // copies keep the options and share the session cache
+            REQUIRE(wolfSSL_CTX_get_min_proto_version(sslCtxNew.getNativeHandle()) == minProtoVersion);
+            REQUIRE(&sslCtxNew.getSessionCache() == &sslCtx.getSessionCache());
+
             auto sslCtxMoved = std::move(sslCtxNew);
             REQUIRE(sslCtxNew.getNativeHandle() == nullptr);
             REQUIRE(sslCtxMoved.getNativeHandle() != nullptr);
@@ -114,8 +119,31 @@ TEST_CASE_METHOD(iggy::testutil::SelfSignedCertificate, "SSL context init", UT_T
 
             iggy::ssl::SSLContext<WOLFSSL_CTX*> sslCtxNew2;
             sslCtxNew2 = std::move(sslCtx);
+
+            wolfSSL_free(ssl);
         }
     }
+
+    SECTION("session cache") {
+        auto sslCtx = iggy::ssl::SSLContext<WOLFSSL_CTX*>(options, pkiEnv);
+        auto& cache = sslCtx.getSessionCache();
+        REQUIRE(cache.size() == 0);
+
+        iggy::net::IggyProtocolProvider provider;
+        auto address = provider.createAddress("tcp+tls://localhost:8090");
+        WOLFSSL* ssl = wolfSSL_new(sslCtx.getNativeHandle());
+        REQUIRE(ssl != nullptr);
+
+        // nothing to offer yet, and a connection without a completed handshake has no session worth saving
+        REQUIRE_FALSE(cache.resume(address, ssl));
+        REQUIRE_NOTHROW(cache.forget(address));
+
+        auto shared = std::make_shared<iggy::ssl::SessionCache>();
+        sslCtx.setSessionCache(shared);
+        REQUIRE(&sslCtx.getSessionCache() == shared.get());
+
+        wolfSSL_free(ssl);
+    }
 }
 
 TEST_CASE("error message conversion", UT_TAG) {
@@ -0,0 +1,48 @@
+#include <future>
+#include <memory>
+#include <vector>
+#include "../sdk/net/tcp/conn.h"
+#if defined(IGGY_HAVE_IO_URING)
+#include "../sdk/net/tcp/uring.h"
+#endif
+#include "unit_testutils.h"
+
+namespace {
+void benchmarkConnection(const std::string& name, iggy::net::conn::Connection& conn) {
+    conn.connect();
+
+    BENCHMARK(name + ": ping round trip") {
+        return conn.send(iggy::serialization::binary::PING, {}).get().getStatus();
+    };
+
+    BENCHMARK(name + ": 64 pipelined 1KB requests") {
+        std::vector<std::future<iggy::net::conn::Response>> futures;
+        for (int i = 0; i < 64; i++) {
+            futures.push_back(conn.send(iggy::serialization::binary::GET_CLIENT, std::vector<unsigned char>(1024, 0x5a)));
+        }
+        size_t received = 0;
+        for (auto& future : futures) {
+            received += future.get().getPayload().size();
+        }
+        return received;
+    };
+
+    conn.close();
+}
+}  // namespace
+
+TEST_CASE_METHOD(iggy::testutil::StubIggyServer, "TCP backends", BENCH_TAG) {
+    setHandler(iggy::serialization::binary::GET_CLIENT, [](const std::vector<unsigned char>& payload) { return std::make_pair(0u, payload); });
+
+    SECTION("libuv") {
+        iggy::net::tcp::TcpConnection conn("127.0.0.1", getPort());
+        benchmarkConnection("libuv", conn);
+    }
+
+#if defined(IGGY_HAVE_IO_URING)
+    SECTION("io_uring") {
+        iggy::net::tcp::UringConnection conn("127.0.0.1", getPort());
+        benchmarkConnection("io_uring", conn);
+    }
+#endif
+}
@@ -0,0 +1,200 @@
+#include <array>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+#include "../sdk/net/tcp/conn.h"
+#include "unit_testutils.h"
+
+TEST_CASE_METHOD(iggy::testutil::StubIggyServer, "TCP connection", UT_TAG) {
+    iggy::net::tcp::TcpConnection conn("127.0.0.1", getPort());
+    conn.connect();
+
+    SECTION("single round trip") {
+        auto response = conn.send(iggy::serialization::binary::PING, {}).get();
+        REQUIRE(response.isOk());
+        REQUIRE(response.getPayload().empty());
+    }
+
+    SECTION("request payload delivered intact") {
+        setHandler(iggy::serialization::binary::GET_CLIENT,
+                   [](const std::vector<unsigned char>& payload) { return std::make_pair(0u, payload); });
+        std::vector<unsigned char> payload = {1, 2, 3, 4};
+        auto response = conn.send(iggy::serialization::binary::GET_CLIENT, payload).get();
+        REQUIRE(response.getPayload() == payload);
+    }
+
+    SECTION("large response split across reads") {
+        setHandler(iggy::serialization::binary::GET_STREAMS, [](const std::vector<unsigned char>&) {
+            return std::make_pair(0u, std::vector<unsigned char>(4 * 1024 * 1024, 0x5a));
+        });
+        auto response = conn.send(iggy::serialization::binary::GET_STREAMS, {}).get();
+        REQUIRE(response.getPayload().size() == 4 * 1024 * 1024);
+        REQUIRE(response.getPayload().back() == 0x5a);
+    }
+
+    SECTION("large responses pipelined with small ones") {
+        setHandler(iggy::serialization::binary::GET_STREAMS, [](const std::vector<unsigned char>& payload) {
+            return std::make_pair(0u, std::vector<unsigned char>(1024 * 1024 + payload.front(), payload.front()));
+        });
+        std::vector<std::future<iggy::net::conn::Response>> futures;
+        for (unsigned char i = 1; i <= 20; i++) {
+            futures.push_back(conn.send(iggy::serialization::binary::GET_STREAMS, {i}));
+            futures.push_back(conn.send(iggy::serialization::binary::PING, {}));
+        }
+        for (unsigned char i = 1; i <= 20; i++) {
+            auto large = futures[2 * (i - 1)].get();
+            REQUIRE(large.getPayload().size() == 1024 * 1024 + i);
+            REQUIRE(large.getPayload().front() == i);
+            REQUIRE(large.getPayload().back() == i);
+            REQUIRE(futures[2 * (i - 1) + 1].get().isOk());
+        }
+    }
+
+    SECTION("queued requests") {
+        std::vector<std::future<iggy::net::conn::Response>> futures;
+        for (int i = 0; i < 100; i++) {
+            futures.push_back(conn.send(iggy::serialization::binary::PING, {}));
+        }
+        for (auto& future : futures) {
+            REQUIRE(future.get().isOk());
+        }
+        REQUIRE(getRequestCount() == 100);
+    }
+
+    SECTION("gathered payload with more segments than IOV_MAX") {
+        setHandler(iggy::serialization::binary::SEND_MESSAGES, [](const std::vector<unsigned char>& payload) {
+            return std::make_pair(0u, std::vector<unsigned char>{payload.front(), payload.back()});
+        });
+        std::vector<unsigned char> chunk(iggy::serialization::binary::GatherBuffer::REFERENCE_THRESHOLD, 0x33);
+        iggy::serialization::binary::GatherBuffer payload;
+        unsigned char first = 0x11;
+        payload.append(&first, 1);
+        for (int i = 0; i < 2048; i++) {
+            payload.appendReference(chunk.data(), chunk.size());
+        }
+        REQUIRE(payload.segmentCount() == 2049);
+        auto response = conn.sendGathered(iggy::serialization::binary::SEND_MESSAGES, std::move(payload)).get();
+        REQUIRE(response.getPayload() == std::vector<unsigned char>{0x11, 0x33});
+    }
+
+    SECTION("static frames pipelined with encoded ones") {
+        setHandler(iggy::serialization::binary::GET_CLIENT,
+                   [](const std::vector<unsigned char>& payload) { return std::make_pair(0u, payload); });
+        std::vector<std::future<iggy::net::conn::Response>> futures;
+        for (unsigned char i = 0; i < 30; i++) {
+            futures.push_back(conn.send(i % 3 == 0 ? iggy::serialization::binary::GET_CLIENT : iggy::serialization::binary::PING,
+                                        i % 3 == 0 ? std::vector<unsigned char>{i} : std::vector<unsigned char>{}));
+        }
+        for (unsigned char i = 0; i < 30; i++) {
+            auto response = futures[i].get();
+            REQUIRE(response.isOk());
+            REQUIRE(response.getPayload() == (i % 3 == 0 ? std::vector<unsigned char>{i} : std::vector<unsigned char>{}));
+        }
+    }
+
+    SECTION("oversized response length fails the connection") {
+        setAnnouncedLength(iggy::serialization::binary::GET_STREAMS, iggy::net::tcp::MAX_RESPONSE_SIZE + 1);
+        auto response = conn.send(iggy::serialization::binary::GET_STREAMS, {});
+        REQUIRE(response.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+        REQUIRE_THROWS_AS(response.get(), std::runtime_error);
+    }
+
+    SECTION("send after close") {
+        conn.close();
+        REQUIRE_THROWS_AS(conn.send(iggy::serialization::binary::PING, {}), std::runtime_error);
+    }
+}
+
+TEST_CASE("TCP request frames", UT_TAG) {
+    static_assert(iggy::net::tcp::EMPTY_REQUEST<iggy::serialization::binary::GET_STREAMS>[4] == 201);
+    std::array<unsigned char, iggy::net::tcp::REQUEST_HEADER_SIZE> storage = {};
+
+    SECTION("parameterless commands use their static frame") {
+        auto header = iggy::net::tcp::prepareRequestHeader(storage, iggy::serialization::binary::PING, 0);
+        REQUIRE(header == iggy::net::tcp::EMPTY_REQUEST<iggy::serialization::binary::PING>.data());
+        REQUIRE(std::vector<unsigned char>(header, header + iggy::net::tcp::REQUEST_HEADER_SIZE) ==
+                std::vector<unsigned char>{4, 0, 0, 0, 1, 0, 0, 0});
+    }
+
+    SECTION("other commands are encoded into the storage") {
+        auto header = iggy::net::tcp::prepareRequestHeader(storage, iggy::serialization::binary::GET_CLIENT, 4);
+        REQUIRE(header == storage.data());
+        REQUIRE(std::vector<unsigned char>(storage.begin(), storage.end()) == std::vector<unsigned char>{8, 0, 0, 0, 21, 0, 0, 0});
+    }
+
+    SECTION("a payload rules out the static frame") {
+        REQUIRE(iggy::net::tcp::prepareRequestHeader(storage, iggy::serialization::binary::GET_STATS, 1) == storage.data());
+    }
+}
+
+TEST_CASE_METHOD(iggy::testutil::StubIggyServer, "TCP request pipelining", UT_TAG) {
+    // echo the payload back after a short delay so that later requests have time to queue up behind the first one
+    setHandler(iggy::serialization::binary::GET_CLIENT, [](const std::vector<unsigned char>& payload) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return std::make_pair(0u, payload);
+    });
+
+    auto sendAll = [](iggy::net::tcp::TcpConnection& conn) {
+        std::vector<std::future<iggy::net::conn::Response>> futures;
+        for (unsigned char i = 0; i < 50; i++) {
+            futures.push_back(conn.send(iggy::serialization::binary::GET_CLIENT, {i}));
+        }
+        for (unsigned char i = 0; i < 50; i++) {
+            auto response = futures[i].get();
+            REQUIRE(response.getPayload() == std::vector<unsigned char>{i});
+        }
+    };
+
+    SECTION("responses matched to requests in order") {
+        iggy::net::tcp::TcpConnection conn("127.0.0.1", getPort(), 8);
+        conn.connect();
+        sendAll(conn);
+        REQUIRE(getPipelinedRequestCount() > 0);
+    }
+
+    SECTION("window of one is lock-step") {
+        iggy::net::tcp::TcpConnection conn("127.0.0.1", getPort(), 1);
+        conn.connect();
+        sendAll(conn);
+        REQUIRE(getPipelinedRequestCount() == 0);
+    }
+
+    SECTION("multiple caller threads") {
+        iggy::net::tcp::TcpConnection conn("127.0.0.1", getPort(), 4);
+        conn.connect();
+        std::vector<std::thread> callers;
+        for (int i = 0; i < 4; i++) {
+            callers.emplace_back([&conn]() {
+                for (int j = 0; j < 25; j++) {
+                    conn.send(iggy::serialization::binary::PING, {}).get();
+                }
+            });
+        }
+        for (auto& caller : callers) {
+            caller.join();
+        }
+        REQUIRE(getRequestCount() == 100);
+    }
+
+    SECTION("empty window rejected") {
+        REQUIRE_THROWS_AS(iggy::net::tcp::TcpConnection("127.0.0.1", getPort(), 0), std::invalid_argument);
+    }
+}
+
+TEST_CASE("TCP connection failures", UT_TAG) {
+    SECTION("server drops the connection") {
+        iggy::testutil::StubIggyServer server;
+        iggy::net::tcp::TcpConnection conn("127.0.0.1", server.getPort());
+        conn.connect();
+        REQUIRE(conn.send(iggy::serialization::binary::PING, {}).get().isOk());
+
+        server.disconnectAll();
+        REQUIRE_THROWS_AS(conn.send(iggy::serialization::binary::PING, {}).get(), std::runtime_error);
+    }
+
+    SECTION("unresolvable host") {
+        iggy::net::tcp::TcpConnection conn("iggy.invalid", 8090);
+        REQUIRE_THROWS_AS(conn.connect(), std::runtime_error);
+    }
+}
@@ -0,0 +1,205 @@
+#include <fmt/format.h>
+#include <array>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../sdk/net/crypto/ssl.h"
+#include "../sdk/net/iggy.h"
+#include "../sdk/net/tcp/conn.h"
+#include "../sdk/net/tcp/tls.h"
+#include "unit_testutils.h"
+
+namespace {
+/// @brief Outlives every address created from it, which keep a pointer back to it.
+const iggy::net::IggyProtocolProvider protocolProvider;
+
+/// @brief Client TLS setup trusting the stub server's self-signed certificate, as the client builds it for TCP.
+struct TcpClientTls {
+    iggy::ssl::SSLOptions<WOLFSSL_CTX*> sslOptions;
+    iggy::crypto::CertificateAuthority<WOLFSSL_CTX*> certAuth;
+    iggy::crypto::PKIEnvironment<WOLFSSL_CTX*> pkiEnv;
+    iggy::ssl::SSLContext<WOLFSSL_CTX*> context;
+    iggy::net::address::LogicalAddress address;
+
+    TcpClientTls(const std::filesystem::path& caPath, const std::string& host, uint16_t port)
+        : certAuth(caPath, nullptr)
+        , pkiEnv(certAuth)
+        , context(sslOptions, pkiEnv)
+        , address(protocolProvider.createAddress(fmt::format("{}://{}:{}", iggy::net::TCP_TLS_PROTOCOL, host, port))) {
+        this->pkiEnv.configure(this->context.getNativeHandle(), this->pkiEnv);
+    }
+
+    iggy::net::tcp::TlsEndpoint endpoint() { return iggy::net::tcp::TlsEndpoint{this->context, this->address}; }
+};
+}  // namespace
+
+TEST_CASE_METHOD(iggy::testutil::StubTlsServer, "TLS connection", UT_TAG) {
+    TcpClientTls tls(getCertificatePath(), "localhost", getTlsPort());
+
+    // the same traffic with records encrypted in userspace and, where the kernel supports it, by kTLS
+    auto kernelTls = GENERATE(false, true);
+    iggy::net::tcp::TcpConnection conn("localhost", getTlsPort(), iggy::net::tcp::DEFAULT_MAX_IN_FLIGHT, tls.endpoint(), kernelTls);
+    conn.connect();
+    if (kernelTls) {
+        // the handshake's last flight is tiny and written at once, so offload is never skipped on an idle socket
+        REQUIRE(conn.getTransmitOffload() != iggy::net::tcp::TransmitOffload::SKIPPED);
+        REQUIRE(conn.isTransmitOffloaded() == (conn.getTransmitOffload() == iggy::net::tcp::TransmitOffload::OFFLOADED));
+    } else {
+        REQUIRE(conn.getTransmitOffload() == iggy::net::tcp::TransmitOffload::DISABLED);
+        REQUIRE_FALSE(conn.isTransmitOffloaded());
+    }
+
+    SECTION("single round trip") {
+        auto response = conn.send(iggy::serialization::binary::PING, {}).get();
+        REQUIRE(response.isOk());
+        REQUIRE(response.getPayload().empty());
+    }
+
+    SECTION("large response split across records") {
+        setHandler(iggy::serialization::binary::GET_STREAMS, [](const std::vector<unsigned char>&) {
+            return std::make_pair(0u, std::vector<unsigned char>(4 * 1024 * 1024, 0x5a));
+        });
+        auto response = conn.send(iggy::serialization::binary::GET_STREAMS, {}).get();
+        REQUIRE(response.getPayload().size() == 4 * 1024 * 1024);
+        REQUIRE(response.getPayload().back() == 0x5a);
+    }
+
+    SECTION("pipelined requests with a gathered payload") {
+        setHandler(iggy::serialization::binary::SEND_MESSAGES, [](const std::vector<unsigned char>& payload) {
+            return std::make_pair(0u, std::vector<unsigned char>{payload.front(), payload.back()});
+        });
+        std::vector<unsigned char> chunk(iggy::serialization::binary::GatherBuffer::REFERENCE_THRESHOLD, 0x33);
+        iggy::serialization::binary::GatherBuffer payload;
+        unsigned char first = 0x11;
+        payload.append(&first, 1);
+        for (int i = 0; i < 256; i++) {
+            payload.appendReference(chunk.data(), chunk.size());
+        }
+        std::vector<std::future<iggy::net::conn::Response>> pings;
+        for (int i = 0; i < 50; i++) {
+            pings.push_back(conn.send(iggy::serialization::binary::PING, {}));
+        }
+        auto send = conn.sendGathered(iggy::serialization::binary::SEND_MESSAGES, std::move(payload));
+        for (auto& ping : pings) {
+            REQUIRE(ping.get().isOk());
+        }
+        REQUIRE(send.get().getPayload() == std::vector<unsigned char>{0x11, 0x33});
+    }
+}
+
+TEST_CASE_METHOD(iggy::testutil::StubTlsServer, "TLS handshake", UT_TAG) {
+    SECTION("server name does not match the certificate") {
+        TcpClientTls tls(getCertificatePath(), "example.com", getTlsPort());
+        iggy::net::tcp::TcpConnection conn("localhost", getTlsPort(), iggy::net::tcp::DEFAULT_MAX_IN_FLIGHT, tls.endpoint());
+        REQUIRE_THROWS_AS(conn.connect(), std::runtime_error);
+    }
+
+    SECTION("plain TCP connection reports no offload") {
+        iggy::net::tcp::TcpConnection conn("127.0.0.1", getPort());
+        conn.connect();
+        REQUIRE(conn.getTransmitOffload() == iggy::net::tcp::TransmitOffload::DISABLED);
+        REQUIRE_FALSE(conn.isSessionResumed());
+    }
+}
+
+#if defined(__linux__)
+#include <linux/tls.h>
+
+TEST_CASE("kernel TLS crypto info", UT_TAG) {
+    std::vector<unsigned char> key(16, 0xaa);
+    std::vector<unsigned char> iv = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+
+    SECTION("TLS 1.3 AES-128-GCM splits the static IV into salt and nonce") {
+        auto packed = iggy::net::tcp::makeKernelTlsCryptoInfo(WOLFSSL_TLSV1_3, wolfssl_aes_gcm, key, iv, 0);
+        REQUIRE(packed.has_value());
+        REQUIRE(packed->size() == sizeof(tls12_crypto_info_aes_gcm_128));
+
+        tls12_crypto_info_aes_gcm_128 info;
+        std::memcpy(&info, packed->data(), sizeof(info));
+        REQUIRE(info.info.version == TLS_1_3_VERSION);
+        REQUIRE(info.info.cipher_type == TLS_CIPHER_AES_GCM_128);
+        REQUIRE(std::vector<unsigned char>(info.key, info.key + 16) == key);
+        REQUIRE(std::vector<unsigned char>(info.salt, info.salt + 4) == std::vector<unsigned char>{1, 2, 3, 4});
+        REQUIRE(std::vector<unsigned char>(info.iv, info.iv + 8) == std::vector<unsigned char>{5, 6, 7, 8, 9, 10, 11, 12});
+        REQUIRE(std::vector<unsigned char>(info.rec_seq, info.rec_seq + 8) == std::vector<unsigned char>(8, 0));
+    }
+
+    SECTION("TLS 1.2 AES-256-GCM seeds the explicit nonce from the sequence number") {
+        std::vector<unsigned char> key256(32, 0xbb);
+        std::vector<unsigned char> implicitIv = {1, 2, 3, 4};
+        auto packed = iggy::net::tcp::makeKernelTlsCryptoInfo(WOLFSSL_TLSV1_2, wolfssl_aes_gcm, key256, implicitIv, 1);
+        REQUIRE(packed.has_value());
+        REQUIRE(packed->size() == sizeof(tls12_crypto_info_aes_gcm_256));
+
+        tls12_crypto_info_aes_gcm_256 info;
+        std::memcpy(&info, packed->data(), sizeof(info));
+        REQUIRE(info.info.version == TLS_1_2_VERSION);
+        REQUIRE(info.info.cipher_type == TLS_CIPHER_AES_GCM_256);
+        REQUIRE(std::vector<unsigned char>(info.salt, info.salt + 4) == implicitIv);
+
+        std::vector<unsigned char> sequenceOne = {0, 0, 0, 0, 0, 0, 0, 1};
+        REQUIRE(std::vector<unsigned char>(info.iv, info.iv + 8) == sequenceOne);
+        REQUIRE(std::vector<unsigned char>(info.rec_seq, info.rec_seq + 8) == sequenceOne);
+    }
+
+    SECTION("ChaCha20-Poly1305 uses the whole IV as the nonce") {
+        std::vector<unsigned char> key256(32, 0xcc);
+        auto packed = iggy::net::tcp::makeKernelTlsCryptoInfo(WOLFSSL_TLSV1_3, wolfssl_chacha, key256, iv, 0);
+        REQUIRE(packed.has_value());
+
+        tls12_crypto_info_chacha20_poly1305 info;
+        std::memcpy(&info, packed->data(), sizeof(info));
+        REQUIRE(info.info.cipher_type == TLS_CIPHER_CHACHA20_POLY1305);
+        REQUIRE(std::vector<unsigned char>(info.iv, info.iv + 12) == iv);
+    }
+
+    SECTION("unsupported parameters fall back to userspace") {
+        REQUIRE_FALSE(iggy::net::tcp::makeKernelTlsCryptoInfo(WOLFSSL_TLSV1_3, wolfssl_aes_ccm, key, iv, 0).has_value());
+        REQUIRE_FALSE(iggy::net::tcp::makeKernelTlsCryptoInfo(WOLFSSL_TLSV1_1, wolfssl_aes_gcm, key, iv, 0).has_value());
+        REQUIRE_FALSE(iggy::net::tcp::makeKernelTlsCryptoInfo(WOLFSSL_TLSV1_3, wolfssl_aes_gcm, std::vector<unsigned char>(24), iv, 0)
+                          .has_value());
+        REQUIRE_FALSE(iggy::net::tcp::makeKernelTlsCryptoInfo(WOLFSSL_TLSV1_2, wolfssl_aes_gcm, key, iv, 1).has_value());
+    }
+}
+#endif
+
+TEST_CASE_METHOD(iggy::testutil::StubTlsServer, "TLS session resumption", UT_TAG) {
+    TcpClientTls tls(getCertificatePath(), "localhost", getTlsPort());
+    {
+        iggy::net::tcp::TcpConnection first("localhost", getTlsPort(), iggy::net::tcp::DEFAULT_MAX_IN_FLIGHT, tls.endpoint());
+        first.connect();
+        // the TLS 1.3 ticket arrives after the handshake, ahead of the first response
+        REQUIRE(first.send(iggy::serialization::binary::PING, {}).get().isOk());
+        REQUIRE_FALSE(first.isSessionResumed());
+    }
+    REQUIRE(tls.context.getSessionCache().size() == 1);
+
+    SECTION("same context") {
+        iggy::net::tcp::TcpConnection conn("localhost", getTlsPort(), iggy::net::tcp::DEFAULT_MAX_IN_FLIGHT, tls.endpoint());
+        conn.connect();
+        REQUIRE(conn.send(iggy::serialization::binary::PING, {}).get().isOk());
+        REQUIRE(conn.isSessionResumed());
+        REQUIRE(getResumedSessionCount() == 1);
+    }
+
+    SECTION("cache shared with a new context") {
+        // as a client recreated with the same Options::tlsSessionCache would
+        auto shared = std::make_shared<iggy::ssl::SessionCache>();
+        tls.context.setSessionCache(shared);
+        iggy::net::tcp::TcpConnection seeding("localhost", getTlsPort(), iggy::net::tcp::DEFAULT_MAX_IN_FLIGHT, tls.endpoint());
+        seeding.connect();
+        REQUIRE(seeding.send(iggy::serialization::binary::PING, {}).get().isOk());
+        REQUIRE_FALSE(seeding.isSessionResumed());
+        seeding.close();
+
+        TcpClientTls recreated(getCertificatePath(), "localhost", getTlsPort());
+        recreated.context.setSessionCache(shared);
+        iggy::net::tcp::TcpConnection conn("localhost", getTlsPort(), iggy::net::tcp::DEFAULT_MAX_IN_FLIGHT, recreated.endpoint());
+        conn.connect();
+        REQUIRE(conn.send(iggy::serialization::binary::PING, {}).get().isOk());
+        REQUIRE(conn.isSessionResumed());
+        REQUIRE(getResumedSessionCount() == 1);
+    }
+}
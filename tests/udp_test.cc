@@ -0,0 +1,90 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+#include "../sdk/net/quic/udp.h"
+#include "unit_testutils.h"
+
+namespace {
+/// @brief A plain UDP socket on an ephemeral loopback port, standing in for the server end.
+struct LoopbackPeer {
+    int fd;
+    sockaddr_in address = {};
+
+    LoopbackPeer() {
+        this->fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+        this->address.sin_family = AF_INET;
+        this->address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(this->address);
+        ::bind(this->fd, reinterpret_cast<sockaddr*>(&this->address), sizeof(this->address));
+        ::getsockname(this->fd, reinterpret_cast<sockaddr*>(&this->address), &length);
+    }
+
+    ~LoopbackPeer() { ::close(this->fd); }
+
+    std::vector<size_t> receiveSizes(size_t count) {
+        std::vector<size_t> sizes;
+        std::vector<unsigned char> buffer(65536);
+        while (sizes.size() < count) {
+            pollfd pfd = {this->fd, POLLIN, 0};
+            if (::poll(&pfd, 1, 1000) <= 0) {
+                break;
+            }
+            sizes.push_back(static_cast<size_t>(::recv(this->fd, buffer.data(), buffer.size(), 0)));
+        }
+        return sizes;
+    }
+};
+}  // namespace
+
+TEST_CASE("UDP datagram batching", UT_TAG) {
+    bool batching = GENERATE(true, false);
+    LoopbackPeer peer;
+    iggy::net::quic::DatagramSocket socket(reinterpret_cast<const sockaddr*>(&peer.address), batching);
+    REQUIRE((batching || !socket.isSegmentationOffloaded()));
+
+    SECTION("packets keep their boundaries") {
+        // a run of equal packets ended by a shorter one is exactly what segmentation offload sends in one go
+        std::vector<size_t> sizes = {1200, 1200, 1200, 1200, 1200, 700, 1200, 1300};
+        for (size_t size : sizes) {
+            std::fill_n(socket.reserve(1500), size, static_cast<unsigned char>(size));
+            socket.commit(size);
+        }
+        REQUIRE(socket.hasQueued());
+        REQUIRE(socket.flush());
+        REQUIRE_FALSE(socket.hasQueued());
+        REQUIRE(peer.receiveSizes(sizes.size()) == sizes);
+    }
+
+    SECTION("batch fills up") {
+        size_t limit = batching ? iggy::net::quic::MAX_BATCH_PACKETS : 1;
+        for (size_t i = 0; i < limit; i++) {
+            REQUIRE_FALSE(socket.isBatchFull());
+            socket.reserve(100);
+            socket.commit(100);
+        }
+        REQUIRE(socket.isBatchFull());
+        REQUIRE(socket.flush());
+        REQUIRE(peer.receiveSizes(limit).size() == limit);
+    }
+
+    SECTION("every waiting datagram is received") {
+        sockaddr_in local = {};
+        socklen_t length = sizeof(local);
+        ::getsockname(socket.getFd(), reinterpret_cast<sockaddr*>(&local), &length);
+        std::vector<unsigned char> datagram(1000, 0x42);
+        for (int i = 0; i < 20; i++) {
+            ::sendto(peer.fd, datagram.data(), datagram.size() - i, 0, reinterpret_cast<sockaddr*>(&local), sizeof(local));
+        }
+
+        std::vector<size_t> received;
+        pollfd pfd = {socket.getFd(), POLLIN, 0};
+        while (received.size() < 20 && ::poll(&pfd, 1, 1000) > 0) {
+            REQUIRE(socket.receive([&received](const unsigned char* data, size_t length) { received.push_back(length); }) == 0);
+        }
+        REQUIRE(received.size() == 20);
+        REQUIRE(received.back() == 981);
+    }
+}
@@ -1,10 +1,30 @@
 #include "unit_testutils.h"
+#include <arpa/inet.h>
 #include <fmt/format.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <nghttp2/nghttp2.h>
+#include <ngtcp2/ngtcp2.h>
+#include <ngtcp2/ngtcp2_crypto.h>
+#include <ngtcp2/ngtcp2_crypto_wolfssl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <wolfssl/options.h>
+#include <wolfssl/ssl.h>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
 #include <iostream>
+#include <optional>
 #include <reproc++/drain.hpp>
 #include <reproc++/reproc.hpp>
 #include <stdexcept>
 #include <vector>
+#include "../sdk/binary.h"
+#include "../sdk/crc32.h"
 
 iggy::testutil::SelfSignedCertificate::SelfSignedCertificate() {
     std::vector<std::string> arguments = {"openssl",  "req",
@@ -39,3 +59,990 @@ iggy::testutil::SelfSignedCertificate::~SelfSignedCertificate() {
 std::filesystem::path iggy::testutil::SelfSignedCertificate::generateRandomTempPath(std::string baseName) {
     return std::filesystem::temp_directory_path() / (std::to_string(std::rand()) + baseName);
 }
+
+namespace {
+bool readFully(int fd, unsigned char* data, size_t length) {
+    size_t offset = 0;
+    while (offset < length) {
+        ssize_t n = ::recv(fd, data + offset, length - offset, 0);
+        if (n <= 0) {
+            return false;
+        }
+        offset += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool writeFully(int fd, const unsigned char* data, size_t length) {
+    size_t offset = 0;
+    while (offset < length) {
+        ssize_t n = ::send(fd, data + offset, length - offset, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        offset += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+uint32_t readUint32(const unsigned char* data) {
+    return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) | (static_cast<uint32_t>(data[2]) << 16) |
+           (static_cast<uint32_t>(data[3]) << 24);
+}
+
+template <typename T>
+void append(std::vector<unsigned char>& out, T value) {
+    for (size_t i = 0; i < sizeof(T); i++) {
+        out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+    }
+}
+
+void appendString(std::vector<unsigned char>& out, const std::string& value) {
+    append<uint32_t>(out, static_cast<uint32_t>(value.size()));
+    out.insert(out.end(), value.begin(), value.end());
+}
+
+/// @brief Opens a TCP socket listening on an ephemeral loopback port, which it stores in port.
+int listenOnLoopback(uint16_t& port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw std::runtime_error(fmt::format("Failed to create stub server socket: {}", std::strerror(errno)));
+    }
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    socklen_t addrLen = sizeof(addr);
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(fd, 64) < 0 ||
+        ::getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &addrLen) < 0) {
+        ::close(fd);
+        throw std::runtime_error(fmt::format("Failed to start stub server: {}", std::strerror(errno)));
+    }
+    port = ntohs(addr.sin_port);
+    return fd;
+}
+}  // namespace
+
+iggy::testutil::StubIggyServer::StubIggyServer() {
+    this->handlers[38] = [](const std::vector<unsigned char>&) {
+        std::vector<unsigned char> userId;
+        append<uint32_t>(userId, 1);
+        return std::make_pair(0u, userId);
+    };
+    this->handlers[1] = [](const std::vector<unsigned char>&) { return std::make_pair(0u, std::vector<unsigned char>()); };
+    this->handlers[10] = [](const std::vector<unsigned char>&) { return std::make_pair(0u, encodeStats()); };
+
+    this->listenFd = listenOnLoopback(this->port);
+    this->acceptThread = std::thread([this]() { this->acceptLoop(); });
+}
+
+iggy::testutil::StubIggyServer::~StubIggyServer() {
+    this->running = false;
+    ::shutdown(this->listenFd, SHUT_RDWR);
+    this->acceptThread.join();
+    ::close(this->listenFd);
+
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        for (int fd : this->clientFds) {
+            ::shutdown(fd, SHUT_RDWR);
+        }
+        threads.swap(this->clientThreads);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (int fd : this->clientFds) {
+        ::close(fd);
+    }
+}
+
+void iggy::testutil::StubIggyServer::setHandler(uint32_t command, Handler handler) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->handlers[command] = handler;
+}
+
+void iggy::testutil::StubIggyServer::setAnnouncedLength(uint32_t command, uint32_t length) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->announcedLengths[command] = length;
+}
+
+void iggy::testutil::StubIggyServer::disconnectAll() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    for (int fd : this->clientFds) {
+        ::shutdown(fd, SHUT_RDWR);
+    }
+}
+
+void iggy::testutil::StubIggyServer::acceptLoop() {
+    while (this->running) {
+        int fd = ::accept(this->listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            return;
+        }
+
+        // like the real server, otherwise Nagle and delayed ACKs stall pipelined responses
+        int noDelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->clientFds.push_back(fd);
+        this->clientThreads.emplace_back([this, fd]() { this->serve(fd); });
+    }
+}
+
+void iggy::testutil::StubIggyServer::serve(int fd) {
+    this->serveFrames([fd](unsigned char* data, size_t length) { return readFully(fd, data, length); },
+                      [this, fd](const unsigned char* data, size_t length) {
+                          // a request is answered as soon as it has been read, so anything queued behind it was pipelined
+                          int queuedBytes = 0;
+                          if (::ioctl(fd, FIONREAD, &queuedBytes) == 0 && queuedBytes > 0) {
+                              this->pipelinedRequestCount++;
+                          }
+                          return writeFully(fd, data, length);
+                      });
+}
+
+void iggy::testutil::StubIggyServer::serveFrames(const std::function<bool(unsigned char*, size_t)>& read,
+                                                 const std::function<bool(const unsigned char*, size_t)>& write) {
+    unsigned char header[8];
+    while (read(header, sizeof(header))) {
+        uint32_t length = readUint32(header);
+        uint32_t command = readUint32(header + 4);
+        if (length < 4) {
+            return;
+        }
+        std::vector<unsigned char> payload(length - 4);
+        if (!read(payload.data(), payload.size())) {
+            return;
+        }
+        std::vector<unsigned char> response = this->respond(command, payload);
+        if (!write(response.data(), response.size())) {
+            return;
+        }
+    }
+}
+
+std::vector<unsigned char> iggy::testutil::StubIggyServer::respond(uint32_t command, const std::vector<unsigned char>& payload) {
+    this->requestCount++;
+    Handler handler;
+    std::optional<uint32_t> announcedLength;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        auto it = this->handlers.find(command);
+        if (it != this->handlers.end()) {
+            handler = it->second;
+        }
+        auto announced = this->announcedLengths.find(command);
+        if (announced != this->announcedLengths.end()) {
+            announcedLength = announced->second;
+        }
+    }
+
+    // unknown commands get the server's generic "invalid command" error code
+    auto [status, body] = handler ? handler(payload) : std::make_pair(3u, std::vector<unsigned char>());
+    std::vector<unsigned char> response;
+    append<uint32_t>(response, status);
+    append<uint32_t>(response, announcedLength.value_or(static_cast<uint32_t>(body.size())));
+    response.insert(response.end(), body.begin(), body.end());
+    return response;
+}
+
+std::vector<unsigned char> iggy::testutil::StubIggyServer::encodeStats() {
+    std::vector<unsigned char> out;
+    float cpuUsage = 0.5f;
+    uint32_t cpuUsageBits;
+    std::memcpy(&cpuUsageBits, &cpuUsage, sizeof(cpuUsageBits));
+
+    append<uint32_t>(out, 1234);              // process_id
+    append<uint32_t>(out, cpuUsageBits);      // cpu_usage
+    append<uint64_t>(out, 1024 * 1024);       // memory_usage
+    append<uint64_t>(out, 8 * 1024 * 1024);   // total_memory
+    append<uint64_t>(out, 4 * 1024 * 1024);   // available_memory
+    append<uint64_t>(out, 60);                // run_time
+    append<uint64_t>(out, 1700000000);        // start_time
+    append<uint64_t>(out, 100);               // read_bytes
+    append<uint64_t>(out, 200);               // written_bytes
+    append<uint64_t>(out, 300);               // messages_size_bytes
+    append<uint32_t>(out, 1);                 // streams_count
+    append<uint32_t>(out, 2);                 // topics_count
+    append<uint32_t>(out, 3);                 // partitions_count
+    append<uint32_t>(out, 4);                 // segments_count
+    append<uint64_t>(out, 5);                 // messages_count
+    append<uint32_t>(out, 6);                 // clients_count
+    append<uint32_t>(out, 7);                 // consumer_groups_count
+    appendString(out, "localhost");           // hostname
+    appendString(out, "Linux");               // os_name
+    appendString(out, "Debian 12");           // os_version
+    appendString(out, "6.1.0");               // kernel_version
+    return out;
+}
+
+std::vector<unsigned char> iggy::testutil::StubIggyServer::encodePolledMessages(uint32_t count, size_t payloadSize) {
+    std::vector<unsigned char> header;
+    appendString(header, "source");
+    append<uint8_t>(header, 2);  // STRING
+    appendString(header, "stub");
+
+    std::vector<unsigned char> out;
+    append<uint32_t>(out, 1);                                          // partition_id
+    append<uint64_t>(out, count == 0 ? 0 : count - 1);                 // current_offset
+    append<uint32_t>(out, count);                                      // messages_count
+    for (uint32_t i = 0; i < count; i++) {
+        std::vector<unsigned char> payload(payloadSize, static_cast<unsigned char>(i));
+        uint32_t checksum = iggy::serialization::crc32::checksum(payload.data(), payload.size());
+        append<uint64_t>(out, i);                                      // offset
+        append<uint8_t>(out, 1);                                       // state
+        append<uint64_t>(out, 1700000000000000 + i);                   // timestamp
+        append<uint64_t>(out, i + 1);                                  // id, low half
+        append<uint64_t>(out, 0);                                      // id, high half
+        append<uint32_t>(out, checksum);                               // checksum
+        append<uint32_t>(out, static_cast<uint32_t>(header.size()));  // headers_length
+        out.insert(out.end(), header.begin(), header.end());
+        append<uint32_t>(out, static_cast<uint32_t>(payloadSize));    // payload_length
+        out.insert(out.end(), payload.begin(), payload.end());
+    }
+    return out;
+}
+
+std::vector<unsigned char> iggy::testutil::StubIggyServer::encodePolledMessages(
+    const std::vector<iggy::model::message::Message>& messages) {
+    std::vector<unsigned char> out;
+    append<uint32_t>(out, 1);                                                 // partition_id
+    append<uint64_t>(out, messages.empty() ? 0 : messages.size() - 1);        // current_offset
+    append<uint32_t>(out, static_cast<uint32_t>(messages.size()));            // messages_count
+    for (size_t i = 0; i < messages.size(); i++) {
+        const auto& message = messages[i];
+        auto payload = message.getPayload();
+        uint32_t checksum = iggy::serialization::crc32::checksum(payload.data(), payload.size());
+        std::vector<unsigned char> headers;
+        for (const auto& [key, value] : message.getHeaders()) {
+            appendString(headers, std::string(key.getName()));
+            append<uint8_t>(headers, static_cast<uint8_t>(value.getKind()));
+            append<uint32_t>(headers, static_cast<uint32_t>(value.getValue().size()));
+            headers.insert(headers.end(), value.getValue().begin(), value.getValue().end());
+        }
+        append<uint64_t>(out, i);                                             // offset
+        append<uint8_t>(out, 1);                                              // state
+        append<uint64_t>(out, 1700000000000000 + i);                          // timestamp
+        append<uint64_t>(out, static_cast<uint64_t>(message.getId()));        // id, low half
+        append<uint64_t>(out, static_cast<uint64_t>(message.getId() >> 64));  // id, high half
+        append<uint32_t>(out, checksum);                                      // checksum
+        append<uint32_t>(out, static_cast<uint32_t>(headers.size()));         // headers_length
+        out.insert(out.end(), headers.begin(), headers.end());
+        append<uint32_t>(out, static_cast<uint32_t>(payload.size()));         // payload_length
+        out.insert(out.end(), payload.begin(), payload.end());
+    }
+    return out;
+}
+
+iggy::command::message::SendMessages iggy::testutil::makeBatch(std::vector<iggy::model::message::Message> messages) {
+    return iggy::command::message::SendMessages(iggy::model::shared::Identifier::numeric(1), iggy::model::shared::Identifier::numeric(1),
+                                                iggy::command::message::Partitioning(iggy::command::message::BALANCED, 0, {}),
+                                                std::move(messages));
+}
+
+iggy::model::message::PolledMessagesView iggy::testutil::pollBack(const iggy::command::message::SendMessages& command) {
+    auto payload = std::make_shared<const std::vector<unsigned char>>(StubIggyServer::encodePolledMessages(command.getMessages()));
+    return iggy::serialization::binary::BinaryWireFormat(true).read<iggy::model::message::PolledMessagesView>(payload);
+}
+
+namespace {
+/// @brief Length of the connection IDs the QUIC stub chooses for itself.
+const size_t STUB_CONNECTION_ID_LENGTH = 18;
+
+/// @brief Monotonic time in nanoseconds, the clock ngtcp2 timestamps are measured in.
+ngtcp2_tstamp stubTimestamp() {
+    return static_cast<ngtcp2_tstamp>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/// @brief Fills the buffer with random bytes; the stub has no need for cryptographic randomness in its IDs.
+void stubRandom(uint8_t* dest, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        dest[i] = static_cast<uint8_t>(std::rand());
+    }
+}
+}  // namespace
+
+/// @brief Socket, TLS context and connections of the QUIC stub, touched only by its own thread once it has started.
+struct iggy::testutil::StubQuicServer::State {
+    int fd = -1;
+    sockaddr_storage local = {};
+    socklen_t localLength = sizeof(local);
+    WOLFSSL_CTX* tlsContext = nullptr;
+    std::vector<std::unique_ptr<Session>> sessions;
+    std::atomic<uint32_t> handshakeCount = 0;
+    std::atomic<uint32_t> earlyRequestCount = 0;
+    std::atomic<bool> earlyDataAccepted = true;
+
+    ~State();
+};
+
+/// @brief One client connection to the QUIC stub along with the requests and responses on its streams.
+struct iggy::testutil::StubQuicServer::Session {
+    /// @brief A response being written back on the stream its request arrived on.
+    struct Reply {
+        std::vector<unsigned char> data;
+        size_t sent = 0;
+        bool finSent = false;
+    };
+
+    StubQuicServer* server = nullptr;
+    sockaddr_storage peer = {};
+    socklen_t peerLength = 0;
+    ngtcp2_path_storage path;
+    ngtcp2_conn* conn = nullptr;
+    WOLFSSL* ssl = nullptr;
+    ngtcp2_crypto_conn_ref connRef;
+    std::map<int64_t, std::vector<unsigned char>> requests;
+    std::map<int64_t, Reply> replies;
+
+    ~Session() {
+        if (this->conn) {
+            ngtcp2_conn_del(this->conn);
+        }
+        if (this->ssl) {
+            wolfSSL_free(this->ssl);
+        }
+    }
+
+    static ngtcp2_conn* getConn(ngtcp2_crypto_conn_ref* connRef) { return static_cast<Session*>(connRef->user_data)->conn; }
+
+    static void onRandom(uint8_t* dest, size_t length, const ngtcp2_rand_ctx* randCtx) { stubRandom(dest, length); }
+
+    static int onNewConnectionId(ngtcp2_conn* conn, ngtcp2_cid* cid, uint8_t* token, size_t cidLength, void* userData) {
+        stubRandom(cid->data, cidLength);
+        cid->datalen = cidLength;
+        stubRandom(token, NGTCP2_STATELESS_RESET_TOKENLEN);
+        return 0;
+    }
+
+    static int onHandshakeCompleted(ngtcp2_conn* conn, void* userData) {
+        static_cast<Session*>(userData)->server->state->handshakeCount++;
+        return 0;
+    }
+
+    static int onStreamData(ngtcp2_conn* conn,
+                            uint32_t flags,
+                            int64_t streamId,
+                            uint64_t offset,
+                            const uint8_t* data,
+                            size_t length,
+                            void* userData,
+                            void* streamUserData) {
+        auto self = static_cast<Session*>(userData);
+        auto& request = self->requests[streamId];
+        request.insert(request.end(), data, data + length);
+        ngtcp2_conn_extend_max_stream_offset(conn, streamId, length);
+        ngtcp2_conn_extend_max_offset(conn, length);
+        if ((flags & NGTCP2_STREAM_DATA_FLAG_FIN) == 0) {
+            return 0;
+        }
+
+        // the whole request has arrived; a malformed one is answered with an empty stream, which the client reports
+        if (!ngtcp2_conn_get_handshake_completed(conn)) {
+            self->server->state->earlyRequestCount++;
+        }
+        Reply reply;
+        if (request.size() >= 8 && readUint32(request.data()) == request.size() - 4) {
+            std::vector<unsigned char> payload(request.begin() + 8, request.end());
+            reply.data = self->server->respond(readUint32(request.data() + 4), payload);
+        }
+        self->requests.erase(streamId);
+        self->replies[streamId] = std::move(reply);
+        return 0;
+    }
+
+    static int onStreamClose(ngtcp2_conn* conn, uint32_t flags, int64_t streamId, uint64_t appErrorCode, void* userData,
+                             void* streamUserData) {
+        auto self = static_cast<Session*>(userData);
+        self->requests.erase(streamId);
+        self->replies.erase(streamId);
+        return 0;
+    }
+};
+
+iggy::testutil::StubQuicServer::State::~State() {
+    this->sessions.clear();
+    if (this->tlsContext) {
+        wolfSSL_CTX_free(this->tlsContext);
+    }
+    if (this->fd >= 0) {
+        ::close(this->fd);
+    }
+}
+
+iggy::testutil::StubQuicServer::StubQuicServer()
+    : state(std::make_unique<State>()) {
+    wolfSSL_Init();
+    this->state->tlsContext = wolfSSL_CTX_new(wolfTLSv1_3_server_method());
+    if (!this->state->tlsContext || ngtcp2_crypto_wolfssl_configure_server_context(this->state->tlsContext) != 0 ||
+        wolfSSL_CTX_use_certificate_file(this->state->tlsContext, this->getCertificatePath().c_str(), WOLFSSL_FILETYPE_PEM) !=
+            WOLFSSL_SUCCESS ||
+        wolfSSL_CTX_use_PrivateKey_file(this->state->tlsContext, this->getKeyPath().c_str(), WOLFSSL_FILETYPE_PEM) != WOLFSSL_SUCCESS) {
+        throw std::runtime_error("Failed to set up the QUIC stub server's TLS context");
+    }
+#ifdef WOLFSSL_EARLY_DATA
+    // QUIC requires the limit to be exactly this if early data is accepted at all; the transport enforces the real limits
+    wolfSSL_CTX_set_max_early_data(this->state->tlsContext, UINT32_MAX);
+#endif
+
+    // localhost may resolve to either loopback address, so listen dual-stack where IPv6 is available
+    this->state->fd = ::socket(AF_INET6, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    int rc;
+    if (this->state->fd >= 0) {
+        int v6Only = 0;
+        setsockopt(this->state->fd, IPPROTO_IPV6, IPV6_V6ONLY, &v6Only, sizeof(v6Only));
+        sockaddr_in6 addr = {};
+        addr.sin6_family = AF_INET6;
+        addr.sin6_addr = in6addr_any;
+        rc = ::bind(this->state->fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    } else {
+        this->state->fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        rc = this->state->fd < 0 ? -1 : ::bind(this->state->fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    }
+    if (rc < 0 || ::getsockname(this->state->fd, reinterpret_cast<sockaddr*>(&this->state->local), &this->state->localLength) < 0) {
+        throw std::runtime_error(fmt::format("Failed to start QUIC stub server: {}", std::strerror(errno)));
+    }
+    this->quicPort = this->state->local.ss_family == AF_INET6 ? ntohs(reinterpret_cast<sockaddr_in6*>(&this->state->local)->sin6_port)
+                                                              : ntohs(reinterpret_cast<sockaddr_in*>(&this->state->local)->sin_port);
+    this->quicThread = std::thread([this]() { this->quicLoop(); });
+}
+
+iggy::testutil::StubQuicServer::~StubQuicServer() {
+    this->quicRunning = false;
+    this->quicThread.join();
+}
+
+uint32_t iggy::testutil::StubQuicServer::getQuicConnectionCount() const {
+    return this->state->handshakeCount;
+}
+
+uint32_t iggy::testutil::StubQuicServer::getEarlyRequestCount() const {
+    return this->state->earlyRequestCount;
+}
+
+void iggy::testutil::StubQuicServer::setEarlyDataAccepted(bool accepted) {
+    this->state->earlyDataAccepted = accepted;
+}
+
+void iggy::testutil::StubQuicServer::quicLoop() {
+    std::vector<unsigned char> buffer(64 * 1024);
+    auto& sessions = this->state->sessions;
+    while (this->quicRunning) {
+        // wake up at least every 50ms to notice shutdown
+        ngtcp2_tstamp now = stubTimestamp();
+        ngtcp2_tstamp deadline = now + 50 * NGTCP2_MILLISECONDS;
+        for (auto& session : sessions) {
+            deadline = std::min(deadline, ngtcp2_conn_get_expiry(session->conn));
+        }
+        pollfd pfd = {this->state->fd, POLLIN, 0};
+        ::poll(&pfd, 1, deadline > now ? static_cast<int>((deadline - now + NGTCP2_MILLISECONDS - 1) / NGTCP2_MILLISECONDS) : 0);
+
+        for (;;) {
+            sockaddr_storage peer = {};
+            socklen_t peerLength = sizeof(peer);
+            ssize_t n = ::recvfrom(this->state->fd, buffer.data(), buffer.size(), 0, reinterpret_cast<sockaddr*>(&peer), &peerLength);
+            if (n < 0) {
+                break;
+            }
+            auto it = std::find_if(sessions.begin(), sessions.end(), [&](const std::unique_ptr<Session>& session) {
+                return session->peerLength == peerLength && std::memcmp(&session->peer, &peer, peerLength) == 0;
+            });
+            if (it == sessions.end()) {
+                ngtcp2_pkt_hd header;
+                if (ngtcp2_accept(&header, buffer.data(), static_cast<size_t>(n)) != 0) {
+                    continue;
+                }
+                auto session = std::make_unique<Session>();
+                session->server = this;
+                session->peer = peer;
+                session->peerLength = peerLength;
+                ngtcp2_path_storage_init(&session->path, reinterpret_cast<const sockaddr*>(&this->state->local), this->state->localLength,
+                                         reinterpret_cast<const sockaddr*>(&peer), peerLength, nullptr);
+
+                ngtcp2_callbacks callbacks = {};
+                callbacks.recv_client_initial = ngtcp2_crypto_recv_client_initial_cb;
+                callbacks.recv_crypto_data = ngtcp2_crypto_recv_crypto_data_cb;
+                callbacks.encrypt = ngtcp2_crypto_encrypt_cb;
+                callbacks.decrypt = ngtcp2_crypto_decrypt_cb;
+                callbacks.hp_mask = ngtcp2_crypto_hp_mask_cb;
+                callbacks.update_key = ngtcp2_crypto_update_key_cb;
+                callbacks.delete_crypto_aead_ctx = ngtcp2_crypto_delete_crypto_aead_ctx_cb;
+                callbacks.delete_crypto_cipher_ctx = ngtcp2_crypto_delete_crypto_cipher_ctx_cb;
+                callbacks.get_path_challenge_data = ngtcp2_crypto_get_path_challenge_data_cb;
+                callbacks.version_negotiation = ngtcp2_crypto_version_negotiation_cb;
+                callbacks.rand = Session::onRandom;
+                callbacks.get_new_connection_id = Session::onNewConnectionId;
+                callbacks.handshake_completed = Session::onHandshakeCompleted;
+                callbacks.recv_stream_data = Session::onStreamData;
+                callbacks.stream_close = Session::onStreamClose;
+
+                ngtcp2_settings settings;
+                ngtcp2_settings_default(&settings);
+                settings.initial_ts = stubTimestamp();
+
+                ngtcp2_transport_params params;
+                ngtcp2_transport_params_default(&params);
+                params.original_dcid = header.dcid;
+                params.original_dcid_present = 1;
+                params.initial_max_streams_bidi = 1000;
+                params.initial_max_stream_data_bidi_remote = 16 * 1024 * 1024;
+                params.initial_max_data = 64 * 1024 * 1024;
+                params.max_idle_timeout = 30 * NGTCP2_SECONDS;
+
+                ngtcp2_cid scid;
+                scid.datalen = STUB_CONNECTION_ID_LENGTH;
+                stubRandom(scid.data, scid.datalen);
+                if (ngtcp2_conn_server_new(&session->conn, &header.scid, &scid, &session->path.path, header.version, &callbacks, &settings,
+                                           &params, nullptr, session.get()) != 0) {
+                    session->conn = nullptr;
+                    continue;
+                }
+                session->ssl = wolfSSL_new(this->state->tlsContext);
+                session->connRef.get_conn = Session::getConn;
+                session->connRef.user_data = session.get();
+                wolfSSL_set_app_data(session->ssl, &session->connRef);
+                wolfSSL_set_accept_state(session->ssl);
+#ifdef WOLFSSL_EARLY_DATA
+                // the session tickets still allow early data, so clients attempt it and the handshake rejects it
+                wolfSSL_set_quic_early_data_enabled(session->ssl, this->state->earlyDataAccepted ? 1 : 0);
+#endif
+                ngtcp2_conn_set_tls_native_handle(session->conn, session->ssl);
+                sessions.push_back(std::move(session));
+                it = sessions.end() - 1;
+            }
+
+            ngtcp2_pkt_info info = {};
+            if (ngtcp2_conn_read_pkt((*it)->conn, &(*it)->path.path, &info, buffer.data(), static_cast<size_t>(n), stubTimestamp()) != 0) {
+                // closed by the client, or hopelessly broken; either way there is nobody left to answer
+                sessions.erase(it);
+            }
+        }
+
+        now = stubTimestamp();
+        for (auto it = sessions.begin(); it != sessions.end();) {
+            Session& session = **it;
+            bool alive = ngtcp2_conn_get_expiry(session.conn) > now || ngtcp2_conn_handle_expiry(session.conn, now) == 0;
+
+            // write every pending reply in full, or until flow control stops it, then whatever else ngtcp2 has queued
+            std::vector<int64_t> ids;
+            for (auto& [id, reply] : session.replies) {
+                if (!reply.finSent) {
+                    ids.push_back(id);
+                }
+            }
+            size_t next = 0;
+            while (alive) {
+                int64_t streamId = next < ids.size() ? ids[next] : -1;
+                Session::Reply* reply = streamId >= 0 ? &session.replies[streamId] : nullptr;
+                ngtcp2_vec vec = {};
+                uint32_t flags = NGTCP2_WRITE_STREAM_FLAG_MORE;
+                if (reply) {
+                    vec.base = reply->data.data() + reply->sent;
+                    vec.len = reply->data.size() - reply->sent;
+                    flags |= NGTCP2_WRITE_STREAM_FLAG_FIN;
+                }
+                ngtcp2_ssize written = -1;
+                ngtcp2_pkt_info info = {};
+                ngtcp2_ssize n = ngtcp2_conn_writev_stream(session.conn, nullptr, &info, buffer.data(), buffer.size(), &written, flags,
+                                                           streamId, reply ? &vec : nullptr, reply ? 1 : 0, now);
+                if (reply && written >= 0) {
+                    reply->sent += static_cast<size_t>(written);
+                    reply->finSent = reply->sent == reply->data.size();
+                    if (reply->finSent) {
+                        next++;
+                    }
+                }
+                if (n == NGTCP2_ERR_WRITE_MORE) {
+                    continue;
+                }
+                if (n == NGTCP2_ERR_STREAM_DATA_BLOCKED || n == NGTCP2_ERR_STREAM_SHUT_WR) {
+                    next++;
+                    continue;
+                }
+                if (n < 0) {
+                    alive = false;
+                } else if (n == 0) {
+                    break;
+                } else {
+                    ::sendto(this->state->fd, buffer.data(), static_cast<size_t>(n), 0, reinterpret_cast<const sockaddr*>(&session.peer),
+                             session.peerLength);
+                }
+            }
+            it = alive ? it + 1 : sessions.erase(it);
+        }
+    }
+}
+
+/// @brief TLS context and client connections of the TLS stub.
+struct iggy::testutil::StubTlsServer::State {
+    WOLFSSL_CTX* tlsContext = nullptr;
+    std::mutex mutex;
+    std::vector<int> clientFds;
+    std::vector<std::thread> clientThreads;
+
+    ~State() {
+        if (this->tlsContext) {
+            wolfSSL_CTX_free(this->tlsContext);
+        }
+    }
+};
+
+iggy::testutil::StubTlsServer::StubTlsServer()
+    : state(std::make_unique<State>()) {
+    wolfSSL_Init();
+    this->state->tlsContext = wolfSSL_CTX_new(wolfTLSv1_3_server_method());
+    if (!this->state->tlsContext ||
+        wolfSSL_CTX_use_certificate_file(this->state->tlsContext, this->getCertificatePath().c_str(), WOLFSSL_FILETYPE_PEM) !=
+            WOLFSSL_SUCCESS ||
+        wolfSSL_CTX_use_PrivateKey_file(this->state->tlsContext, this->getKeyPath().c_str(), WOLFSSL_FILETYPE_PEM) != WOLFSSL_SUCCESS) {
+        throw std::runtime_error("Failed to set up the TLS stub server's TLS context");
+    }
+    this->tlsListenFd = listenOnLoopback(this->tlsPort);
+    this->tlsAcceptThread = std::thread([this]() { this->tlsAcceptLoop(); });
+}
+
+iggy::testutil::StubTlsServer::~StubTlsServer() {
+    ::shutdown(this->tlsListenFd, SHUT_RDWR);
+    this->tlsAcceptThread.join();
+    ::close(this->tlsListenFd);
+
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lock(this->state->mutex);
+        for (int fd : this->state->clientFds) {
+            ::shutdown(fd, SHUT_RDWR);
+        }
+        threads.swap(this->state->clientThreads);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (int fd : this->state->clientFds) {
+        ::close(fd);
+    }
+}
+
+void iggy::testutil::StubTlsServer::tlsAcceptLoop() {
+    while (true) {
+        int fd = ::accept(this->tlsListenFd, nullptr, nullptr);
+        if (fd < 0) {
+            return;
+        }
+        int noDelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        std::lock_guard<std::mutex> lock(this->state->mutex);
+        this->state->clientFds.push_back(fd);
+        this->state->clientThreads.emplace_back([this, fd]() { this->serveTls(fd); });
+    }
+}
+
+void iggy::testutil::StubTlsServer::serveTls(int fd) {
+    WOLFSSL* ssl = wolfSSL_new(this->state->tlsContext);
+    if (!ssl) {
+        return;
+    }
+    wolfSSL_set_fd(ssl, fd);
+    if (wolfSSL_accept(ssl) == WOLFSSL_SUCCESS) {
+        if (wolfSSL_session_reused(ssl) == 1) {
+            this->resumedSessionCount++;
+        }
+        this->serveFrames(
+            [ssl](unsigned char* data, size_t length) {
+                size_t offset = 0;
+                while (offset < length) {
+                    int n = wolfSSL_read(ssl, data + offset, static_cast<int>(length - offset));
+                    if (n <= 0) {
+                        return false;
+                    }
+                    offset += static_cast<size_t>(n);
+                }
+                return true;
+            },
+            [ssl](const unsigned char* data, size_t length) {
+                return wolfSSL_write(ssl, data, static_cast<int>(length)) == static_cast<int>(length);
+            });
+    }
+    wolfSSL_free(ssl);
+}
+
+iggy::testutil::StubHttpServer::StubHttpServer() {
+    this->handlers["POST /users/login"] = [](const Request&) {
+        return std::make_pair(200, fmt::format(R"({{"user_id":1,"access_token":{{"token":"{}","expiry":1700000000}}}})", ACCESS_TOKEN));
+    };
+    this->handlers["GET /ping"] = [](const Request&) { return std::make_pair(200, std::string("pong")); };
+
+    this->listenFd = listenOnLoopback(this->port);
+    this->acceptThread = std::thread([this]() { this->acceptLoop(); });
+}
+
+iggy::testutil::StubHttpServer::~StubHttpServer() {
+    this->running = false;
+    ::shutdown(this->listenFd, SHUT_RDWR);
+    this->acceptThread.join();
+    ::close(this->listenFd);
+
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        for (int fd : this->clientFds) {
+            ::shutdown(fd, SHUT_RDWR);
+        }
+        threads.swap(this->clientThreads);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (int fd : this->clientFds) {
+        ::close(fd);
+    }
+}
+
+void iggy::testutil::StubHttpServer::setHandler(const std::string& method, const std::string& path, Handler handler) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->handlers[method + " " + path] = handler;
+}
+
+void iggy::testutil::StubHttpServer::acceptLoop() {
+    while (this->running) {
+        int fd = ::accept(this->listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            return;
+        }
+        int noDelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->clientFds.push_back(fd);
+        this->clientThreads.emplace_back([this, fd]() { this->serve(fd); });
+    }
+}
+
+void iggy::testutil::StubHttpServer::serve(int fd) {
+    // read until the bytes so far either complete the HTTP/2 preface or cannot start it; either way they are handed on
+    std::string received;
+    char chunk[NGHTTP2_CLIENT_MAGIC_LEN];
+    while (received.size() < NGHTTP2_CLIENT_MAGIC_LEN && received.compare(0, received.size(), NGHTTP2_CLIENT_MAGIC, received.size()) == 0) {
+        ssize_t n = ::recv(fd, chunk, NGHTTP2_CLIENT_MAGIC_LEN - received.size(), 0);
+        if (n <= 0) {
+            return;
+        }
+        received.append(chunk, static_cast<size_t>(n));
+    }
+    if (received == NGHTTP2_CLIENT_MAGIC) {
+        this->http2ConnectionCount++;
+        this->serveHttp2(fd, received);
+    } else {
+        this->serveHttp1(fd, received);
+    }
+}
+
+void iggy::testutil::StubHttpServer::serveHttp1(int fd, std::string buffer) {
+    char chunk[16 * 1024];
+    while (true) {
+        size_t headerEnd;
+        while ((headerEnd = buffer.find("\r\n\r\n")) == std::string::npos) {
+            ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+            if (n <= 0) {
+                return;
+            }
+            buffer.append(chunk, static_cast<size_t>(n));
+        }
+
+        Request request;
+        size_t lineEnd = buffer.find("\r\n");
+        std::string requestLine = buffer.substr(0, lineEnd);
+        size_t methodEnd = requestLine.find(' ');
+        size_t pathEnd = requestLine.find(' ', methodEnd + 1);
+        request.method = requestLine.substr(0, methodEnd);
+        request.path = requestLine.substr(methodEnd + 1, pathEnd - methodEnd - 1);
+        size_t contentLength = 0;
+        for (size_t at = lineEnd + 2; at < headerEnd;) {
+            size_t end = buffer.find("\r\n", at);
+            std::string line = buffer.substr(at, end - at);
+            at = end + 2;
+            size_t colon = line.find(':');
+            if (colon == std::string::npos) {
+                continue;
+            }
+            std::string name = line.substr(0, colon);
+            std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+            std::string value = line.substr(line.find_first_not_of(' ', colon + 1));
+            if (name == "content-length") {
+                contentLength = std::stoul(value);
+            } else if (name == "authorization") {
+                request.authorization = value;
+            }
+        }
+
+        size_t requestEnd = headerEnd + 4 + contentLength;
+        while (buffer.size() < requestEnd) {
+            ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+            if (n <= 0) {
+                return;
+            }
+            buffer.append(chunk, static_cast<size_t>(n));
+        }
+        request.body = buffer.substr(headerEnd + 4, contentLength);
+        buffer.erase(0, requestEnd);
+
+        auto [status, body] = this->respond(request);
+        auto response = fmt::format("HTTP/1.1 {} {}\r\nContent-Type: application/json\r\nContent-Length: {}\r\n\r\n{}", status,
+                                    status < 300 ? "OK" : "Error", body.size(), body);
+        if (!writeFully(fd, reinterpret_cast<const unsigned char*>(response.data()), response.size())) {
+            return;
+        }
+    }
+}
+
+/// @brief One HTTP/2 connection to the stub along with the requests and responses on its streams.
+struct iggy::testutil::StubHttpServer::Http2Session {
+    /// @brief A response body being sent on the stream its request arrived on.
+    struct Reply {
+        std::string body;
+        size_t sent = 0;
+    };
+
+    StubHttpServer* server = nullptr;
+    nghttp2_session* session = nullptr;
+    std::map<int32_t, Request> requests;
+    std::map<int32_t, Reply> replies;
+
+    ~Http2Session() {
+        if (this->session) {
+            nghttp2_session_del(this->session);
+        }
+    }
+};
+
+void iggy::testutil::StubHttpServer::serveHttp2(int fd, const std::string& preface) {
+    Http2Session h2;
+    h2.server = this;
+
+    nghttp2_session_callbacks* callbacks;
+    nghttp2_session_callbacks_new(&callbacks);
+    nghttp2_session_callbacks_set_on_begin_headers_callback(callbacks, [](nghttp2_session*, const nghttp2_frame* frame, void* userData) {
+        auto h2 = static_cast<Http2Session*>(userData);
+        if (frame->hd.type == NGHTTP2_HEADERS && frame->headers.cat == NGHTTP2_HCAT_REQUEST) {
+            h2->requests[frame->hd.stream_id];
+            uint32_t open = static_cast<uint32_t>(h2->requests.size());
+            uint32_t seen = h2->server->maxConcurrentStreams;
+            while (open > seen && !h2->server->maxConcurrentStreams.compare_exchange_weak(seen, open)) {
+            }
+        }
+        return 0;
+    });
+    nghttp2_session_callbacks_set_on_header_callback(
+        callbacks, [](nghttp2_session*, const nghttp2_frame* frame, const uint8_t* name, size_t nameLength, const uint8_t* value,
+                      size_t valueLength, uint8_t, void* userData) {
+            auto h2 = static_cast<Http2Session*>(userData);
+            auto it = h2->requests.find(frame->hd.stream_id);
+            if (it == h2->requests.end()) {
+                return 0;
+            }
+            std::string headerName(reinterpret_cast<const char*>(name), nameLength);
+            std::string headerValue(reinterpret_cast<const char*>(value), valueLength);
+            if (headerName == ":method") {
+                it->second.method = headerValue;
+            } else if (headerName == ":path") {
+                it->second.path = headerValue;
+            } else if (headerName == "authorization") {
+                it->second.authorization = headerValue;
+            }
+            return 0;
+        });
+    nghttp2_session_callbacks_set_on_data_chunk_recv_callback(
+        callbacks, [](nghttp2_session*, uint8_t, int32_t streamId, const uint8_t* data, size_t length, void* userData) {
+            auto h2 = static_cast<Http2Session*>(userData);
+            auto it = h2->requests.find(streamId);
+            if (it != h2->requests.end()) {
+                it->second.body.append(reinterpret_cast<const char*>(data), length);
+            }
+            return 0;
+        });
+    nghttp2_session_callbacks_set_on_frame_recv_callback(callbacks, [](nghttp2_session* session, const nghttp2_frame* frame,
+                                                                       void* userData) {
+        auto h2 = static_cast<Http2Session*>(userData);
+        bool isRequestFrame = frame->hd.type == NGHTTP2_HEADERS || frame->hd.type == NGHTTP2_DATA;
+        bool requestComplete = isRequestFrame && (frame->hd.flags & NGHTTP2_FLAG_END_STREAM);
+        auto it = h2->requests.find(frame->hd.stream_id);
+        if (!requestComplete || it == h2->requests.end()) {
+            return 0;
+        }
+        auto [status, body] = h2->server->respond(it->second);
+        auto& reply = h2->replies[frame->hd.stream_id];
+        reply.body = std::move(body);
+
+        std::string statusText = std::to_string(status);
+        std::string contentType = "application/json";
+        nghttp2_nv headers[] = {
+            {reinterpret_cast<uint8_t*>(const_cast<char*>(":status")), reinterpret_cast<uint8_t*>(statusText.data()), 7,
+             statusText.size(), NGHTTP2_NV_FLAG_NONE},
+            {reinterpret_cast<uint8_t*>(const_cast<char*>("content-type")), reinterpret_cast<uint8_t*>(contentType.data()), 12,
+             contentType.size(), NGHTTP2_NV_FLAG_NONE}};
+        nghttp2_data_provider provider;
+        provider.source.ptr = &reply;
+        provider.read_callback = [](nghttp2_session*, int32_t, uint8_t* buf, size_t length, uint32_t* dataFlags,
+                                    nghttp2_data_source* source, void*) -> ssize_t {
+            auto reply = static_cast<Http2Session::Reply*>(source->ptr);
+            size_t count = std::min(length, reply->body.size() - reply->sent);
+            std::memcpy(buf, reply->body.data() + reply->sent, count);
+            reply->sent += count;
+            if (reply->sent == reply->body.size()) {
+                *dataFlags |= NGHTTP2_DATA_FLAG_EOF;
+            }
+            return static_cast<ssize_t>(count);
+        };
+        return nghttp2_submit_response(session, frame->hd.stream_id, headers, 2, &provider);
+    });
+    nghttp2_session_callbacks_set_on_stream_close_callback(callbacks, [](nghttp2_session*, int32_t streamId, uint32_t, void* userData) {
+        auto h2 = static_cast<Http2Session*>(userData);
+        h2->requests.erase(streamId);
+        h2->replies.erase(streamId);
+        return 0;
+    });
+    nghttp2_session_server_new(&h2.session, callbacks, &h2);
+    nghttp2_session_callbacks_del(callbacks);
+
+    nghttp2_settings_entry settings[] = {{NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS, 100}};
+    nghttp2_submit_settings(h2.session, NGHTTP2_FLAG_NONE, settings, 1);
+    if (nghttp2_session_mem_recv(h2.session, reinterpret_cast<const uint8_t*>(preface.data()), preface.size()) < 0) {
+        return;
+    }
+    std::vector<uint8_t> buffer(16 * 1024);
+    while (true) {
+        // send everything queued, including the responses to every request in the last read, before reading again
+        const uint8_t* data;
+        ssize_t n;
+        while ((n = nghttp2_session_mem_send(h2.session, &data)) > 0) {
+            if (!writeFully(fd, data, static_cast<size_t>(n))) {
+                return;
+            }
+        }
+        if (n < 0 || (!nghttp2_session_want_read(h2.session) && !nghttp2_session_want_write(h2.session))) {
+            return;
+        }
+        ssize_t received = ::recv(fd, buffer.data(), buffer.size(), 0);
+        if (received <= 0 || nghttp2_session_mem_recv(h2.session, buffer.data(), static_cast<size_t>(received)) < 0) {
+            return;
+        }
+    }
+}
+
+std::pair<int, std::string> iggy::testutil::StubHttpServer::respond(const Request& request) {
+    this->requestCount++;
+    Handler handler;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->lastAuthorization = request.authorization;
+        auto it = this->handlers.find(request.method + " " + request.path.substr(0, request.path.find('?')));
+        if (it != this->handlers.end()) {
+            handler = it->second;
+        }
+    }
+    return handler ? handler(request) : std::make_pair(404, std::string());
+}
@@ -1,10 +1,22 @@
 #pragma once
 
 #include <catch.hpp>
+#include <atomic>
+#include <cstdint>
 #include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "../sdk/command.h"
+#include "../sdk/model.h"
 
 const char UT_TAG[] = "[Unit Tests]";
+const char BENCH_TAG[] = "[Benchmarks]";
 
 namespace iggy {
 namespace testutil {
@@ -24,5 +36,302 @@ public:
     std::filesystem::path getCertificatePath() { return this->certificatePath; }
     std::filesystem::path getKeyPath() { return this->keyPath; }
 };
+
+/**
+ * @brief A minimal in-process stand-in for the Iggy server speaking the binary protocol over loopback TCP.
+ *
+ * It listens on an ephemeral port, answers LOGIN_USER, PING and GET_STATS with canned responses by default and lets tests
+ * override the handler for any command code. Each accepted connection is served on its own thread.
+ */
+class StubIggyServer {
+public:
+    /**
+     * @brief Handler for a single command: takes the request payload and returns the status and response payload.
+     */
+    using Handler = std::function<std::pair<uint32_t, std::vector<unsigned char>>(const std::vector<unsigned char>&)>;
+
+private:
+    int listenFd = -1;
+    uint16_t port = 0;
+    std::atomic<bool> running = true;
+    std::atomic<uint32_t> requestCount = 0;
+    std::atomic<uint32_t> pipelinedRequestCount = 0;
+    std::thread acceptThread;
+    std::mutex mutex;
+    std::map<uint32_t, Handler> handlers;
+    std::map<uint32_t, uint32_t> announcedLengths;
+    std::vector<int> clientFds;
+    std::vector<std::thread> clientThreads;
+
+    void acceptLoop();
+    void serve(int fd);
+
+protected:
+    /**
+     * @brief Runs the handler for one request and encodes the response frame, status and length header included.
+     */
+    std::vector<unsigned char> respond(uint32_t command, const std::vector<unsigned char>& payload);
+
+    /**
+     * @brief Answers request frames in order until a read or write fails; both return false once the peer has gone.
+     */
+    void serveFrames(const std::function<bool(unsigned char*, size_t)>& read,
+                     const std::function<bool(const unsigned char*, size_t)>& write);
+
+public:
+    StubIggyServer();
+    ~StubIggyServer();
+
+    /**
+     * @brief Gets the ephemeral port the server is listening on.
+     */
+    uint16_t getPort() const { return this->port; }
+
+    /**
+     * @brief Gets the total number of requests received across all connections.
+     */
+    uint32_t getRequestCount() const { return this->requestCount; }
+
+    /**
+     * @brief Gets the number of connections accepted so far.
+     */
+    size_t getConnectionCount() {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->clientFds.size();
+    }
+
+    /**
+     * @brief Gets the number of requests that arrived while the next request was already waiting in the socket.
+     *
+     * A client in strict request/response lock-step never causes this to be non-zero.
+     */
+    uint32_t getPipelinedRequestCount() const { return this->pipelinedRequestCount; }
+
+    /**
+     * @brief Replaces the handler for the given command code.
+     */
+    void setHandler(uint32_t command, Handler handler);
+
+    /**
+     * @brief Makes responses to the given command code announce a payload of the given length in their frame header,
+     * whatever payload follows, as a corrupt or hostile server would.
+     */
+    void setAnnouncedLength(uint32_t command, uint32_t length);
+
+    /**
+     * @brief Abruptly closes every accepted connection, as if the server had crashed.
+     */
+    void disconnectAll();
+
+    /**
+     * @brief Encodes the canned server statistics returned for GET_STATS.
+     */
+    static std::vector<unsigned char> encodeStats();
+
+    /**
+     * @brief Encodes a POLL_MESSAGES response for partition 1 with the given number of messages.
+     *
+     * Message i has offset i, id i + 1, a single STRING header "source" = "stub" and a payload of payloadSize bytes all
+     * equal to i modulo 256, with the payload's CRC-32 as its checksum.
+     */
+    static std::vector<unsigned char> encodePolledMessages(uint32_t count, size_t payloadSize);
+
+    /**
+     * @brief Encodes a POLL_MESSAGES response for partition 1 carrying the given messages, e.g. ones that were sent.
+     *
+     * Message i has offset i and keeps its id, headers and payload, with the payload's CRC-32 as its checksum.
+     */
+    static std::vector<unsigned char> encodePolledMessages(const std::vector<iggy::model::message::Message>& messages);
+};
+
+/**
+ * @brief Builds a batch sent to stream 1, topic 1 with balanced partitioning.
+ */
+iggy::command::message::SendMessages makeBatch(std::vector<iggy::model::message::Message> messages);
+
+/**
+ * @brief Polls back a batch as the server would return it after storing it; see @ref StubIggyServer::encodePolledMessages.
+ */
+iggy::model::message::PolledMessagesView pollBack(const iggy::command::message::SendMessages& command);
+
+/**
+ * @brief The stub server's handlers served over QUIC as well, on a loopback UDP port of its own.
+ *
+ * Like the real server it reads one request frame per client-initiated bidirectional stream, up to the stream's FIN, and
+ * answers on the same stream. All QUIC connections are served from a single thread with ngtcp2 and a self-signed
+ * certificate for localhost, which clients trust through @ref getCertificatePath.
+ */
+class StubQuicServer : public StubIggyServer, public SelfSignedCertificate {
+private:
+    struct Session;
+    struct State;
+    std::unique_ptr<State> state;
+    uint16_t quicPort = 0;
+    std::atomic<bool> quicRunning = true;
+    std::thread quicThread;
+
+    void quicLoop();
+
+public:
+    StubQuicServer();
+    ~StubQuicServer();
+
+    /**
+     * @brief Gets the ephemeral UDP port QUIC clients connect to.
+     */
+    uint16_t getQuicPort() const { return this->quicPort; }
+
+    /**
+     * @brief Gets the number of QUIC connections whose handshake has completed.
+     */
+    uint32_t getQuicConnectionCount() const;
+
+    /**
+     * @brief Gets the number of requests that arrived in full as 0-RTT early data, before their connection's handshake
+     * completed.
+     */
+    uint32_t getEarlyRequestCount() const;
+
+    /**
+     * @brief Sets whether new connections accept 0-RTT early data; when they do not, clients resuming a session have their
+     * early data rejected and must send it again once the handshake completes. Accepted by default.
+     */
+    void setEarlyDataAccepted(bool accepted);
+};
+
+/**
+ * @brief The stub server's handlers served over TLS as well, on a loopback TCP port of its own.
+ *
+ * Each connection runs a wolfSSL server session over a blocking socket on its own thread, with a self-signed certificate
+ * for localhost that clients trust through @ref getCertificatePath. Session tickets are issued, so clients that keep their
+ * session cache resume on their next connection.
+ */
+class StubTlsServer : public StubIggyServer, public SelfSignedCertificate {
+private:
+    struct State;
+    std::unique_ptr<State> state;
+    int tlsListenFd = -1;
+    uint16_t tlsPort = 0;
+    std::atomic<uint32_t> resumedSessionCount = 0;
+    std::thread tlsAcceptThread;
+
+    void tlsAcceptLoop();
+    void serveTls(int fd);
+
+public:
+    StubTlsServer();
+    ~StubTlsServer();
+
+    /**
+     * @brief Gets the ephemeral port TLS clients connect to.
+     */
+    uint16_t getTlsPort() const { return this->tlsPort; }
+
+    /**
+     * @brief Gets the number of TLS handshakes that resumed a session instead of running a full key exchange.
+     */
+    uint32_t getResumedSessionCount() const { return this->resumedSessionCount; }
+};
+
+/**
+ * @brief A minimal in-process stand-in for the Iggy server's HTTP REST API over loopback TCP.
+ *
+ * Connections speak either HTTP/1.1 with keep-alive or cleartext HTTP/2 with prior knowledge, told apart by the HTTP/2
+ * connection preface. It answers POST /users/login with a fixed access token and GET /ping by default and lets tests
+ * override the handler for any route. Each accepted connection is served on its own thread.
+ */
+class StubHttpServer {
+public:
+    /**
+     * @brief The parts of a request the handlers get to see.
+     */
+    struct Request {
+        std::string method;
+        std::string path;
+        std::string authorization;
+        std::string body;
+    };
+
+    /**
+     * @brief Handler for a single route: takes the request and returns the HTTP status and response body.
+     */
+    using Handler = std::function<std::pair<int, std::string>(const Request&)>;
+
+    /**
+     * @brief The access token returned by the default login handler.
+     */
+    static constexpr const char* ACCESS_TOKEN = "stub-token";
+
+private:
+    struct Http2Session;
+
+    int listenFd = -1;
+    uint16_t port = 0;
+    std::atomic<bool> running = true;
+    std::atomic<uint32_t> requestCount = 0;
+    std::atomic<uint32_t> http2ConnectionCount = 0;
+    std::atomic<uint32_t> maxConcurrentStreams = 0;
+    std::thread acceptThread;
+    std::mutex mutex;
+    std::map<std::string, Handler> handlers;
+    std::string lastAuthorization;
+    std::vector<int> clientFds;
+    std::vector<std::thread> clientThreads;
+
+    void acceptLoop();
+    void serve(int fd);
+    void serveHttp1(int fd, std::string buffer);
+    void serveHttp2(int fd, const std::string& preface);
+
+    /**
+     * @brief Runs the handler for the request's method and path, ignoring any query string; unknown routes get a 404.
+     */
+    std::pair<int, std::string> respond(const Request& request);
+
+public:
+    StubHttpServer();
+    ~StubHttpServer();
+
+    /**
+     * @brief Gets the ephemeral port the server is listening on.
+     */
+    uint16_t getPort() const { return this->port; }
+
+    /**
+     * @brief Gets the total number of requests received across all connections.
+     */
+    uint32_t getRequestCount() const { return this->requestCount; }
+
+    /**
+     * @brief Gets the number of connections accepted so far, whichever HTTP version they speak.
+     */
+    size_t getConnectionCount() {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->clientFds.size();
+    }
+
+    /**
+     * @brief Gets the number of accepted connections that speak HTTP/2.
+     */
+    uint32_t getHttp2ConnectionCount() const { return this->http2ConnectionCount; }
+
+    /**
+     * @brief Gets the most HTTP/2 streams that were open at once on any one connection.
+     */
+    uint32_t getMaxConcurrentStreams() const { return this->maxConcurrentStreams; }
+
+    /**
+     * @brief Gets the Authorization header of the latest request, empty if it had none.
+     */
+    std::string getLastAuthorization() {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->lastAuthorization;
+    }
+
+    /**
+     * @brief Replaces the handler for the given method and path.
+     */
+    void setHandler(const std::string& method, const std::string& path, Handler handler);
+};
 }  // namespace testutil
 }  // namespace iggy
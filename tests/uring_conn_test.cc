@@ -0,0 +1,101 @@
+#if defined(IGGY_HAVE_IO_URING)
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+#include "../sdk/net/tcp/uring.h"
+#include "unit_testutils.h"
+
+TEST_CASE_METHOD(iggy::testutil::StubIggyServer, "io_uring TCP connection", UT_TAG) {
+    iggy::net::tcp::UringConnection conn("127.0.0.1", getPort());
+    conn.connect();
+
+    SECTION("single round trip") {
+        auto response = conn.send(iggy::serialization::binary::PING, {}).get();
+        REQUIRE(response.isOk());
+        REQUIRE(response.getPayload().empty());
+    }
+
+    SECTION("large request bypasses the registered buffer") {
+        setHandler(iggy::serialization::binary::GET_CLIENT,
+                   [](const std::vector<unsigned char>& payload) { return std::make_pair(0u, std::vector<unsigned char>{payload.back()}); });
+        std::vector<unsigned char> payload(1024 * 1024, 0x11);
+        payload.back() = 0x22;
+        auto response = conn.send(iggy::serialization::binary::GET_CLIENT, payload).get();
+        REQUIRE(response.getPayload() == std::vector<unsigned char>{0x22});
+    }
+
+    SECTION("large response spans many provided buffers") {
+        setHandler(iggy::serialization::binary::GET_STREAMS, [](const std::vector<unsigned char>&) {
+            return std::make_pair(0u, std::vector<unsigned char>(4 * 1024 * 1024, 0x5a));
+        });
+        auto response = conn.send(iggy::serialization::binary::GET_STREAMS, {}).get();
+        REQUIRE(response.getPayload().size() == 4 * 1024 * 1024);
+        REQUIRE(response.getPayload().back() == 0x5a);
+    }
+
+    SECTION("queued requests from multiple caller threads") {
+        std::vector<std::thread> callers;
+        for (int i = 0; i < 4; i++) {
+            callers.emplace_back([&conn]() {
+                std::vector<std::future<iggy::net::conn::Response>> futures;
+                for (int j = 0; j < 50; j++) {
+                    futures.push_back(conn.send(iggy::serialization::binary::PING, {}));
+                }
+                for (auto& future : futures) {
+                    REQUIRE(future.get().isOk());
+                }
+            });
+        }
+        for (auto& caller : callers) {
+            caller.join();
+        }
+        REQUIRE(getRequestCount() == 200);
+    }
+
+    SECTION("gathered payload with more segments than IOV_MAX") {
+        setHandler(iggy::serialization::binary::SEND_MESSAGES, [](const std::vector<unsigned char>& payload) {
+            return std::make_pair(0u, std::vector<unsigned char>{payload.front(), payload.back()});
+        });
+        std::vector<unsigned char> chunk(iggy::serialization::binary::GatherBuffer::REFERENCE_THRESHOLD, 0x33);
+        iggy::serialization::binary::GatherBuffer payload;
+        unsigned char first = 0x11;
+        payload.append(&first, 1);
+        for (int i = 0; i < 2048; i++) {
+            payload.appendReference(chunk.data(), chunk.size());
+        }
+        REQUIRE(payload.segmentCount() == 2049);
+        auto response = conn.sendGathered(iggy::serialization::binary::SEND_MESSAGES, std::move(payload)).get();
+        REQUIRE(response.getPayload() == std::vector<unsigned char>{0x11, 0x33});
+    }
+
+    SECTION("oversized response length fails the connection") {
+        setAnnouncedLength(iggy::serialization::binary::GET_STREAMS, iggy::net::tcp::MAX_RESPONSE_SIZE + 1);
+        auto response = conn.send(iggy::serialization::binary::GET_STREAMS, {});
+        REQUIRE(response.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+        REQUIRE_THROWS_AS(response.get(), std::runtime_error);
+    }
+
+    SECTION("send after close") {
+        conn.close();
+        REQUIRE_THROWS_AS(conn.send(iggy::serialization::binary::PING, {}), std::runtime_error);
+    }
+}
+
+TEST_CASE("io_uring TCP connection failures", UT_TAG) {
+    SECTION("server drops the connection") {
+        iggy::testutil::StubIggyServer server;
+        iggy::net::tcp::UringConnection conn("127.0.0.1", server.getPort());
+        conn.connect();
+        REQUIRE(conn.send(iggy::serialization::binary::PING, {}).get().isOk());
+
+        server.disconnectAll();
+        REQUIRE_THROWS_AS(conn.send(iggy::serialization::binary::PING, {}).get(), std::runtime_error);
+    }
+
+    SECTION("unresolvable host") {
+        iggy::net::tcp::UringConnection conn("iggy.invalid", 8090);
+        REQUIRE_THROWS_AS(conn.connect(), std::runtime_error);
+    }
+}
+#endif  // IGGY_HAVE_IO_URING